@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <err.h>
+
+#include <tskit.h>
+
+#define check_tsk_error(val)                                                            \
+    if (val < 0) {                                                                      \
+        errx(EXIT_FAILURE, "line %d: %s", __LINE__, tsk_strerror(val));                 \
+    }
+
+/* Iterate over all trees forwards and then backwards, returning the elapsed
+ * CPU time in seconds. */
+static double
+time_iteration(tsk_treeseq_t *ts, tsk_flags_t options, tsk_size_t num_passes)
+{
+    int ret;
+    tsk_size_t j;
+    tsk_tree_t tree;
+    clock_t start;
+
+    ret = tsk_tree_init(&tree, ts, options);
+    check_tsk_error(ret);
+    start = clock();
+    for (j = 0; j < num_passes; j++) {
+        for (ret = tsk_tree_first(&tree); ret == TSK_TREE_OK;
+             ret = tsk_tree_next(&tree)) {
+        }
+        check_tsk_error(ret);
+        for (ret = tsk_tree_last(&tree); ret == TSK_TREE_OK;
+             ret = tsk_tree_prev(&tree)) {
+        }
+        check_tsk_error(ret);
+    }
+    tsk_tree_free(&tree);
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+    tsk_size_t j, num_passes;
+    tsk_treeseq_t ts;
+    double t_arrays, t_links, num_transitions;
+    const char *names[] = { "sample counts", "no sample counts" };
+    tsk_flags_t options[] = { 0, TSK_NO_SAMPLE_COUNTS };
+
+    if (argc != 3) {
+        errx(EXIT_FAILURE, "usage: <tree sequence file> <num passes>");
+    }
+    ret = tsk_treeseq_load(&ts, argv[1], 0);
+    check_tsk_error(ret);
+    num_passes = (tsk_size_t) atoi(argv[2]);
+
+    /* Each pass inserts and removes every edge twice */
+    num_transitions = 4.0 * (double) tsk_treeseq_get_num_edges(&ts) * num_passes;
+    printf("%lld nodes, %lld edges, %lld trees\n",
+        (long long) tsk_treeseq_get_num_nodes(&ts),
+        (long long) tsk_treeseq_get_num_edges(&ts),
+        (long long) tsk_treeseq_get_num_trees(&ts));
+    for (j = 0; j < sizeof(options) / sizeof(*options); j++) {
+        t_arrays = time_iteration(&ts, options[j], num_passes);
+        t_links = time_iteration(&ts, options[j] | TSK_INTERLEAVED_LINKS, num_passes);
+        printf("%s:\n", names[j]);
+        printf("\tarrays: %.3fs (%.3g edge transitions/s)\n", t_arrays,
+            num_transitions / t_arrays);
+        printf("\tinterleaved links: %.3fs (%.3g edge transitions/s)\n", t_links,
+            num_transitions / t_links);
+    }
+
+    tsk_treeseq_free(&ts);
+    return 0;
+}
@@ -1,3 +1,8 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+/* Needed for fileno, fstat and mmap */
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -5,6 +10,22 @@
 #include <errno.h>
 #include <stdbool.h>
 
+#if !defined(_WIN32)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#endif
+
+/* The crc32 instruction is compiled for x86-64 with GCC and clang and used
+ * when the CPU supports SSE4.2, which is checked at runtime. */
+#if defined(__x86_64__) && defined(__GNUC__)
+#define KAS_HAVE_HW_CRC32C 1
+#include <nmmintrin.h>
+#endif
+
 #include "kastore.h"
 
 /* Private flag used to indicate when we have opened the file ourselves
@@ -13,6 +34,16 @@
  * and this is the highest bit that can be guaranteed to fit into
  * an int. */
 #define OWN_FILE (1 << 14)
+/* Private flag used to indicate that array data is read or written
+ * concurrently using positional IO. */
+#define PARALLEL_IO (1 << 13)
+/* Private flag used to indicate that the keys and arrays point into a
+ * buffer owned by the caller, which was passed to kastore_openf_buffer. */
+#define BORROWS_BUFFER (1 << 12)
+
+/* Arrays are split into chunks of at most this many bytes for concurrent
+ * IO, so that the work is spread evenly even when a few arrays dominate. */
+#define KAS_IO_CHUNK_SIZE (16 * 1024 * 1024)
 
 const char *
 kas_strerror(int err)
@@ -35,8 +66,9 @@ kas_strerror(int err)
             break;
         case KAS_ERR_BAD_FLAGS:
             ret = "Unknown flags specified. Only (KAS_GET_TAKES_OWNERSHIP and/or"
-                  "KAS_READ_ALL) or 0 can be specified "
-                  "for open, and KAS_BORROWS_ARRAY or 0 for put";
+                  "KAS_READ_ALL) or (KAS_READ_MMAP and/or KAS_READ_ALL), along with "
+                  "KAS_VERIFY, or KAS_NO_CHECKSUMS in write mode, or 0 can be "
+                  "specified for open, and KAS_BORROWS_ARRAY or 0 for put";
             break;
         case KAS_ERR_NO_MEMORY:
             ret = "Out of memory";
@@ -73,6 +105,9 @@ kas_strerror(int err)
         case KAS_ERR_EOF:
             ret = "End of file";
             break;
+        case KAS_ERR_BAD_CHECKSUM:
+            ret = "Array checksum mismatch; the file is corrupt";
+            break;
     }
     return ret;
 }
@@ -110,6 +145,25 @@ compare_items(const void *a, const void *b)
     return ret;
 }
 
+/* A key to search for, compared against items by compare_key_item. */
+typedef struct {
+    const char *key;
+    size_t key_len;
+} kas_search_key_t;
+
+static int
+compare_key_item(const void *a, const void *b)
+{
+    const kas_search_key_t *ka = (const kas_search_key_t *) a;
+    const kaitem_t *ib = (const kaitem_t *) b;
+    size_t len = ka->key_len < ib->key_len ? ka->key_len : ib->key_len;
+    int ret = memcmp(ka->key, ib->key, len);
+    if (ret == 0) {
+        ret = (ka->key_len > ib->key_len) - (ka->key_len < ib->key_len);
+    }
+    return ret;
+}
+
 /* When a read error occurs we don't know whether this is because the file
  * ended unexpectedly or an IO error occured. If the file ends unexpectedly
  * this is a file format error.
@@ -125,6 +179,122 @@ kastore_get_read_io_error(kastore_t *self)
     return ret;
 }
 
+/* Items with this bit set in the flags byte of their descriptor have a
+ * checksum of their stored bytes. */
+#define KAS_ITEM_HAS_CHECKSUM 1
+
+#define KAS_CRC32C_POLY 0x82F63B78u
+
+/* Checksums are CRC32C (Castagnoli), which is computed by the crc32
+ * instruction when the CPU supports SSE4.2. Otherwise we use slicing-by-8,
+ * with lookup tables built for each operation on the store rather than held
+ * in global state. A NULL table indicates that the instruction is used. */
+#ifdef KAS_HAVE_HW_CRC32C
+
+static bool
+kas_crc32c_hw_supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2") != 0;
+}
+
+__attribute__((target("sse4.2"))) static uint32_t
+kas_crc32c_hw(const void *data, size_t size)
+{
+    const uint8_t *p = (const uint8_t *) data;
+    uint64_t crc = 0xFFFFFFFFu;
+    uint64_t word;
+
+    while (size >= 8) {
+        memcpy(&word, p, 8);
+        crc = _mm_crc32_u64(crc, word);
+        p += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        crc = _mm_crc32_u8((uint32_t) crc, *p);
+        p++;
+        size--;
+    }
+    return ~(uint32_t) crc;
+}
+
+#else
+
+static bool
+kas_crc32c_hw_supported(void)
+{
+    return false;
+}
+
+static uint32_t
+kas_crc32c_hw(const void *KAS_UNUSED(data), size_t KAS_UNUSED(size))
+{
+    return 0;
+}
+
+#endif
+
+static int KAS_WARN_UNUSED
+kas_crc32c_init(uint32_t **table)
+{
+    int ret = 0;
+    uint32_t *t = NULL;
+    uint32_t crc;
+    size_t j, k;
+
+    if (kas_crc32c_hw_supported()) {
+        goto out;
+    }
+    t = (uint32_t *) malloc(8 * 256 * sizeof(*t));
+    if (t == NULL) {
+        ret = KAS_ERR_NO_MEMORY;
+        goto out;
+    }
+    for (j = 0; j < 256; j++) {
+        crc = (uint32_t) j;
+        for (k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (KAS_CRC32C_POLY & (0u - (crc & 1)));
+        }
+        t[j] = crc;
+    }
+    for (k = 1; k < 8; k++) {
+        for (j = 0; j < 256; j++) {
+            crc = t[(k - 1) * 256 + j];
+            t[k * 256 + j] = (crc >> 8) ^ t[crc & 0xFF];
+        }
+    }
+out:
+    *table = t;
+    return ret;
+}
+
+static uint32_t
+kas_crc32c(const uint32_t *t, const void *data, size_t size)
+{
+    const uint8_t *p = (const uint8_t *) data;
+    uint32_t crc = 0xFFFFFFFFu;
+
+    if (t == NULL) {
+        return kas_crc32c_hw(data, size);
+    }
+    while (size >= 8) {
+        crc ^= (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16
+               | (uint32_t) p[3] << 24;
+        crc = t[7 * 256 + (crc & 0xFF)] ^ t[6 * 256 + ((crc >> 8) & 0xFF)]
+              ^ t[5 * 256 + ((crc >> 16) & 0xFF)] ^ t[4 * 256 + (crc >> 24)]
+              ^ t[3 * 256 + p[4]] ^ t[2 * 256 + p[5]] ^ t[256 + p[6]] ^ t[p[7]];
+        p += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        crc = t[(crc ^ *p) & 0xFF] ^ (crc >> 8);
+        p++;
+        size--;
+    }
+    return ~crc;
+}
+
 static int KAS_WARN_UNUSED
 kastore_write_header(kastore_t *self)
 {
@@ -151,23 +321,13 @@ out:
 }
 
 static int KAS_WARN_UNUSED
-kastore_read_header(kastore_t *self)
+kastore_parse_header(kastore_t *self, const char *header)
 {
     int ret = 0;
-    char header[KAS_HEADER_SIZE];
     uint16_t version_major, version_minor;
     uint32_t num_items;
     uint64_t file_size;
-    size_t count;
 
-    count = fread(header, 1, KAS_HEADER_SIZE, self->file);
-    if (count == 0 && feof(self->file)) {
-        ret = KAS_ERR_EOF;
-        goto out;
-    } else if (count != KAS_HEADER_SIZE) {
-        ret = kastore_get_read_io_error(self);
-        goto out;
-    }
     if (strncmp(header, KAS_MAGIC, 8) != 0) {
         ret = KAS_ERR_BAD_FILE_FORMAT;
         goto out;
@@ -195,6 +355,80 @@ out:
     return ret;
 }
 
+static int KAS_WARN_UNUSED
+kastore_read_header(kastore_t *self)
+{
+    int ret = 0;
+    char header[KAS_HEADER_SIZE];
+    size_t count;
+
+    count = fread(header, 1, KAS_HEADER_SIZE, self->file);
+    if (count == 0 && feof(self->file)) {
+        ret = KAS_ERR_EOF;
+        goto out;
+    } else if (count != KAS_HEADER_SIZE) {
+        ret = kastore_get_read_io_error(self);
+        goto out;
+    }
+    ret = kastore_parse_header(self, header);
+out:
+    return ret;
+}
+
+/* Return the number of bytes used to store the specified item in the file. */
+static size_t
+kastore_item_stored_size(const kaitem_t *item)
+{
+    return item->array_len * type_size(item->type);
+}
+
+/* Return the bytes to write to the file for the specified item. */
+static const char *
+kastore_item_write_buffer(const kaitem_t *item)
+{
+    return item->borrowed_array != NULL ? (const char *) item->borrowed_array
+                                        : (const char *) item->array;
+}
+
+/* Check the stored bytes of the specified item against its checksum, if we
+ * are verifying checksums and the item has one. */
+static int KAS_WARN_UNUSED
+kastore_verify_item(const kastore_t *self, const kaitem_t *item, const char *stored)
+{
+    int ret = 0;
+
+    if ((self->flags & KAS_VERIFY) && item->has_checksum
+        && kas_crc32c(self->crc32c_table, stored, kastore_item_stored_size(item))
+               != item->checksum) {
+        ret = KAS_ERR_BAD_CHECKSUM;
+    }
+    return ret;
+}
+
+/* Compute the checksums of the bytes to be written for each item. */
+static int KAS_WARN_UNUSED
+kastore_compute_checksums(kastore_t *self)
+{
+    int ret = 0;
+    size_t j;
+    uint32_t *table = NULL;
+    kaitem_t *item;
+
+    ret = kas_crc32c_init(&table);
+    if (ret != 0) {
+        goto out;
+    }
+    for (j = 0; j < self->num_items; j++) {
+        item = &self->items[j];
+        item->checksum = kas_crc32c(
+            table, kastore_item_write_buffer(item), kastore_item_stored_size(item));
+        item->has_checksum = true;
+    }
+out:
+    kas_safe_free(table);
+    return ret;
+}
+
 /* Compute the locations of the keys and arrays in the file. */
 static void
 kastore_pack_items(kastore_t *self)
@@ -214,7 +448,7 @@ kastore_pack_items(kastore_t *self)
             offset += KAS_ARRAY_ALIGN - remainder;
         }
         self->items[j].array_start = offset;
-        offset += self->items[j].array_len * type_size(self->items[j].type);
+        offset += kastore_item_stored_size(&self->items[j]);
     }
     self->file_size = offset;
 }
@@ -224,23 +458,30 @@ kastore_write_descriptors(kastore_t *self)
 {
     int ret = 0;
     size_t j;
-    uint8_t type;
+    uint8_t type, item_flags;
     uint64_t key_start, key_len, array_start, array_len;
+    uint32_t checksum;
     char descriptor[KAS_ITEM_DESCRIPTOR_SIZE];
 
     for (j = 0; j < self->num_items; j++) {
         memset(descriptor, 0, KAS_ITEM_DESCRIPTOR_SIZE);
         type = (uint8_t) self->items[j].type;
+        item_flags = self->items[j].has_checksum ? KAS_ITEM_HAS_CHECKSUM : 0;
+        checksum = self->items[j].checksum;
         key_start = (uint64_t) self->items[j].key_start;
         key_len = (uint64_t) self->items[j].key_len;
         array_start = (uint64_t) self->items[j].array_start;
         array_len = (uint64_t) self->items[j].array_len;
         memcpy(descriptor, &type, 1);
-        /* Bytes 1-8 are reserved */
+        /* Byte 1 is reserved */
+        memcpy(descriptor + 2, &item_flags, 1);
+        /* Bytes 3-8 are reserved */
         memcpy(descriptor + 8, &key_start, 8);
         memcpy(descriptor + 16, &key_len, 8);
         memcpy(descriptor + 24, &array_start, 8);
         memcpy(descriptor + 32, &array_len, 8);
+        /* Readers from before checksums were added ignore these bytes */
+        memcpy(descriptor + 48, &checksum, 4);
         /* Rest of descriptor is reserved */
         if (fwrite(descriptor, sizeof(descriptor), 1, self->file) != 1) {
             ret = KAS_ERR_IO;
@@ -251,47 +492,38 @@ out:
     return ret;
 }
 
+/* Parse the item descriptors, which must have been checked to lie within
+ * the file by the caller. */
 static int KAS_WARN_UNUSED
-kastore_read_descriptors(kastore_t *self)
+kastore_parse_descriptors(kastore_t *self, const char *read_buffer)
 {
     int ret = KAS_ERR_BAD_FILE_FORMAT;
     size_t j;
-    uint8_t type;
+    uint8_t type, item_flags;
     uint64_t key_start, key_len, array_start, array_len;
-    char *descriptor;
-    size_t descriptor_offset, offset, remainder, size, count;
-    char *read_buffer = NULL;
-
-    size = self->num_items * KAS_ITEM_DESCRIPTOR_SIZE;
-    if (size + KAS_HEADER_SIZE > self->file_size) {
-        goto out;
-    }
-    read_buffer = (char *) malloc(size);
-    if (read_buffer == NULL) {
-        ret = KAS_ERR_NO_MEMORY;
-        goto out;
-    }
-    count = fread(read_buffer, size, 1, self->file);
-    if (count == 0) {
-        ret = kastore_get_read_io_error(self);
-        goto out;
-    }
+    uint32_t checksum;
+    const char *descriptor;
+    size_t descriptor_offset, offset, remainder;
 
     descriptor_offset = 0;
     for (j = 0; j < self->num_items; j++) {
         descriptor = read_buffer + descriptor_offset;
         descriptor_offset += KAS_ITEM_DESCRIPTOR_SIZE;
         memcpy(&type, descriptor, 1);
+        memcpy(&item_flags, descriptor + 2, 1);
         memcpy(&key_start, descriptor + 8, 8);
         memcpy(&key_len, descriptor + 16, 8);
         memcpy(&array_start, descriptor + 24, 8);
         memcpy(&array_len, descriptor + 32, 8);
+        memcpy(&checksum, descriptor + 48, 4);
 
         if (type >= KAS_NUM_TYPES) {
             ret = KAS_ERR_BAD_TYPE;
             goto out;
         }
         self->items[j].type = (int) type;
+        self->items[j].has_checksum = !!(item_flags & KAS_ITEM_HAS_CHECKSUM);
+        self->items[j].checksum = checksum;
         if (key_start + key_len > self->file_size) {
             goto out;
         }
@@ -324,25 +556,332 @@ kastore_read_descriptors(kastore_t *self)
             ret = KAS_ERR_BAD_FILE_FORMAT;
             goto out;
         }
-        offset += self->items[j].array_len * type_size(self->items[j].type);
+        offset += kastore_item_stored_size(&self->items[j]);
     }
     if (offset != self->file_size) {
         ret = KAS_ERR_BAD_FILE_FORMAT;
         goto out;
     }
     ret = 0;
+out:
+    return ret;
+}
+
+static int KAS_WARN_UNUSED
+kastore_read_descriptors(kastore_t *self)
+{
+    int ret = KAS_ERR_BAD_FILE_FORMAT;
+    size_t size, count;
+    char *read_buffer = NULL;
+
+    size = self->num_items * KAS_ITEM_DESCRIPTOR_SIZE;
+    if (size + KAS_HEADER_SIZE > self->file_size) {
+        goto out;
+    }
+    read_buffer = (char *) malloc(size);
+    if (read_buffer == NULL) {
+        ret = KAS_ERR_NO_MEMORY;
+        goto out;
+    }
+    count = fread(read_buffer, size, 1, self->file);
+    if (count == 0) {
+        ret = kastore_get_read_io_error(self);
+        goto out;
+    }
+    ret = kastore_parse_descriptors(self, read_buffer);
 out:
     kas_safe_free(read_buffer);
     return ret;
 }
 
+/* A contiguous region of the file to be read or written concurrently */
+typedef struct {
+    /* Destination when reading */
+    char *read_buffer;
+    /* Source when writing */
+    const char *write_buffer;
+    size_t size;
+    size_t offset;
+} kas_io_chunk_t;
+
+#if defined(_WIN32)
+
+static bool
+kastore_parallel_io_supported(kastore_t *KAS_UNUSED(self))
+{
+    return false;
+}
+
+static int KAS_WARN_UNUSED
+kastore_run_parallel_io(kastore_t *KAS_UNUSED(self), kas_io_chunk_t *KAS_UNUSED(chunks),
+    size_t KAS_UNUSED(num_chunks), bool KAS_UNUSED(write))
+{
+    return KAS_ERR_ILLEGAL_OPERATION;
+}
+
+#else
+
+typedef struct {
+    int fd;
+    bool write;
+    kas_io_chunk_t *chunks;
+    size_t num_chunks;
+    size_t next_chunk;
+    int ret;
+    int err;
+    pthread_mutex_t mutex;
+} kas_io_work_t;
+
+/* Concurrent IO needs positional reads and writes on a regular file. Files
+ * opened for appending are excluded, as pwrite ignores the offset for them. */
+static bool
+kastore_parallel_io_supported(kastore_t *self)
+{
+    int fd, fd_flags;
+    struct stat st;
+
+    if (self->num_threads <= 1) {
+        return false;
+    }
+    fd = fileno(self->file);
+    if (fd == -1 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    fd_flags = fcntl(fd, F_GETFL);
+    return fd_flags != -1 && !(fd_flags & O_APPEND);
+}
+
+static int
+kastore_transfer_chunk(int fd, const kas_io_chunk_t *chunk, bool write)
+{
+    int ret = 0;
+    size_t done = 0;
+    ssize_t count;
+    off_t offset;
+
+    while (done < chunk->size) {
+        offset = (off_t) (chunk->offset + done);
+        if (write) {
+            count = pwrite(fd, chunk->write_buffer + done, chunk->size - done, offset);
+        } else {
+            count = pread(fd, chunk->read_buffer + done, chunk->size - done, offset);
+        }
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            ret = KAS_ERR_IO;
+            goto out;
+        }
+        if (count == 0) {
+            /* The file ended before the store did */
+            errno = 0;
+            ret = write ? KAS_ERR_IO : KAS_ERR_BAD_FILE_FORMAT;
+            goto out;
+        }
+        done += (size_t) count;
+    }
+out:
+    return ret;
+}
+
+static void *
+kastore_parallel_io_worker(void *arg)
+{
+    kas_io_work_t *work = (kas_io_work_t *) arg;
+    kas_io_chunk_t *chunk;
+    int ret;
+
+    while (true) {
+        chunk = NULL;
+        pthread_mutex_lock(&work->mutex);
+        if (work->ret == 0 && work->next_chunk < work->num_chunks) {
+            chunk = &work->chunks[work->next_chunk];
+            work->next_chunk++;
+        }
+        pthread_mutex_unlock(&work->mutex);
+        if (chunk == NULL) {
+            break;
+        }
+        ret = kastore_transfer_chunk(work->fd, chunk, work->write);
+        if (ret != 0) {
+            pthread_mutex_lock(&work->mutex);
+            if (work->ret == 0) {
+                work->ret = ret;
+                work->err = errno;
+            }
+            pthread_mutex_unlock(&work->mutex);
+        }
+    }
+    return NULL;
+}
+
+/* Transfer the specified chunks using up to num_threads threads, including
+ * the calling thread. The first error encountered is returned. */
+static int KAS_WARN_UNUSED
+kastore_run_parallel_io(
+    kastore_t *self, kas_io_chunk_t *chunks, size_t num_chunks, bool write)
+{
+    int ret = 0;
+    size_t j, num_threads, num_started;
+    pthread_t *threads = NULL;
+    kas_io_work_t work;
+
+    memset(&work, 0, sizeof(work));
+    work.fd = fileno(self->file);
+    work.write = write;
+    work.chunks = chunks;
+    work.num_chunks = num_chunks;
+
+    num_threads = (size_t) self->num_threads;
+    if (num_threads > num_chunks) {
+        num_threads = num_chunks;
+    }
+    if (num_threads > 1) {
+        threads = (pthread_t *) malloc((num_threads - 1) * sizeof(*threads));
+        if (threads == NULL) {
+            ret = KAS_ERR_NO_MEMORY;
+            goto out;
+        }
+    }
+    if (pthread_mutex_init(&work.mutex, NULL) != 0) {
+        ret = KAS_ERR_GENERIC;
+        goto out;
+    }
+    /* If we can't start a thread we carry on with those that we have */
+    num_started = 0;
+    for (j = 0; j + 1 < num_threads; j++) {
+        if (pthread_create(&threads[j], NULL, kastore_parallel_io_worker, &work)
+            != 0) {
+            break;
+        }
+        num_started++;
+    }
+    kastore_parallel_io_worker(&work);
+    for (j = 0; j < num_started; j++) {
+        pthread_join(threads[j], NULL);
+    }
+    pthread_mutex_destroy(&work.mutex);
+    ret = work.ret;
+    if (ret == KAS_ERR_IO) {
+        /* Report the error from the thread that encountered it */
+        errno = work.err;
+    }
+out:
+    kas_safe_free(threads);
+    return ret;
+}
+
+#endif
+
+/* Split the specified regions of the file into chunks of at most
+ * KAS_IO_CHUNK_SIZE bytes and transfer them concurrently. */
+static int KAS_WARN_UNUSED
+kastore_parallel_io(
+    kastore_t *self, const kas_io_chunk_t *regions, size_t num_regions, bool write)
+{
+    int ret = 0;
+    size_t j, num_chunks, offset, size;
+    kas_io_chunk_t *chunks = NULL;
+
+    num_chunks = 0;
+    for (j = 0; j < num_regions; j++) {
+        num_chunks += (regions[j].size + KAS_IO_CHUNK_SIZE - 1) / KAS_IO_CHUNK_SIZE;
+    }
+    if (num_chunks == 0) {
+        goto out;
+    }
+    chunks = (kas_io_chunk_t *) malloc(num_chunks * sizeof(*chunks));
+    if (chunks == NULL) {
+        ret = KAS_ERR_NO_MEMORY;
+        goto out;
+    }
+    num_chunks = 0;
+    for (j = 0; j < num_regions; j++) {
+        for (offset = 0; offset < regions[j].size; offset += size) {
+            size = regions[j].size - offset;
+            if (size > KAS_IO_CHUNK_SIZE) {
+                size = KAS_IO_CHUNK_SIZE;
+            }
+            chunks[num_chunks] = regions[j];
+            if (write) {
+                chunks[num_chunks].write_buffer = regions[j].write_buffer + offset;
+            } else {
+                chunks[num_chunks].read_buffer = regions[j].read_buffer + offset;
+            }
+            chunks[num_chunks].size = size;
+            chunks[num_chunks].offset = regions[j].offset + offset;
+            num_chunks++;
+        }
+    }
+    ret = kastore_run_parallel_io(self, chunks, num_chunks, write);
+out:
+    kas_safe_free(chunks);
+    return ret;
+}
+
+/* Write the arrays, which start at the specified offset in the store, with
+ * positional IO. The keys and everything before them must already have been
+ * written to the FILE. */
+static int KAS_WARN_UNUSED
+kastore_write_arrays_parallel(kastore_t *self, size_t offset)
+{
+    int ret = 0;
+    int err;
+    size_t j, size;
+    const char pad[KAS_ARRAY_ALIGN] = { 0, 0, 0, 0, 0, 0, 0 };
+    const char *write_array;
+    kas_io_chunk_t *regions = NULL;
+
+    if (self->num_items > 0) {
+        regions = (kas_io_chunk_t *) calloc(2 * self->num_items, sizeof(*regions));
+        if (regions == NULL) {
+            ret = KAS_ERR_NO_MEMORY;
+            goto out;
+        }
+    }
+    for (j = 0; j < self->num_items; j++) {
+        /* Each array is preceded by zero padding up to its aligned start */
+        regions[2 * j].write_buffer = pad;
+        regions[2 * j].size = self->items[j].array_start - offset;
+        regions[2 * j].offset = (size_t) self->file_offset + offset;
+        assert(regions[2 * j].size < KAS_ARRAY_ALIGN);
+
+        size = kastore_item_stored_size(&self->items[j]);
+        write_array = kastore_item_write_buffer(&self->items[j]);
+        assert(write_array != NULL);
+        regions[2 * j + 1].write_buffer = write_array;
+        regions[2 * j + 1].size = size;
+        regions[2 * j + 1].offset
+            = (size_t) self->file_offset + self->items[j].array_start;
+        offset = self->items[j].array_start + size;
+    }
+    /* Make sure everything buffered in the FILE reaches the file first */
+    if (fflush(self->file) != 0) {
+        ret = KAS_ERR_IO;
+        goto out;
+    }
+    ret = kastore_parallel_io(self, regions, 2 * self->num_items, true);
+    if (ret != 0) {
+        goto out;
+    }
+    err = fseek(self->file, self->file_offset + (long) self->file_size, SEEK_SET);
+    if (err != 0) {
+        ret = KAS_ERR_IO;
+        goto out;
+    }
+out:
+    kas_safe_free(regions);
+    return ret;
+}
+
 static int KAS_WARN_UNUSED
 kastore_write_data(kastore_t *self)
 {
     int ret = 0;
     size_t j, size, offset, padding;
     char pad[KAS_ARRAY_ALIGN] = { 0, 0, 0, 0, 0, 0, 0 };
-    const void *write_array;
+    const char *write_array;
 
     offset = KAS_HEADER_SIZE + self->num_items * KAS_ITEM_DESCRIPTOR_SIZE;
 
@@ -355,6 +894,10 @@ kastore_write_data(kastore_t *self)
         }
         offset += self->items[j].key_len;
     }
+    if (self->flags & PARALLEL_IO) {
+        ret = kastore_write_arrays_parallel(self, offset);
+        goto out;
+    }
     /* Write the arrays. */
     for (j = 0; j < self->num_items; j++) {
         padding = self->items[j].array_start - offset;
@@ -363,10 +906,8 @@ kastore_write_data(kastore_t *self)
             ret = KAS_ERR_IO;
             goto out;
         }
-        size = self->items[j].array_len * type_size(self->items[j].type);
-        write_array = self->items[j].borrowed_array != NULL
-                          ? self->items[j].borrowed_array
-                          : self->items[j].array;
+        size = kastore_item_stored_size(&self->items[j]);
+        write_array = kastore_item_write_buffer(&self->items[j]);
         assert(write_array != NULL);
         if (size > 0 && fwrite(write_array, size, 1, self->file) != 1) {
             ret = KAS_ERR_IO;
@@ -382,8 +923,12 @@ static int KAS_WARN_UNUSED
 kastore_read_file(kastore_t *self)
 {
     int ret = 0;
+    int err;
     size_t count, size, offset, j;
     bool read_all = !!(self->flags & KAS_READ_ALL);
+    bool parallel = !!(self->flags & PARALLEL_IO);
+    kas_io_chunk_t *regions = NULL;
+    char *buffer;
 
     offset = KAS_HEADER_SIZE + self->num_items * KAS_ITEM_DESCRIPTOR_SIZE;
 
@@ -403,6 +948,13 @@ kastore_read_file(kastore_t *self)
         ret = kastore_get_read_io_error(self);
         goto out;
     }
+    if (parallel) {
+        regions = (kas_io_chunk_t *) calloc(self->num_items, sizeof(*regions));
+        if (regions == NULL) {
+            ret = KAS_ERR_NO_MEMORY;
+            goto out;
+        }
+    }
     /* Assign the pointers for the keys and arrays */
     for (j = 0; j < self->num_items; j++) {
         /* keys are already loaded in the read buffer */
@@ -413,34 +965,159 @@ kastore_read_file(kastore_t *self)
             } else {
                 size = self->items[j + 1].array_start - self->items[j].array_start;
             }
-            self->items[j].array = (char *) malloc(size == 0 ? 1 : size);
-            if (self->items[j].array == NULL) {
+            buffer = (char *) malloc(size == 0 ? 1 : size);
+            if (buffer == NULL) {
                 ret = KAS_ERR_NO_MEMORY;
                 goto out;
             }
-            if (size > 0) {
-                count = fread(self->items[j].array, size, 1, self->file);
+            self->items[j].array = buffer;
+            if (parallel) {
+                regions[j].read_buffer = buffer;
+                regions[j].size = size;
+                regions[j].offset
+                    = (size_t) self->file_offset + self->items[j].array_start;
+            } else if (size > 0) {
+                count = fread(buffer, size, 1, self->file);
                 if (count == 0) {
                     ret = kastore_get_read_io_error(self);
                     goto out;
                 }
             }
+            if (!parallel) {
+                /* Verify the array while it's still in cache */
+                ret = kastore_verify_item(self, &self->items[j], buffer);
+                if (ret != 0) {
+                    goto out;
+                }
+            }
+        }
+    }
+    if (parallel) {
+        ret = kastore_parallel_io(self, regions, self->num_items, false);
+        if (ret != 0) {
+            goto out;
+        }
+        err = fseek(self->file, self->file_offset + (long) self->file_size, SEEK_SET);
+        if (err != 0) {
+            ret = KAS_ERR_IO;
+            goto out;
+        }
+        for (j = 0; j < self->num_items; j++) {
+            ret = kastore_verify_item(self, &self->items[j], regions[j].read_buffer);
+            if (ret != 0) {
+                goto out;
+            }
         }
     }
 out:
+    kas_safe_free(regions);
     return ret;
 }
 
+#if defined(_WIN32)
+
+static int KAS_WARN_UNUSED
+kastore_mmap_file(kastore_t *KAS_UNUSED(self))
+{
+    return KAS_ERR_ILLEGAL_OPERATION;
+}
+
+static void
+kastore_munmap_file(kastore_t *KAS_UNUSED(self))
+{
+}
+
+#else
+
+/* Map the store into memory and point the keys and arrays directly into
+ * the mapping. The mapping must start at a page boundary, so we map from
+ * the nearest page boundary below the start of the store and remember the
+ * slack. On success the file is positioned at the end of the store, as it
+ * would be after reading it with KAS_READ_ALL. */
+static int KAS_WARN_UNUSED
+kastore_mmap_file(kastore_t *self)
+{
+    int ret = 0;
+    int fd, err;
+    struct stat st;
+    long page_size;
+    size_t slack, j;
+    char *data;
+    void *addr;
+
+    fd = fileno(self->file);
+    if (fd == -1) {
+        ret = KAS_ERR_IO;
+        goto out;
+    }
+    if (fstat(fd, &st) != 0) {
+        ret = KAS_ERR_IO;
+        goto out;
+    }
+    if (!S_ISREG(st.st_mode) || self->file_offset % KAS_ARRAY_ALIGN != 0) {
+        ret = KAS_ERR_ILLEGAL_OPERATION;
+        goto out;
+    }
+    if ((uint64_t) st.st_size < (uint64_t) self->file_offset + self->file_size) {
+        ret = KAS_ERR_BAD_FILE_FORMAT;
+        goto out;
+    }
+    page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0) {
+        ret = KAS_ERR_IO;
+        goto out;
+    }
+    slack = (size_t) (self->file_offset % page_size);
+    /* The mapping is read-only, so that the pages are shared with the page
+     * cache and any attempt to write to the arrays fails */
+    addr = mmap(NULL, self->file_size + slack, PROT_READ, MAP_PRIVATE, fd,
+        (off_t) ((size_t) self->file_offset - slack));
+    if (addr == MAP_FAILED) {
+        ret = KAS_ERR_IO;
+        goto out;
+    }
+    self->mmap_addr = addr;
+    self->mmap_size = self->file_size + slack;
+    data = (char *) addr + slack;
+    for (j = 0; j < self->num_items; j++) {
+        self->items[j].key = data + self->items[j].key_start;
+        ret = kastore_verify_item(
+            self, &self->items[j], data + self->items[j].array_start);
+        if (ret != 0) {
+            goto out;
+        }
+        self->items[j].array = data + self->items[j].array_start;
+    }
+    err = fseek(self->file, self->file_offset + (long) self->file_size, SEEK_SET);
+    if (err != 0) {
+        ret = KAS_ERR_IO;
+        goto out;
+    }
+out:
+    return ret;
+}
+
+static void
+kastore_munmap_file(kastore_t *self)
+{
+    if (self->mmap_addr != NULL) {
+        munmap(self->mmap_addr, self->mmap_size);
+        self->mmap_addr = NULL;
+    }
+}
+
+#endif
+
 static int KAS_WARN_UNUSED
 kastore_read_item(kastore_t *self, kaitem_t *item)
 {
     int ret = 0;
     int err;
-    size_t size = item->array_len * type_size(item->type);
+    size_t size = kastore_item_stored_size(item);
     size_t count;
+    char *buffer = (char *) malloc(size == 0 ? 1 : size);
 
-    item->array = malloc(size == 0 ? 1 : size);
-    if (item->array == NULL) {
+    if (buffer == NULL) {
         ret = KAS_ERR_NO_MEMORY;
         goto out;
     }
@@ -450,13 +1127,20 @@ kastore_read_item(kastore_t *self, kaitem_t *item)
             ret = KAS_ERR_IO;
             goto out;
         }
-        count = fread(item->array, size, 1, self->file);
+        count = fread(buffer, size, 1, self->file);
         if (count == 0) {
             ret = kastore_get_read_io_error(self);
             goto out;
         }
     }
+    ret = kastore_verify_item(self, item, buffer);
+    if (ret != 0) {
+        goto out;
+    }
+    item->array = buffer;
+    buffer = NULL;
 out:
+    kas_safe_free(buffer);
     return ret;
 }
 
@@ -465,6 +1149,20 @@ kastore_write_file(kastore_t *self)
 {
     int ret = 0;
 
+    if (kastore_parallel_io_supported(self)) {
+        self->file_offset = ftell(self->file);
+        if (self->file_offset == -1) {
+            ret = KAS_ERR_IO;
+            goto out;
+        }
+        self->flags |= PARALLEL_IO;
+    }
+    if (!(self->flags & KAS_NO_CHECKSUMS)) {
+        ret = kastore_compute_checksums(self);
+        if (ret != 0) {
+            goto out;
+        }
+    }
     qsort(self->items, self->num_items, sizeof(kaitem_t), compare_items);
     kastore_pack_items(self);
     ret = kastore_write_header(self);
@@ -488,9 +1186,14 @@ kastore_read(kastore_t *self)
 {
     int ret = 0;
 
-    if (!(self->flags & KAS_READ_ALL)) {
+    if ((self->flags & KAS_READ_ALL) && !(self->flags & KAS_READ_MMAP)
+        && kastore_parallel_io_supported(self)) {
+        self->flags |= PARALLEL_IO;
+    }
+    if (!(self->flags & KAS_READ_ALL) || (self->flags & (KAS_READ_MMAP | PARALLEL_IO))) {
         /* Record the current file offset, in case this is a multi-store file,
-         * so that we can seek to the correct location in kastore_read_item().
+         * so that we can seek to the correct location in kastore_read_item()
+         * or map or read the correct region of the file.
          */
         self->file_offset = ftell(self->file);
         if (self->file_offset == -1) {
@@ -512,7 +1215,11 @@ kastore_read(kastore_t *self)
         if (ret != 0) {
             goto out;
         }
-        ret = kastore_read_file(self);
+        if (self->flags & KAS_READ_MMAP) {
+            ret = kastore_mmap_file(self);
+        } else {
+            ret = kastore_read_file(self);
+        }
         if (ret != 0) {
             goto out;
         }
@@ -545,6 +1252,13 @@ out:
 
 int KAS_WARN_UNUSED
 kastore_open(kastore_t *self, const char *filename, const char *mode, int flags)
+{
+    return kastore_open_threads(self, filename, mode, flags, 1);
+}
+
+int KAS_WARN_UNUSED
+kastore_open_threads(kastore_t *self, const char *filename, const char *mode,
+    int flags, int num_threads)
 {
     int ret = 0;
     const char *file_mode;
@@ -572,7 +1286,8 @@ kastore_open(kastore_t *self, const char *filename, const char *mode, int flags)
         goto out;
     }
     if (appending) {
-        ret = kastore_open(&tmp, filename, "r", KAS_READ_ALL);
+        ret = kastore_open_threads(
+            &tmp, filename, "r", KAS_READ_ALL | (flags & KAS_VERIFY), num_threads);
         if (ret != 0) {
             goto out;
         }
@@ -590,7 +1305,7 @@ kastore_open(kastore_t *self, const char *filename, const char *mode, int flags)
         ret = KAS_ERR_IO;
         goto out;
     }
-    ret = kastore_openf(self, file, mode, flags);
+    ret = kastore_openf_threads(self, file, mode, flags, num_threads);
     if (ret != 0) {
         (void) fclose(file);
     } else {
@@ -608,6 +1323,13 @@ out:
 
 int KAS_WARN_UNUSED
 kastore_openf(kastore_t *self, FILE *file, const char *mode, int flags)
+{
+    return kastore_openf_threads(self, file, mode, flags, 1);
+}
+
+int KAS_WARN_UNUSED
+kastore_openf_threads(
+    kastore_t *self, FILE *file, const char *mode, int flags, int num_threads)
 {
     int ret = 0;
 
@@ -625,20 +1347,150 @@ kastore_openf(kastore_t *self, FILE *file, const char *mode, int flags)
         goto out;
     }
 
-    if (flags > (KAS_READ_ALL | KAS_GET_TAKES_OWNERSHIP) || flags < 0) {
+    if ((flags
+            & ~(KAS_READ_ALL | KAS_GET_TAKES_OWNERSHIP | KAS_READ_MMAP | KAS_VERIFY
+                | KAS_NO_CHECKSUMS))
+            != 0
+        || flags < 0) {
+        ret = KAS_ERR_BAD_FLAGS;
+        goto out;
+    }
+    if ((flags & KAS_NO_CHECKSUMS) && self->mode != KAS_WRITE) {
+        ret = KAS_ERR_BAD_FLAGS;
+        goto out;
+    }
+    if ((flags & KAS_READ_MMAP) && (flags & KAS_GET_TAKES_OWNERSHIP)) {
         ret = KAS_ERR_BAD_FLAGS;
         goto out;
     }
 
     self->flags = flags;
     self->file = file;
+    self->num_threads = num_threads;
     if (self->mode == KAS_READ) {
+        if (flags & KAS_VERIFY) {
+            ret = kas_crc32c_init(&self->crc32c_table);
+            if (ret != 0) {
+                goto out;
+            }
+        }
         ret = kastore_read(self);
     }
 out:
     return ret;
 }
 
+/* Ensure that the buffer can hold at least the specified number of bytes. */
+static int KAS_WARN_UNUSED
+kastore_reserve_buffer(void **buffer, size_t *buffer_size, size_t size)
+{
+    int ret = 0;
+    size_t new_size;
+    void *tmp;
+
+    if (size > *buffer_size) {
+        new_size = *buffer_size * 2 > size ? *buffer_size * 2 : size;
+        tmp = realloc(*buffer, new_size);
+        if (tmp == NULL) {
+            ret = KAS_ERR_NO_MEMORY;
+            goto out;
+        }
+        *buffer = tmp;
+        *buffer_size = new_size;
+    }
+out:
+    return ret;
+}
+
+int KAS_WARN_UNUSED
+kastore_openf_buffer(
+    kastore_t *self, FILE *file, void **buffer, size_t *buffer_size, int flags)
+{
+    int ret = 0;
+    size_t count, j;
+    char *data;
+
+    memset(self, 0, sizeof(*self));
+    self->mode = KAS_READ;
+    self->file = file;
+    self->flags = BORROWS_BUFFER | flags;
+    self->num_threads = 1;
+    if ((flags & ~KAS_VERIFY) != 0) {
+        ret = KAS_ERR_BAD_FLAGS;
+        goto out;
+    }
+    if (flags & KAS_VERIFY) {
+        ret = kas_crc32c_init(&self->crc32c_table);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    ret = kastore_reserve_buffer(buffer, buffer_size, KAS_HEADER_SIZE);
+    if (ret != 0) {
+        goto out;
+    }
+    data = (char *) *buffer;
+    count = fread(data, 1, KAS_HEADER_SIZE, file);
+    if (count == 0 && feof(file)) {
+        ret = KAS_ERR_EOF;
+        goto out;
+    } else if (count != KAS_HEADER_SIZE) {
+        ret = kastore_get_read_io_error(self);
+        goto out;
+    }
+    ret = kastore_parse_header(self, data);
+    if (ret != 0) {
+        goto out;
+    }
+    if (self->num_items * KAS_ITEM_DESCRIPTOR_SIZE + KAS_HEADER_SIZE
+        > self->file_size) {
+        ret = KAS_ERR_BAD_FILE_FORMAT;
+        goto out;
+    }
+    /* Read the rest of the store in one go, reusing the buffer from any
+     * previous store if it is large enough */
+    ret = kastore_reserve_buffer(buffer, buffer_size, self->file_size);
+    if (ret != 0) {
+        goto out;
+    }
+    data = (char *) *buffer;
+    if (self->file_size > KAS_HEADER_SIZE) {
+        count = fread(data + KAS_HEADER_SIZE, self->file_size - KAS_HEADER_SIZE, 1,
+            self->file);
+        if (count == 0) {
+            ret = kastore_get_read_io_error(self);
+            goto out;
+        }
+    }
+    self->mmap_addr = data;
+    self->mmap_size = self->file_size;
+    if (self->num_items > 0) {
+        self->items = (kaitem_t *) calloc(self->num_items, sizeof(*self->items));
+        if (self->items == NULL) {
+            ret = KAS_ERR_NO_MEMORY;
+            goto out;
+        }
+        ret = kastore_parse_descriptors(self, data + KAS_HEADER_SIZE);
+        if (ret != 0) {
+            goto out;
+        }
+        for (j = 0; j < self->num_items; j++) {
+            self->items[j].key = data + self->items[j].key_start;
+            ret = kastore_verify_item(
+                self, &self->items[j], data + self->items[j].array_start);
+            if (ret != 0) {
+                goto out;
+            }
+            self->items[j].array = data + self->items[j].array_start;
+        }
+    } else if (self->file_size != KAS_HEADER_SIZE) {
+        ret = KAS_ERR_BAD_FILE_FORMAT;
+        goto out;
+    }
+out:
+    return ret;
+}
+
 int KAS_WARN_UNUSED
 kastore_close(kastore_t *self)
 {
@@ -664,6 +1516,11 @@ kastore_close(kastore_t *self)
                 kas_safe_free(self->items[j].array);
             }
         }
+    } else if (self->flags & (KAS_READ_MMAP | BORROWS_BUFFER)) {
+        /* Keys and arrays point into the mapping or buffer */
+        if (self->flags & KAS_READ_MMAP) {
+            kastore_munmap_file(self);
+        }
     } else {
         kas_safe_free(self->key_read_buffer);
         if (self->items != NULL) {
@@ -673,6 +1530,7 @@ kastore_close(kastore_t *self)
         }
     }
     kas_safe_free(self->items);
+    kas_safe_free(self->crc32c_table);
     if (self->file != NULL && (self->flags & OWN_FILE)) {
         err = fclose(self->file);
         if (err != 0) {
@@ -687,27 +1545,21 @@ static int
 kastore_find_item(kastore_t *self, const char *key, size_t key_len, kaitem_t **item)
 {
     int ret = KAS_ERR_KEY_NOT_FOUND;
-    kaitem_t search;
-    search.key = (char *) malloc(key_len);
+    kas_search_key_t search;
+    search.key = key;
     search.key_len = key_len;
 
     if (self->mode != KAS_READ) {
         ret = KAS_ERR_ILLEGAL_OPERATION;
         goto out;
     }
-    if (search.key == NULL) {
-        ret = KAS_ERR_NO_MEMORY;
-        goto out;
-    }
-    memcpy(search.key, key, key_len);
     *item = bsearch(
-        &search, self->items, self->num_items, sizeof(kaitem_t), compare_items);
+        &search, self->items, self->num_items, sizeof(kaitem_t), compare_key_item);
     if (*item == NULL) {
         goto out;
     }
     ret = 0;
 out:
-    kas_safe_free(search.key);
     return ret;
 }
 
@@ -1163,10 +2015,11 @@ kastore_print_state(kastore_t *self, FILE *out)
         item = self->items + j;
         fprintf(out,
             "%.*s: type=%d, key_start=%zu, key_len=%zu, key=%p, "
-            "array_start=%zu, array_len=%zu, array=%p\n",
+            "array_start=%zu, array_len=%zu, array=%p, checksum=%d:%08x\n",
             (int) item->key_len, item->key, item->type, item->key_start, item->key_len,
             (void *) item->key, item->array_start, item->array_len,
-            (void *) item->array);
+            (void *) item->array, item->has_checksum,
+            (unsigned int) item->checksum);
     }
     fprintf(out, "============================\n");
 }
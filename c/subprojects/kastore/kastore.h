@@ -91,11 +91,18 @@ End of file was reached while reading data.
 Unknown flags were provided to open.
 */
 #define KAS_ERR_BAD_FLAGS                             -15
+/**
+The checksum of an array did not match its contents in the file.
+*/
+#define KAS_ERR_BAD_CHECKSUM                          -16
 /** @} */
 
 /* Flags for open */
 #define KAS_READ_ALL                       (1 << 0)
 #define KAS_GET_TAKES_OWNERSHIP            (1 << 1)
+#define KAS_READ_MMAP                      (1 << 2)
+#define KAS_VERIFY                         (1 << 3)
+#define KAS_NO_CHECKSUMS                   (1 << 4)
 
 /* Flags for put */
 #define KAS_BORROWS_ARRAY          (1 << 8)
@@ -147,17 +154,17 @@ The library major version. Incremented when breaking changes to the API or ABI a
 introduced. This includes any changes to the signatures of functions and the
 sizes and types of externally visible structs.
 */
-#define KAS_VERSION_MAJOR   2
+#define KAS_VERSION_MAJOR   3
 /**
 The library minor version. Incremented when non-breaking backward-compatible changes
 to the API or ABI are introduced, i.e., the addition of a new function.
 */
-#define KAS_VERSION_MINOR   1
+#define KAS_VERSION_MINOR   0
 /**
 The library patch version. Incremented when any changes not relevant to the
 to the API or ABI are introduced, i.e., internal refactors of bugfixes.
 */
-#define KAS_VERSION_PATCH   2
+#define KAS_VERSION_PATCH   0
 /** @} */
 
 #define KAS_HEADER_SIZE             64
@@ -198,6 +205,10 @@ typedef struct {
     void *array;
     size_t key_start;
     size_t array_start;
+    /* The CRC32C of the bytes stored in the file. Items read from files
+     * written by earlier versions have no checksum. */
+    bool has_checksum;
+    uint32_t checksum;
 } kaitem_t;
 
 /**
@@ -213,6 +224,14 @@ typedef struct {
     size_t file_size;
     long file_offset;
     char *key_read_buffer;
+    /* The memory holding the store when KAS_READ_MMAP is set or the store
+     * was opened with kastore_openf_buffer */
+    void *mmap_addr;
+    size_t mmap_size;
+    /* Number of threads used to read and write array data */
+    int num_threads;
+    /* Lookup tables used to compute checksums when KAS_VERIFY is set */
+    uint32_t *crc32c_table;
 } kastore_t;
 
 /**
@@ -263,6 +282,32 @@ KAS_GET_TAKES_OWNERSHIP
     KAS_READ_ALL flag is set, and will therefore fail on unseekable
     streams.
 
+KAS_READ_MMAP
+    If this option is specified, the file is memory-mapped at open time
+    and the arrays returned by ``get`` operations point directly into the
+    mapping. No array data is copied, and the page cache is shared
+    between processes mapping the same file. The mapping is read-only,
+    and writing to the returned arrays is an error. The
+    returned arrays are valid until :c:func:`kastore_close` is called and
+    must not be freed. This flag cannot be combined with
+    ``KAS_GET_TAKES_OWNERSHIP``, requires a regular file, and is not
+    supported on Windows, where ``KAS_ERR_ILLEGAL_OPERATION`` is returned.
+
+KAS_VERIFY
+    If this option is specified, the CRC32C checksum stored with each array
+    is checked as the array is read from the file, and
+    ``KAS_ERR_BAD_CHECKSUM`` is returned if the array has been corrupted.
+    Arrays are read when the store is opened with ``KAS_READ_ALL`` or
+    ``KAS_READ_MMAP``, and by the first ``get`` operation on the key
+    otherwise. Arrays written without checksums, either by earlier versions
+    of kastore or with ``KAS_NO_CHECKSUMS``, are not checked.
+
+KAS_NO_CHECKSUMS
+    By default, a CRC32C checksum of each array is computed and stored when
+    writing. If this option is specified, no checksums are stored, which
+    avoids a pass over the data when the file is written. This flag may only
+    be used in write mode.
+
 @endrst
 
 @param self A pointer to a kastore object.
@@ -289,6 +334,9 @@ performed on the FILE and so streams such as stdin, FIFOs etc are
 supported. The FILE pointer will be positioned exactly at the end
 of the kastore encoded bytes once reading is completed, and reading
 multiple stores from the same FILE sequentially is fully supported.
+If the KAS_READ_MMAP flag is supplied the FILE must refer to a regular
+file and the store must start at an offset that is a multiple of
+``KAS_ARRAY_ALIGN``; otherwise ``KAS_ERR_ILLEGAL_OPERATION`` is returned.
 @endrst
 
 @param self A pointer to a kastore object.
@@ -299,6 +347,82 @@ multiple stores from the same FILE sequentially is fully supported.
 */
 int kastore_openf(kastore_t *self, FILE *file, const char *mode, int flags);
 
+/**
+@brief Open a store from a given file, using multiple threads for IO.
+
+@rst
+Behaviour, mode and flags follow that of :c:func:`kastore_open`, except that
+up to ``num_threads`` threads are used to read and write the array data
+concurrently using positional IO (``pread`` and ``pwrite``). Arrays are read
+concurrently at open time when ``KAS_READ_ALL`` is specified, and written
+concurrently when the store is closed in write or append mode. The on-disk
+format is identical to that produced by :c:func:`kastore_open`.
+
+Concurrent IO is only used for regular files on POSIX systems; in other
+cases, or if ``num_threads`` is less than 2, this function behaves exactly
+like :c:func:`kastore_open`.
+@endrst
+
+@param self A pointer to a kastore object.
+@param filename The file path to open.
+@param mode The open mode: can be read ("r"), write ("w") or append ("a").
+@param flags The open flags.
+@param num_threads The maximum number of threads to use for IO.
+@return Return 0 on success or a negative value on failure.
+*/
+int kastore_open_threads(kastore_t *self, const char *filename, const char *mode,
+    int flags, int num_threads);
+
+/**
+@brief Open a store from a given FILE pointer, using multiple threads for IO.
+
+@rst
+Behaviour, mode and flags follow that of :c:func:`kastore_openf`, and
+threading follows that of :c:func:`kastore_open_threads`. When concurrent IO
+is used, the FILE is still positioned exactly at the end of the kastore
+encoded bytes once reading or writing is completed.
+@endrst
+
+@param self A pointer to a kastore object.
+@param file The FILE* to read/write the store from/to.
+@param mode The open mode: can be read ("r") or write ("w").
+@param flags The open flags.
+@param num_threads The maximum number of threads to use for IO.
+@return Return 0 on success or a negative value on failure.
+*/
+int kastore_openf_threads(
+    kastore_t *self, FILE *file, const char *mode, int flags, int num_threads);
+
+/**
+@brief Read a store from a given FILE pointer into a reusable buffer.
+
+@rst
+Reads the next store from the FILE in read mode, in the same way as
+:c:func:`kastore_openf` with the ``KAS_READ_ALL`` flag, except that the
+encoded bytes are read into the specified caller-owned buffer with a single
+read, and the keys and arrays of the store point directly into it. The buffer
+is grown using ``realloc`` if it is too small to hold the store, and is
+otherwise reused as is, so that a sequence of stores can be read from a
+stream without allocating memory for each array.
+
+The buffer must not be modified or freed until :c:func:`kastore_close` has
+been called, and must be freed by the caller after this. The ``buffer``
+may initially be NULL, with a ``buffer_size`` of zero. No ``seek``
+operations are performed on the FILE, and reading multiple stores from the
+same FILE sequentially is fully supported. The ``flags`` argument may be
+``KAS_VERIFY`` or zero.
+@endrst
+
+@param self A pointer to a kastore object.
+@param file The FILE* to read the store from.
+@param buffer A pointer to the buffer to read the store into.
+@param buffer_size A pointer to the size of the buffer in bytes.
+@param flags The open flags.
+@return Return 0 on success or a negative value on failure.
+*/
+int kastore_openf_buffer(
+    kastore_t *self, FILE *file, void **buffer, size_t *buffer_size, int flags);
+
 /**
 @brief Close an opened store, freeing all resources.
 
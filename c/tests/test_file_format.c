@@ -149,8 +149,20 @@ test_format_data_load_errors(void)
     ret = tsk_table_collection_free(&tables);
     CU_ASSERT_EQUAL_FATAL(ret, 0);
 
+    /* Files with compressed columns have a higher major version */
+    version[0] = TSK_FILE_FORMAT_COMPRESSED_VERSION_MAJOR;
+    ret = kastore_open(&store, _tmp_file_name, "w", 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    write_table_cols(&store, write_cols, sizeof(write_cols) / sizeof(*write_cols));
+    ret = kastore_close(&store);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_load(&tables, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_REQUIRED_COL_NOT_FOUND);
+    ret = tsk_table_collection_free(&tables);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
     /* Version too new */
-    version[0] = TSK_FILE_FORMAT_VERSION_MAJOR + 1;
+    version[0] = TSK_FILE_FORMAT_COMPRESSED_VERSION_MAJOR + 1;
     ret = kastore_open(&store, _tmp_file_name, "w", 0);
     CU_ASSERT_EQUAL_FATAL(ret, 0);
     write_table_cols(&store, write_cols, sizeof(write_cols) / sizeof(*write_cols));
@@ -677,6 +689,41 @@ test_missing_reference_sequence(void)
     free(ts);
 }
 
+/* Copy the store in infile to outfile, replacing the array for the specified
+ * key, or dropping it if array is NULL. */
+static void
+copy_store_replace_column(const char *infile, const char *outfile, const char *key,
+    void *array, size_t array_len, int type)
+{
+    int ret = 0;
+    kastore_t read_store, write_store;
+    kaitem_t *item;
+    size_t j;
+
+    ret = kastore_open(&read_store, infile, "r", KAS_READ_ALL);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = kastore_open(&write_store, outfile, "w", 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < read_store.num_items; j++) {
+        item = &read_store.items[j];
+        if (strlen(key) == item->key_len
+            && strncmp(key, item->key, item->key_len) == 0) {
+            if (array != NULL) {
+                ret = kastore_put(
+                    &write_store, item->key, item->key_len, array, array_len, type, 0);
+                CU_ASSERT_EQUAL_FATAL(ret, 0);
+            }
+        } else {
+            ret = kastore_put(&write_store, item->key, item->key_len, item->array,
+                item->array_len, item->type, 0);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+        }
+    }
+    kastore_close(&read_store);
+    ret = kastore_close(&write_store);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+}
+
 static void
 test_bad_column_types(void)
 {
@@ -1400,6 +1447,1694 @@ test_skip_reference_sequence(void)
     free(ts1);
 }
 
+static void
+write_example_kastore(FILE *f, const uint8_t *large, size_t large_len, int num_threads)
+{
+    int ret;
+    kastore_t store;
+    const double small[] = { 1.0, 2.0, 3.0 };
+    const int32_t odd[] = { 1, 2, 3, 4, 5 };
+
+    ret = kastore_openf_threads(&store, f, "w", 0, num_threads);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = kastore_puts_uint8(&store, "large", large, large_len, KAS_BORROWS_ARRAY);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    /* Odd sized arrays and keys make sure the padding is written correctly */
+    ret = kastore_puts_int8(&store, "a", (const int8_t *) large, 3, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = kastore_puts_float64(&store, "small", small, 3, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = kastore_puts_int32(&store, "odd", odd, 5, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = kastore_puts_int32(&store, "empty", odd, 0, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = kastore_close(&store);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+}
+
+static void
+test_kastore_parallel_io(void)
+{
+    int ret;
+    /* Larger than the chunk size used for concurrent IO */
+    size_t j, large_len = 40 * 1024 * 1024 + 3;
+    uint8_t *large = malloc(large_len);
+    uint8_t *array;
+    char *serial_bytes, *parallel_bytes;
+    long serial_size, parallel_size;
+    int num_threads[] = { 2, 3, 8 };
+    size_t k, len;
+    kastore_t store;
+    FILE *f;
+
+    CU_ASSERT_FATAL(large != NULL);
+    for (j = 0; j < large_len; j++) {
+        large[j] = (uint8_t) (j % 251);
+    }
+    f = fopen(_tmp_file_name, "w+");
+    CU_ASSERT_NOT_EQUAL_FATAL(f, NULL);
+    write_example_kastore(f, large, large_len, 1);
+    serial_size = ftell(f);
+    serial_bytes = malloc((size_t) serial_size);
+    parallel_bytes = malloc((size_t) serial_size);
+    CU_ASSERT_FATAL(serial_bytes != NULL && parallel_bytes != NULL);
+    fseek(f, 0, SEEK_SET);
+    CU_ASSERT_EQUAL_FATAL(fread(serial_bytes, (size_t) serial_size, 1, f), 1);
+    fclose(f);
+
+    for (k = 0; k < sizeof(num_threads) / sizeof(*num_threads); k++) {
+        /* Fill the file with junk first to check that all bytes are written */
+        f = fopen(_tmp_file_name, "w+");
+        CU_ASSERT_NOT_EQUAL_FATAL(f, NULL);
+        memset(parallel_bytes, 0xff, (size_t) serial_size);
+        CU_ASSERT_EQUAL_FATAL(fwrite(parallel_bytes, (size_t) serial_size, 1, f), 1);
+        fseek(f, 0, SEEK_SET);
+        write_example_kastore(f, large, large_len, num_threads[k]);
+        parallel_size = ftell(f);
+        CU_ASSERT_EQUAL_FATAL(parallel_size, serial_size);
+        /* A second store in the same stream */
+        write_example_kastore(f, large, 16, num_threads[k]);
+
+        fseek(f, 0, SEEK_SET);
+        CU_ASSERT_EQUAL_FATAL(fread(parallel_bytes, (size_t) serial_size, 1, f), 1);
+        CU_ASSERT_EQUAL(memcmp(serial_bytes, parallel_bytes, (size_t) serial_size), 0);
+
+        fseek(f, 0, SEEK_SET);
+        ret = kastore_openf_threads(&store, f, "r", KAS_READ_ALL, num_threads[k]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL(ftell(f), serial_size);
+        ret = kastore_gets_uint8(&store, "large", &array, &len);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL_FATAL(len, large_len);
+        CU_ASSERT_EQUAL(memcmp(array, large, large_len), 0);
+        kastore_close(&store);
+
+        ret = kastore_openf_threads(&store, f, "r", KAS_READ_ALL, num_threads[k]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = kastore_gets_uint8(&store, "large", &array, &len);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL_FATAL(len, 16);
+        CU_ASSERT_EQUAL(memcmp(array, large, 16), 0);
+        kastore_close(&store);
+        CU_ASSERT_EQUAL(fgetc(f), EOF);
+        fclose(f);
+    }
+
+    /* Truncated files are detected */
+    CU_ASSERT_EQUAL_FATAL(truncate(_tmp_file_name, serial_size - 1), 0);
+    ret = kastore_open_threads(&store, _tmp_file_name, "r", KAS_READ_ALL, 4);
+    CU_ASSERT_EQUAL(ret, KAS_ERR_BAD_FILE_FORMAT);
+    kastore_close(&store);
+
+    free(large);
+    free(serial_bytes);
+    free(parallel_bytes);
+}
+
+static void
+test_parallel_round_trip(void)
+{
+    int ret;
+    tsk_treeseq_t *ts = caterpillar_tree(50, 30, 3);
+    tsk_table_collection_t t1, t2;
+    tsk_size_t num_threads[] = { 0, 1, 2, 4, 64 };
+    size_t j;
+
+    for (j = 0; j < sizeof(num_threads) / sizeof(*num_threads); j++) {
+        ret = tsk_table_collection_dump_parallel(
+            ts->tables, _tmp_file_name, num_threads[j], 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_table_collection_load(&t1, _tmp_file_name, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, ts->tables, 0));
+        ret = tsk_table_collection_load_parallel(
+            &t2, _tmp_file_name, num_threads[j], 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+        tsk_table_collection_free(&t2);
+
+        /* Options are passed through */
+        ret = tsk_table_collection_load_parallel(
+            &t2, _tmp_file_name, num_threads[j], TSK_LOAD_SKIP_METADATA);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, TSK_CMP_IGNORE_METADATA));
+        CU_ASSERT_EQUAL(t2.nodes.metadata_length, 0);
+        tsk_table_collection_free(&t2);
+        ret = tsk_table_collection_load_parallel(&t2, _tmp_file_name, num_threads[j],
+            TSK_LOAD_MMAP | TSK_LOAD_SKIP_PROVENANCES);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, TSK_CMP_IGNORE_PROVENANCE));
+        tsk_table_collection_free(&t2);
+        tsk_table_collection_free(&t1);
+    }
+
+    ret = tsk_table_collection_load_parallel(&t1, "/", 4, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_IO);
+    tsk_table_collection_free(&t1);
+    ret = tsk_table_collection_dump_parallel(ts->tables, "/", 4, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_IO);
+
+    tsk_treeseq_free(ts);
+    free(ts);
+}
+
+static long
+get_file_size(const char *filename)
+{
+    long size;
+    FILE *f = fopen(filename, "r");
+
+    CU_ASSERT_FATAL(f != NULL);
+    CU_ASSERT_EQUAL_FATAL(fseek(f, 0, SEEK_END), 0);
+    size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+static void
+verify_corrupt_compressed_column(const char *source, const char *key, void *array,
+    size_t array_len, int type, int expected)
+{
+    int ret;
+    tsk_table_collection_t tables;
+    tsk_flags_t load_options[] = { 0, TSK_LOAD_MMAP };
+    size_t j;
+
+    copy_store_replace_column(source, _tmp_file_name, key, array, array_len, type);
+    for (j = 0; j < sizeof(load_options) / sizeof(*load_options); j++) {
+        ret = tsk_table_collection_load(&tables, _tmp_file_name, load_options[j]);
+        CU_ASSERT_EQUAL(ret, expected);
+        tsk_table_collection_free(&tables);
+    }
+}
+
+static void
+test_compressed_columns(void)
+{
+    int ret;
+    tsk_treeseq_t *ts = caterpillar_tree(500, 30, 30);
+    tsk_table_collection_t tables;
+    tsk_table_collection_reader_t reader;
+    kastore_t store;
+    char source[] = "/tmp/tsk_c_test_compressed_XXXXXX";
+    const char *keys[] = { "edges/left/compressed", "edges/parent/compressed" };
+    char data[1000];
+    uint64_t x = 12345;
+    uint64_t num_elements;
+    uint32_t *version;
+    uint8_t *encoded, *corrupt;
+    size_t j, len, encoded_len;
+    int fd;
+    FILE *f;
+
+    fd = mkstemp(source);
+    CU_ASSERT_FATAL(fd != -1);
+    close(fd);
+
+    /* Random data doesn't compress, so is stored verbatim */
+    ret = tsk_table_collection_copy(ts->tables, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < sizeof(data); j++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        data[j] = (char) (x >> 56);
+    }
+    ret = tsk_reference_sequence_set_data(
+        &tables.reference_sequence, data, (tsk_size_t) sizeof(data));
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_dump(&tables, source, TSK_DUMP_COMPRESS);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    ret = kastore_open(&store, source, "r", KAS_READ_ALL);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(kastore_containss(&store, "edges/left"), 0);
+    CU_ASSERT_EQUAL(kastore_containss(&store, "edges/left/compressed"), 1);
+    CU_ASSERT_EQUAL(kastore_containss(&store, "edges/parent/compressed"), 1);
+    CU_ASSERT_EQUAL(kastore_containss(&store, "reference_sequence/data"), 1);
+    CU_ASSERT_EQUAL(
+        kastore_containss(&store, "reference_sequence/data/compressed"), 0);
+    CU_ASSERT_EQUAL(kastore_containss(&store, "format/name"), 1);
+    /* Earlier versions of tskit reject the file as too new */
+    ret = kastore_gets_uint32(&store, "format/version", &version, &len);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(len, 2);
+    CU_ASSERT_EQUAL(version[0], TSK_FILE_FORMAT_COMPRESSED_VERSION_MAJOR);
+    CU_ASSERT_EQUAL(version[1], TSK_FILE_FORMAT_VERSION_MINOR);
+    kastore_close(&store);
+
+    /* Files are read the same way whether or not they are compressed */
+    f = fopen(source, "rb");
+    CU_ASSERT_FATAL(f != NULL);
+    ret = tsk_table_collection_reader_init(&reader, f, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_reader_next(&reader);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&reader.tables, &tables, 0));
+    tsk_table_collection_reader_free(&reader);
+    fclose(f);
+
+    /* Corrupt compressed columns are rejected. The edge coordinates are
+     * LZ compressed and the edge parents are delta encoded. */
+    ret = kastore_open(&store, source, "r", KAS_READ_ALL);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < sizeof(keys) / sizeof(*keys); j++) {
+        ret = kastore_gets_uint8(&store, keys[j], &encoded, &encoded_len);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_FATAL(encoded_len > 16);
+        corrupt = malloc(encoded_len + 1);
+        CU_ASSERT_FATAL(corrupt != NULL);
+
+        memcpy(corrupt, encoded, encoded_len);
+        verify_corrupt_compressed_column(
+            source, keys[j], corrupt, encoded_len, KAS_INT8, TSK_ERR_BAD_COLUMN_TYPE);
+        verify_corrupt_compressed_column(
+            source, keys[j], corrupt, 8, KAS_UINT8, TSK_ERR_FILE_FORMAT);
+        verify_corrupt_compressed_column(
+            source, keys[j], corrupt, encoded_len - 1, KAS_UINT8, TSK_ERR_FILE_FORMAT);
+        corrupt[encoded_len] = 0;
+        verify_corrupt_compressed_column(
+            source, keys[j], corrupt, encoded_len + 1, KAS_UINT8, TSK_ERR_FILE_FORMAT);
+        /* Unknown codec */
+        corrupt[0] = 0;
+        verify_corrupt_compressed_column(
+            source, keys[j], corrupt, encoded_len, KAS_UINT8, TSK_ERR_FILE_FORMAT);
+        /* Unknown type */
+        memcpy(corrupt, encoded, encoded_len);
+        corrupt[1] = KAS_NUM_TYPES;
+        verify_corrupt_compressed_column(
+            source, keys[j], corrupt, encoded_len, KAS_UINT8, TSK_ERR_FILE_FORMAT);
+        /* Wrong number of elements */
+        memcpy(corrupt, encoded, encoded_len);
+        memcpy(&num_elements, corrupt + 8, sizeof(num_elements));
+        num_elements++;
+        memcpy(corrupt + 8, &num_elements, sizeof(num_elements));
+        verify_corrupt_compressed_column(
+            source, keys[j], corrupt, encoded_len, KAS_UINT8, TSK_ERR_FILE_FORMAT);
+        num_elements = UINT64_MAX;
+        memcpy(corrupt + 8, &num_elements, sizeof(num_elements));
+        verify_corrupt_compressed_column(
+            source, keys[j], corrupt, encoded_len, KAS_UINT8, TSK_ERR_FILE_FORMAT);
+        free(corrupt);
+    }
+    kastore_close(&store);
+    unlink(source);
+
+    tsk_table_collection_free(&tables);
+    tsk_treeseq_free(ts);
+    free(ts);
+}
+
+static void
+test_compressed_round_trip(void)
+{
+    int ret;
+    tsk_treeseq_t *ts = caterpillar_tree(500, 30, 30);
+    tsk_treeseq_t ts2;
+    tsk_table_collection_t t1;
+    long raw_size, compressed_size;
+    tsk_flags_t load_options[]
+        = { 0, TSK_LOAD_MMAP, TSK_LOAD_SKIP_PROVENANCES, TSK_LOAD_SKIP_METADATA };
+    tsk_flags_t dump_options[] = { 0, TSK_DUMP_FORCE_OFFSET_64 };
+    size_t j, k;
+
+    ret = tsk_treeseq_dump(ts, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    raw_size = get_file_size(_tmp_file_name);
+
+    for (k = 0; k < sizeof(dump_options) / sizeof(*dump_options); k++) {
+        ret = tsk_treeseq_dump(ts, _tmp_file_name, TSK_DUMP_COMPRESS | dump_options[k]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        compressed_size = get_file_size(_tmp_file_name);
+        CU_ASSERT_TRUE(compressed_size < raw_size);
+
+        for (j = 0; j < sizeof(load_options) / sizeof(*load_options); j++) {
+            ret = tsk_table_collection_load(&t1, _tmp_file_name, load_options[j]);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, ts->tables,
+                TSK_CMP_IGNORE_METADATA | TSK_CMP_IGNORE_PROVENANCE));
+            if (load_options[j] == 0) {
+                CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, ts->tables, 0));
+            }
+            tsk_table_collection_free(&t1);
+        }
+        ret = tsk_table_collection_load_parallel(&t1, _tmp_file_name, 4, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, ts->tables, 0));
+        tsk_table_collection_free(&t1);
+
+        ret = tsk_treeseq_load(&ts2, _tmp_file_name, TSK_LOAD_MMAP);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(ts2.tables, ts->tables, 0));
+        tsk_treeseq_free(&ts2);
+    }
+
+    tsk_treeseq_free(ts);
+    free(ts);
+}
+
+static void
+test_skip_metadata(void)
+{
+    int ret;
+    tsk_treeseq_t *ts1 = caterpillar_tree(5, 3, 3);
+    tsk_treeseq_t ts2;
+    tsk_table_collection_t t1, t2;
+    tsk_flags_t dump_flags[] = { 0, TSK_DUMP_FORCE_OFFSET_64 };
+    size_t j;
+    FILE *f;
+
+    for (j = 0; j < sizeof(dump_flags) / sizeof(*dump_flags); j++) {
+        ret = tsk_treeseq_dump(ts1, _tmp_file_name, dump_flags[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_table_collection_load(&t1, _tmp_file_name, TSK_LOAD_SKIP_METADATA);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+        CU_ASSERT_FALSE(tsk_table_collection_equals(&t1, ts1->tables, 0));
+        CU_ASSERT_TRUE(
+            tsk_table_collection_equals(&t1, ts1->tables, TSK_CMP_IGNORE_METADATA));
+        CU_ASSERT_EQUAL(t1.populations.num_rows, ts1->tables->populations.num_rows);
+        CU_ASSERT_EQUAL(t1.individuals.metadata_length, 0);
+        CU_ASSERT_EQUAL(t1.nodes.metadata_length, 0);
+        CU_ASSERT_EQUAL(t1.edges.metadata_length, 0);
+        CU_ASSERT_EQUAL(t1.migrations.metadata_length, 0);
+        CU_ASSERT_EQUAL(t1.sites.metadata_length, 0);
+        CU_ASSERT_EQUAL(t1.mutations.metadata_length, 0);
+        CU_ASSERT_EQUAL(t1.populations.metadata_length, 0);
+        CU_ASSERT_EQUAL(t1.nodes.metadata_schema_length, 0);
+        CU_ASSERT_EQUAL(t1.nodes.metadata_offset[t1.nodes.num_rows], 0);
+        CU_ASSERT_EQUAL(t1.populations.metadata_offset[t1.populations.num_rows], 0);
+        /* Top-level and reference sequence metadata are still loaded */
+        CU_ASSERT_EQUAL(t1.metadata_length, ts1->tables->metadata_length);
+        CU_ASSERT_EQUAL(t1.metadata_schema_length, ts1->tables->metadata_schema_length);
+        CU_ASSERT_TRUE(tsk_reference_sequence_equals(
+            &t1.reference_sequence, &ts1->tables->reference_sequence, 0));
+        tsk_table_collection_free(&t1);
+    }
+
+    ret = tsk_table_collection_load(&t1, _tmp_file_name, TSK_LOAD_SKIP_METADATA);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    /* Test _loadf code path as well */
+    f = fopen(_tmp_file_name, "r+");
+    ret = tsk_table_collection_loadf(&t2, f, TSK_LOAD_SKIP_METADATA);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+    fclose(f);
+    tsk_table_collection_free(&t2);
+
+    /* Can be combined with TSK_LOAD_MMAP */
+    ret = tsk_table_collection_load(
+        &t2, _tmp_file_name, TSK_LOAD_SKIP_METADATA | TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+    tsk_table_collection_free(&t2);
+
+    /* Edge metadata can be skipped when it is disabled */
+    ret = tsk_table_collection_load(
+        &t2, _tmp_file_name, TSK_LOAD_SKIP_METADATA | TSK_TC_NO_EDGE_METADATA);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(t2.edges.options & TSK_TABLE_NO_METADATA);
+    CU_ASSERT_TRUE(tsk_node_table_equals(&t1.nodes, &t2.nodes, 0));
+    tsk_table_collection_free(&t2);
+
+    /* We should be able to make a tree sequence */
+    ret = tsk_treeseq_init(&ts2, &t1, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_treeseq_free(&ts2);
+
+    /* Do the same thing with treeseq API */
+    ret = tsk_treeseq_load(&ts2, _tmp_file_name, TSK_LOAD_SKIP_METADATA);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, ts2.tables, 0));
+    tsk_treeseq_free(&ts2);
+
+    tsk_table_collection_free(&t1);
+    tsk_treeseq_free(ts1);
+    free(ts1);
+}
+
+static void
+test_skip_provenances(void)
+{
+    int ret;
+    tsk_treeseq_t *ts1 = caterpillar_tree(5, 3, 3);
+    tsk_treeseq_t ts2;
+    tsk_table_collection_t t1, t2;
+    FILE *f;
+
+    CU_ASSERT_TRUE(ts1->tables->provenances.num_rows > 0);
+    ret = tsk_treeseq_dump(ts1, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_load(&t1, _tmp_file_name, TSK_LOAD_SKIP_PROVENANCES);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    CU_ASSERT_FALSE(tsk_table_collection_equals(&t1, ts1->tables, 0));
+    CU_ASSERT_TRUE(
+        tsk_table_collection_equals(&t1, ts1->tables, TSK_CMP_IGNORE_PROVENANCE));
+    CU_ASSERT_EQUAL(t1.provenances.num_rows, 0);
+
+    /* Test _loadf code path as well */
+    f = fopen(_tmp_file_name, "r+");
+    ret = tsk_table_collection_loadf(
+        &t2, f, TSK_LOAD_SKIP_PROVENANCES | TSK_LOAD_SKIP_METADATA);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, TSK_CMP_IGNORE_METADATA));
+    CU_ASSERT_EQUAL(t2.provenances.num_rows, 0);
+    CU_ASSERT_EQUAL(t2.nodes.metadata_length, 0);
+    fclose(f);
+    tsk_table_collection_free(&t2);
+
+    /* Do the same thing with treeseq API */
+    ret = tsk_treeseq_load(&ts2, _tmp_file_name, TSK_LOAD_SKIP_PROVENANCES);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, ts2.tables, 0));
+    tsk_treeseq_free(&ts2);
+
+    tsk_table_collection_free(&t1);
+    tsk_treeseq_free(ts1);
+    free(ts1);
+}
+
+static void
+test_mmap_round_trip(void)
+{
+    int ret;
+    tsk_treeseq_t *ts1 = caterpillar_tree(5, 3, 3);
+    tsk_treeseq_t ts2;
+    tsk_table_collection_t t1, t2, t3;
+    tsk_flags_t dump_flags[] = { 0, TSK_DUMP_FORCE_OFFSET_64 };
+    size_t j;
+    FILE *f;
+
+    ret = tsk_treeseq_copy_tables(ts1, &t1, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    for (j = 0; j < sizeof(dump_flags) / sizeof(*dump_flags); j++) {
+        ret = tsk_table_collection_dump(&t1, _tmp_file_name, dump_flags[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_table_collection_load(&t2, _tmp_file_name, TSK_LOAD_MMAP);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_FATAL(t2.mapped_store != NULL);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+        CU_ASSERT_TRUE(tsk_table_collection_has_index(&t2, 0));
+        CU_ASSERT_TRUE(tsk_table_collection_has_reference_sequence(&t2));
+
+        /* A copy is independent of the mapping and can be modified */
+        ret = tsk_table_collection_copy(&t2, &t3, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL(t3.mapped_store, NULL);
+        ret = tsk_node_table_add_row(&t3.nodes, 0, 1.0, TSK_NULL, TSK_NULL, NULL, 0);
+        CU_ASSERT_FATAL(ret >= 0);
+        tsk_table_collection_free(&t3);
+
+        /* Rebuilding the indexes replaces the mapped arrays */
+        ret = tsk_table_collection_build_index(&t2, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+        tsk_table_collection_free(&t2);
+    }
+
+    /* Skipping parts of the file is supported */
+    ret = tsk_table_collection_load(
+        &t2, _tmp_file_name, TSK_LOAD_MMAP | TSK_LOAD_SKIP_TABLES);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, TSK_CMP_IGNORE_TABLES));
+    CU_ASSERT_EQUAL(t2.nodes.num_rows, 0);
+    tsk_table_collection_free(&t2);
+    ret = tsk_table_collection_load(
+        &t2, _tmp_file_name, TSK_LOAD_MMAP | TSK_LOAD_SKIP_REFERENCE_SEQUENCE);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(
+        &t1, &t2, TSK_CMP_IGNORE_REFERENCE_SEQUENCE));
+    CU_ASSERT_FALSE(tsk_table_collection_has_reference_sequence(&t2));
+    tsk_table_collection_free(&t2);
+
+    /* Use loadf form; the stream is left at the end of the store */
+    f = fopen(_tmp_file_name, "w+");
+    CU_ASSERT_NOT_EQUAL_FATAL(f, NULL);
+    ret = tsk_table_collection_dumpf(&t1, f, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    fseek(f, 0, SEEK_SET);
+    ret = tsk_table_collection_loadf(&t2, f, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+    CU_ASSERT_EQUAL(fgetc(f), EOF);
+    tsk_table_collection_free(&t2);
+    fclose(f);
+
+    /* Do the same thing with treeseq API */
+    ret = tsk_treeseq_dump(ts1, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_load(&ts2, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, ts2.tables, 0));
+    CU_ASSERT_EQUAL(tsk_treeseq_get_num_trees(&ts2), tsk_treeseq_get_num_trees(ts1));
+    tsk_treeseq_free(&ts2);
+
+    f = fopen(_tmp_file_name, "r");
+    CU_ASSERT_NOT_EQUAL_FATAL(f, NULL);
+    ret = tsk_treeseq_loadf(&ts2, f, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, ts2.tables, 0));
+    tsk_treeseq_free(&ts2);
+    fclose(f);
+
+    tsk_table_collection_free(&t1);
+    tsk_treeseq_free(ts1);
+    free(ts1);
+}
+
+static void
+test_mmap_errors(void)
+{
+    int ret;
+    tsk_treeseq_t *ts = caterpillar_tree(5, 3, 3);
+    tsk_table_collection_t tables;
+    FILE *f;
+
+    ret = tsk_treeseq_dump(ts, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    /* Mapped tables cannot be overwritten by loading into them */
+    ret = tsk_table_collection_load(&tables, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_load(&tables, _tmp_file_name, TSK_NO_INIT);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_table_collection_load(
+        &tables, _tmp_file_name, TSK_NO_INIT | TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    tsk_table_collection_free(&tables);
+
+    /* The store must start at an aligned offset */
+    f = fopen(_tmp_file_name, "w+");
+    CU_ASSERT_NOT_EQUAL_FATAL(f, NULL);
+    CU_ASSERT_EQUAL_FATAL(fputc('X', f), 'X');
+    ret = tsk_treeseq_dumpf(ts, f, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    fseek(f, 1, SEEK_SET);
+    ret = tsk_table_collection_loadf(&tables, f, TSK_LOAD_MMAP);
+    CU_ASSERT_TRUE(tsk_is_kas_error(ret));
+    CU_ASSERT_EQUAL(tsk_get_kas_error(ret), KAS_ERR_ILLEGAL_OPERATION);
+    tsk_table_collection_free(&tables);
+
+    /* Reading the same store normally works */
+    fseek(f, 1, SEEK_SET);
+    ret = tsk_table_collection_loadf(&tables, f, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&tables, ts->tables, 0));
+    tsk_table_collection_free(&tables);
+    fclose(f);
+
+    /* Truncated files are detected */
+    f = fopen(_tmp_file_name, "w+");
+    CU_ASSERT_NOT_EQUAL_FATAL(f, NULL);
+    ret = tsk_treeseq_dumpf(ts, f, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    fclose(f);
+    CU_ASSERT_EQUAL_FATAL(truncate(_tmp_file_name, 1024), 0);
+    ret = tsk_table_collection_load(&tables, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_TRUE(tsk_is_kas_error(ret));
+    CU_ASSERT_EQUAL(tsk_get_kas_error(ret), KAS_ERR_BAD_FILE_FORMAT);
+    tsk_table_collection_free(&tables);
+
+    tsk_treeseq_free(ts);
+    free(ts);
+}
+
+static void
+test_mmap_modify(void)
+{
+    int ret;
+    tsk_id_t ret_id;
+    tsk_treeseq_t *ts = caterpillar_tree(5, 3, 3);
+    tsk_table_collection_t tables;
+    tsk_node_table_batch_t node_batch;
+    tsk_edge_table_batch_t edge_batch;
+    tsk_size_t j, num_nodes;
+    double *time;
+    tsk_flags_t *flags;
+    tsk_bool_t *keep;
+
+    ret = tsk_treeseq_dump(ts, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_load(&tables, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    num_nodes = tables.nodes.num_rows;
+
+    /* None of the tables can be grown */
+    ret_id = tsk_individual_table_add_row(
+        &tables.individuals, 0, NULL, 0, NULL, 0, NULL, 0);
+    CU_ASSERT_EQUAL(ret_id, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret_id = tsk_node_table_add_row(&tables.nodes, 0, 1.0, TSK_NULL, TSK_NULL, NULL, 0);
+    CU_ASSERT_EQUAL(ret_id, TSK_ERR_CANT_MODIFY_MAPPED);
+    CU_ASSERT_EQUAL(tables.nodes.num_rows, num_nodes);
+    ret_id = tsk_edge_table_add_row(&tables.edges, 0, 1, 0, 1, NULL, 0);
+    CU_ASSERT_EQUAL(ret_id, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret_id = tsk_migration_table_add_row(&tables.migrations, 0, 1, 0, 0, 1, 0, NULL, 0);
+    CU_ASSERT_EQUAL(ret_id, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret_id = tsk_site_table_add_row(&tables.sites, 0.5, "A", 1, NULL, 0);
+    CU_ASSERT_EQUAL(ret_id, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret_id = tsk_mutation_table_add_row(
+        &tables.mutations, 0, 0, TSK_NULL, TSK_UNKNOWN_TIME, "T", 1, NULL, 0);
+    CU_ASSERT_EQUAL(ret_id, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret_id = tsk_population_table_add_row(&tables.populations, NULL, 0);
+    CU_ASSERT_EQUAL(ret_id, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret_id = tsk_provenance_table_add_row(&tables.provenances, "a", 1, "b", 1);
+    CU_ASSERT_EQUAL(ret_id, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret = tsk_node_table_reserve_rows(&tables.nodes, 1, 0, &node_batch);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret = tsk_edge_table_reserve_rows(&tables.edges, 1, 0, &edge_batch);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_CANT_MODIFY_MAPPED);
+
+    /* Nor can they be modified in place, as the mapping is read-only */
+    keep = tsk_malloc(num_nodes * sizeof(*keep));
+    CU_ASSERT_FATAL(keep != NULL);
+    for (j = 0; j < num_nodes; j++) {
+        keep[j] = true;
+    }
+    ret = tsk_node_table_update_row(
+        &tables.nodes, 0, 0, 1.0, TSK_NULL, TSK_NULL, NULL, 0);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret = tsk_node_table_set_columns(&tables.nodes, num_nodes, tables.nodes.flags,
+        tables.nodes.time, NULL, NULL, NULL, NULL);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret = tsk_node_table_keep_rows(&tables.nodes, keep, 0, NULL);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret = tsk_edge_table_squash(&tables.edges);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret = tsk_table_collection_sort(&tables, NULL, 0);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret = tsk_table_collection_compute_mutation_parents(&tables, 0);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret = tsk_table_collection_compute_mutation_times(&tables, NULL, 0);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret = tsk_table_collection_deduplicate_sites(&tables, 0);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret = tsk_table_collection_simplify(&tables, NULL, 0, 0, NULL);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret = tsk_table_collection_subset(&tables, NULL, 0, 0);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_CANT_MODIFY_MAPPED);
+    ret = tsk_table_collection_delete_older(&tables, 1.0, 0);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_CANT_MODIFY_MAPPED);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&tables, ts->tables, 0));
+    free(keep);
+
+    /* Truncated rows cannot be overwritten */
+    ret = tsk_edge_table_truncate(&tables.edges, 1);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret_id = tsk_edge_table_add_row(&tables.edges, 0, 1, 0, 1, NULL, 0);
+    CU_ASSERT_EQUAL(ret_id, TSK_ERR_CANT_MODIFY_MAPPED);
+    CU_ASSERT_EQUAL(tables.edges.num_rows, 1);
+
+    /* The values that are not stored in columns can be replaced */
+    ret = tsk_table_collection_set_metadata(&tables, "abc", 3);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_reference_sequence_set_data(&tables.reference_sequence, "ACGT", 4);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_drop_index(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    /* Columns can be replaced by taking ownership of new arrays */
+    time = tsk_calloc(num_nodes, sizeof(*time));
+    flags = tsk_calloc(num_nodes, sizeof(*flags));
+    CU_ASSERT_FATAL(time != NULL && flags != NULL);
+    ret = tsk_node_table_takeset_columns(
+        &tables.nodes, num_nodes, flags, time, NULL, NULL, NULL, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(tables.nodes.time, time);
+    tsk_table_collection_free(&tables);
+
+    tsk_treeseq_free(ts);
+    free(ts);
+}
+
+static void
+scale_bookmark(tsk_bookmark_t *bookmark, const tsk_bookmark_t *total, tsk_size_t num,
+    tsk_size_t denom)
+{
+    bookmark->individuals = total->individuals * num / denom;
+    bookmark->nodes = total->nodes * num / denom;
+    bookmark->edges = total->edges * num / denom;
+    bookmark->migrations = total->migrations * num / denom;
+    bookmark->sites = total->sites * num / denom;
+    bookmark->mutations = total->mutations * num / denom;
+    bookmark->populations = total->populations * num / denom;
+    bookmark->provenances = total->provenances * num / denom;
+}
+
+static void
+verify_increments_round_trip(tsk_table_collection_t *tables, tsk_flags_t dump_options)
+{
+    int ret;
+    tsk_table_collection_t t1, t2;
+    tsk_bookmark_t total, written, pos;
+    tsk_size_t j;
+    tsk_size_t num_increments = 4;
+
+    ret = tsk_table_collection_record_num_rows(tables, &total);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    memset(&written, 0, sizeof(written));
+
+    /* Write the rows in a sequence of increments, as a simulation would */
+    for (j = 1; j <= num_increments; j++) {
+        ret = tsk_table_collection_copy(tables, &t1, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        scale_bookmark(&pos, &total, j, num_increments);
+        ret = tsk_table_collection_truncate(&t1, &pos);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_table_collection_dump_increment(
+            &t1, _tmp_file_name, &written, dump_options);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL(memcmp(&written, &pos, sizeof(pos)), 0);
+
+        ret = tsk_table_collection_load_increments(&t2, _tmp_file_name, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+        tsk_table_collection_free(&t2);
+        tsk_table_collection_free(&t1);
+    }
+
+    ret = tsk_table_collection_load_increments(&t1, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, tables, 0));
+    CU_ASSERT_FALSE(tsk_table_collection_has_index(&t1, 0));
+    tsk_table_collection_free(&t1);
+
+    ret = tsk_table_collection_load_increments(
+        &t1, _tmp_file_name, TSK_LOAD_SKIP_PROVENANCES);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(t1.provenances.num_rows, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, tables, TSK_CMP_IGNORE_PROVENANCE));
+    tsk_table_collection_free(&t1);
+
+    ret = tsk_table_collection_load_increments(
+        &t1, _tmp_file_name, TSK_LOAD_SKIP_TABLES);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(t1.nodes.num_rows, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, tables, TSK_CMP_IGNORE_TABLES));
+    tsk_table_collection_free(&t1);
+
+    /* The base is an ordinary file */
+    ret = tsk_table_collection_load(&t1, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(t1.nodes.num_rows, total.nodes / num_increments);
+    tsk_table_collection_free(&t1);
+}
+
+static void
+test_increments_round_trip(void)
+{
+    int ret;
+    tsk_treeseq_t *ts = caterpillar_tree(50, 5, 5);
+    tsk_table_collection_t tables;
+    tsk_flags_t dump_options[]
+        = { 0, TSK_DUMP_COMPRESS, TSK_DUMP_FORCE_OFFSET_64,
+              TSK_DUMP_COMPRESS | TSK_DUMP_FORCE_OFFSET_64 };
+    size_t j, k;
+    char record[] = "provenance record";
+
+    ret = tsk_treeseq_copy_tables(ts, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < 8; j++) {
+        ret = tsk_provenance_table_add_row(&tables.provenances, "time", 4, record,
+            (tsk_size_t) j + 1);
+        CU_ASSERT_FATAL(ret >= 0);
+    }
+
+    for (k = 0; k < sizeof(dump_options) / sizeof(*dump_options); k++) {
+        verify_increments_round_trip(&tables, dump_options[k]);
+    }
+
+    /* A file without increments loads as normal */
+    ret = tsk_treeseq_dump(ts, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_load_increments(&tables, _tmp_file_name, TSK_NO_INIT);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&tables, ts->tables, 0));
+    CU_ASSERT_TRUE(tsk_table_collection_has_index(&tables, 0));
+
+    tsk_table_collection_free(&tables);
+    tsk_treeseq_free(ts);
+    free(ts);
+}
+
+static void
+test_increments_errors(void)
+{
+    int ret;
+    tsk_treeseq_t *ts = caterpillar_tree(10, 3, 3);
+    tsk_table_collection_t tables, t1;
+    tsk_bookmark_t bookmark, saved;
+    kastore_t store;
+    int8_t x = 0;
+    FILE *f;
+
+    ret = tsk_treeseq_copy_tables(ts, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    memset(&bookmark, 0, sizeof(bookmark));
+
+    ret = tsk_table_collection_dump_increment(&tables, "/", &bookmark, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_IO);
+    CU_ASSERT_EQUAL(bookmark.nodes, 0);
+
+    ret = tsk_table_collection_dump_increment(&tables, _tmp_file_name, &bookmark, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(bookmark.nodes, tables.nodes.num_rows);
+
+    /* Bookmarks beyond the end of the tables are errors */
+    saved = bookmark;
+    bookmark.nodes++;
+    ret = tsk_table_collection_dump_increment(&tables, _tmp_file_name, &bookmark, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_TABLE_POSITION);
+    CU_ASSERT_EQUAL(bookmark.nodes, saved.nodes + 1);
+
+    /* An empty increment is fine */
+    bookmark = saved;
+    ret = tsk_table_collection_dump_increment(&tables, _tmp_file_name, &bookmark, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_load_increments(&t1, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &tables, 0));
+    tsk_table_collection_free(&t1);
+
+    /* An increment that skips rows doesn't match the preceding rows */
+    ret = tsk_node_table_add_row(&tables.nodes, 0, 0, TSK_NULL, TSK_NULL, NULL, 0);
+    CU_ASSERT_FATAL(ret >= 0);
+    ret = tsk_node_table_add_row(&tables.nodes, 0, 0, TSK_NULL, TSK_NULL, NULL, 0);
+    CU_ASSERT_FATAL(ret >= 0);
+    bookmark.nodes++;
+    ret = tsk_table_collection_dump_increment(&tables, _tmp_file_name, &bookmark, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_load_increments(&t1, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_INCREMENT);
+    tsk_table_collection_free(&t1);
+
+    /* Concatenated stores that aren't increments are errors */
+    ret = tsk_table_collection_dump(&tables, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    f = fopen(_tmp_file_name, "ab");
+    CU_ASSERT_FATAL(f != NULL);
+    ret = kastore_openf(&store, f, "w", 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = kastore_puts_int8(&store, "x", &x, 1, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = kastore_close(&store);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    fclose(f);
+    ret = tsk_table_collection_load_increments(&t1, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_INCREMENT);
+    tsk_table_collection_free(&t1);
+
+    ret = tsk_table_collection_load_increments(&t1, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    tsk_table_collection_free(&t1);
+
+    ret = tsk_table_collection_load_increments(&t1, "/", 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_IO);
+    tsk_table_collection_free(&t1);
+
+    tsk_table_collection_free(&tables);
+    tsk_treeseq_free(ts);
+    free(ts);
+}
+
+static void
+test_reader_round_trip(void)
+{
+    int ret;
+    tsk_treeseq_t *ts1 = caterpillar_tree(50, 5, 5);
+    tsk_treeseq_t *ts2 = caterpillar_tree(5, 3, 3);
+    tsk_table_collection_t tables[4];
+    tsk_table_collection_reader_t reader;
+    tsk_flags_t dump_options[]
+        = { 0, TSK_DUMP_COMPRESS, TSK_DUMP_FORCE_OFFSET_64, TSK_DUMP_COMPRESS };
+    tsk_flags_t load_options[] = { 0, TSK_LOAD_SKIP_TABLES,
+        TSK_LOAD_SKIP_REFERENCE_SEQUENCE, TSK_LOAD_SKIP_METADATA,
+        TSK_LOAD_SKIP_PROVENANCES };
+    tsk_flags_t cmp_options[] = { 0, TSK_CMP_IGNORE_TABLES,
+        TSK_CMP_IGNORE_REFERENCE_SEQUENCE, TSK_CMP_IGNORE_METADATA,
+        TSK_CMP_IGNORE_PROVENANCE };
+    size_t num_tables = sizeof(tables) / sizeof(*tables);
+    size_t j, k, buffer_size;
+    void *buffer;
+    double *node_time;
+    FILE *f;
+
+    ret = tsk_treeseq_copy_tables(ts1, &tables[0], 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_copy_tables(ts2, &tables[1], 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_copy_tables(ts1, &tables[2], 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_copy_tables(ts2, &tables[3], 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    /* Properties missing from a collection must not be inherited from the last */
+    ret = tsk_table_collection_drop_index(&tables[3], 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_reference_sequence_free(&tables[3].reference_sequence);
+    ret = tsk_reference_sequence_init(&tables[3].reference_sequence, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_clear(&tables[3],
+        TSK_CLEAR_METADATA_SCHEMAS | TSK_CLEAR_TS_METADATA_AND_SCHEMA);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_set_time_units(&tables[2], "generations", 11);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    f = fopen(_tmp_file_name, "w+");
+    CU_ASSERT_FATAL(f != NULL);
+    for (j = 0; j < num_tables; j++) {
+        ret = tsk_table_collection_dumpf(&tables[j], f, dump_options[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+    }
+
+    for (k = 0; k < sizeof(load_options) / sizeof(*load_options); k++) {
+        rewind(f);
+        ret = tsk_table_collection_reader_init(&reader, f, load_options[k]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        for (j = 0; j < num_tables; j++) {
+            ret = tsk_table_collection_reader_next(&reader);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            CU_ASSERT_TRUE(
+                tsk_table_collection_equals(&reader.tables, &tables[j], cmp_options[k]));
+            if (load_options[k] == 0) {
+                CU_ASSERT_EQUAL(tsk_table_collection_has_index(&reader.tables, 0),
+                    tsk_table_collection_has_index(&tables[j], 0));
+            }
+        }
+        ret = tsk_table_collection_reader_next(&reader);
+        CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_EOF);
+        ret = tsk_table_collection_reader_next(&reader);
+        CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_EOF);
+        tsk_table_collection_reader_free(&reader);
+    }
+
+    /* Memory is reused when reading a smaller collection after a larger one */
+    rewind(f);
+    ret = tsk_table_collection_reader_init(&reader, f, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_reader_next(&reader);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    buffer = reader.buffer;
+    buffer_size = reader.buffer_size;
+    node_time = reader.tables.nodes.time;
+    ret = tsk_table_collection_reader_next(&reader);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&reader.tables, &tables[1], 0));
+    CU_ASSERT_EQUAL(reader.buffer, buffer);
+    CU_ASSERT_EQUAL(reader.buffer_size, buffer_size);
+    CU_ASSERT_EQUAL(reader.tables.nodes.time, node_time);
+
+    /* The tables can be modified between reads */
+    ret = tsk_node_table_add_row(
+        &reader.tables.nodes, 0, 1.0, TSK_NULL, TSK_NULL, NULL, 0);
+    CU_ASSERT_FATAL(ret >= 0);
+    ret = tsk_table_collection_reader_next(&reader);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&reader.tables, &tables[2], 0));
+    tsk_table_collection_reader_free(&reader);
+    fclose(f);
+
+    for (j = 0; j < num_tables; j++) {
+        tsk_table_collection_free(&tables[j]);
+    }
+    tsk_treeseq_free(ts1);
+    free(ts1);
+    tsk_treeseq_free(ts2);
+    free(ts2);
+}
+
+static void
+test_reader_errors(void)
+{
+    int ret;
+    tsk_treeseq_t *ts = caterpillar_tree(5, 3, 3);
+    tsk_table_collection_reader_t reader;
+    kastore_t store;
+    void *buffer = NULL;
+    size_t buffer_size = 0;
+    int8_t x = 0;
+    long size;
+    FILE *f;
+
+    f = fopen(_tmp_file_name, "w+");
+    CU_ASSERT_FATAL(f != NULL);
+
+    ret = tsk_table_collection_reader_init(&reader, f, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    tsk_table_collection_reader_free(&reader);
+
+    /* Reading an empty stream gives EOF */
+    ret = tsk_table_collection_reader_init(&reader, f, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_reader_next(&reader);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_EOF);
+
+    ret = kastore_openf_buffer(&store, f, &buffer, &buffer_size, 1);
+    CU_ASSERT_EQUAL_FATAL(ret, KAS_ERR_BAD_FLAGS);
+    kastore_close(&store);
+
+    /* A store that isn't a table collection is skipped over after the error */
+    ret = kastore_openf(&store, f, "w", 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = kastore_puts_int8(&store, "x", &x, 1, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = kastore_close(&store);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_dumpf(ts, f, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    rewind(f);
+    ret = tsk_table_collection_reader_next(&reader);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_REQUIRED_COL_NOT_FOUND);
+    ret = tsk_table_collection_reader_next(&reader);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&reader.tables, ts->tables, 0));
+    ret = tsk_table_collection_reader_next(&reader);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_EOF);
+    tsk_table_collection_reader_free(&reader);
+    fclose(f);
+
+    /* A truncated stream is a file format error */
+    ret = tsk_treeseq_dump(ts, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    size = get_file_size(_tmp_file_name);
+    CU_ASSERT_EQUAL_FATAL(truncate(_tmp_file_name, size / 2), 0);
+    f = fopen(_tmp_file_name, "r");
+    CU_ASSERT_FATAL(f != NULL);
+    ret = tsk_table_collection_reader_init(&reader, f, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_reader_next(&reader);
+    CU_ASSERT_TRUE(tsk_is_kas_error(ret));
+    CU_ASSERT_EQUAL(ret ^ (1 << TSK_KAS_ERR_BIT), KAS_ERR_BAD_FILE_FORMAT);
+    tsk_table_collection_reader_free(&reader);
+    fclose(f);
+
+    tsk_treeseq_free(ts);
+    free(ts);
+}
+
+static tsk_treeseq_t *
+paper_example(void)
+{
+    tsk_treeseq_t *ts = tsk_malloc(sizeof(*ts));
+
+    CU_ASSERT_FATAL(ts != NULL);
+    tsk_treeseq_from_text(ts, 10, paper_ex_nodes, paper_ex_edges, NULL, paper_ex_sites,
+        paper_ex_mutations, paper_ex_individuals, NULL, 0);
+    return ts;
+}
+
+static void
+test_treeseq_indexes_round_trip(void)
+{
+    int ret;
+    tsk_treeseq_t *examples[] = { caterpillar_tree(50, 5, 5), paper_example() };
+    tsk_treeseq_t ts;
+    tsk_tree_t tree;
+    tsk_flags_t dump_options[] = { 0, TSK_DUMP_COMPRESS };
+    tsk_flags_t load_options[] = { 0, TSK_LOAD_MMAP };
+    size_t j, k, l;
+    FILE *f;
+
+    for (j = 0; j < sizeof(examples) / sizeof(*examples); j++) {
+        for (k = 0; k < sizeof(dump_options) / sizeof(*dump_options); k++) {
+            ret = tsk_treeseq_dump(
+                examples[j], _tmp_file_name, TSK_DUMP_TREESEQ_INDEXES | dump_options[k]);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            for (l = 0; l < sizeof(load_options) / sizeof(*load_options); l++) {
+                ret = tsk_treeseq_load(
+                    &ts, _tmp_file_name, TSK_LOAD_TREESEQ_INDEXES | load_options[l]);
+                CU_ASSERT_EQUAL_FATAL(ret, 0);
+                CU_ASSERT_EQUAL(ts.mapped_indexes, load_options[l] == TSK_LOAD_MMAP);
+                verify_treeseq_indexes_equal(examples[j], &ts);
+                ret = tsk_tree_init(&tree, &ts, 0);
+                CU_ASSERT_EQUAL_FATAL(ret, 0);
+                for (ret = tsk_tree_first(&tree); ret == TSK_TREE_OK;
+                     ret = tsk_tree_next(&tree)) {
+                }
+                CU_ASSERT_EQUAL_FATAL(ret, 0);
+                CU_ASSERT_EQUAL(tree.index, -1);
+                tsk_tree_free(&tree);
+                tsk_treeseq_free(&ts);
+            }
+
+            /* The stored indexes are ignored unless requested */
+            ret = tsk_treeseq_load(&ts, _tmp_file_name, TSK_LOAD_MMAP);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            CU_ASSERT_FALSE(ts.mapped_indexes);
+            verify_treeseq_indexes_equal(examples[j], &ts);
+            tsk_treeseq_free(&ts);
+
+            f = fopen(_tmp_file_name, "w+");
+            CU_ASSERT_FATAL(f != NULL);
+            ret = tsk_treeseq_dumpf(
+                examples[j], f, TSK_DUMP_TREESEQ_INDEXES | dump_options[k]);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            ret = tsk_treeseq_dumpf(examples[j], f, dump_options[k]);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            rewind(f);
+            for (l = 0; l < 2; l++) {
+                ret = tsk_treeseq_loadf(&ts, f, TSK_LOAD_TREESEQ_INDEXES);
+                CU_ASSERT_EQUAL_FATAL(ret, 0);
+                verify_treeseq_indexes_equal(examples[j], &ts);
+                tsk_treeseq_free(&ts);
+            }
+            fclose(f);
+        }
+        tsk_treeseq_free(examples[j]);
+        free(examples[j]);
+    }
+}
+
+static void
+test_treeseq_indexes_errors(void)
+{
+    int ret;
+    tsk_treeseq_t *ts = caterpillar_tree(5, 3, 3);
+    tsk_treeseq_t ts2;
+    char indexed_file[] = "/tmp/tsk_c_test_indexed_XXXXXX";
+    char uuid[TSK_UUID_SIZE];
+    double breakpoints[] = { 0, 0.5, 1 };
+    int fd;
+
+    fd = mkstemp(indexed_file);
+    CU_ASSERT_FATAL(fd != -1);
+    close(fd);
+    ret = tsk_treeseq_dump(ts, indexed_file, TSK_DUMP_TREESEQ_INDEXES);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    /* Indexes written with different tables are recomputed */
+    memset(uuid, 'a', sizeof(uuid));
+    copy_store_replace_column(
+        indexed_file, _tmp_file_name, "uuid", uuid, sizeof(uuid), KAS_INT8);
+    ret = tsk_treeseq_load(
+        &ts2, _tmp_file_name, TSK_LOAD_TREESEQ_INDEXES | TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_FALSE(ts2.mapped_indexes);
+    verify_treeseq_indexes_equal(ts, &ts2);
+    tsk_treeseq_free(&ts2);
+
+    /* As are incomplete indexes */
+    copy_store_replace_column(
+        indexed_file, _tmp_file_name, "derived/breakpoints", NULL, 0, 0);
+    ret = tsk_treeseq_load(
+        &ts2, _tmp_file_name, TSK_LOAD_TREESEQ_INDEXES | TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_FALSE(ts2.mapped_indexes);
+    verify_treeseq_indexes_equal(ts, &ts2);
+    tsk_treeseq_free(&ts2);
+
+    copy_store_replace_column(
+        indexed_file, _tmp_file_name, "derived/samples", NULL, 0, KAS_FLOAT64);
+    ret = tsk_treeseq_load(&ts2, _tmp_file_name, TSK_LOAD_TREESEQ_INDEXES);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_treeseq_free(&ts2);
+
+    copy_store_replace_column(indexed_file, _tmp_file_name, "derived/samples",
+        breakpoints, 2, KAS_FLOAT64);
+    ret = tsk_treeseq_load(&ts2, _tmp_file_name, TSK_LOAD_TREESEQ_INDEXES);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_COLUMN_TYPE);
+    tsk_treeseq_free(&ts2);
+
+    copy_store_replace_column(indexed_file, _tmp_file_name, "derived/breakpoints",
+        breakpoints, 3, KAS_FLOAT64);
+    ret = tsk_treeseq_load(&ts2, _tmp_file_name, TSK_LOAD_TREESEQ_INDEXES);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_FILE_FORMAT);
+    tsk_treeseq_free(&ts2);
+    ret = tsk_treeseq_load(
+        &ts2, _tmp_file_name, TSK_LOAD_TREESEQ_INDEXES | TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_FILE_FORMAT);
+    tsk_treeseq_free(&ts2);
+
+    /* The stored indexes are not read unless requested */
+    ret = tsk_treeseq_load(&ts2, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    verify_treeseq_indexes_equal(ts, &ts2);
+    tsk_treeseq_free(&ts2);
+
+    unlink(indexed_file);
+    tsk_treeseq_free(ts);
+    free(ts);
+}
+
+/* Overwrite one byte of the stored array for the specified key in place,
+ * or if descriptor is true, clear the flags in the key's item descriptor. */
+static void
+corrupt_store_column(const char *filename, const char *key, bool descriptor)
+{
+    int ret;
+    kastore_t store;
+    kaitem_t *item;
+    long offset = -1;
+    size_t j;
+    FILE *f;
+
+    ret = kastore_open(&store, filename, "r", 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < store.num_items; j++) {
+        item = &store.items[j];
+        if (strlen(key) == item->key_len
+            && strncmp(key, item->key, item->key_len) == 0) {
+            CU_ASSERT_TRUE(item->has_checksum);
+            offset = descriptor ? (long) (64 + 64 * j + 2) : (long) item->array_start;
+        }
+    }
+    kastore_close(&store);
+    CU_ASSERT_FATAL(offset != -1);
+
+    f = fopen(filename, "r+b");
+    CU_ASSERT_FATAL(f != NULL);
+    CU_ASSERT_EQUAL_FATAL(fseek(f, offset, SEEK_SET), 0);
+    if (descriptor) {
+        CU_ASSERT_EQUAL_FATAL(fputc(0, f), 0);
+    } else {
+        ret = fgetc(f);
+        CU_ASSERT_FATAL(ret != EOF);
+        CU_ASSERT_EQUAL_FATAL(fseek(f, offset, SEEK_SET), 0);
+        CU_ASSERT_EQUAL_FATAL(fputc(ret ^ 0xff, f), ret ^ 0xff);
+    }
+    fclose(f);
+}
+
+static void
+test_verify_checksums(void)
+{
+    int ret;
+    tsk_treeseq_t *ts = caterpillar_tree(50, 5, 5);
+    tsk_table_collection_t tables;
+    tsk_table_collection_reader_t reader;
+    tsk_flags_t load_options[] = { 0, TSK_LOAD_MMAP, TSK_LOAD_SKIP_METADATA,
+        TSK_LOAD_SKIP_PROVENANCES | TSK_LOAD_MMAP };
+    size_t j;
+    FILE *f;
+
+    ret = tsk_treeseq_dump(ts, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < sizeof(load_options) / sizeof(*load_options); j++) {
+        ret = tsk_table_collection_load(
+            &tables, _tmp_file_name, TSK_LOAD_VERIFY | load_options[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&tables, ts->tables,
+            TSK_CMP_IGNORE_METADATA | TSK_CMP_IGNORE_PROVENANCE));
+        tsk_table_collection_free(&tables);
+    }
+
+    /* Corrupted arrays are only detected when verifying */
+    corrupt_store_column(_tmp_file_name, "edges/left", false);
+    ret = tsk_table_collection_load(&tables, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_FALSE(tsk_table_collection_equals(&tables, ts->tables, 0));
+    tsk_table_collection_free(&tables);
+    for (j = 0; j < sizeof(load_options) / sizeof(*load_options); j++) {
+        ret = tsk_table_collection_load(
+            &tables, _tmp_file_name, TSK_LOAD_VERIFY | load_options[j]);
+        CU_ASSERT_TRUE(tsk_is_kas_error(ret));
+        CU_ASSERT_EQUAL_FATAL(ret ^ (1 << TSK_KAS_ERR_BIT), KAS_ERR_BAD_CHECKSUM);
+        tsk_table_collection_free(&tables);
+    }
+    ret = tsk_table_collection_load_parallel(
+        &tables, _tmp_file_name, 4, TSK_LOAD_VERIFY);
+    CU_ASSERT_EQUAL_FATAL(ret ^ (1 << TSK_KAS_ERR_BIT), KAS_ERR_BAD_CHECKSUM);
+    tsk_table_collection_free(&tables);
+
+    f = fopen(_tmp_file_name, "rb");
+    CU_ASSERT_FATAL(f != NULL);
+    ret = tsk_table_collection_reader_init(&reader, f, TSK_LOAD_VERIFY);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_reader_next(&reader);
+    CU_ASSERT_EQUAL_FATAL(ret ^ (1 << TSK_KAS_ERR_BIT), KAS_ERR_BAD_CHECKSUM);
+    tsk_table_collection_reader_free(&reader);
+    fclose(f);
+
+    /* Arrays without a checksum, as written by earlier versions, are not verified */
+    corrupt_store_column(_tmp_file_name, "edges/left", true);
+    for (j = 0; j < sizeof(load_options) / sizeof(*load_options); j++) {
+        ret = tsk_table_collection_load(
+            &tables, _tmp_file_name, TSK_LOAD_VERIFY | load_options[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        tsk_table_collection_free(&tables);
+    }
+
+    /* The checksums of compressed columns cover the encoded bytes */
+    ret = tsk_treeseq_dump(ts, _tmp_file_name, TSK_DUMP_COMPRESS);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_load(&tables, _tmp_file_name, TSK_LOAD_VERIFY);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&tables, ts->tables, 0));
+    tsk_table_collection_free(&tables);
+    corrupt_store_column(_tmp_file_name, "edges/left/compressed", false);
+    for (j = 0; j < sizeof(load_options) / sizeof(*load_options); j++) {
+        ret = tsk_table_collection_load(
+            &tables, _tmp_file_name, TSK_LOAD_VERIFY | load_options[j]);
+        CU_ASSERT_EQUAL_FATAL(ret ^ (1 << TSK_KAS_ERR_BIT), KAS_ERR_BAD_CHECKSUM);
+        tsk_table_collection_free(&tables);
+    }
+
+    tsk_treeseq_free(ts);
+    free(ts);
+}
+
+static void
+test_dump_no_checksums(void)
+{
+    int ret;
+    tsk_treeseq_t *ts = caterpillar_tree(50, 5, 5);
+    tsk_table_collection_t tables;
+    kastore_t store;
+    const char check[] = "123456789";
+    uint32_t checksum;
+    size_t j;
+    FILE *f;
+
+    /* The stored checksum is the standard CRC32C of the array */
+    ret = kastore_open(&store, _tmp_file_name, "w", 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = kastore_puts_int8(&store, "check", (const int8_t *) check, 9, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = kastore_close(&store);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    f = fopen(_tmp_file_name, "rb");
+    CU_ASSERT_FATAL(f != NULL);
+    CU_ASSERT_EQUAL_FATAL(fseek(f, 64 + 48, SEEK_SET), 0);
+    CU_ASSERT_EQUAL_FATAL(fread(&checksum, sizeof(checksum), 1, f), 1);
+    fclose(f);
+    CU_ASSERT_EQUAL(checksum, 0xE3069283);
+
+    /* KAS_NO_CHECKSUMS is only valid for writing */
+    ret = kastore_open(&store, _tmp_file_name, "r", KAS_NO_CHECKSUMS);
+    CU_ASSERT_EQUAL_FATAL(ret, KAS_ERR_BAD_FLAGS);
+    kastore_close(&store);
+
+    ret = tsk_treeseq_dump(ts, _tmp_file_name, TSK_DUMP_NO_CHECKSUMS);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = kastore_open(&store, _tmp_file_name, "r", KAS_READ_ALL | KAS_VERIFY);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(store.num_items > 0);
+    for (j = 0; j < store.num_items; j++) {
+        CU_ASSERT_FALSE(store.items[j].has_checksum);
+    }
+    kastore_close(&store);
+    ret = tsk_table_collection_load(&tables, _tmp_file_name, TSK_LOAD_VERIFY);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&tables, ts->tables, 0));
+    tsk_table_collection_free(&tables);
+
+    tsk_treeseq_free(ts);
+    free(ts);
+}
+
+static void
+count_loader_callback(tsk_treeseq_t *tree_sequence, int ret, void *arg)
+{
+    int *result = (int *) arg;
+
+    CU_ASSERT_FATAL(tree_sequence != NULL);
+    /* Record the result, offset so we can tell that we were called */
+    *result = ret + 1;
+}
+
+static void
+test_treeseq_loader(void)
+{
+    int ret;
+    tsk_treeseq_t *examples[] = { caterpillar_tree(50, 5, 5), paper_example(),
+        caterpillar_tree(5, 3, 3) };
+    tsk_treeseq_t ts[3];
+    tsk_treeseq_loader_t loader[3];
+    int results[3];
+    tsk_flags_t load_options[] = { 0, TSK_LOAD_MMAP };
+    char filenames[3][64];
+    size_t j, k;
+    int fd;
+
+    for (j = 0; j < 3; j++) {
+        strcpy(filenames[j], "/tmp/tsk_c_test_loader_XXXXXX");
+        fd = mkstemp(filenames[j]);
+        CU_ASSERT_FATAL(fd != -1);
+        close(fd);
+        ret = tsk_treeseq_dump(examples[j], filenames[j], 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+    }
+
+    for (k = 0; k < sizeof(load_options) / sizeof(*load_options); k++) {
+        for (j = 0; j < 3; j++) {
+            results[j] = 0;
+            ret = tsk_treeseq_loader_init(&loader[j], &ts[j], filenames[j],
+                count_loader_callback, &results[j], load_options[k]);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+        }
+        while (!tsk_treeseq_loader_poll(&loader[0])) {
+            /* spin */
+        }
+        CU_ASSERT_EQUAL(results[0], 1);
+        for (j = 0; j < 3; j++) {
+            ret = tsk_treeseq_loader_wait(&loader[j]);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            CU_ASSERT_TRUE(tsk_treeseq_loader_poll(&loader[j]));
+            CU_ASSERT_EQUAL(results[j], 1);
+            CU_ASSERT_TRUE(
+                tsk_table_collection_equals(ts[j].tables, examples[j]->tables, 0));
+            CU_ASSERT_EQUAL(tsk_treeseq_get_num_trees(&ts[j]),
+                tsk_treeseq_get_num_trees(examples[j]));
+            /* Waiting again returns the same result */
+            ret = tsk_treeseq_loader_wait(&loader[j]);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            tsk_treeseq_loader_free(&loader[j]);
+            tsk_treeseq_free(&ts[j]);
+        }
+    }
+
+    /* The loader can be freed without waiting */
+    ret = tsk_treeseq_loader_init(&loader[0], &ts[0], filenames[0], NULL, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_treeseq_loader_free(&loader[0]);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(ts[0].tables, examples[0]->tables, 0));
+    tsk_treeseq_free(&ts[0]);
+
+    /* Errors are reported by wait and to the callback */
+    results[0] = 0;
+    ret = tsk_treeseq_loader_init(
+        &loader[0], &ts[0], "/", count_loader_callback, &results[0], 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_loader_wait(&loader[0]);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_IO);
+    CU_ASSERT_EQUAL(results[0], TSK_ERR_IO + 1);
+    tsk_treeseq_loader_free(&loader[0]);
+    tsk_treeseq_free(&ts[0]);
+
+    for (j = 0; j < 3; j++) {
+        unlink(filenames[j]);
+        tsk_treeseq_free(examples[j]);
+        free(examples[j]);
+    }
+}
+
+static void
+verify_load_interval(tsk_treeseq_t *ts, double left, double right)
+{
+    int ret;
+    tsk_table_collection_t tables;
+    tsk_treeseq_t sub_ts;
+    tsk_tree_t tree, sub_tree;
+    tsk_size_t j, num_edges, num_sites, num_mutations;
+    tsk_id_t u, site_offset, mutation_offset;
+    tsk_site_t site, other_site;
+    tsk_mutation_t mutation, other_mutation;
+    const tsk_table_collection_t *t = ts->tables;
+
+    ret = tsk_table_collection_load_interval(&tables, _tmp_file_name, left, right, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(tables.sequence_length, t->sequence_length);
+    CU_ASSERT_TRUE(tsk_node_table_equals(&tables.nodes, &t->nodes, 0));
+    CU_ASSERT_TRUE(tsk_population_table_equals(&tables.populations, &t->populations, 0));
+    CU_ASSERT_TRUE(tsk_individual_table_equals(&tables.individuals, &t->individuals, 0));
+    CU_ASSERT_TRUE(tsk_provenance_table_equals(&tables.provenances, &t->provenances, 0));
+    CU_ASSERT_TRUE(tsk_table_collection_has_index(&tables, 0));
+
+    num_edges = 0;
+    for (j = 0; j < t->edges.num_rows; j++) {
+        num_edges += t->edges.left[j] < right && t->edges.right[j] > left;
+    }
+    CU_ASSERT_EQUAL_FATAL(tables.edges.num_rows, num_edges);
+    for (j = 0; j < tables.edges.num_rows; j++) {
+        CU_ASSERT_TRUE(tables.edges.left[j] >= left);
+        CU_ASSERT_TRUE(tables.edges.right[j] <= right);
+    }
+    num_sites = 0;
+    num_mutations = 0;
+    for (j = 0; j < t->sites.num_rows; j++) {
+        num_sites += t->sites.position[j] >= left && t->sites.position[j] < right;
+    }
+    for (j = 0; j < t->mutations.num_rows; j++) {
+        u = t->mutations.site[j];
+        num_mutations += t->sites.position[u] >= left && t->sites.position[u] < right;
+    }
+    CU_ASSERT_EQUAL_FATAL(tables.sites.num_rows, num_sites);
+    CU_ASSERT_EQUAL_FATAL(tables.mutations.num_rows, num_mutations);
+    /* The sites and mutations are a contiguous block of the originals */
+    site_offset
+        = (tsk_id_t) tsk_search_sorted(t->sites.position, t->sites.num_rows, left);
+    mutation_offset = 0;
+    while (mutation_offset < (tsk_id_t) t->mutations.num_rows
+           && t->mutations.site[mutation_offset] < site_offset) {
+        mutation_offset++;
+    }
+    for (j = 0; j < num_sites; j++) {
+        ret = tsk_site_table_get_row(&tables.sites, (tsk_id_t) j, &site);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_site_table_get_row(&t->sites, (tsk_id_t) j + site_offset, &other_site);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL(site.position, other_site.position);
+        CU_ASSERT_EQUAL(site.ancestral_state_length, other_site.ancestral_state_length);
+    }
+    for (j = 0; j < num_mutations; j++) {
+        ret = tsk_mutation_table_get_row(&tables.mutations, (tsk_id_t) j, &mutation);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_mutation_table_get_row(
+            &t->mutations, (tsk_id_t) j + mutation_offset, &other_mutation);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL(mutation.site + site_offset, other_mutation.site);
+        CU_ASSERT_EQUAL(mutation.node, other_mutation.node);
+        if (other_mutation.parent == TSK_NULL) {
+            CU_ASSERT_EQUAL(mutation.parent, TSK_NULL);
+        } else {
+            CU_ASSERT_EQUAL(mutation.parent + mutation_offset, other_mutation.parent);
+        }
+        CU_ASSERT_EQUAL(
+            mutation.derived_state_length, other_mutation.derived_state_length);
+    }
+
+    /* The trees within the interval are the same */
+    ret = tsk_treeseq_init(&sub_ts, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_tree_init(&tree, ts, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_tree_init(&sub_tree, &sub_ts, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_tree_seek(&sub_tree, left, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    while (sub_tree.index != -1 && sub_tree.interval.left < right) {
+        ret = tsk_tree_seek(&tree, sub_tree.interval.left, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        for (u = 0; u < (tsk_id_t) t->nodes.num_rows; u++) {
+            CU_ASSERT_EQUAL(tree.parent[u], sub_tree.parent[u]);
+        }
+        ret = tsk_tree_next(&sub_tree);
+        CU_ASSERT_FATAL(ret >= 0);
+    }
+    tsk_tree_free(&tree);
+    tsk_tree_free(&sub_tree);
+    tsk_treeseq_free(&sub_ts);
+    tsk_table_collection_free(&tables);
+}
+
+static void
+test_load_interval(void)
+{
+    int ret;
+    tsk_treeseq_t *examples[] = { caterpillar_tree(50, 20, 5), paper_example() };
+    tsk_table_collection_t tables;
+    double fractions[][2]
+        = { { 0, 1 }, { 0, 0.5 }, { 0.25, 0.75 }, { 0.5, 1 }, { 0.3, 0.31 } };
+    double L;
+    size_t j, k;
+
+    for (j = 0; j < sizeof(examples) / sizeof(*examples); j++) {
+        ret = tsk_treeseq_dump(examples[j], _tmp_file_name, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        L = tsk_treeseq_get_sequence_length(examples[j]);
+        for (k = 0; k < sizeof(fractions) / sizeof(*fractions); k++) {
+            verify_load_interval(
+                examples[j], fractions[k][0] * L, fractions[k][1] * L);
+        }
+        /* Loading the whole genome gives the same tables */
+        ret = tsk_table_collection_load_interval(&tables, _tmp_file_name, 0, L, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&tables, examples[j]->tables, 0));
+        tsk_table_collection_free(&tables);
+    }
+
+    /* Compressed files and other load options are supported */
+    ret = tsk_treeseq_dump(examples[0], _tmp_file_name, TSK_DUMP_COMPRESS);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    verify_load_interval(examples[0], 0.25, 0.75);
+    ret = tsk_table_collection_load_interval(&tables, _tmp_file_name, 0, 1,
+        TSK_LOAD_SKIP_METADATA | TSK_LOAD_SKIP_PROVENANCES | TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&tables, examples[0]->tables,
+        TSK_CMP_IGNORE_METADATA | TSK_CMP_IGNORE_PROVENANCE));
+    CU_ASSERT_EQUAL(tables.provenances.num_rows, 0);
+    /* Loading into an initialised collection replaces its contents */
+    ret = tsk_table_collection_load_interval(
+        &tables, _tmp_file_name, 0, 1, TSK_NO_INIT);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&tables, examples[0]->tables, 0));
+    tsk_table_collection_free(&tables);
+
+    for (j = 0; j < sizeof(examples) / sizeof(*examples); j++) {
+        tsk_treeseq_free(examples[j]);
+        free(examples[j]);
+    }
+}
+
+static void
+test_load_interval_errors(void)
+{
+    int ret;
+    tsk_treeseq_t *ts = caterpillar_tree(5, 3, 3);
+    tsk_table_collection_t tables;
+    double bad_intervals[][2] = { { 0, 0 }, { 0.5, 0.25 }, { -1, 0.5 }, { 0, 2 },
+        { NAN, 0.5 }, { 0, INFINITY } };
+    size_t j;
+
+    ret = tsk_treeseq_dump(ts, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < sizeof(bad_intervals) / sizeof(*bad_intervals); j++) {
+        ret = tsk_table_collection_load_interval(
+            &tables, _tmp_file_name, bad_intervals[j][0], bad_intervals[j][1], 0);
+        CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+        tsk_table_collection_free(&tables);
+    }
+
+    ret = tsk_table_collection_load_interval(&tables, "/", 0, 1, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_IO);
+    tsk_table_collection_free(&tables);
+
+    /* Mutation parents are checked as the mutations are copied */
+    ret = tsk_table_collection_copy(ts->tables, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_FATAL(tables.mutations.num_rows > 1);
+    tables.mutations.parent[0] = 0;
+    ret = tsk_table_collection_dump(&tables, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_table_collection_free(&tables);
+    ret = tsk_table_collection_load_interval(&tables, _tmp_file_name, 0, 1, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_MUTATION_PARENT_EQUAL);
+    tsk_table_collection_free(&tables);
+
+    ret = tsk_table_collection_copy(ts->tables, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tables.mutations.parent[0] = 1;
+    ret = tsk_table_collection_dump(&tables, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_table_collection_free(&tables);
+    ret = tsk_table_collection_load_interval(&tables, _tmp_file_name, 0, 1, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_MUTATION_PARENT_AFTER_CHILD);
+    tsk_table_collection_free(&tables);
+
+    ret = tsk_treeseq_dump(ts, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    /* Mapped collections can't be loaded into */
+    ret = tsk_table_collection_load(&tables, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_load_interval(
+        &tables, _tmp_file_name, 0, 1, TSK_NO_INIT);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    tsk_table_collection_free(&tables);
+
+    tsk_treeseq_free(ts);
+    free(ts);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1425,6 +3160,26 @@ main(int argc, char **argv)
         { "test_copy_store_drop_columns", test_copy_store_drop_columns },
         { "test_skip_tables", test_skip_tables },
         { "test_skip_reference_sequence", test_skip_reference_sequence },
+        { "test_kastore_parallel_io", test_kastore_parallel_io },
+        { "test_parallel_round_trip", test_parallel_round_trip },
+        { "test_compressed_columns", test_compressed_columns },
+        { "test_compressed_round_trip", test_compressed_round_trip },
+        { "test_skip_metadata", test_skip_metadata },
+        { "test_skip_provenances", test_skip_provenances },
+        { "test_mmap_round_trip", test_mmap_round_trip },
+        { "test_mmap_errors", test_mmap_errors },
+        { "test_mmap_modify", test_mmap_modify },
+        { "test_increments_round_trip", test_increments_round_trip },
+        { "test_increments_errors", test_increments_errors },
+        { "test_reader_round_trip", test_reader_round_trip },
+        { "test_reader_errors", test_reader_errors },
+        { "test_treeseq_indexes_round_trip", test_treeseq_indexes_round_trip },
+        { "test_treeseq_indexes_errors", test_treeseq_indexes_errors },
+        { "test_verify_checksums", test_verify_checksums },
+        { "test_dump_no_checksums", test_dump_no_checksums },
+        { "test_treeseq_loader", test_treeseq_loader },
+        { "test_load_interval", test_load_interval },
+        { "test_load_interval_errors", test_load_interval_errors },
         { NULL, NULL },
     };
 
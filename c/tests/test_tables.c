@@ -141,6 +141,137 @@ insert_edge_metadata(tsk_table_collection_t *tables)
     tsk_edge_table_free(&edges);
 }
 
+typedef struct {
+    tsk_size_t num_live;
+    tsk_size_t num_calls;
+} test_allocator_state_t;
+
+static void *
+test_allocator_malloc(size_t size, void *user_data)
+{
+    test_allocator_state_t *state = (test_allocator_state_t *) user_data;
+
+    state->num_live++;
+    state->num_calls++;
+    return malloc(size);
+}
+
+static void *
+test_allocator_realloc(void *ptr, size_t size, void *user_data)
+{
+    test_allocator_state_t *state = (test_allocator_state_t *) user_data;
+
+    if (ptr == NULL) {
+        state->num_live++;
+    }
+    state->num_calls++;
+    return realloc(ptr, size);
+}
+
+static void
+test_allocator_free(void *ptr, void *user_data)
+{
+    test_allocator_state_t *state = (test_allocator_state_t *) user_data;
+
+    state->num_live--;
+    free(ptr);
+}
+
+static void
+test_table_collection_set_allocator(void)
+{
+    int ret;
+    tsk_id_t ret_id;
+    tsk_size_t j, num_calls;
+    tsk_treeseq_t ts;
+    tsk_table_collection_t t1, t2;
+    test_allocator_state_t state = { 0, 0 };
+    tsk_table_allocator_t allocator = {
+        .malloc = test_allocator_malloc,
+        .realloc = test_allocator_realloc,
+        .free = test_allocator_free,
+        .user_data = &state,
+    };
+    tsk_table_allocator_t bad_allocator;
+
+    tsk_treeseq_from_text(&ts, 1, single_tree_ex_nodes, single_tree_ex_edges, NULL,
+        single_tree_ex_sites, single_tree_ex_mutations, NULL, NULL, 0);
+    ret = tsk_treeseq_copy_tables(&ts, &t1, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_copy_tables(&ts, &t2, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    /* The functions must be set together */
+    bad_allocator = allocator;
+    bad_allocator.free = NULL;
+    ret = tsk_table_collection_set_allocator(&t1, &bad_allocator);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    bad_allocator = allocator;
+    bad_allocator.growth_factor = 1;
+    ret = tsk_table_collection_set_allocator(&t1, &bad_allocator);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    CU_ASSERT_EQUAL(state.num_calls, 0);
+
+    /* The existing contents are copied into the new columns */
+    ret = tsk_table_collection_set_allocator(&t1, &allocator);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(state.num_live > 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+    CU_ASSERT_TRUE(tsk_table_collection_has_index(&t1, 0));
+    CU_ASSERT_EQUAL(t1.edges.allocator, &allocator);
+
+    /* New rows are allocated with it */
+    num_calls = state.num_calls;
+    for (j = 0; j < 1025; j++) {
+        ret_id = tsk_node_table_add_row(&t1.nodes, 0, 0, TSK_NULL, TSK_NULL, "x", 1);
+        CU_ASSERT_FATAL(ret_id >= 0);
+        ret_id = tsk_node_table_add_row(&t2.nodes, 0, 0, TSK_NULL, TSK_NULL, "x", 1);
+        CU_ASSERT_FATAL(ret_id >= 0);
+    }
+    CU_ASSERT_TRUE(state.num_calls > num_calls);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+    CU_ASSERT_EQUAL(t1.nodes.max_rows, t2.nodes.max_rows);
+
+    /* Columns grow by the growth factor */
+    allocator.growth_factor = 4;
+    ret = tsk_table_collection_set_allocator(&t1, &allocator);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+    for (j = 0; j < 5000; j++) {
+        ret_id = tsk_node_table_add_row(&t1.nodes, 0, 0, TSK_NULL, TSK_NULL, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+    }
+    CU_ASSERT_EQUAL(t1.nodes.max_rows, 4 * 4 * t2.nodes.num_rows);
+
+    /* Loading copies the columns into memory from the allocator */
+    ret = tsk_table_collection_dump(&t2, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_table_collection_free(&t1);
+    CU_ASSERT_EQUAL(state.num_live, 0);
+    ret = tsk_table_collection_init(&t1, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_set_allocator(&t1, &allocator);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_load(&t1, _tmp_file_name, TSK_NO_INIT | TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    num_calls = state.num_calls;
+    ret = tsk_table_collection_load(&t1, _tmp_file_name, TSK_NO_INIT);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(state.num_calls > num_calls);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+
+    /* Going back to the default allocator releases all the memory */
+    ret = tsk_table_collection_set_allocator(&t1, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(state.num_live, 0);
+    CU_ASSERT_EQUAL(t1.nodes.allocator, NULL);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+
+    tsk_table_collection_free(&t1);
+    tsk_table_collection_free(&t2);
+    tsk_treeseq_free(&ts);
+}
+
 static void
 test_table_collection_equals_options(void)
 {
@@ -1409,6 +1540,87 @@ test_node_table_takeset(void)
     CU_ASSERT_EQUAL(ret, 0);
 }
 
+static void
+test_node_table_reserve_rows(void)
+{
+    int ret;
+    tsk_id_t ret_id;
+    tsk_size_t j, offset;
+    tsk_node_table_t table, expected;
+    tsk_node_table_batch_t batch;
+    const char *metadata = "abcdefghijklmnopqrstuvwxyz";
+    const tsk_size_t num_rows = 2000;
+
+    ret = tsk_node_table_init(&table, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_node_table_init(&expected, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret_id = tsk_node_table_add_row(&table, 1, 0, 0, 0, "x", 1);
+    CU_ASSERT_EQUAL_FATAL(ret_id, 0);
+    ret_id = tsk_node_table_add_row(&expected, 1, 0, 0, 0, "x", 1);
+    CU_ASSERT_EQUAL_FATAL(ret_id, 0);
+
+    ret = tsk_node_table_reserve_rows(&table, num_rows, num_rows * 26, &batch);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(batch.num_rows, num_rows);
+    CU_ASSERT_EQUAL(batch.metadata_length, num_rows * 26);
+    CU_ASSERT_EQUAL(batch.metadata_offset[0], 1);
+    CU_ASSERT_TRUE(table.max_rows >= 1 + num_rows);
+    CU_ASSERT_TRUE(table.max_metadata_length >= 1 + num_rows * 26);
+    CU_ASSERT_EQUAL(table.num_rows, 1);
+    offset = 0;
+    for (j = 0; j < num_rows; j++) {
+        batch.flags[j] = (tsk_flags_t) j;
+        batch.time[j] = (double) j;
+        batch.population[j] = (tsk_id_t) j;
+        batch.individual[j] = -(tsk_id_t) j;
+        tsk_memcpy(batch.metadata + offset, metadata, j % 27);
+        offset += j % 27;
+        batch.metadata_offset[j + 1] = batch.metadata_offset[0] + offset;
+        ret_id = tsk_node_table_add_row(&expected, (tsk_flags_t) j, (double) j,
+            (tsk_id_t) j, -(tsk_id_t) j, metadata, j % 27);
+        CU_ASSERT_FATAL(ret_id > 0);
+    }
+
+    /* Bad values are rejected without changing the table */
+    ret = tsk_node_table_commit_rows(&table, &batch, num_rows + 1);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    batch.metadata_offset[num_rows / 2] = 0;
+    ret = tsk_node_table_commit_rows(&table, &batch, num_rows);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_OFFSET);
+    batch.metadata_offset[num_rows / 2] = batch.metadata_offset[num_rows / 2 - 1];
+    batch.metadata_offset[num_rows / 2] += (num_rows / 2 - 1) % 27;
+    CU_ASSERT_EQUAL(table.num_rows, 1);
+    CU_ASSERT_EQUAL(table.metadata_length, 1);
+
+    /* Rows can be committed in parts */
+    ret = tsk_node_table_commit_rows(&table, &batch, num_rows / 2);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(table.num_rows, 1 + num_rows / 2);
+    ret = tsk_node_table_commit_rows(&table, &batch, num_rows);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    tsk_node_table_truncate(&table, 1);
+    ret = tsk_node_table_commit_rows(&table, &batch, num_rows);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_node_table_equals(&table, &expected, 0));
+
+    /* The reserved metadata can't be exceeded */
+    ret = tsk_node_table_reserve_rows(&table, 1, 1, &batch);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    batch.metadata_offset[1] = batch.metadata_offset[0] + 2;
+    ret = tsk_node_table_commit_rows(&table, &batch, 1);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_OFFSET);
+    ret = tsk_node_table_commit_rows(&table, &batch, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_node_table_equals(&table, &expected, 0));
+
+    ret = tsk_node_table_reserve_rows(&table, TSK_MAX_ID, 0, &batch);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_TABLE_OVERFLOW);
+
+    tsk_node_table_free(&table);
+    tsk_node_table_free(&expected);
+}
+
 static void
 test_node_table_update_row(void)
 {
@@ -2456,6 +2668,70 @@ test_edge_table_takeset(void)
     test_edge_table_takeset_with_options(0);
 }
 
+static void
+test_edge_table_reserve_rows_with_options(tsk_flags_t table_options)
+{
+    int ret;
+    tsk_id_t ret_id;
+    tsk_size_t j;
+    tsk_edge_table_t table, expected;
+    tsk_edge_table_batch_t batch;
+    bool has_metadata = !(table_options & TSK_TABLE_NO_METADATA);
+    const tsk_size_t num_rows = 5000;
+
+    ret = tsk_edge_table_init(&table, table_options);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_edge_table_init(&expected, table_options);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    ret = tsk_edge_table_reserve_rows(&table, num_rows, has_metadata, &batch);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(batch.num_rows, num_rows);
+    for (j = 0; j < num_rows; j++) {
+        batch.left[j] = (double) j;
+        batch.right[j] = (double) j + 1;
+        batch.parent[j] = (tsk_id_t) j;
+        batch.child[j] = (tsk_id_t) j + 1;
+        ret_id = tsk_edge_table_add_row(&expected, (double) j, (double) j + 1,
+            (tsk_id_t) j, (tsk_id_t) j + 1, "x", j == 0 && has_metadata);
+        CU_ASSERT_FATAL(ret_id >= 0);
+    }
+    if (has_metadata) {
+        CU_ASSERT_EQUAL(batch.metadata_length, 1);
+        batch.metadata[0] = 'x';
+        for (j = 0; j < num_rows; j++) {
+            batch.metadata_offset[j + 1] = 1;
+        }
+    } else {
+        CU_ASSERT_EQUAL(batch.metadata, NULL);
+        CU_ASSERT_EQUAL(batch.metadata_offset, NULL);
+    }
+    ret = tsk_edge_table_commit_rows(&table, &batch, num_rows);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_edge_table_equals(&table, &expected, 0));
+
+    /* The table can't be modified between reserving and committing */
+    ret = tsk_edge_table_reserve_rows(&table, 1, 0, &batch);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret_id = tsk_edge_table_add_row(&table, 0, 1, 0, 1, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret = tsk_edge_table_commit_rows(&table, &batch, 1);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+
+    ret = tsk_edge_table_reserve_rows(&table, 1, 1, &batch);
+    CU_ASSERT_EQUAL_FATAL(ret, has_metadata ? 0 : TSK_ERR_METADATA_DISABLED);
+
+    tsk_edge_table_free(&table);
+    tsk_edge_table_free(&expected);
+}
+
+static void
+test_edge_table_reserve_rows(void)
+{
+    test_edge_table_reserve_rows_with_options(TSK_TABLE_NO_METADATA);
+    test_edge_table_reserve_rows_with_options(0);
+}
+
 static void
 test_edge_table_copy_semantics(void)
 {
@@ -8629,6 +8905,325 @@ test_simplify_metadata(void)
     tsk_table_collection_free(&tables);
 }
 
+static void
+make_wright_fisher_tables(tsk_table_collection_t *tables, int N, int T, int num_sites)
+{
+    int ret, j, t;
+    tsk_id_t ret_id, u, v, left_parent, right_parent;
+    tsk_id_t *buffer = tsk_malloc(2 * (size_t) N * sizeof(*buffer));
+    tsk_id_t *parents = buffer;
+    tsk_id_t *children = buffer + N;
+    tsk_id_t *tmp;
+    double breakpoint, position;
+
+    CU_ASSERT_FATAL(buffer != NULL);
+    ret = tsk_table_collection_init(tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tables->sequence_length = 100;
+    for (j = 0; j < N; j++) {
+        parents[j] = tsk_node_table_add_row(
+            &tables->nodes, 0, T, TSK_NULL, TSK_NULL, NULL, 0);
+        CU_ASSERT_FATAL(parents[j] >= 0);
+    }
+    for (t = T - 1; t >= 0; t--) {
+        for (j = 0; j < N; j++) {
+            u = tsk_node_table_add_row(&tables->nodes, t == 0 ? TSK_NODE_IS_SAMPLE : 0,
+                t, TSK_NULL, TSK_NULL, NULL, 0);
+            CU_ASSERT_FATAL(u >= 0);
+            left_parent = parents[rand() % N];
+            right_parent = parents[rand() % N];
+            breakpoint = 1 + rand() % 98 + rand() / (1. + RAND_MAX);
+            ret_id = tsk_edge_table_add_row(
+                &tables->edges, 0, breakpoint, left_parent, u, NULL, 0);
+            CU_ASSERT_FATAL(ret_id >= 0);
+            ret_id = tsk_edge_table_add_row(&tables->edges, breakpoint,
+                tables->sequence_length, right_parent, u, NULL, 0);
+            CU_ASSERT_FATAL(ret_id >= 0);
+            children[j] = u;
+        }
+        tmp = parents;
+        parents = children;
+        children = tmp;
+    }
+    position = 0;
+    for (j = 0; j < num_sites; j++) {
+        position += tables->sequence_length / (num_sites + 1);
+        ret_id = tsk_site_table_add_row(&tables->sites, position, "0", 1, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+        /* Every third site has a back mutation below a mutation on a root */
+        u = (tsk_id_t) (rand() % (int) tables->nodes.num_rows);
+        if (j % 3 == 0) {
+            u = (tsk_id_t) (rand() % N);
+        }
+        v = tsk_mutation_table_add_row(&tables->mutations, ret_id, u, TSK_NULL,
+            TSK_UNKNOWN_TIME, "1", 1, NULL, 0);
+        CU_ASSERT_FATAL(v >= 0);
+        if (j % 3 == 0) {
+            u = (tsk_id_t) (N + rand() % ((int) tables->nodes.num_rows - N));
+            ret_id = tsk_mutation_table_add_row(&tables->mutations, ret_id, u, v,
+                TSK_UNKNOWN_TIME, "0", 1, NULL, 0);
+            CU_ASSERT_FATAL(ret_id >= 0);
+        }
+    }
+    ret = tsk_table_collection_sort(tables, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    free(buffer);
+}
+
+static void
+verify_simplify_parallel(tsk_table_collection_t *tables, const tsk_id_t *samples,
+    tsk_size_t num_samples, tsk_flags_t options)
+{
+    int ret;
+    tsk_table_collection_t expected, copy;
+    tsk_size_t num_nodes = tables->nodes.num_rows;
+    tsk_id_t *expected_node_map = tsk_malloc(num_nodes * sizeof(tsk_id_t));
+    tsk_id_t *node_map = tsk_malloc(num_nodes * sizeof(tsk_id_t));
+    tsk_size_t num_threads[] = { 0, 1, 2, 3, 8, 100 };
+    size_t j;
+
+    CU_ASSERT_FATAL(expected_node_map != NULL && node_map != NULL);
+    ret = tsk_table_collection_copy(tables, &expected, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_simplify(
+        &expected, samples, num_samples, options, expected_node_map);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    for (j = 0; j < sizeof(num_threads) / sizeof(*num_threads); j++) {
+        ret = tsk_table_collection_copy(tables, &copy, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_table_collection_simplify_parallel(
+            &copy, samples, num_samples, options, node_map, num_threads[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&copy, &expected, 0));
+        CU_ASSERT_EQUAL(
+            tsk_memcmp(node_map, expected_node_map, num_nodes * sizeof(tsk_id_t)), 0);
+        tsk_table_collection_free(&copy);
+    }
+    tsk_table_collection_free(&expected);
+    free(expected_node_map);
+    free(node_map);
+}
+
+static void
+test_simplify_parallel(void)
+{
+    int ret;
+    tsk_table_collection_t tables;
+    tsk_id_t samples[] = { 419, 401, 405, 410, 415, 400 };
+    tsk_flags_t options[] = { 0, TSK_SIMPLIFY_FILTER_SITES, TSK_SIMPLIFY_KEEP_UNARY,
+        TSK_SIMPLIFY_KEEP_INPUT_ROOTS, TSK_SIMPLIFY_NO_FILTER_NODES,
+        TSK_SIMPLIFY_REDUCE_TO_SITE_TOPOLOGY, TSK_SIMPLIFY_KEEP_UNARY_IN_INDIVIDUALS,
+        TSK_SIMPLIFY_FILTER_SITES | TSK_SIMPLIFY_FILTER_INDIVIDUALS
+            | TSK_SIMPLIFY_KEEP_INPUT_ROOTS };
+    tsk_id_t ret_id;
+    size_t j;
+
+    srand(5);
+    make_wright_fisher_tables(&tables, 20, 20, 50);
+    CU_ASSERT_FATAL(tables.nodes.num_rows == 420);
+    for (j = 0; j < tables.nodes.num_rows; j += 7) {
+        ret_id = tsk_individual_table_add_row(
+            &tables.individuals, 0, NULL, 0, NULL, 0, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+        tables.nodes.individual[j] = ret_id;
+    }
+    for (j = 0; j < sizeof(options) / sizeof(*options); j++) {
+        verify_simplify_parallel(&tables, NULL, 0, options[j]);
+        verify_simplify_parallel(&tables, samples, 6, options[j]);
+    }
+    tsk_table_collection_free(&tables);
+
+    /* Errors are the same as for simplify */
+    make_wright_fisher_tables(&tables, 5, 5, 0);
+    ret = tsk_table_collection_simplify_parallel(&tables, NULL, 0,
+        TSK_SIMPLIFY_KEEP_UNARY | TSK_SIMPLIFY_KEEP_UNARY_IN_INDIVIDUALS, NULL, 4);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_KEEP_UNARY_MUTUALLY_EXCLUSIVE);
+    ret = tsk_table_collection_simplify_parallel(&tables, samples, 1, 0, NULL, 4);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_NODE_OUT_OF_BOUNDS);
+    tables.edges.parent[0] = 0;
+    tables.edges.child[0] = 1;
+    ret = tsk_table_collection_simplify_parallel(&tables, NULL, 0, 0, NULL, 4);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_NODE_TIME_ORDERING);
+    tsk_table_collection_free(&tables);
+
+    make_wright_fisher_tables(&tables, 5, 5, 0);
+    ret_id = tsk_population_table_add_row(&tables.populations, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret_id = tsk_migration_table_add_row(&tables.migrations, 0,
+        tables.sequence_length, 0, ret_id, ret_id, 0.5, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret = tsk_table_collection_simplify_parallel(&tables, NULL, 0, 0, NULL, 4);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_SIMPLIFY_MIGRATIONS_NOT_SUPPORTED);
+    tsk_table_collection_free(&tables);
+}
+
+static void
+verify_incremental_simplifier(tsk_flags_t options)
+{
+    int ret, j, t;
+    tsk_id_t ret_id, u;
+    tsk_table_collection_t tables, expected;
+    tsk_incremental_simplifier_t simplifier;
+    const int N = 10;
+    const int T = 60;
+    tsk_id_t parents[10], children[10];
+    tsk_id_t *node_map = NULL;
+    tsk_id_t *expected_node_map = NULL;
+    tsk_size_t num_nodes;
+    double breakpoint;
+
+    ret = tsk_table_collection_init(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tables.sequence_length = 10;
+    ret = tsk_incremental_simplifier_init(&simplifier, &tables, options);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(simplifier.tables, &tables);
+    CU_ASSERT_EQUAL(simplifier.options, options);
+    for (j = 0; j < N; j++) {
+        parents[j]
+            = tsk_node_table_add_row(&tables.nodes, 0, T, TSK_NULL, TSK_NULL, NULL, 0);
+        CU_ASSERT_FATAL(parents[j] >= 0);
+    }
+    for (t = T - 1; t >= 0; t--) {
+        for (j = 0; j < N; j++) {
+            children[j] = tsk_node_table_add_row(
+                &tables.nodes, 0, t, TSK_NULL, TSK_NULL, NULL, 0);
+            CU_ASSERT_FATAL(children[j] >= 0);
+            breakpoint = 1 + rand() % 8 + rand() / (1. + RAND_MAX);
+            ret_id = tsk_edge_table_add_row(
+                &tables.edges, 0, breakpoint, parents[rand() % N], children[j], NULL, 0);
+            CU_ASSERT_FATAL(ret_id >= 0);
+            ret_id = tsk_edge_table_add_row(&tables.edges, breakpoint, 10,
+                parents[rand() % N], children[j], NULL, 0);
+            CU_ASSERT_FATAL(ret_id >= 0);
+        }
+        /* A new site at a random position with a mutation in this generation */
+        ret_id = tsk_site_table_add_row(
+            &tables.sites, rand() / (1. + RAND_MAX) * 10, "0", 1, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+        ret_id = tsk_mutation_table_add_row(&tables.mutations, ret_id,
+            children[rand() % N], TSK_NULL, TSK_UNKNOWN_TIME, "1", 1, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+
+        if (t % 7 == 0) {
+            num_nodes = tables.nodes.num_rows;
+            node_map = tsk_malloc(num_nodes * sizeof(*node_map));
+            expected_node_map = tsk_malloc(num_nodes * sizeof(*node_map));
+            CU_ASSERT_FATAL(node_map != NULL && expected_node_map != NULL);
+            ret = tsk_table_collection_copy(&tables, &expected, 0);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            ret = tsk_table_collection_sort(&expected, NULL, 0);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            ret = tsk_table_collection_simplify(
+                &expected, children, (tsk_size_t) N, options, expected_node_map);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+            ret = tsk_incremental_simplifier_run(
+                &simplifier, children, (tsk_size_t) N, node_map);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            CU_ASSERT_TRUE(tsk_table_collection_equals(&tables, &expected, 0));
+            /* Each of the samples has at least one segment of ancestry */
+            CU_ASSERT_TRUE(simplifier.max_num_segments >= (tsk_size_t) N);
+            /* The segments of extracted ancestry are recycled, so the peak
+             * follows the live ancestry of the samples and doesn't grow with
+             * the number of generations. */
+            CU_ASSERT_TRUE(simplifier.num_segments <= simplifier.max_num_segments);
+            CU_ASSERT_TRUE(simplifier.max_num_segments <= (tsk_size_t) (8 * N));
+            CU_ASSERT_EQUAL(tsk_memcmp(node_map, expected_node_map,
+                                num_nodes * sizeof(*node_map)),
+                0);
+            for (j = 0; j < N; j++) {
+                u = node_map[children[j]];
+                CU_ASSERT_FATAL(u >= 0);
+                children[j] = u;
+            }
+            tsk_table_collection_free(&expected);
+            free(node_map);
+            free(expected_node_map);
+        }
+        tsk_memcpy(parents, children, sizeof(parents));
+    }
+    /* Removing rows means that all rows are sorted again */
+    ret = tsk_edge_table_truncate(&tables.edges, tables.edges.num_rows / 2);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_site_table_clear(&tables.sites);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_mutation_table_clear(&tables.mutations);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_copy(&tables, &expected, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_simplify(&expected, NULL, 0, options, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_incremental_simplifier_run(&simplifier, NULL, 0, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&tables, &expected, 0));
+    tsk_table_collection_free(&expected);
+
+    tsk_incremental_simplifier_free(&simplifier);
+    tsk_table_collection_free(&tables);
+}
+
+static void
+test_incremental_simplifier(void)
+{
+    int ret;
+    tsk_table_collection_t tables;
+    tsk_incremental_simplifier_t simplifier;
+    tsk_id_t samples[] = { 0, 1 };
+    tsk_id_t ret_id;
+    tsk_size_t j;
+    FILE *tmp = fopen(_tmp_file_name, "w");
+
+    CU_ASSERT_FATAL(tmp != NULL);
+    srand(10);
+    verify_incremental_simplifier(0);
+    verify_incremental_simplifier(TSK_SIMPLIFY_FILTER_SITES);
+    verify_incremental_simplifier(TSK_SIMPLIFY_KEEP_INPUT_ROOTS);
+    verify_incremental_simplifier(TSK_SIMPLIFY_KEEP_UNARY);
+    verify_incremental_simplifier(TSK_SIMPLIFY_NO_FILTER_NODES);
+    /* Checks the state of the recycled segments after each run */
+    tsk_set_debug_stream(tmp);
+    verify_incremental_simplifier(TSK_DEBUG);
+    tsk_set_debug_stream(stdout);
+    CU_ASSERT_TRUE(ftell(tmp) > 0);
+    fclose(tmp);
+
+    ret = tsk_table_collection_init(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tables.sequence_length = 1;
+    ret = tsk_incremental_simplifier_init(&simplifier, &tables,
+        TSK_SIMPLIFY_KEEP_UNARY | TSK_SIMPLIFY_KEEP_UNARY_IN_INDIVIDUALS);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_KEEP_UNARY_MUTUALLY_EXCLUSIVE);
+    tsk_incremental_simplifier_free(&simplifier);
+
+    ret = tsk_incremental_simplifier_init(&simplifier, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_incremental_simplifier_run(&simplifier, samples, 2, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_NODE_OUT_OF_BOUNDS);
+
+    /* Four samples coalescing into one parent. The segments of the samples
+     * are freed when they are extracted, leaving only the parent's. */
+    for (j = 0; j < 4; j++) {
+        ret_id = tsk_node_table_add_row(
+            &tables.nodes, TSK_NODE_IS_SAMPLE, 0, TSK_NULL, TSK_NULL, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+    }
+    ret_id = tsk_node_table_add_row(&tables.nodes, 0, 1, TSK_NULL, TSK_NULL, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    for (j = 0; j < 4; j++) {
+        ret_id = tsk_edge_table_add_row(&tables.edges, 0, 1, 4, (tsk_id_t) j, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+    }
+    ret = tsk_incremental_simplifier_run(&simplifier, NULL, 0, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(tables.edges.num_rows, 4);
+    CU_ASSERT_EQUAL(simplifier.max_num_segments, 4);
+    CU_ASSERT_EQUAL(simplifier.num_segments, 1);
+    tsk_incremental_simplifier_free(&simplifier);
+    tsk_table_collection_free(&tables);
+}
+
 static void
 test_edge_update_invalidates_index(void)
 {
@@ -9574,6 +10169,253 @@ test_sorter_interface(void)
     tsk_treeseq_free(&ts);
 }
 
+static void
+verify_sort_edges_parallel(tsk_table_collection_t *tables, tsk_size_t start)
+{
+    int ret;
+    tsk_table_collection_t expected, copy;
+    tsk_table_sorter_t sorter;
+    tsk_bookmark_t pos;
+    tsk_size_t num_threads[] = { 0, 1, 2, 3, 8 };
+    size_t j;
+
+    tsk_memset(&pos, 0, sizeof(pos));
+    pos.edges = start;
+    ret = tsk_table_collection_copy(tables, &expected, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_sorter_init(&sorter, &expected, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_sorter_run(&sorter, &pos);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_table_sorter_free(&sorter);
+
+    for (j = 0; j < sizeof(num_threads) / sizeof(*num_threads); j++) {
+        ret = tsk_table_collection_copy(tables, &copy, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_table_sorter_init(&sorter, &copy, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL(sorter.num_threads, 1);
+        sorter.sort_edges = tsk_table_sorter_sort_edges_parallel;
+        sorter.num_threads = num_threads[j];
+        ret = tsk_table_sorter_run(&sorter, &pos);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_edge_table_equals(&copy.edges, &expected.edges, 0));
+        tsk_table_sorter_free(&sorter);
+        tsk_table_collection_free(&copy);
+    }
+    tsk_table_collection_free(&expected);
+}
+
+static void
+test_sort_edges_parallel(void)
+{
+    int ret;
+    tsk_id_t ret_id;
+    tsk_table_collection_t tables;
+    tsk_size_t num_nodes[] = { 4, 10, 300, 5000 };
+    tsk_size_t num_edges[] = { 0, 1, 100, 50000 };
+    tsk_id_t parent, child;
+    double left, time;
+    size_t j, k, l;
+
+    srand(1234);
+    for (j = 0; j < sizeof(num_nodes) / sizeof(*num_nodes); j++) {
+        for (k = 0; k < sizeof(num_edges) / sizeof(*num_edges); k++) {
+            ret = tsk_table_collection_init(&tables, 0);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            tables.sequence_length = 100;
+            for (l = 0; l < num_nodes[j]; l++) {
+                /* Include ties in time, which are broken by node ID */
+                time = (double) ((int) (l % 2) + rand() % (int) (num_nodes[j] / 2));
+                ret_id = tsk_node_table_add_row(
+                    &tables.nodes, 0, time, TSK_NULL, TSK_NULL, NULL, 0);
+                CU_ASSERT_FATAL(ret_id >= 0);
+            }
+            for (l = 0; l < num_edges[k]; l++) {
+                do {
+                    parent = (tsk_id_t) (rand() % (int) num_nodes[j]);
+                    child = (tsk_id_t) (rand() % (int) num_nodes[j]);
+                } while (tables.nodes.time[parent] <= tables.nodes.time[child]);
+                /* Many edges share a parent and child */
+                left = rand() % 99;
+                ret_id = tsk_edge_table_add_row(
+                    &tables.edges, left, left + 1, parent, child, NULL, 0);
+                CU_ASSERT_FATAL(ret_id >= 0);
+            }
+            verify_sort_edges_parallel(&tables, 0);
+            verify_sort_edges_parallel(&tables, num_edges[k] / 2);
+            tsk_table_collection_free(&tables);
+        }
+    }
+
+    /* Edges with metadata are supported */
+    ret = tsk_table_collection_init(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tables.sequence_length = 1;
+    for (l = 0; l < 3; l++) {
+        ret_id = tsk_node_table_add_row(
+            &tables.nodes, 0, (double) l, TSK_NULL, TSK_NULL, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+    }
+    ret_id = tsk_edge_table_add_row(&tables.edges, 0, 1, 2, 0, "a", 1);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret_id = tsk_edge_table_add_row(&tables.edges, 0, 1, 1, 0, "bc", 2);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    verify_sort_edges_parallel(&tables, 0);
+    tsk_table_collection_free(&tables);
+}
+
+static void
+add_random_sort_merge_rows(tsk_table_collection_t *tables, tsk_size_t num_edges,
+    tsk_size_t num_sites, tsk_size_t num_mutations)
+{
+    tsk_id_t ret_id, parent, child, site, mut_parent;
+    tsk_size_t num_nodes = tables->nodes.num_rows;
+    tsk_size_t j;
+    double left;
+    char metadata;
+
+    for (j = 0; j < num_edges; j++) {
+        do {
+            parent = (tsk_id_t) (rand() % (int) num_nodes);
+            child = (tsk_id_t) (rand() % (int) num_nodes);
+        } while (tables->nodes.time[parent] <= tables->nodes.time[child]);
+        left = rand() % 99;
+        metadata = (char) ('a' + rand() % 26);
+        ret_id = tsk_edge_table_add_row(
+            &tables->edges, left, left + 1, parent, child, &metadata, 1);
+        CU_ASSERT_FATAL(ret_id >= 0);
+    }
+    for (j = 0; j < num_sites; j++) {
+        /* Include sites at the same position */
+        ret_id = tsk_site_table_add_row(
+            &tables->sites, rand() % 50, "0", 1, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+    }
+    for (j = 0; j < num_mutations; j++) {
+        site = (tsk_id_t) (rand() % (int) tables->sites.num_rows);
+        mut_parent = TSK_NULL;
+        if (tables->mutations.num_rows > 0 && rand() % 4 == 0) {
+            mut_parent = (tsk_id_t) (rand() % (int) tables->mutations.num_rows);
+            site = tables->mutations.site[mut_parent];
+        }
+        ret_id = tsk_mutation_table_add_row(&tables->mutations, site,
+            (tsk_id_t) (rand() % (int) num_nodes), mut_parent, TSK_UNKNOWN_TIME, "1",
+            1, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+    }
+}
+
+static void
+verify_sort_merge(tsk_table_collection_t *tables, tsk_bookmark_t *start)
+{
+    int ret;
+    tsk_table_collection_t expected, copy;
+    tsk_table_sorter_t sorter;
+
+    ret = tsk_table_collection_copy(tables, &expected, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_sort(&expected, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    ret = tsk_table_collection_copy(tables, &copy, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_sort(&copy, start, TSK_SORT_MERGE);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&copy, &expected, 0));
+    tsk_table_collection_free(&copy);
+
+    /* The merge also applies to edges sorted by other functions */
+    ret = tsk_table_collection_copy(tables, &copy, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_sorter_init(&sorter, &copy, TSK_SORT_MERGE);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(sorter.options, TSK_SORT_MERGE);
+    sorter.sort_edges = tsk_table_sorter_sort_edges_parallel;
+    sorter.num_threads = 2;
+    ret = tsk_table_sorter_run(&sorter, start);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&copy, &expected, 0));
+    tsk_table_sorter_free(&sorter);
+    tsk_table_collection_free(&copy);
+
+    tsk_table_collection_free(&expected);
+}
+
+static void
+test_sort_merge(void)
+{
+    int ret;
+    tsk_id_t ret_id;
+    tsk_table_collection_t tables;
+    tsk_bookmark_t start;
+    tsk_size_t num_rows[] = { 0, 1, 10, 1000 };
+    size_t j, k, l;
+
+    srand(4321);
+    for (j = 0; j < sizeof(num_rows) / sizeof(*num_rows); j++) {
+        for (k = 0; k < sizeof(num_rows) / sizeof(*num_rows); k++) {
+            ret = tsk_table_collection_init(&tables, 0);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            tables.sequence_length = 100;
+            for (l = 0; l < 100; l++) {
+                ret_id = tsk_node_table_add_row(&tables.nodes, 0,
+                    (double) (rand() % 50), TSK_NULL, TSK_NULL, NULL, 0);
+                CU_ASSERT_FATAL(ret_id >= 0);
+            }
+            /* A sorted prefix followed by unsorted new rows */
+            add_random_sort_merge_rows(
+                &tables, num_rows[j], num_rows[j] + 1, num_rows[j]);
+            /* Unsorted rows before the start are also sorted */
+            tsk_memset(&start, 0, sizeof(start));
+            start.edges = tables.edges.num_rows / 2;
+            start.sites = tables.sites.num_rows / 2;
+            start.mutations = tables.mutations.num_rows / 2;
+            verify_sort_merge(&tables, &start);
+            /* Including when there are no rows after the start */
+            ret = tsk_table_collection_record_num_rows(&tables, &start);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            verify_sort_merge(&tables, &start);
+
+            ret = tsk_table_collection_sort(&tables, NULL, 0);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            ret = tsk_table_collection_record_num_rows(&tables, &start);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            add_random_sort_merge_rows(&tables, num_rows[k], num_rows[k], num_rows[k]);
+            verify_sort_merge(&tables, &start);
+
+            /* Sites and mutations can be sorted in full, or not at all */
+            start.sites = 0;
+            start.mutations = 0;
+            verify_sort_merge(&tables, &start);
+            start.mutations = tables.mutations.num_rows;
+            verify_sort_merge(&tables, &start);
+            tsk_table_collection_free(&tables);
+        }
+    }
+
+    ret = tsk_table_collection_init(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tables.sequence_length = 100;
+    ret_id = tsk_node_table_add_row(&tables.nodes, 0, 0, TSK_NULL, TSK_NULL, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret_id = tsk_site_table_add_row(&tables.sites, 0, "0", 1, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    tsk_memset(&start, 0, sizeof(start));
+    start.sites = 2;
+    ret = tsk_table_collection_sort(&tables, &start, TSK_SORT_MERGE);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_SITE_OUT_OF_BOUNDS);
+    start.sites = 0;
+    start.mutations = 1;
+    ret = tsk_table_collection_sort(&tables, &start, TSK_SORT_MERGE);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_MUTATION_OUT_OF_BOUNDS);
+    start.mutations = 0;
+    start.edges = 1;
+    ret = tsk_table_collection_sort(&tables, &start, TSK_SORT_MERGE);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_EDGE_OUT_OF_BOUNDS);
+    tsk_table_collection_free(&tables);
+}
+
 static void
 test_dump_unindexed_with_options(tsk_flags_t tc_options)
 {
@@ -10775,6 +11617,356 @@ test_check_integrity_bad_mutation_parent_topology(void)
     tsk_table_collection_free(&tables);
 }
 
+static void
+verify_check_integrity_parallel(tsk_table_collection_t *tables)
+{
+    tsk_id_t ret, expected;
+    tsk_flags_t options[] = { 0, TSK_CHECK_EDGE_ORDERING,
+        TSK_CHECK_SITE_ORDERING | TSK_CHECK_SITE_DUPLICATES
+            | TSK_CHECK_MUTATION_ORDERING | TSK_CHECK_MIGRATION_ORDERING,
+        TSK_CHECK_INDEXES, TSK_CHECK_TREES, TSK_CHECK_MUTATION_PARENTS };
+    tsk_size_t num_threads[] = { 0, 1, 2, 3, 8 };
+    size_t j, k;
+
+    for (j = 0; j < sizeof(options) / sizeof(*options); j++) {
+        expected = tsk_table_collection_check_integrity(tables, options[j]);
+        for (k = 0; k < sizeof(num_threads) / sizeof(*num_threads); k++) {
+            ret = tsk_table_collection_check_integrity_parallel(
+                tables, options[j], num_threads[k]);
+            CU_ASSERT_EQUAL_FATAL(ret, expected);
+        }
+    }
+}
+
+/* Returns a random row, half of the time next to a multiple of the 65536 row
+ * chunks that the parallel checks split the tables into. */
+static tsk_size_t
+random_check_row(tsk_size_t num_rows)
+{
+    tsk_size_t row = (tsk_size_t) rand() % num_rows;
+
+    if (rand() % 2 == 0) {
+        row = ((row >> 16) << 16) + (tsk_size_t) (rand() % 3);
+        row = row == 0 ? 0 : row - 1;
+        row = TSK_MIN(row, num_rows - 1);
+    }
+    return row;
+}
+
+static void
+test_check_integrity_parallel(void)
+{
+    int ret;
+    tsk_table_collection_t tables, copy;
+    tsk_size_t j, k, num_errors, row;
+    tsk_id_t tmp;
+
+    srand(42);
+    make_wright_fisher_tables(&tables, 500, 300, 100000);
+    CU_ASSERT_FATAL(tables.edges.num_rows > 4 * 65536);
+    CU_ASSERT_FATAL(tables.mutations.num_rows > 2 * 65536);
+    ret = tsk_table_collection_build_index(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_compute_mutation_parents(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(
+        tsk_table_collection_check_integrity(&tables, TSK_CHECK_MUTATION_PARENTS) > 0);
+    verify_check_integrity_parallel(&tables);
+
+    for (j = 0; j < 40; j++) {
+        ret = tsk_table_collection_copy(&tables, &copy, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        num_errors = 1 + (tsk_size_t) (rand() % 3);
+        for (k = 0; k < num_errors; k++) {
+            switch (rand() % 12) {
+                case 0:
+                    row = random_check_row(copy.nodes.num_rows);
+                    copy.nodes.individual[row] = 1;
+                    break;
+                case 1:
+                    row = random_check_row(copy.nodes.num_rows);
+                    copy.nodes.metadata_offset[row + 1] = 1;
+                    break;
+                case 2:
+                    row = random_check_row(copy.edges.num_rows);
+                    copy.edges.parent[row] = (tsk_id_t) copy.nodes.num_rows;
+                    break;
+                case 3:
+                    row = random_check_row(copy.edges.num_rows);
+                    copy.edges.left[row] = copy.edges.right[row];
+                    break;
+                case 4:
+                    /* Swapping edges gives sorting and contiguity errors */
+                    row = random_check_row(copy.edges.num_rows - 2);
+                    tmp = copy.edges.parent[row];
+                    copy.edges.parent[row] = copy.edges.parent[row + 2];
+                    copy.edges.parent[row + 2] = tmp;
+                    tmp = copy.edges.child[row];
+                    copy.edges.child[row] = copy.edges.child[row + 2];
+                    copy.edges.child[row + 2] = tmp;
+                    break;
+                case 5:
+                    row = random_check_row(copy.edges.num_rows);
+                    copy.edges.parent[row] = copy.edges.parent[row / 2];
+                    break;
+                case 6:
+                    row = random_check_row(copy.sites.num_rows - 1);
+                    copy.sites.position[row + 1] = copy.sites.position[row];
+                    break;
+                case 7:
+                    row = random_check_row(copy.mutations.num_rows);
+                    copy.mutations.site[row] = (tsk_id_t) copy.sites.num_rows;
+                    break;
+                case 8:
+                    row = random_check_row(copy.mutations.num_rows);
+                    copy.mutations.time[row]
+                        = copy.nodes.time[copy.mutations.node[row]] + 1;
+                    break;
+                case 9:
+                    row = random_check_row(copy.mutations.num_rows);
+                    copy.mutations.parent[row] = TSK_NULL;
+                    break;
+                case 10:
+                    row = random_check_row(copy.edges.num_rows);
+                    copy.indexes.edge_removal_order[row] = -1;
+                    break;
+                default:
+                    row = random_check_row(copy.edges.num_rows);
+                    copy.edges.right[row] = copy.edges.left[row] + 1e-9;
+                    break;
+            }
+        }
+        verify_check_integrity_parallel(&copy);
+        tsk_table_collection_free(&copy);
+    }
+
+    tables.sequence_length = -1;
+    CU_ASSERT_EQUAL_FATAL(tsk_table_collection_check_integrity_parallel(&tables, 0, 4),
+        TSK_ERR_BAD_SEQUENCE_LENGTH);
+    tables.sequence_length = 100;
+    tsk_table_collection_drop_index(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(
+        tsk_table_collection_check_integrity_parallel(&tables, TSK_CHECK_INDEXES, 4),
+        TSK_ERR_TABLES_NOT_INDEXED);
+    tsk_table_collection_free(&tables);
+}
+
+static const tsk_table_collection_t *index_sort_tables;
+
+static int
+cmp_edge_insertion(const void *a, const void *b)
+{
+    const tsk_edge_table_t *edges = &index_sort_tables->edges;
+    const double *time = index_sort_tables->nodes.time;
+    tsk_id_t ea = *(const tsk_id_t *) a;
+    tsk_id_t eb = *(const tsk_id_t *) b;
+    int ret = (edges->left[ea] > edges->left[eb]) - (edges->left[ea] < edges->left[eb]);
+
+    if (ret == 0) {
+        ret = (time[edges->parent[ea]] > time[edges->parent[eb]])
+              - (time[edges->parent[ea]] < time[edges->parent[eb]]);
+    }
+    if (ret == 0) {
+        ret = (edges->parent[ea] > edges->parent[eb])
+              - (edges->parent[ea] < edges->parent[eb]);
+    }
+    if (ret == 0) {
+        ret = (edges->child[ea] > edges->child[eb])
+              - (edges->child[ea] < edges->child[eb]);
+    }
+    return ret;
+}
+
+static int
+cmp_edge_removal(const void *a, const void *b)
+{
+    const tsk_edge_table_t *edges = &index_sort_tables->edges;
+    const double *time = index_sort_tables->nodes.time;
+    tsk_id_t ea = *(const tsk_id_t *) a;
+    tsk_id_t eb = *(const tsk_id_t *) b;
+    int ret
+        = (edges->right[ea] > edges->right[eb]) - (edges->right[ea] < edges->right[eb]);
+
+    if (ret == 0) {
+        ret = (time[edges->parent[ea]] < time[edges->parent[eb]])
+              - (time[edges->parent[ea]] > time[edges->parent[eb]]);
+    }
+    if (ret == 0) {
+        ret = (edges->parent[ea] < edges->parent[eb])
+              - (edges->parent[ea] > edges->parent[eb]);
+    }
+    if (ret == 0) {
+        ret = (edges->child[ea] < edges->child[eb])
+              - (edges->child[ea] > edges->child[eb]);
+    }
+    return ret;
+}
+
+static void
+verify_build_index_parallel(tsk_table_collection_t *tables)
+{
+    int ret;
+    tsk_size_t num_edges = tables->edges.num_rows;
+    tsk_id_t *insertion = tsk_malloc(num_edges * sizeof(tsk_id_t));
+    tsk_id_t *removal = tsk_malloc(num_edges * sizeof(tsk_id_t));
+    tsk_size_t num_threads[] = { 0, 1, 2, 3, 8 };
+    tsk_size_t j;
+
+    CU_ASSERT_FATAL(num_edges == 0 || (insertion != NULL && removal != NULL));
+    for (j = 0; j < num_edges; j++) {
+        insertion[j] = (tsk_id_t) j;
+        removal[j] = (tsk_id_t) j;
+    }
+    index_sort_tables = tables;
+    qsort(insertion, (size_t) num_edges, sizeof(tsk_id_t), cmp_edge_insertion);
+    qsort(removal, (size_t) num_edges, sizeof(tsk_id_t), cmp_edge_removal);
+
+    for (j = 0; j < sizeof(num_threads) / sizeof(*num_threads); j++) {
+        tsk_table_collection_drop_index(tables, 0);
+        ret = tsk_table_collection_build_index_parallel(tables, 0, num_threads[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_has_index(tables, 0));
+        CU_ASSERT_EQUAL(tsk_memcmp(tables->indexes.edge_insertion_order, insertion,
+                            num_edges * sizeof(tsk_id_t)),
+            0);
+        CU_ASSERT_EQUAL(tsk_memcmp(tables->indexes.edge_removal_order, removal,
+                            num_edges * sizeof(tsk_id_t)),
+            0);
+    }
+    free(insertion);
+    free(removal);
+}
+
+static void
+test_table_collection_build_index_parallel(void)
+{
+    int ret;
+    tsk_id_t ret_id;
+    tsk_table_collection_t tables;
+    tsk_size_t j;
+
+    srand(10);
+    make_wright_fisher_tables(&tables, 200, 100, 0);
+    verify_build_index_parallel(&tables);
+    /* Many edges with the same coordinates */
+    for (j = 0; j < tables.edges.num_rows; j++) {
+        tables.edges.left[j] = floor(tables.edges.left[j]);
+        tables.edges.right[j] = floor(tables.edges.right[j]);
+    }
+    tables.edges.left[0] = -0.0;
+    ret = tsk_table_collection_sort(&tables, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    verify_build_index_parallel(&tables);
+    tsk_table_collection_free(&tables);
+
+    /* Parents with the same time in decreasing ID order */
+    ret = tsk_table_collection_init(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tables.sequence_length = 1;
+    for (j = 0; j < 4; j++) {
+        ret_id = tsk_node_table_add_row(
+            &tables.nodes, 0, j < 2 ? 0 : 1, TSK_NULL, TSK_NULL, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+    }
+    ret_id = tsk_edge_table_add_row(&tables.edges, 0, 1, 3, 1, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret_id = tsk_edge_table_add_row(&tables.edges, 0, 1, 2, 0, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    verify_build_index_parallel(&tables);
+    CU_ASSERT_EQUAL(tables.indexes.edge_insertion_order[0], 1);
+    CU_ASSERT_EQUAL(tables.indexes.edge_removal_order[0], 0);
+
+    /* Errors are the same as for build_index */
+    tables.edges.parent[0] = 4;
+    ret = tsk_table_collection_build_index_parallel(&tables, 0, 4);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_NODE_OUT_OF_BOUNDS);
+    tsk_edge_table_clear(&tables.edges);
+    verify_build_index_parallel(&tables);
+    tsk_table_collection_free(&tables);
+}
+
+static void
+verify_compute_mutation_parents_and_times(tsk_table_collection_t *tables)
+{
+    int ret;
+    tsk_table_collection_t expected, copy;
+    tsk_size_t num_threads[] = { 0, 1, 2, 3, 8 };
+    tsk_size_t j;
+
+    ret = tsk_table_collection_copy(tables, &expected, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_memset(expected.mutations.parent, 0xff,
+        expected.mutations.num_rows * sizeof(tsk_id_t));
+    ret = tsk_table_collection_compute_mutation_times(&expected, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_build_index(&expected, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_compute_mutation_parents(&expected, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    for (j = 0; j < sizeof(num_threads) / sizeof(*num_threads); j++) {
+        ret = tsk_table_collection_copy(tables, &copy, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_table_collection_compute_mutation_parents_and_times(
+            &copy, 0, num_threads[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&copy, &expected, 0));
+        CU_ASSERT_TRUE(tsk_table_collection_has_index(&copy, 0));
+        tsk_table_collection_free(&copy);
+    }
+    tsk_table_collection_free(&expected);
+}
+
+static void
+test_table_collection_compute_mutation_parents_and_times(void)
+{
+    int ret;
+    tsk_id_t ret_id;
+    tsk_table_collection_t tables;
+    tsk_mutation_table_t mutations;
+    tsk_size_t j;
+
+    srand(7);
+    make_wright_fisher_tables(&tables, 50, 50, 5000);
+    ret = tsk_table_collection_build_index(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    /* The times are in the same order as the mutations */
+    verify_compute_mutation_parents_and_times(&tables);
+
+    /* After simplifying, edges span many generations and more mutations at
+     * some sites make the times out of order */
+    ret = tsk_table_collection_simplify(&tables, NULL, 0, 0, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < tables.sites.num_rows; j += 10) {
+        ret_id = tsk_mutation_table_add_row(&tables.mutations, (tsk_id_t) j,
+            (tsk_id_t) (rand() % (int) tables.nodes.num_rows), TSK_NULL,
+            TSK_UNKNOWN_TIME, "2", 1, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+    }
+    ret = tsk_table_collection_sort(&tables, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_build_index(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    verify_compute_mutation_parents_and_times(&tables);
+
+    /* The parents and times are restored on error */
+    ret = tsk_mutation_table_copy(&tables.mutations, &mutations, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_table_collection_drop_index(&tables, 0);
+    ret = tsk_table_collection_compute_mutation_parents_and_times(&tables, 0, 4);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_TABLES_NOT_INDEXED);
+    CU_ASSERT_TRUE(tsk_mutation_table_equals(&tables.mutations, &mutations, 0));
+    tsk_mutation_table_free(&mutations);
+
+    /* No mutations */
+    ret = tsk_mutation_table_clear(&tables.mutations);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_build_index(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    verify_compute_mutation_parents_and_times(&tables);
+    tsk_table_collection_free(&tables);
+}
+
 static void
 test_table_collection_compute_mutation_parents_tolerates_invalid_input(void)
 {
@@ -11894,6 +13086,7 @@ main(int argc, char **argv)
         { "test_node_table_update_row", test_node_table_update_row },
         { "test_node_table_keep_rows", test_node_table_keep_rows },
         { "test_node_table_takeset", test_node_table_takeset },
+        { "test_node_table_reserve_rows", test_node_table_reserve_rows },
         { "test_edge_table", test_edge_table },
         { "test_edge_table_update_row", test_edge_table_update_row },
         { "test_edge_table_update_row_no_metadata",
@@ -11902,6 +13095,7 @@ main(int argc, char **argv)
         { "test_edge_table_keep_rows_no_metadata",
             test_edge_table_keep_rows_no_metadata },
         { "test_edge_table_takeset", test_edge_table_takeset },
+        { "test_edge_table_reserve_rows", test_edge_table_reserve_rows },
         { "test_edge_table_copy_semantics", test_edge_table_copy_semantics },
         { "test_edge_table_squash", test_edge_table_squash },
         { "test_edge_table_squash_multiple_parents",
@@ -11941,6 +13135,7 @@ main(int argc, char **argv)
         { "test_table_size_increments", test_table_size_increments },
         { "test_table_expansion", test_table_expansion },
         { "test_ragged_expansion", test_ragged_expansion },
+        { "test_table_collection_set_allocator", test_table_collection_set_allocator },
         { "test_table_collection_equals_options", test_table_collection_equals_options },
         { "test_table_collection_simplify_errors",
             test_table_collection_simplify_errors },
@@ -11958,6 +13153,8 @@ main(int argc, char **argv)
         { "test_simplify_tables_drops_indexes", test_simplify_tables_drops_indexes },
         { "test_simplify_empty_tables", test_simplify_empty_tables },
         { "test_simplify_metadata", test_simplify_metadata },
+        { "test_simplify_parallel", test_simplify_parallel },
+        { "test_incremental_simplifier", test_incremental_simplifier },
         { "test_link_ancestors_no_edges", test_link_ancestors_no_edges },
         { "test_link_ancestors_input_errors", test_link_ancestors_input_errors },
         { "test_link_ancestors_single_tree", test_link_ancestors_single_tree },
@@ -11982,6 +13179,8 @@ main(int argc, char **argv)
         { "test_ibd_segments_odd_topologies", test_ibd_segments_odd_topologies },
         { "test_ibd_segments_errors", test_ibd_segments_errors },
         { "test_sorter_interface", test_sorter_interface },
+        { "test_sort_edges_parallel", test_sort_edges_parallel },
+        { "test_sort_merge", test_sort_merge },
         { "test_sort_tables_canonical_errors", test_sort_tables_canonical_errors },
         { "test_sort_tables_canonical", test_sort_tables_canonical },
         { "test_sort_tables_drops_indexes", test_sort_tables_drops_indexes },
@@ -12013,6 +13212,11 @@ main(int argc, char **argv)
             test_table_collection_check_integrity_bad_indexes },
         { "test_check_integrity_bad_mutation_parent_topology",
             test_check_integrity_bad_mutation_parent_topology },
+        { "test_check_integrity_parallel", test_check_integrity_parallel },
+        { "test_table_collection_build_index_parallel",
+            test_table_collection_build_index_parallel },
+        { "test_table_collection_compute_mutation_parents_and_times",
+            test_table_collection_compute_mutation_parents_and_times },
         { "test_table_collection_compute_mutation_parents_tolerates_invalid_input",
             test_table_collection_compute_mutation_parents_tolerates_invalid_input },
         { "test_table_collection_compute_mutation_parents_restores_on_error",
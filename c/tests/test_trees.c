@@ -429,6 +429,223 @@ get_tree_list(tsk_treeseq_t *ts)
     return trees;
 }
 
+static void
+check_interleaved_links_identical(tsk_tree_t *self, tsk_tree_t *other)
+{
+    int ret = tsk_tree_update_arrays(other);
+
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    check_trees_identical(self, other);
+}
+
+static void
+verify_tree_interleaved_links(tsk_treeseq_t *ts, tsk_flags_t options)
+{
+    int ret, lret;
+    tsk_tree_t t, lt, other;
+    tsk_id_t j;
+    tsk_id_t num_trees = (tsk_id_t) tsk_treeseq_get_num_trees(ts);
+    const tsk_flags_t loptions = options | TSK_INTERLEAVED_LINKS;
+
+    ret = tsk_tree_init(&t, ts, options);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_tree_init(&lt, ts, loptions);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_FATAL(lt.links != NULL);
+    check_interleaved_links_identical(&t, &lt);
+
+    ret = tsk_tree_first(&t);
+    lret = tsk_tree_first(&lt);
+    while (ret == TSK_TREE_OK) {
+        CU_ASSERT_EQUAL_FATAL(ret, lret);
+        check_interleaved_links_identical(&t, &lt);
+        ret = tsk_tree_next(&t);
+        lret = tsk_tree_next(&lt);
+    }
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(lret, 0);
+    check_interleaved_links_identical(&t, &lt);
+
+    /* Only bring the arrays up to date after several transitions */
+    ret = tsk_tree_last(&t);
+    lret = tsk_tree_last(&lt);
+    while (ret == TSK_TREE_OK) {
+        CU_ASSERT_EQUAL_FATAL(ret, lret);
+        if (t.index % 3 == 0) {
+            check_interleaved_links_identical(&t, &lt);
+        }
+        ret = tsk_tree_prev(&t);
+        lret = tsk_tree_prev(&lt);
+    }
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(lret, 0);
+    check_interleaved_links_identical(&t, &lt);
+
+    for (j = 0; j < num_trees; j++) {
+        ret = tsk_tree_seek_index(&t, j, TSK_SEEK_SKIP);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_tree_seek_index(&lt, j, TSK_SEEK_SKIP);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        check_interleaved_links_identical(&t, &lt);
+        ret = tsk_tree_seek_index(&t, num_trees - j - 1, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_tree_seek_index(&lt, num_trees - j - 1, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        check_interleaved_links_identical(&t, &lt);
+    }
+
+    /* Copying brings the arrays up to date in the destination */
+    ret = tsk_tree_first(&t);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_TREE_OK);
+    ret = tsk_tree_first(&lt);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_TREE_OK);
+    ret = tsk_tree_copy(&lt, &other, options);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    check_trees_identical(&t, &other);
+    tsk_tree_free(&other);
+    ret = tsk_tree_copy(&t, &other, loptions);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    while (true) {
+        check_interleaved_links_identical(&t, &other);
+        CU_ASSERT_EQUAL_FATAL(tsk_tree_next(&t), tsk_tree_next(&other));
+        if (t.index == -1) {
+            break;
+        }
+    }
+    check_interleaved_links_identical(&t, &other);
+    tsk_tree_free(&other);
+
+    if (!(options & TSK_NO_SAMPLE_COUNTS)) {
+        ret = tsk_tree_last(&t);
+        CU_ASSERT_EQUAL_FATAL(ret, TSK_TREE_OK);
+        ret = tsk_tree_last(&lt);
+        CU_ASSERT_EQUAL_FATAL(ret, TSK_TREE_OK);
+        ret = tsk_tree_set_tracked_samples(&t, 1, ts->samples);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_tree_set_tracked_samples(&lt, 1, ts->samples);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        check_interleaved_links_identical(&t, &lt);
+    }
+
+    tsk_tree_free(&t);
+    tsk_tree_free(&lt);
+}
+
+static tsk_size_t
+get_checkpoints_memory(const tsk_treeseq_t *ts)
+{
+    const tsk_tree_checkpoints_t *checkpoints = &ts->checkpoints;
+    tsk_size_t n = checkpoints->num_checkpoints;
+
+    return (n + 1) * sizeof(tsk_size_t) + 2 * n * sizeof(tsk_id_t)
+           + checkpoints->edges_offset[n] * sizeof(tsk_id_t);
+}
+
+static void
+verify_seek_checkpoints(tsk_treeseq_t *ts)
+{
+    int ret;
+    tsk_tree_t t;
+    tsk_size_t num_trees = tsk_treeseq_get_num_trees(ts);
+    tsk_size_t N = tsk_treeseq_get_num_nodes(ts) + 1;
+    tsk_size_t j, k, l, step, budget, memory;
+    tsk_id_t index;
+    tsk_size_t intervals[] = { 1, 2, 3, 7 };
+    tsk_flags_t options[]
+        = { 0, TSK_SAMPLE_LISTS, TSK_NO_SAMPLE_COUNTS, TSK_INTERLEAVED_LINKS };
+    tsk_id_t *parent = tsk_malloc(num_trees * N * sizeof(*parent));
+    tsk_id_t *edge = tsk_malloc(num_trees * N * sizeof(*edge));
+    tsk_size_t *num_samples = tsk_malloc(num_trees * N * sizeof(*num_samples));
+    tsk_size_t *num_roots = tsk_malloc(num_trees * sizeof(*num_roots));
+
+    CU_ASSERT_FATAL(parent != NULL && edge != NULL);
+    CU_ASSERT_FATAL(num_samples != NULL && num_roots != NULL);
+    ret = tsk_tree_init(&t, ts, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (ret = tsk_tree_first(&t); ret == TSK_TREE_OK; ret = tsk_tree_next(&t)) {
+        tsk_memcpy(parent + t.index * (tsk_id_t) N, t.parent, N * sizeof(*parent));
+        tsk_memcpy(edge + t.index * (tsk_id_t) N, t.edge, N * sizeof(*edge));
+        tsk_memcpy(num_samples + t.index * (tsk_id_t) N, t.num_samples,
+            N * sizeof(*num_samples));
+        num_roots[t.index] = tsk_tree_get_num_roots(&t);
+    }
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_tree_free(&t);
+
+    for (j = 0; j < sizeof(intervals) / sizeof(*intervals); j++) {
+        ret = tsk_treeseq_build_checkpoints(ts, intervals[j], 0, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL_FATAL(ts->checkpoints.interval, intervals[j]);
+        CU_ASSERT_EQUAL_FATAL(ts->checkpoints.num_checkpoints,
+            (num_trees + intervals[j] - 1) / intervals[j]);
+        for (k = 0; k < sizeof(options) / sizeof(*options); k++) {
+            ret = tsk_tree_init(&t, ts, options[k]);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            srand(1);
+            for (step = 0; step < 4 * num_trees; step++) {
+                index = (tsk_id_t) ((tsk_size_t) rand() % num_trees);
+                if (step % 2 == 0) {
+                    ret = tsk_tree_seek_index(&t, index, 0);
+                } else {
+                    ret = tsk_tree_seek(&t, ts->breakpoints[index], TSK_SEEK_SKIP);
+                }
+                CU_ASSERT_EQUAL_FATAL(ret, 0);
+                if (step % 3 == 0) {
+                    /* Moving on from a restored tree works as usual */
+                    ret = tsk_tree_next(&t);
+                    CU_ASSERT_FATAL(ret >= 0);
+                    index = t.index;
+                    if (index == -1) {
+                        continue;
+                    }
+                }
+                CU_ASSERT_EQUAL_FATAL(t.index, index);
+                ret = tsk_tree_update_arrays(&t);
+                CU_ASSERT_EQUAL_FATAL(ret, 0);
+                l = (tsk_size_t) index * N;
+                CU_ASSERT_FATAL(
+                    tsk_memcmp(t.parent, parent + l, N * sizeof(*parent)) == 0);
+                CU_ASSERT_FATAL(tsk_memcmp(t.edge, edge + l, N * sizeof(*edge)) == 0);
+                if (tsk_tree_has_sample_counts(&t)) {
+                    /* Roots are only maintained with sample counts */
+                    tsk_tree_print_state(&t, _devnull);
+                    CU_ASSERT_FATAL(tsk_memcmp(t.num_samples, num_samples + l,
+                                        N * sizeof(*num_samples))
+                                    == 0);
+                    CU_ASSERT_EQUAL_FATAL(tsk_tree_get_num_roots(&t), num_roots[index]);
+                }
+            }
+            tsk_tree_free(&t);
+        }
+    }
+
+    /* The interval grows by factors of two until the checkpoints fit */
+    ret = tsk_treeseq_build_checkpoints(ts, num_trees, 0, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    budget = get_checkpoints_memory(ts);
+    ret = tsk_treeseq_build_checkpoints(ts, 1, 0, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    memory = get_checkpoints_memory(ts);
+    budget = (budget + memory) / 2;
+    ret = tsk_treeseq_build_checkpoints(ts, 1, budget, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(ts->checkpoints.interval > 1, memory > budget);
+    CU_ASSERT_EQUAL(ts->checkpoints.interval & (ts->checkpoints.interval - 1), 0);
+    CU_ASSERT_TRUE(get_checkpoints_memory(ts) <= budget);
+
+    ret = tsk_treeseq_build_checkpoints(ts, 1, 1, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    CU_ASSERT_EQUAL_FATAL(ts->checkpoints.num_checkpoints, 0);
+    ret = tsk_treeseq_build_checkpoints(ts, 0, 0, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    CU_ASSERT_EQUAL_FATAL(ts->checkpoints.num_checkpoints, 0);
+
+    tsk_safe_free(parent);
+    tsk_safe_free(edge);
+    tsk_safe_free(num_samples);
+    tsk_safe_free(num_roots);
+}
+
 static void
 verify_tree_next_prev(tsk_treeseq_t *ts)
 {
@@ -5734,6 +5951,8 @@ test_left_to_right_multi_tree(void)
     verify_trees(&ts, num_trees, parents);
     verify_tree_next_prev(&ts);
     verify_edge_array_trees(&ts);
+    verify_tree_interleaved_links(&ts, 0);
+    verify_seek_checkpoints(&ts);
     tsk_treeseq_free(&ts);
 }
 
@@ -5780,6 +5999,8 @@ test_gappy_multi_tree(void)
     verify_trees(&ts, num_trees, parents);
     verify_tree_next_prev(&ts);
     verify_edge_array_trees(&ts);
+    verify_tree_interleaved_links(&ts, 0);
+    verify_seek_checkpoints(&ts);
     tsk_treeseq_free(&ts);
 }
 
@@ -6422,6 +6643,418 @@ test_seek_errors(void)
     tsk_treeseq_free(&ts);
 }
 
+typedef struct {
+    tsk_size_t *visits;
+    tsk_size_t *thread_ids;
+    tsk_size_t *num_edges;
+    tsk_id_t *left_roots;
+    tsk_id_t fail_index[2];
+} for_each_tree_test_t;
+
+static int
+for_each_tree_callback(tsk_tree_t *tree, tsk_size_t thread_id, void *arg)
+{
+    for_each_tree_test_t *test = (for_each_tree_test_t *) arg;
+    tsk_id_t index = tree->index;
+
+    /* CUnit asserts are not thread safe, so we only record state here */
+    test->visits[index]++;
+    test->thread_ids[index] = thread_id;
+    test->num_edges[index] = tree->num_edges;
+    test->left_roots[index] = tsk_tree_get_left_root(tree);
+    if (index == test->fail_index[0] || index == test->fail_index[1]) {
+        return -100 - index;
+    }
+    return 0;
+}
+
+/* Make a tree sequence with an independent caterpillar tree over the samples
+ * on each unit interval */
+static void
+make_many_trees(tsk_treeseq_t *ts, tsk_size_t num_trees, tsk_size_t num_samples)
+{
+    int ret;
+    tsk_table_collection_t tables;
+    tsk_size_t j, k;
+    tsk_id_t u, v;
+
+    ret = tsk_table_collection_init(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tables.sequence_length = (double) num_trees;
+    for (k = 0; k < num_samples; k++) {
+        ret = tsk_node_table_add_row(
+            &tables.nodes, TSK_NODE_IS_SAMPLE, 0, TSK_NULL, TSK_NULL, NULL, 0);
+        CU_ASSERT_FATAL(ret >= 0);
+    }
+    for (j = 0; j < num_trees; j++) {
+        v = (tsk_id_t) ((j + 1) % num_samples);
+        for (k = 1; k < num_samples; k++) {
+            u = tsk_node_table_add_row(
+                &tables.nodes, 0, (double) k, TSK_NULL, TSK_NULL, NULL, 0);
+            CU_ASSERT_FATAL(u >= 0);
+            ret = tsk_edge_table_add_row(&tables.edges, (double) j, (double) j + 1, u,
+                v, NULL, 0);
+            CU_ASSERT_FATAL(ret >= 0);
+            ret = tsk_edge_table_add_row(&tables.edges, (double) j, (double) j + 1, u,
+                (tsk_id_t) ((j + k + 1) % num_samples), NULL, 0);
+            CU_ASSERT_FATAL(ret >= 0);
+            v = u;
+        }
+    }
+    ret = tsk_table_collection_sort(&tables, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_init(ts, &tables, TSK_TS_INIT_BUILD_INDEXES);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_table_collection_free(&tables);
+}
+
+static void
+verify_for_each_tree_parallel(tsk_treeseq_t *ts, tsk_flags_t options)
+{
+    int ret;
+    tsk_tree_t t;
+    tsk_size_t j, num_threads[] = { 0, 1, 2, 3, 8 };
+    tsk_size_t num_trees = tsk_treeseq_get_num_trees(ts);
+    for_each_tree_test_t test;
+    tsk_id_t index;
+
+    test.visits = tsk_malloc(num_trees * sizeof(*test.visits));
+    test.thread_ids = tsk_malloc(num_trees * sizeof(*test.thread_ids));
+    test.num_edges = tsk_malloc(num_trees * sizeof(*test.num_edges));
+    test.left_roots = tsk_malloc(num_trees * sizeof(*test.left_roots));
+    CU_ASSERT_FATAL(test.visits != NULL && test.thread_ids != NULL);
+    CU_ASSERT_FATAL(test.num_edges != NULL && test.left_roots != NULL);
+    ret = tsk_tree_init(&t, ts, options);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    for (j = 0; j < sizeof(num_threads) / sizeof(*num_threads); j++) {
+        test.fail_index[0] = TSK_NULL;
+        test.fail_index[1] = TSK_NULL;
+        tsk_memset(test.visits, 0, num_trees * sizeof(*test.visits));
+        ret = tsk_treeseq_for_each_tree_parallel(
+            ts, for_each_tree_callback, &test, options, num_threads[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        for (ret = tsk_tree_first(&t); ret == TSK_TREE_OK; ret = tsk_tree_next(&t)) {
+            index = t.index;
+            CU_ASSERT_EQUAL(test.visits[index], 1);
+            CU_ASSERT(test.thread_ids[index] < TSK_MAX(1, num_threads[j]));
+            CU_ASSERT_EQUAL(test.num_edges[index], t.num_edges);
+            CU_ASSERT_EQUAL(test.left_roots[index], tsk_tree_get_left_root(&t));
+            if (index > 0) {
+                /* Chunks are contiguous and in thread order */
+                CU_ASSERT_TRUE(test.thread_ids[index] >= test.thread_ids[index - 1]);
+            }
+        }
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        if (num_threads[j] > 1 && num_trees >= num_threads[j]) {
+            CU_ASSERT_EQUAL(test.thread_ids[num_trees - 1], num_threads[j] - 1);
+        }
+
+        /* The error for the first failed tree is returned */
+        test.fail_index[0] = (tsk_id_t) (num_trees - 1);
+        test.fail_index[1] = (tsk_id_t) (num_trees / 2);
+        ret = tsk_treeseq_for_each_tree_parallel(
+            ts, for_each_tree_callback, &test, options, num_threads[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, -100 - (tsk_id_t) (num_trees / 2));
+    }
+
+    ret = tsk_treeseq_for_each_tree_parallel(ts, NULL, NULL, options, 2);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+
+    tsk_tree_free(&t);
+    tsk_safe_free(test.visits);
+    tsk_safe_free(test.thread_ids);
+    tsk_safe_free(test.num_edges);
+    tsk_safe_free(test.left_roots);
+}
+
+static void
+test_for_each_tree_parallel(void)
+{
+    tsk_treeseq_t ts;
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, NULL, NULL,
+        paper_ex_individuals, NULL, 0);
+    verify_for_each_tree_parallel(&ts, 0);
+    verify_for_each_tree_parallel(&ts, TSK_NO_SAMPLE_COUNTS);
+    tsk_treeseq_free(&ts);
+
+    make_many_trees(&ts, 100, 5);
+    CU_ASSERT_EQUAL_FATAL(tsk_treeseq_get_num_trees(&ts), 100);
+    verify_for_each_tree_parallel(&ts, 0);
+    verify_for_each_tree_parallel(&ts, TSK_INTERLEAVED_LINKS);
+    tsk_treeseq_free(&ts);
+}
+
+static void
+test_seek_checkpoints(void)
+{
+    tsk_treeseq_t ts;
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, NULL, NULL,
+        paper_ex_individuals, NULL, 0);
+    verify_seek_checkpoints(&ts);
+    tsk_treeseq_free(&ts);
+
+    make_many_trees(&ts, 200, 6);
+    verify_seek_checkpoints(&ts);
+    tsk_treeseq_free(&ts);
+}
+
+/* Add sites at a quarter, half and three quarters of each unit interval of
+ * the tables made by make_many_trees, with no mutations at the middle site */
+static void
+add_many_sites(tsk_table_collection_t *tables, tsk_size_t num_trees,
+    tsk_size_t num_samples)
+{
+    tsk_id_t site_id, ret_id;
+    tsk_size_t j;
+
+    for (j = 0; j < num_trees; j++) {
+        site_id = tsk_site_table_add_row(
+            &tables->sites, (double) j + 0.25, "0", 1, NULL, 0);
+        CU_ASSERT_FATAL(site_id >= 0);
+        ret_id = tsk_mutation_table_add_row(&tables->mutations, site_id,
+            (tsk_id_t) (j % num_samples), TSK_NULL, TSK_UNKNOWN_TIME, "1", 1, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+        site_id
+            = tsk_site_table_add_row(&tables->sites, (double) j + 0.5, "0", 1, NULL, 0);
+        CU_ASSERT_FATAL(site_id >= 0);
+        site_id = tsk_site_table_add_row(
+            &tables->sites, (double) j + 0.75, "0", 1, NULL, 0);
+        CU_ASSERT_FATAL(site_id >= 0);
+        ret_id = tsk_mutation_table_add_row(&tables->mutations, site_id,
+            (tsk_id_t) (j % num_samples), TSK_NULL, 0.5, "1", 1, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+        ret_id = tsk_mutation_table_add_row(&tables->mutations, site_id,
+            (tsk_id_t) ((j + 1) % num_samples), TSK_NULL, 0.5, "2", 1, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+    }
+}
+
+static void
+verify_treeseq_init_parallel(tsk_treeseq_t *ts)
+{
+    int ret;
+    tsk_treeseq_t other;
+    tsk_size_t j, k;
+    tsk_size_t num_threads[] = { 0, 1, 2, 3, 5, 8 };
+    tsk_flags_t options[] = { 0, TSK_TS_INIT_BUILD_INDEXES };
+
+    for (j = 0; j < sizeof(num_threads) / sizeof(*num_threads); j++) {
+        for (k = 0; k < sizeof(options) / sizeof(*options); k++) {
+            ret = tsk_treeseq_init_parallel(
+                &other, ts->tables, options[k], num_threads[j]);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            verify_treeseq_indexes_equal(ts, &other);
+            tsk_treeseq_free(&other);
+        }
+    }
+}
+
+static void
+test_treeseq_init_parallel(void)
+{
+    int ret;
+    tsk_treeseq_t ts, *caterpillar;
+    tsk_table_collection_t tables;
+    tsk_size_t num_trees = 100;
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL,
+        paper_ex_sites, paper_ex_mutations, paper_ex_individuals, NULL, 0);
+    verify_treeseq_init_parallel(&ts);
+    tsk_treeseq_free(&ts);
+
+    caterpillar = caterpillar_tree(30, 5, 5);
+    verify_treeseq_init_parallel(caterpillar);
+    tsk_treeseq_free(caterpillar);
+    free(caterpillar);
+
+    /* Many trees with sites in each, some without mutations */
+    make_many_trees(&ts, num_trees, 5);
+    verify_treeseq_init_parallel(&ts);
+    ret = tsk_treeseq_copy_tables(&ts, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_treeseq_free(&ts);
+    add_many_sites(&tables, num_trees, 5);
+    ret = tsk_treeseq_init(&ts, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_FALSE(ts.discrete_genome);
+    verify_treeseq_init_parallel(&ts);
+    tsk_treeseq_free(&ts);
+
+    /* Errors in the tables are found before any threads are used */
+    tables.edges.left[0] = tables.edges.right[0];
+    ret = tsk_treeseq_init_parallel(&ts, &tables, 0, 4);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_BAD_EDGE_INTERVAL);
+    tsk_treeseq_free(&ts);
+    tsk_table_collection_free(&tables);
+}
+
+static int
+count_sites_callback(tsk_tree_t *tree, tsk_size_t thread_id, void *arg)
+{
+    int ret;
+    tsk_size_t *counts = (tsk_size_t *) arg;
+    const tsk_site_t *sites;
+    tsk_size_t num_sites;
+
+    ret = tsk_tree_get_sites(tree, &sites, &num_sites);
+    if (ret == 0 && num_sites > 0 && sites == NULL) {
+        ret = TSK_ERR_GENERIC;
+    }
+    counts[thread_id] += num_sites;
+    return ret;
+}
+
+static void
+verify_treeseq_init_lazy(tsk_treeseq_t *ts)
+{
+    int ret;
+    tsk_treeseq_t lazy, loaded;
+    tsk_tree_t tree, lazy_tree;
+    tsk_mutation_t mutation, lazy_mutation;
+    tsk_site_t site;
+    const tsk_site_t *sites, *lazy_sites;
+    tsk_size_t j, k, num_sites, lazy_num_sites;
+    tsk_size_t counts[4];
+    const tsk_size_t num_mutations = tsk_treeseq_get_num_mutations(ts);
+    tsk_flags_t load_options[] = { TSK_LOAD_LAZY,
+        TSK_LOAD_LAZY | TSK_LOAD_TREESEQ_INDEXES,
+        TSK_LOAD_LAZY | TSK_LOAD_TREESEQ_INDEXES | TSK_LOAD_MMAP };
+
+    ret = tsk_treeseq_init(&lazy, ts->tables, TSK_TS_INIT_LAZY);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(lazy.discrete_genome, ts->discrete_genome);
+    CU_ASSERT_EQUAL(lazy.discrete_time, ts->discrete_time);
+    CU_ASSERT_EQUAL(lazy.min_time, ts->min_time);
+    CU_ASSERT_EQUAL(lazy.max_time, ts->max_time);
+    tsk_treeseq_print_state(&lazy, _devnull);
+
+    /* Mutations are found without building the structs */
+    for (j = 0; j < num_mutations; j++) {
+        ret = tsk_treeseq_get_mutation(ts, (tsk_id_t) j, &mutation);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_treeseq_get_mutation(&lazy, (tsk_id_t) j, &lazy_mutation);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL(mutation.edge, lazy_mutation.edge);
+        CU_ASSERT_EQUAL_FATAL(
+            mutation.inherited_state_length, lazy_mutation.inherited_state_length);
+        CU_ASSERT_EQUAL(0, memcmp(mutation.inherited_state,
+                               lazy_mutation.inherited_state,
+                               mutation.inherited_state_length));
+    }
+    CU_ASSERT_EQUAL(lazy.site_mutations_mem, NULL);
+    CU_ASSERT_EQUAL(lazy.tree_sites, NULL);
+
+    /* Stored indexes are the same as for a fully initialised tree sequence */
+    ret = tsk_treeseq_dump(&lazy, _tmp_file_name, TSK_DUMP_TREESEQ_INDEXES);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_load(&loaded, _tmp_file_name, TSK_LOAD_TREESEQ_INDEXES);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    verify_treeseq_indexes_equal(ts, &loaded);
+    tsk_treeseq_free(&loaded);
+
+    /* Loading with TSK_LOAD_LAZY leaves the sites to be built on first use */
+    for (j = 0; j < sizeof(load_options) / sizeof(*load_options); j++) {
+        ret = tsk_treeseq_load(&loaded, _tmp_file_name, load_options[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL(loaded.site_mutations_mem, NULL);
+        CU_ASSERT_EQUAL(loaded.tree_sites, NULL);
+        if (tsk_treeseq_get_num_sites(ts) > 0) {
+            ret = tsk_treeseq_get_site(&loaded, 0, &site);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            CU_ASSERT_NOT_EQUAL(loaded.tree_sites, NULL);
+        }
+        verify_treeseq_indexes_equal(ts, &loaded);
+        tsk_treeseq_free(&loaded);
+    }
+
+    /* The sites are built by tsk_tree_get_sites */
+    ret = tsk_tree_init(&tree, ts, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_tree_init(&lazy_tree, &lazy, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (ret = tsk_tree_first(&tree); ret == TSK_TREE_OK; ret = tsk_tree_next(&tree)) {
+        ret = tsk_tree_next(&lazy_tree);
+        CU_ASSERT_EQUAL_FATAL(ret, TSK_TREE_OK);
+        CU_ASSERT_EQUAL(lazy_tree.sites, NULL);
+        CU_ASSERT_EQUAL(lazy_tree.sites_length, tree.sites_length);
+        ret = tsk_tree_get_sites(&tree, &sites, &num_sites);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_tree_get_sites(&lazy_tree, &lazy_sites, &lazy_num_sites);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL_FATAL(num_sites, lazy_num_sites);
+        for (k = 0; k < num_sites; k++) {
+            CU_ASSERT_EQUAL(sites[k].id, lazy_sites[k].id);
+            CU_ASSERT_EQUAL(sites[k].position, lazy_sites[k].position);
+            CU_ASSERT_EQUAL(sites[k].mutations_length, lazy_sites[k].mutations_length);
+        }
+        tsk_tree_print_state(&lazy_tree, _devnull);
+    }
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_tree_free(&tree);
+    tsk_tree_free(&lazy_tree);
+    verify_treeseq_indexes_equal(ts, &lazy);
+    tsk_treeseq_free(&lazy);
+
+    /* The sites can be built by several threads at once */
+    ret = tsk_treeseq_init_parallel(&lazy, ts->tables, TSK_TS_INIT_LAZY, 4);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_memset(counts, 0, sizeof(counts));
+    ret = tsk_treeseq_for_each_tree_parallel(
+        &lazy, count_sites_callback, counts, 0, 4);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(counts[0] + counts[1] + counts[2] + counts[3],
+        tsk_treeseq_get_num_sites(ts));
+    verify_treeseq_indexes_equal(ts, &lazy);
+    tsk_treeseq_free(&lazy);
+}
+
+static void
+test_treeseq_init_lazy(void)
+{
+    int ret;
+    tsk_treeseq_t ts, *caterpillar;
+    tsk_table_collection_t tables;
+    tsk_site_t site;
+    tsk_size_t num_trees = 100;
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL,
+        paper_ex_sites, paper_ex_mutations, paper_ex_individuals, NULL, 0);
+    verify_treeseq_init_lazy(&ts);
+    tsk_treeseq_free(&ts);
+
+    caterpillar = caterpillar_tree(30, 5, 5);
+    verify_treeseq_init_lazy(caterpillar);
+    tsk_treeseq_free(caterpillar);
+    free(caterpillar);
+
+    make_many_trees(&ts, num_trees, 5);
+    verify_treeseq_init_lazy(&ts);
+    ret = tsk_treeseq_copy_tables(&ts, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_treeseq_free(&ts);
+    add_many_sites(&tables, num_trees, 5);
+    ret = tsk_treeseq_init(&ts, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    verify_treeseq_init_lazy(&ts);
+    tsk_treeseq_free(&ts);
+
+    /* The sites are also built by tsk_treeseq_get_site */
+    ret = tsk_treeseq_init(&ts, &tables, TSK_TS_INIT_LAZY);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(ts.tree_sites_mem, NULL);
+    ret = tsk_treeseq_get_site(&ts, 2, &site);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_NOT_EQUAL(ts.tree_sites_mem, NULL);
+    CU_ASSERT_EQUAL(site.position, 0.75);
+    CU_ASSERT_EQUAL(site.mutations_length, 2);
+    CU_ASSERT_EQUAL(site.mutations[1].id, 2);
+    tsk_treeseq_free(&ts);
+    tsk_table_collection_free(&tables);
+}
+
 /*=======================================================
  * KC Distance tests.
  *=======================================================*/
@@ -7537,6 +8170,111 @@ test_treeseq_get_individuals_time(void)
     tsk_table_collection_free(&tables);
 }
 
+static void
+test_tree_interleaved_links(void)
+{
+    int ret, oret, depth, other_depth;
+    tsk_treeseq_t ts;
+    tsk_tree_t t, other;
+    tsk_id_t u, v, w;
+    tsk_id_t *nodes;
+    tsk_size_t num_nodes;
+    double length, other_length;
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, NULL, NULL,
+        paper_ex_individuals, NULL, 0);
+    verify_tree_interleaved_links(&ts, 0);
+    verify_tree_interleaved_links(&ts, TSK_NO_SAMPLE_COUNTS);
+
+    /* The getters read the links, and other methods fail until the arrays
+     * have been updated */
+    ret = tsk_tree_init(&t, &ts, TSK_INTERLEAVED_LINKS);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_tree_init(&other, &ts, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    nodes = tsk_malloc((tsk_treeseq_get_num_nodes(&ts) + 1) * sizeof(*nodes));
+    CU_ASSERT_FATAL(nodes != NULL);
+    for (ret = tsk_tree_first(&t), oret = tsk_tree_first(&other); ret == TSK_TREE_OK;
+         ret = tsk_tree_next(&t), oret = tsk_tree_next(&other)) {
+        CU_ASSERT_EQUAL_FATAL(oret, TSK_TREE_OK);
+        CU_ASSERT_TRUE(t.links_dirty);
+        CU_ASSERT_EQUAL(tsk_tree_get_num_roots(&t), tsk_tree_get_num_roots(&other));
+        CU_ASSERT_EQUAL(tsk_tree_get_left_root(&t), tsk_tree_get_left_root(&other));
+        CU_ASSERT_EQUAL(tsk_tree_get_right_root(&t), tsk_tree_get_right_root(&other));
+        for (u = 0; u < (tsk_id_t) tsk_treeseq_get_num_nodes(&ts); u++) {
+            ret = tsk_tree_get_parent(&t, u, &v);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            CU_ASSERT_EQUAL(v, other.parent[u]);
+            ret = tsk_tree_get_depth(&t, u, &depth);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            ret = tsk_tree_get_depth(&other, u, &other_depth);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            CU_ASSERT_EQUAL(depth, other_depth);
+            ret = tsk_tree_get_branch_length(&t, u, &length);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            ret = tsk_tree_get_branch_length(&other, u, &other_length);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            CU_ASSERT_EQUAL(length, other_length);
+            ret = tsk_tree_get_mrca(&t, 0, u, &v);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            ret = tsk_tree_get_mrca(&other, 0, u, &w);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            CU_ASSERT_EQUAL(v, w);
+            CU_ASSERT_EQUAL(
+                tsk_tree_is_descendant(&t, 0, u), tsk_tree_is_descendant(&other, 0, u));
+        }
+        ret = tsk_tree_preorder(&t, nodes, &num_nodes);
+        CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_UNSUPPORTED_OPERATION);
+        ret = tsk_tree_postorder(&t, nodes, &num_nodes);
+        CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_UNSUPPORTED_OPERATION);
+        ret = tsk_tree_get_total_branch_length(&t, -1, &length);
+        CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_UNSUPPORTED_OPERATION);
+        ret = tsk_tree_b1_index(&t, &length);
+        CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_UNSUPPORTED_OPERATION);
+        ret = tsk_tree_b2_index(&t, 10, &length);
+        CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_UNSUPPORTED_OPERATION);
+        ret = tsk_tree_update_arrays(&t);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_FALSE(t.links_dirty);
+        ret = tsk_tree_preorder(&t, nodes, &num_nodes);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_tree_get_total_branch_length(&t, -1, &length);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_tree_get_total_branch_length(&other, -1, &other_length);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL(length, other_length);
+        ret = tsk_tree_b2_index(&t, 10, &length);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_tree_b2_index(&other, 10, &other_length);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL(length, other_length);
+    }
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(oret, 0);
+    free(nodes);
+    tsk_tree_free(&other);
+    tsk_tree_free(&t);
+
+    ret = tsk_tree_init(&t, &ts, TSK_INTERLEAVED_LINKS);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_tree_set_root_threshold(&t, 2);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_tree_first(&t);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_TREE_OK);
+    ret = tsk_tree_update_arrays(&t);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(tsk_tree_get_num_roots(&t), 1);
+    CU_ASSERT_EQUAL(tsk_tree_get_left_root(&t), 8);
+    tsk_tree_free(&t);
+
+    /* Sample lists are not supported */
+    ret = tsk_tree_init(&t, &ts, TSK_INTERLEAVED_LINKS | TSK_SAMPLE_LISTS);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_UNSUPPORTED_OPERATION);
+    tsk_tree_free(&t);
+
+    tsk_treeseq_free(&ts);
+}
+
 static void
 test_tree_copy_flags(void)
 {
@@ -8802,6 +9540,8 @@ main(int argc, char **argv)
         { "test_convenience_arrays_multi_tree", test_convenience_arrays_multi_tree },
 
         { "test_tsk_treeseq_bad_records", test_tsk_treeseq_bad_records },
+        { "test_treeseq_init_parallel", test_treeseq_init_parallel },
+        { "test_treeseq_init_lazy", test_treeseq_init_lazy },
 
         /* multiroot tests */
         { "test_multiroot_mrca", test_multiroot_mrca },
@@ -8822,6 +9562,8 @@ main(int argc, char **argv)
         /* Seek */
         { "test_seek_multi_tree", test_seek_multi_tree },
         { "test_seek_errors", test_seek_errors },
+        { "test_for_each_tree_parallel", test_for_each_tree_parallel },
+        { "test_seek_checkpoints", test_seek_checkpoints },
 
         /* KC distance tests */
         { "test_single_tree_kc", test_single_tree_kc },
@@ -8858,6 +9600,7 @@ main(int argc, char **argv)
             test_treeseq_get_individuals_time_errors },
         { "test_treeseq_get_individuals_time", test_treeseq_get_individuals_time },
         { "test_tree_copy_flags", test_tree_copy_flags },
+        { "test_tree_interleaved_links", test_tree_interleaved_links },
         { "test_genealogical_nearest_neighbours_errors",
             test_genealogical_nearest_neighbours_errors },
         { "test_deduplicate_sites", test_deduplicate_sites },
@@ -989,6 +989,61 @@ unsort_edges(tsk_edge_table_t *edges, size_t start)
     free(buff);
 }
 
+void
+verify_treeseq_indexes_equal(tsk_treeseq_t *ts1, tsk_treeseq_t *ts2)
+{
+    tsk_size_t j, k;
+    tsk_size_t num_nodes = tsk_treeseq_get_num_nodes(ts1);
+    tsk_size_t num_trees = tsk_treeseq_get_num_trees(ts1);
+    tsk_size_t num_individuals = tsk_treeseq_get_num_individuals(ts1);
+    tsk_size_t num_sites = tsk_treeseq_get_num_sites(ts1);
+    tsk_site_t *site1, *site2;
+    const tsk_mutation_t *mut1, *mut2;
+
+    CU_ASSERT_TRUE(tsk_table_collection_equals(ts1->tables, ts2->tables, 0));
+    CU_ASSERT_EQUAL_FATAL(num_trees, tsk_treeseq_get_num_trees(ts2));
+    CU_ASSERT_EQUAL_FATAL(ts1->num_samples, ts2->num_samples);
+    CU_ASSERT_EQUAL(ts1->discrete_genome, ts2->discrete_genome);
+    CU_ASSERT_EQUAL(ts1->discrete_time, ts2->discrete_time);
+    CU_ASSERT_EQUAL(ts1->time_uncalibrated, ts2->time_uncalibrated);
+    CU_ASSERT_EQUAL(ts1->min_time, ts2->min_time);
+    CU_ASSERT_EQUAL(ts1->max_time, ts2->max_time);
+    CU_ASSERT_EQUAL(0, memcmp(ts1->breakpoints, ts2->breakpoints,
+                           (num_trees + 1) * sizeof(*ts1->breakpoints)));
+    CU_ASSERT_EQUAL(0, memcmp(ts1->samples, ts2->samples,
+                           ts1->num_samples * sizeof(*ts1->samples)));
+    CU_ASSERT_EQUAL(0, memcmp(ts1->sample_index_map, ts2->sample_index_map,
+                           num_nodes * sizeof(*ts1->sample_index_map)));
+    for (j = 0; j < num_trees; j++) {
+        CU_ASSERT_EQUAL_FATAL(ts1->tree_sites_length[j], ts2->tree_sites_length[j]);
+        for (k = 0; k < ts1->tree_sites_length[j]; k++) {
+            CU_ASSERT_EQUAL(ts1->tree_sites[j][k].id, ts2->tree_sites[j][k].id);
+        }
+    }
+    for (j = 0; j < num_sites; j++) {
+        site1 = ts1->tree_sites_mem + j;
+        site2 = ts2->tree_sites_mem + j;
+        CU_ASSERT_EQUAL_FATAL(site1->mutations_length, site2->mutations_length);
+        for (k = 0; k < site1->mutations_length; k++) {
+            mut1 = site1->mutations + k;
+            mut2 = site2->mutations + k;
+            CU_ASSERT_EQUAL(mut1->id, mut2->id);
+            CU_ASSERT_EQUAL(mut1->edge, mut2->edge);
+            CU_ASSERT_EQUAL_FATAL(
+                mut1->inherited_state_length, mut2->inherited_state_length);
+            CU_ASSERT_EQUAL(0, memcmp(mut1->inherited_state, mut2->inherited_state,
+                                   mut1->inherited_state_length));
+        }
+    }
+    for (j = 0; j < num_individuals; j++) {
+        CU_ASSERT_EQUAL_FATAL(
+            ts1->individual_nodes_length[j], ts2->individual_nodes_length[j]);
+        for (k = 0; k < ts1->individual_nodes_length[j]; k++) {
+            CU_ASSERT_EQUAL(ts1->individual_nodes[j][k], ts2->individual_nodes[j][k]);
+        }
+    }
+}
+
 static int
 tskit_suite_init(void)
 {
@@ -53,6 +53,7 @@ void parse_mutations(const char *text, tsk_mutation_table_t *mutation_table);
 void parse_individuals(const char *text, tsk_individual_table_t *individual_table);
 
 void unsort_edges(tsk_edge_table_t *edges, size_t start);
+void verify_treeseq_indexes_equal(tsk_treeseq_t *ts1, tsk_treeseq_t *ts2);
 
 /* Use a macro so we can get line numbers at roughly the right place */
 #define assert_arrays_almost_equal(len, a, b)                                           \
@@ -32,6 +32,10 @@
 #include <kastore.h>
 #include <tskit/core.h>
 
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
 #define UUID_NUM_BYTES 16
 
 #if defined(_WIN32)
@@ -189,6 +193,10 @@ tsk_strerror_internal(int err)
             ret = "An incompatible type for a column was found in the file. "
                   "(TSK_ERR_BAD_COLUMN_TYPE)";
             break;
+        case TSK_ERR_BAD_INCREMENT:
+            ret = "An increment in the file does not start at the end of the rows "
+                  "that precede it. (TSK_ERR_BAD_INCREMENT)";
+            break;
 
         /* Out of bounds errors */
         case TSK_ERR_BAD_OFFSET:
@@ -398,6 +406,10 @@ tsk_strerror_internal(int err)
             ret = "Metadata is disabled for this table, so cannot be set. "
                   "(TSK_ERR_METADATA_DISABLED)";
             break;
+        case TSK_ERR_CANT_MODIFY_MAPPED:
+            ret = "Tables loaded with TSK_LOAD_MMAP are read-only; copy the tables "
+                  "to modify them. (TSK_ERR_CANT_MODIFY_MAPPED)";
+            break;
 
         /* Limitations */
         case TSK_ERR_ONLY_INFINITE_SITES:
@@ -862,6 +874,254 @@ tsk_blkalloc_free(tsk_blkalloc_t *self)
     }
 }
 
+#if defined(_WIN32)
+
+struct _tsk_thread_t {
+    bool done;
+};
+
+int
+tsk_thread_start(tsk_thread_t **thread, void (*func)(void *), void *arg)
+{
+    int ret = 0;
+
+    *thread = tsk_malloc(sizeof(**thread));
+    if (*thread == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    func(arg);
+    (*thread)->done = true;
+out:
+    return ret;
+}
+
+bool
+tsk_thread_done(tsk_thread_t *self)
+{
+    return self->done;
+}
+
+void
+tsk_thread_join(tsk_thread_t *self)
+{
+    free(self);
+}
+
+/* All work is done on the calling thread, so there is nothing to lock */
+struct _tsk_mutex_t {
+    bool locked;
+};
+
+int
+tsk_mutex_init(tsk_mutex_t **mutex)
+{
+    int ret = 0;
+
+    *mutex = tsk_calloc(1, sizeof(**mutex));
+    if (*mutex == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+    }
+    return ret;
+}
+
+void
+tsk_mutex_lock(tsk_mutex_t *self)
+{
+    self->locked = true;
+}
+
+void
+tsk_mutex_unlock(tsk_mutex_t *self)
+{
+    self->locked = false;
+}
+
+void
+tsk_mutex_free(tsk_mutex_t *self)
+{
+    free(self);
+}
+
+#else
+
+struct _tsk_thread_t {
+    void (*func)(void *);
+    void *arg;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    bool started;
+    bool done;
+};
+
+static void *
+tsk_thread_run(void *arg)
+{
+    tsk_thread_t *self = (tsk_thread_t *) arg;
+
+    self->func(self->arg);
+    pthread_mutex_lock(&self->mutex);
+    self->done = true;
+    pthread_mutex_unlock(&self->mutex);
+    return NULL;
+}
+
+/* Start running func(arg) on a new thread. The thread must be joined to
+ * release its resources, even if the work is already done. */
+int
+tsk_thread_start(tsk_thread_t **thread, void (*func)(void *), void *arg)
+{
+    int ret = 0;
+    tsk_thread_t *self = tsk_malloc(sizeof(*self));
+
+    *thread = self;
+    if (self == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    tsk_memset(self, 0, sizeof(*self));
+    self->func = func;
+    self->arg = arg;
+    if (pthread_mutex_init(&self->mutex, NULL) != 0) {
+        tsk_safe_free(*thread);
+        ret = tsk_trace_error(TSK_ERR_GENERIC);
+        goto out;
+    }
+    self->started = pthread_create(&self->thread, NULL, tsk_thread_run, self) == 0;
+    if (!self->started) {
+        /* Do the work here rather than failing */
+        tsk_thread_run(self);
+    }
+out:
+    return ret;
+}
+
+bool
+tsk_thread_done(tsk_thread_t *self)
+{
+    bool done;
+
+    pthread_mutex_lock(&self->mutex);
+    done = self->done;
+    pthread_mutex_unlock(&self->mutex);
+    return done;
+}
+
+void
+tsk_thread_join(tsk_thread_t *self)
+{
+    if (self->started) {
+        pthread_join(self->thread, NULL);
+    }
+    pthread_mutex_destroy(&self->mutex);
+    free(self);
+}
+
+struct _tsk_mutex_t {
+    pthread_mutex_t mutex;
+};
+
+int
+tsk_mutex_init(tsk_mutex_t **mutex)
+{
+    int ret = 0;
+    tsk_mutex_t *self = tsk_malloc(sizeof(*self));
+
+    *mutex = self;
+    if (self == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    if (pthread_mutex_init(&self->mutex, NULL) != 0) {
+        tsk_safe_free(*mutex);
+        ret = tsk_trace_error(TSK_ERR_GENERIC);
+        goto out;
+    }
+out:
+    return ret;
+}
+
+void
+tsk_mutex_lock(tsk_mutex_t *self)
+{
+    pthread_mutex_lock(&self->mutex);
+}
+
+void
+tsk_mutex_unlock(tsk_mutex_t *self)
+{
+    pthread_mutex_unlock(&self->mutex);
+}
+
+void
+tsk_mutex_free(tsk_mutex_t *self)
+{
+    pthread_mutex_destroy(&self->mutex);
+    free(self);
+}
+
+#endif
+
+typedef struct {
+    void (*func)(void *, tsk_size_t);
+    void *arg;
+    tsk_size_t index;
+} tsk_parallel_task_t;
+
+static void
+tsk_parallel_task_run(void *arg)
+{
+    tsk_parallel_task_t *task = (tsk_parallel_task_t *) arg;
+
+    task->func(task->arg, task->index);
+}
+
+/* Run func(arg, j) for each j in [0, num_threads) concurrently, using the
+ * calling thread for j = 0, and return when they have all completed. */
+int
+tsk_thread_run_parallel(
+    tsk_size_t num_threads, void (*func)(void *, tsk_size_t), void *arg)
+{
+    int ret = 0;
+    tsk_size_t j, num_started;
+    tsk_parallel_task_t *tasks = tsk_malloc(num_threads * sizeof(*tasks));
+    tsk_thread_t **threads = tsk_malloc(num_threads * sizeof(*threads));
+
+    if (tasks == NULL || threads == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    for (j = 0; j < num_threads; j++) {
+        tasks[j].func = func;
+        tasks[j].arg = arg;
+        tasks[j].index = j;
+    }
+    num_started = 1;
+    while (num_started < num_threads) {
+        ret = tsk_thread_start(
+            &threads[num_started], tsk_parallel_task_run, &tasks[num_started]);
+        if (ret != 0) {
+            break;
+        }
+        num_started++;
+    }
+    if (num_threads > 0) {
+        tsk_parallel_task_run(&tasks[0]);
+    }
+    /* Run any tasks whose threads could not be started here */
+    for (j = num_started; j < num_threads; j++) {
+        tsk_parallel_task_run(&tasks[j]);
+    }
+    for (j = 1; j < num_started; j++) {
+        tsk_thread_join(threads[j]);
+    }
+    ret = 0;
+out:
+    tsk_safe_free(tasks);
+    tsk_safe_free(threads);
+    return ret;
+}
+
 /* Mirrors the semantics of numpy's searchsorted function. Uses binary
  * search to find the index of the closest value in the array. */
 tsk_size_t
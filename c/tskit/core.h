@@ -207,6 +207,9 @@ whose representation differs from the NAN generated by computations such as divi
 #define TSK_FILE_FORMAT_NAME_LENGTH   11
 #define TSK_FILE_FORMAT_VERSION_MAJOR 12
 #define TSK_FILE_FORMAT_VERSION_MINOR 7
+/* Files written with TSK_DUMP_COMPRESS have this major version, so that
+ * earlier versions of tskit, which can't read compressed columns, reject them */
+#define TSK_FILE_FORMAT_COMPRESSED_VERSION_MAJOR 13
 
 /**
 @defgroup GENERIC_FUNCTION_OPTIONS General options flags used in some functions.
@@ -309,6 +312,12 @@ not found in the file.
 An unsupported type was provided for a column in the file.
 */
 #define TSK_ERR_BAD_COLUMN_TYPE                                     -105
+
+/**
+An increment in a file written by tsk_table_collection_dump_increment does
+not follow on from the rows that precede it.
+*/
+#define TSK_ERR_BAD_INCREMENT                                       -106
 /** @} */
 
 /**
@@ -578,6 +587,11 @@ Metadata was attempted to be set on a table where it is disabled.
 There was an error with the table's indexes.
 */
 #define TSK_ERR_TABLES_BAD_INDEXES                                  -707
+/**
+A table loaded with TSK_LOAD_MMAP cannot be modified, as its columns point
+into the read-only memory mapped file.
+*/
+#define TSK_ERR_CANT_MODIFY_MAPPED                                  -708
 /** @} */
 
 /**
@@ -1057,6 +1071,25 @@ extern int tsk_blkalloc_init(tsk_blkalloc_t *self, size_t chunk_size);
 extern void *tsk_blkalloc_get(tsk_blkalloc_t *self, size_t size);
 extern void tsk_blkalloc_free(tsk_blkalloc_t *self);
 
+/* Private support for running work on a background thread. On platforms
+ * without pthreads (Windows), or if a thread cannot be started, the work is
+ * run on the calling thread when the thread is started. */
+typedef struct _tsk_thread_t tsk_thread_t;
+
+int tsk_thread_start(tsk_thread_t **thread, void (*func)(void *), void *arg);
+bool tsk_thread_done(tsk_thread_t *thread);
+void tsk_thread_join(tsk_thread_t *thread);
+int tsk_thread_run_parallel(
+    tsk_size_t num_threads, void (*func)(void *, tsk_size_t), void *arg);
+
+/* Private mutex for sharing state between the threads above. */
+typedef struct _tsk_mutex_t tsk_mutex_t;
+
+int tsk_mutex_init(tsk_mutex_t **mutex);
+void tsk_mutex_lock(tsk_mutex_t *mutex);
+void tsk_mutex_unlock(tsk_mutex_t *mutex);
+void tsk_mutex_free(tsk_mutex_t *mutex);
+
 typedef struct _tsk_avl_node_int_t {
     int64_t key;
     void *value;
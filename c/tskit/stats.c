@@ -179,12 +179,17 @@ static int
 tsk_ld_calc_run_forward(tsk_ld_calc_t *self)
 {
     int ret = 0;
-    tsk_size_t j;
+    tsk_size_t j, num_sites;
+    const tsk_site_t *sites;
     bool done = false;
 
-    for (j = 0; j < self->tree.sites_length; j++) {
-        if (self->tree.sites[j].id > self->focal_site.id) {
-            ret = tsk_ld_calc_compute_and_append(self, &self->tree.sites[j], &done);
+    ret = tsk_tree_get_sites(&self->tree, &sites, &num_sites);
+    if (ret != 0) {
+        goto out;
+    }
+    for (j = 0; j < num_sites; j++) {
+        if (sites[j].id > self->focal_site.id) {
+            ret = tsk_ld_calc_compute_and_append(self, &sites[j], &done);
             if (ret != 0) {
                 goto out;
             }
@@ -194,8 +199,12 @@ tsk_ld_calc_run_forward(tsk_ld_calc_t *self)
         }
     }
     while (((ret = tsk_tree_next(&self->tree)) == TSK_TREE_OK) && !done) {
-        for (j = 0; j < self->tree.sites_length; j++) {
-            ret = tsk_ld_calc_compute_and_append(self, &self->tree.sites[j], &done);
+        ret = tsk_tree_get_sites(&self->tree, &sites, &num_sites);
+        if (ret != 0) {
+            goto out;
+        }
+        for (j = 0; j < num_sites; j++) {
+            ret = tsk_ld_calc_compute_and_append(self, &sites[j], &done);
             if (ret != 0) {
                 goto out;
             }
@@ -217,11 +226,17 @@ tsk_ld_calc_run_reverse(tsk_ld_calc_t *self)
 {
     int ret = 0;
     tsk_id_t j;
+    tsk_size_t num_sites;
+    const tsk_site_t *sites;
     bool done = false;
 
-    for (j = (tsk_id_t) self->tree.sites_length - 1; j >= 0; j--) {
-        if (self->tree.sites[j].id < self->focal_site.id) {
-            ret = tsk_ld_calc_compute_and_append(self, &self->tree.sites[j], &done);
+    ret = tsk_tree_get_sites(&self->tree, &sites, &num_sites);
+    if (ret != 0) {
+        goto out;
+    }
+    for (j = (tsk_id_t) num_sites - 1; j >= 0; j--) {
+        if (sites[j].id < self->focal_site.id) {
+            ret = tsk_ld_calc_compute_and_append(self, &sites[j], &done);
             if (ret != 0) {
                 goto out;
             }
@@ -231,8 +246,12 @@ tsk_ld_calc_run_reverse(tsk_ld_calc_t *self)
         }
     }
     while (((ret = tsk_tree_prev(&self->tree)) == TSK_TREE_OK) && !done) {
-        for (j = (tsk_id_t) self->tree.sites_length - 1; j >= 0; j--) {
-            ret = tsk_ld_calc_compute_and_append(self, &self->tree.sites[j], &done);
+        ret = tsk_tree_get_sites(&self->tree, &sites, &num_sites);
+        if (ret != 0) {
+            goto out;
+        }
+        for (j = (tsk_id_t) num_sites - 1; j >= 0; j--) {
+            ret = tsk_ld_calc_compute_and_append(self, &sites[j], &done);
             if (ret != 0) {
                 goto out;
             }
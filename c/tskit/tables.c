@@ -37,6 +37,8 @@
 #define TABLE_SEP "-----------------------------------------\n"
 
 #define TSK_COL_OPTIONAL (1 << 0)
+/* Metadata columns and schemas, which are skipped with TSK_LOAD_SKIP_METADATA */
+#define TSK_COL_METADATA (1 << 1)
 
 typedef struct {
     const char *name;
@@ -103,578 +105,969 @@ check_offset_overflow(tsk_size_t current_size, tsk_size_t additional_elements)
 #define TSK_NUM_ROWS_UNSET   ((tsk_size_t) - 1)
 #define TSK_MAX_COL_NAME_LEN 64
 
-static int
-read_table_cols(kastore_t *store, tsk_size_t *num_rows, read_table_col_t *cols,
-    tsk_flags_t TSK_UNUSED(flags))
+/* Private load option used by tsk_table_collection_reader_t. Columns are copied
+ * from the store into the existing tables, rather than the tables taking
+ * ownership of the arrays returned by the store. */
+#define TSK_LOAD_COPY_COLUMNS (1 << 15)
+
+/* Returns true if the specified array lies within the memory mapping of the
+ * specified store, which may be NULL. The end of the mapping is included
+ * because zero-length arrays at the end of the file point there. */
+static bool
+store_is_mapped_array(const kastore_t *store, const void *array)
 {
-    int ret = 0;
-    size_t len;
-    int type;
-    read_table_col_t *col;
+    uintptr_t addr = (uintptr_t) array;
+    uintptr_t start;
+    bool ret = false;
 
-    for (col = cols; col->name != NULL; col++) {
-        ret = kastore_containss(store, col->name);
-        if (ret < 0) {
-            ret = tsk_set_kas_error(ret);
-            goto out;
-        }
-        if (ret == 1) {
-            ret = kastore_gets(store, col->name, col->array_dest, &len, &type);
-            if (ret != 0) {
-                ret = tsk_set_kas_error(ret);
-                goto out;
+    if (store != NULL && store->mmap_addr != NULL) {
+        start = (uintptr_t) store->mmap_addr;
+        ret = addr >= start && addr <= start + store->mmap_size;
+    }
+    return ret;
+}
+
+/* Arrays returned by a memory-mapped store are borrowed from the store,
+ * and must not be freed. */
+static void
+free_store_array(const kastore_t *store, void **array)
+{
+    if (!store_is_mapped_array(store, *array)) {
+        tsk_safe_free(*array);
+    }
+    *array = NULL;
+}
+
+/* The number of tables recorded in a tsk_bookmark_t */
+#define TSK_NUM_BOOKMARK_TABLES 8
+
+static void
+bookmark_to_array(const tsk_bookmark_t *bookmark, tsk_size_t *array)
+{
+    array[0] = bookmark->individuals;
+    array[1] = bookmark->nodes;
+    array[2] = bookmark->edges;
+    array[3] = bookmark->migrations;
+    array[4] = bookmark->sites;
+    array[5] = bookmark->mutations;
+    array[6] = bookmark->populations;
+    array[7] = bookmark->provenances;
+}
+
+/* Columns written with TSK_DUMP_COMPRESS are stored as KAS_UINT8 arrays under
+ * their name followed by TSK_COMPRESSED_COL_SUFFIX, so that they can't be
+ * mistaken for the column itself. The stored bytes begin with a header
+ * holding the codec in byte 0, the kastore type of the column in byte 1 and
+ * the number of elements as a uint64 in bytes 8-15, followed by the encoded
+ * elements. Columns that don't shrink when compressed are stored verbatim. */
+#define TSK_COMPRESSED_COL_SUFFIX  "/compressed"
+#define TSK_COMPRESSED_HEADER_SIZE 16
+
+/* The differences between successive elements are zigzag encoded and stored
+ * as variable length integers. Used for integer columns. */
+#define TSK_CODEC_DELTA_VARINT 1
+/* The bytes of the elements are grouped by significance and then compressed
+ * with a byte-oriented LZ77 scheme. Used for floating point and byte columns. */
+#define TSK_CODEC_SHUFFLE_LZ 2
+
+/* Parameters of the LZ codec. Matches are found using a hash table of
+ * the most recent position of each 4 byte sequence. */
+#define TSK_LZ_MIN_MATCH 4
+#define TSK_LZ_MAX_OFFSET 65535
+#define TSK_LZ_HASH_BITS 14
+
+
+/* Elements are treated as little-endian unsigned integers of the
+ * appropriate width, whatever their type. This is always lossless, and on
+ * little-endian machines gives small deltas for slowly changing values. */
+static uint64_t
+load_element(const uint8_t *src, size_t width)
+{
+    uint64_t value = 0;
+    size_t k;
+
+    for (k = 0; k < width; k++) {
+        value |= ((uint64_t) src[k]) << (8 * k);
+    }
+    return value;
+}
+
+static void
+store_element(uint8_t *dest, size_t width, uint64_t value)
+{
+    size_t k;
+
+    for (k = 0; k < width; k++) {
+        dest[k] = (uint8_t) (value >> (8 * k));
+    }
+}
+
+static uint64_t
+element_mask(size_t width)
+{
+    return width == 8 ? UINT64_MAX : (((uint64_t) 1) << (8 * width)) - 1;
+}
+
+/* Encode the differences between successive elements as zigzag LEB128
+ * varints. Returns false if the output does not fit in the buffer. */
+static bool
+delta_varint_encode(const uint8_t *src, size_t num_elements, size_t width,
+    uint8_t *dest, size_t capacity, size_t *size)
+{
+    const uint64_t mask = element_mask(width);
+    const uint64_t sign_bit = ((uint64_t) 1) << (8 * width - 1);
+    uint64_t value, delta, zigzag;
+    uint64_t previous = 0;
+    size_t j;
+    size_t offset = 0;
+
+    for (j = 0; j < num_elements; j++) {
+        value = load_element(src + j * width, width);
+        delta = (value - previous) & mask;
+        previous = value;
+        /* Sign extend so that small negative deltas are small zigzag values */
+        if (delta & sign_bit) {
+            delta |= ~mask;
+        }
+        zigzag = (delta << 1) ^ (0 - (delta >> 63));
+        do {
+            if (offset == capacity) {
+                return false;
             }
-            if (*num_rows == TSK_NUM_ROWS_UNSET) {
-                *num_rows = (tsk_size_t) len;
-            } else {
-                if (*num_rows != (tsk_size_t) len) {
-                    ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
-                    goto out;
-                }
+            dest[offset] = (uint8_t) (zigzag & 0x7f);
+            zigzag >>= 7;
+            if (zigzag != 0) {
+                dest[offset] |= 0x80;
             }
-            if (type != col->type) {
-                ret = tsk_trace_error(TSK_ERR_BAD_COLUMN_TYPE);
-                goto out;
+            offset++;
+        } while (zigzag != 0);
+    }
+    *size = offset;
+    return true;
+}
+
+/* Decode the specified varints, returning false if they are malformed or
+ * do not hold exactly the specified number of elements. */
+static bool
+delta_varint_decode(const uint8_t *src, size_t size, size_t num_elements,
+    size_t width, uint8_t *dest)
+{
+    const uint64_t mask = element_mask(width);
+    uint64_t zigzag;
+    uint64_t value = 0;
+    unsigned int shift;
+    uint8_t byte;
+    size_t j;
+    size_t offset = 0;
+
+    for (j = 0; j < num_elements; j++) {
+        zigzag = 0;
+        shift = 0;
+        do {
+            if (offset == size || shift > 63) {
+                return false;
             }
-        } else if (!(col->options & TSK_COL_OPTIONAL)) {
-            ret = tsk_trace_error(TSK_ERR_REQUIRED_COL_NOT_FOUND);
-            goto out;
+            byte = src[offset];
+            offset++;
+            zigzag |= ((uint64_t) (byte & 0x7f)) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        value = (value + ((zigzag >> 1) ^ (0 - (zigzag & 1)))) & mask;
+        store_element(dest + j * width, width, value);
+    }
+    return offset == size;
+}
+
+/* Group the bytes of the elements by significance, so that the slowly
+ * varying high order bytes of numeric arrays form long runs. */
+static void
+byte_shuffle(const uint8_t *src, size_t num_elements, size_t width, uint8_t *dest)
+{
+    size_t j, k;
+
+    for (j = 0; j < num_elements; j++) {
+        for (k = 0; k < width; k++) {
+            dest[k * num_elements + j] = src[j * width + k];
         }
     }
-out:
-    return ret;
 }
 
-static int
-cast_offset_array(read_table_ragged_col_t *col, uint32_t *source, tsk_size_t num_rows)
+static void
+byte_unshuffle(const uint8_t *src, size_t num_elements, size_t width, uint8_t *dest)
 {
-    int ret = 0;
-    tsk_size_t len = num_rows + 1;
-    tsk_size_t j;
-    uint64_t *dest = tsk_malloc(len * sizeof(*dest));
+    size_t j, k;
 
-    if (dest == NULL) {
-        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
-        goto out;
+    for (j = 0; j < num_elements; j++) {
+        for (k = 0; k < width; k++) {
+            dest[j * width + k] = src[k * num_elements + j];
+        }
     }
-    *col->offset_array_dest = dest;
-    for (j = 0; j < len; j++) {
-        dest[j] = source[j];
+}
+
+/* The LZ format is a sequence of blocks, each consisting of a token byte
+ * holding the number of literals in the high nibble and the match length
+ * minus TSK_LZ_MIN_MATCH in the low nibble, followed by the literals, a
+ * minus TSK_LZ_MIN_MATCH in the low nibble, followed by the literals, a
+ * 2 byte little-endian match offset and the match length. Nibbles equal to
+ * 15 are followed by extra length bytes, which are summed until a byte
+ * less than 255 is seen. The final block consists of literals only. */
+static bool
+lz_put_length(uint8_t *dest, size_t capacity, size_t *offset, size_t length)
+{
+    while (length >= 255) {
+        if (*offset == capacity) {
+            return false;
+        }
+        dest[*offset] = 255;
+        (*offset)++;
+        length -= 255;
     }
-out:
-    return ret;
+    if (*offset == capacity) {
+        return false;
+    }
+    dest[*offset] = (uint8_t) length;
+    (*offset)++;
+    return true;
 }
 
-static int
-read_table_ragged_cols(kastore_t *store, tsk_size_t *num_rows,
-    read_table_ragged_col_t *cols, tsk_flags_t TSK_UNUSED(flags))
+static bool
+lz_put_block(uint8_t *dest, size_t capacity, size_t *offset, const uint8_t *literals,
+    size_t num_literals, size_t match_offset, size_t match_length)
 {
-    int ret = 0;
-    size_t data_len = 0; // initial value unused, just to keep the compiler happy.
-    size_t offset_len;
-    int type;
-    read_table_ragged_col_t *col;
-    char offset_col_name[TSK_MAX_COL_NAME_LEN];
-    bool data_col_present, offset_col_present;
-    void *store_offset_array = NULL;
-    tsk_size_t *offset_array;
+    size_t literal_code = num_literals < 15 ? num_literals : 15;
+    size_t match_code = 0;
 
-    for (col = cols; col->name != NULL; col++) {
-        ret = kastore_containss(store, col->name);
-        if (ret < 0) {
-            ret = tsk_set_kas_error(ret);
-            goto out;
+    if (match_length > 0) {
+        match_code = match_length - TSK_LZ_MIN_MATCH;
+        match_code = match_code < 15 ? match_code : 15;
+    }
+    if (*offset == capacity) {
+        return false;
+    }
+    dest[*offset] = (uint8_t) ((literal_code << 4) | match_code);
+    (*offset)++;
+    if (literal_code == 15
+        && !lz_put_length(dest, capacity, offset, num_literals - 15)) {
+        return false;
+    }
+    if (capacity - *offset < num_literals) {
+        return false;
+    }
+    memcpy(dest + *offset, literals, num_literals);
+    *offset += num_literals;
+    if (match_length > 0) {
+        if (capacity - *offset < 2) {
+            return false;
         }
-        data_col_present = false;
-        if (ret == 1) {
-            ret = kastore_gets(store, col->name, col->data_array_dest, &data_len, &type);
-            if (ret != 0) {
-                ret = tsk_set_kas_error(ret);
-                goto out;
+        dest[*offset] = (uint8_t) (match_offset & 0xff);
+        dest[*offset + 1] = (uint8_t) (match_offset >> 8);
+        *offset += 2;
+        if (match_code == 15
+            && !lz_put_length(
+                dest, capacity, offset, match_length - TSK_LZ_MIN_MATCH - 15)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t
+lz_hash(const uint8_t *src)
+{
+    uint32_t sequence;
+
+    memcpy(&sequence, src, sizeof(sequence));
+    return (sequence * 2654435761U) >> (32 - TSK_LZ_HASH_BITS);
+}
+
+/* Compress the specified bytes into the output buffer, returning false if the
+ * output does not fit. The hash table must have 2^TSK_LZ_HASH_BITS entries,
+ * and is used to record the 1-based position of the last occurence of each
+ * hashed sequence. */
+static bool
+lz_compress(const uint8_t *src, size_t size, uint8_t *dest, size_t capacity,
+    size_t *hash_table, size_t *encoded_size)
+{
+    size_t pos = 0;
+    size_t anchor = 0;
+    size_t offset = 0;
+    size_t match, length;
+    uint32_t h;
+
+    memset(hash_table, 0, sizeof(*hash_table) << TSK_LZ_HASH_BITS);
+    while (size >= TSK_LZ_MIN_MATCH && pos <= size - TSK_LZ_MIN_MATCH) {
+        h = lz_hash(src + pos);
+        match = hash_table[h];
+        hash_table[h] = pos + 1;
+        if (match != 0 && pos - (match - 1) <= TSK_LZ_MAX_OFFSET
+            && memcmp(src + match - 1, src + pos, TSK_LZ_MIN_MATCH) == 0) {
+            match--;
+            length = TSK_LZ_MIN_MATCH;
+            while (pos + length < size && src[match + length] == src[pos + length]) {
+                length++;
             }
-            if (type != col->data_type) {
-                ret = tsk_trace_error(TSK_ERR_BAD_COLUMN_TYPE);
-                goto out;
+            if (!lz_put_block(dest, capacity, &offset, src + anchor, pos - anchor,
+                    pos - match, length)) {
+                return false;
             }
-            *col->data_len_dest = (tsk_size_t) data_len;
-            data_col_present = true;
-        } else if (!(col->options & TSK_COL_OPTIONAL)) {
-            ret = tsk_trace_error(TSK_ERR_REQUIRED_COL_NOT_FOUND);
-            goto out;
+            pos += length;
+            anchor = pos;
+        } else {
+            pos++;
         }
+    }
+    if (!lz_put_block(dest, capacity, &offset, src + anchor, size - anchor, 0, 0)) {
+        return false;
+    }
+    *encoded_size = offset;
+    return true;
+}
 
-        assert(strlen(col->name) + strlen("_offset") + 2 < sizeof(offset_col_name));
-        strcpy(offset_col_name, col->name);
-        strcat(offset_col_name, "_offset");
+static bool
+lz_get_length(const uint8_t *src, size_t size, size_t *offset, size_t *length)
+{
+    uint8_t byte;
 
-        ret = kastore_containss(store, offset_col_name);
-        if (ret < 0) {
-            ret = tsk_set_kas_error(ret);
-            goto out;
+    do {
+        if (*offset == size || *length > SIZE_MAX - 255) {
+            return false;
         }
-        offset_col_present = ret == 1;
-        if (offset_col_present != data_col_present) {
-            ret = tsk_trace_error(TSK_ERR_BOTH_COLUMNS_REQUIRED);
-            goto out;
+        byte = src[*offset];
+        (*offset)++;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+/* Decompress the specified bytes, returning false if they are malformed or
+ * do not decompress to exactly the specified number of bytes. */
+static bool
+lz_decompress(const uint8_t *src, size_t size, uint8_t *dest, size_t decoded_size)
+{
+    size_t in = 0;
+    size_t out = 0;
+    size_t num_literals, match_offset, match_length, j;
+    uint8_t token;
+
+    while (true) {
+        if (in == size) {
+            return false;
+        }
+        token = src[in];
+        in++;
+        num_literals = token >> 4;
+        if (num_literals == 15 && !lz_get_length(src, size, &in, &num_literals)) {
+            return false;
+        }
+        if (size - in < num_literals || decoded_size - out < num_literals) {
+            return false;
+        }
+        memcpy(dest + out, src + in, num_literals);
+        in += num_literals;
+        out += num_literals;
+        if (in == size) {
+            break;
         }
-        if (offset_col_present) {
-            ret = kastore_gets(
-                store, offset_col_name, &store_offset_array, &offset_len, &type);
-            if (ret != 0) {
-                ret = tsk_set_kas_error(ret);
-                goto out;
-            }
-            /* A table with zero rows will still have an offset length of 1;
-             * catching this here prevents underflows in the logic below */
-            if (offset_len == 0) {
-                ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
-                goto out;
-            }
-            /* Some tables have only ragged columns */
-            if (*num_rows == TSK_NUM_ROWS_UNSET) {
-                *num_rows = (tsk_size_t) offset_len - 1;
-            } else {
-                if (*num_rows != (tsk_size_t) offset_len - 1) {
-                    ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
-                    goto out;
-                }
-            }
-            if (type == KAS_UINT64) {
-                *col->offset_array_dest = (uint64_t *) store_offset_array;
-                store_offset_array = NULL;
-            } else if (type == KAS_UINT32) {
-                ret = cast_offset_array(col, (uint32_t *) store_offset_array, *num_rows);
-                if (ret != 0) {
-                    goto out;
-                }
-                tsk_safe_free(store_offset_array);
-                store_offset_array = NULL;
-            } else {
-                ret = tsk_trace_error(TSK_ERR_BAD_COLUMN_TYPE);
-                goto out;
-            }
-            offset_array = *col->offset_array_dest;
-            if (offset_array[*num_rows] != (tsk_size_t) data_len) {
-                ret = tsk_trace_error(TSK_ERR_BAD_OFFSET);
-                goto out;
-            }
+        if (size - in < 2) {
+            return false;
+        }
+        match_offset = (size_t) src[in] | ((size_t) src[in + 1] << 8);
+        in += 2;
+        match_length = token & 0xf;
+        if (match_length == 15 && !lz_get_length(src, size, &in, &match_length)) {
+            return false;
+        }
+        match_length += TSK_LZ_MIN_MATCH;
+        if (match_offset == 0 || match_offset > out
+            || decoded_size - out < match_length) {
+            return false;
         }
+        /* Matches may overlap the output, so copy byte by byte */
+        for (j = 0; j < match_length; j++) {
+            dest[out + j] = dest[out + j - match_offset];
+        }
+        out += match_length;
     }
-out:
-    tsk_safe_free(store_offset_array);
-    return ret;
+    return out == decoded_size;
+}
+
+static size_t
+column_type_size(int type)
+{
+    size_t size;
+
+    switch (type) {
+        case KAS_INT8:
+        case KAS_UINT8:
+            size = 1;
+            break;
+        case KAS_INT16:
+        case KAS_UINT16:
+            size = 2;
+            break;
+        case KAS_INT32:
+        case KAS_UINT32:
+        case KAS_FLOAT32:
+            size = 4;
+            break;
+        default:
+            size = 8;
+            break;
+    }
+    return size;
 }
 
+/* Compress the specified column into a newly allocated buffer holding the
+ * header and the encoded elements. If compression doesn't reduce the size
+ * of the column, *encoded is set to NULL. */
 static int
-read_table_properties(
-    kastore_t *store, read_table_property_t *properties, tsk_flags_t TSK_UNUSED(flags))
+compress_column(const void *array, size_t len, int type, uint8_t **encoded,
+    size_t *encoded_len)
 {
     int ret = 0;
-    size_t len;
-    int type;
-    read_table_property_t *property;
-
-    for (property = properties; property->name != NULL; property++) {
-        ret = kastore_containss(store, property->name);
-        if (ret < 0) {
-            ret = tsk_set_kas_error(ret);
+    size_t width = column_type_size(type);
+    size_t size = len * width;
+    const uint8_t *src = (const uint8_t *) array;
+    uint8_t codec = TSK_CODEC_DELTA_VARINT;
+    uint64_t num_elements = (uint64_t) len;
+    uint8_t *dest = NULL;
+    uint8_t *shuffled = NULL;
+    size_t *hash_table = NULL;
+    size_t capacity, payload_size = 0;
+    bool fits;
+
+    *encoded = NULL;
+    if (size <= TSK_COMPRESSED_HEADER_SIZE + 1) {
+        goto out;
+    }
+    if (type == KAS_FLOAT64 || type == KAS_FLOAT32 || type == KAS_INT8
+        || type == KAS_UINT8) {
+        codec = TSK_CODEC_SHUFFLE_LZ;
+    }
+    /* The compressed column must be strictly smaller than the original */
+    capacity = size - TSK_COMPRESSED_HEADER_SIZE - 1;
+    dest = tsk_malloc(TSK_COMPRESSED_HEADER_SIZE + capacity);
+    if (dest == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    if (codec == TSK_CODEC_DELTA_VARINT) {
+        fits = delta_varint_encode(src, len, width, dest + TSK_COMPRESSED_HEADER_SIZE,
+            capacity, &payload_size);
+    } else {
+        hash_table = tsk_malloc(sizeof(*hash_table) << TSK_LZ_HASH_BITS);
+        if (hash_table == NULL) {
+            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
             goto out;
         }
-        if (ret == 1) {
-            ret = kastore_gets(store, property->name, property->array_dest, &len, &type);
-            if (ret != 0) {
-                ret = tsk_set_kas_error(ret);
-                assert(ret != 0); /* Tell static analysers that we're handling errors */
-                goto out;
-            }
-            if (type != property->type) {
-                ret = tsk_trace_error(TSK_ERR_BAD_COLUMN_TYPE);
+        if (width > 1) {
+            shuffled = tsk_malloc(size);
+            if (shuffled == NULL) {
+                ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
                 goto out;
             }
-            *property->len_dest = (tsk_size_t) len;
+            byte_shuffle(src, len, width, shuffled);
+            src = shuffled;
         }
-        assert(property->options & TSK_COL_OPTIONAL);
+        fits = lz_compress(src, size, dest + TSK_COMPRESSED_HEADER_SIZE, capacity,
+            hash_table, &payload_size);
+    }
+    if (fits) {
+        tsk_memset(dest, 0, TSK_COMPRESSED_HEADER_SIZE);
+        dest[0] = codec;
+        dest[1] = (uint8_t) type;
+        tsk_memcpy(dest + 8, &num_elements, sizeof(num_elements));
+        *encoded = dest;
+        *encoded_len = TSK_COMPRESSED_HEADER_SIZE + payload_size;
+        dest = NULL;
     }
 out:
+    tsk_safe_free(dest);
+    tsk_safe_free(shuffled);
+    tsk_safe_free(hash_table);
     return ret;
 }
 
+/* Decode the specified compressed column into a newly allocated array. */
 static int
-read_table(kastore_t *store, tsk_size_t *num_rows, read_table_col_t *cols,
-    read_table_ragged_col_t *ragged_cols, read_table_property_t *properties,
-    tsk_flags_t options)
+decompress_column(const uint8_t *encoded, size_t encoded_len, void **array,
+    size_t *len, int *type)
 {
     int ret = 0;
-
-    *num_rows = TSK_NUM_ROWS_UNSET;
-    if (cols != NULL) {
-        ret = read_table_cols(store, num_rows, cols, options);
-        if (ret != 0) {
-            goto out;
-        }
+    const uint8_t *src = encoded + TSK_COMPRESSED_HEADER_SIZE;
+    uint8_t *dest = NULL;
+    uint8_t *shuffled = NULL;
+    uint8_t codec, stored_type;
+    uint64_t num_elements;
+    size_t width, size, payload_size;
+    bool valid;
+
+    if (encoded_len < TSK_COMPRESSED_HEADER_SIZE) {
+        ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+        goto out;
     }
-    if (ragged_cols != NULL) {
-        ret = read_table_ragged_cols(store, num_rows, ragged_cols, options);
-        if (ret != 0) {
-            goto out;
-        }
+    codec = encoded[0];
+    stored_type = encoded[1];
+    tsk_memcpy(&num_elements, encoded + 8, sizeof(num_elements));
+    payload_size = encoded_len - TSK_COMPRESSED_HEADER_SIZE;
+    if ((codec != TSK_CODEC_DELTA_VARINT && codec != TSK_CODEC_SHUFFLE_LZ)
+        || stored_type >= KAS_NUM_TYPES) {
+        ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+        goto out;
     }
-    if (*num_rows == TSK_NUM_ROWS_UNSET) {
+    width = column_type_size(stored_type);
+    /* Every delta encoded element takes at least one byte */
+    if (num_elements > SIZE_MAX / width
+        || (codec == TSK_CODEC_DELTA_VARINT && num_elements > payload_size)) {
         ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
         goto out;
     }
-    if (properties != NULL) {
-        ret = read_table_properties(store, properties, options);
-        if (ret != 0) {
+    size = (size_t) num_elements * width;
+    dest = tsk_malloc(size);
+    if (dest == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    if (codec == TSK_CODEC_DELTA_VARINT) {
+        valid = delta_varint_decode(
+            src, payload_size, (size_t) num_elements, width, dest);
+    } else if (width == 1) {
+        valid = lz_decompress(src, payload_size, dest, size);
+    } else {
+        shuffled = tsk_malloc(size);
+        if (shuffled == NULL) {
+            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
             goto out;
         }
+        valid = lz_decompress(src, payload_size, shuffled, size);
+        if (valid) {
+            byte_unshuffle(shuffled, (size_t) num_elements, width, dest);
+        }
+    }
+    if (!valid) {
+        ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+        goto out;
     }
+    *array = dest;
+    *len = (size_t) num_elements;
+    *type = (int) stored_type;
+    dest = NULL;
 out:
+    tsk_safe_free(dest);
+    tsk_safe_free(shuffled);
     return ret;
 }
 
 static void
-free_read_table_mem(read_table_col_t *cols, read_table_ragged_col_t *ragged_cols,
-    read_table_property_t *properties)
+compressed_column_name(const char *name, char *compressed_name)
 {
-    read_table_col_t *col;
-    read_table_ragged_col_t *ragged_col;
-    read_table_property_t *property;
-
-    if (cols != NULL) {
-        for (col = cols; col->name != NULL; col++) {
-            tsk_safe_free(*(col->array_dest));
-        }
-    }
-    if (ragged_cols != NULL) {
-        for (ragged_col = ragged_cols; ragged_col->name != NULL; ragged_col++) {
-            tsk_safe_free(*(ragged_col->data_array_dest));
-            tsk_safe_free(*(ragged_col->offset_array_dest));
-        }
-    }
-    if (properties != NULL) {
-        for (property = properties; property->name != NULL; property++) {
-            tsk_safe_free(*(property->array_dest));
-        }
-    }
+    assert(strlen(name) + strlen(TSK_COMPRESSED_COL_SUFFIX) < TSK_MAX_COL_NAME_LEN);
+    strcpy(compressed_name, name);
+    strcat(compressed_name, TSK_COMPRESSED_COL_SUFFIX);
 }
 
+/* Returns 1 if the store contains the specified column, either verbatim or
+ * compressed, 0 if it doesn't, and a negative value on error. */
 static int
-write_offset_col(
-    kastore_t *store, const write_table_ragged_col_t *col, tsk_flags_t options)
+store_contains_column(kastore_t *store, const char *name)
 {
-    int ret = 0;
-    char offset_col_name[TSK_MAX_COL_NAME_LEN];
-    uint32_t *offset32 = NULL;
-    tsk_size_t len = col->num_rows + 1;
-    tsk_size_t j;
-    int32_t put_flags = 0;
-    int type;
-    const void *data;
-    bool needs_64 = col->offset_array[col->num_rows] > UINT32_MAX;
-
-    assert(strlen(col->name) + strlen("_offset") + 2 < sizeof(offset_col_name));
-    strcpy(offset_col_name, col->name);
-    strcat(offset_col_name, "_offset");
+    int ret;
+    char compressed_name[TSK_MAX_COL_NAME_LEN];
 
-    if (options & TSK_DUMP_FORCE_OFFSET_64 || needs_64) {
-        type = KAS_UINT64;
-        data = col->offset_array;
-        put_flags = KAS_BORROWS_ARRAY;
-    } else {
-        offset32 = tsk_malloc(len * sizeof(*offset32));
-        if (offset32 == NULL) {
-            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
-            goto out;
-        }
-        for (j = 0; j < len; j++) {
-            offset32[j] = (uint32_t) col->offset_array[j];
-        }
-        type = KAS_UINT32;
-        data = offset32;
-        /* We've just allocated a temp buffer, so kas can't borrow so leave put_flags=0*/
+    ret = kastore_containss(store, name);
+    if (ret == 0) {
+        compressed_column_name(name, compressed_name);
+        ret = kastore_containss(store, compressed_name);
     }
-    ret = kastore_puts(store, offset_col_name, data, (size_t) len, type, put_flags);
-    if (ret != 0) {
+    if (ret < 0) {
         ret = tsk_set_kas_error(ret);
-        goto out;
     }
-out:
-    tsk_safe_free(offset32);
     return ret;
 }
 
+/* Read the specified column, which must be in the store. Compressed columns
+ * are decoded into a newly allocated array that belongs to the caller, even
+ * if the store is memory mapped. */
 static int
-write_table_ragged_cols(
-    kastore_t *store, const write_table_ragged_col_t *write_cols, tsk_flags_t options)
+store_get_column(
+    kastore_t *store, const char *name, void **array, size_t *len, int *type)
 {
-    int ret = 0;
-    const write_table_ragged_col_t *col;
+    int ret;
+    char compressed_name[TSK_MAX_COL_NAME_LEN];
+    void *encoded = NULL;
+    size_t encoded_len;
+    int encoded_type;
 
-    for (col = write_cols; col->name != NULL; col++) {
-        ret = kastore_puts(store, col->name, col->data_array, (size_t) col->data_len,
-            col->data_type, KAS_BORROWS_ARRAY);
+    ret = kastore_containss(store, name);
+    if (ret < 0) {
+        ret = tsk_set_kas_error(ret);
+        goto out;
+    }
+    if (ret == 1) {
+        ret = kastore_gets(store, name, array, len, type);
         if (ret != 0) {
             ret = tsk_set_kas_error(ret);
-            goto out;
-        }
-        ret = write_offset_col(store, col, options);
-        if (ret != 0) {
-            goto out;
         }
+        goto out;
+    }
+    compressed_column_name(name, compressed_name);
+    ret = kastore_gets(store, compressed_name, &encoded, &encoded_len, &encoded_type);
+    if (ret != 0) {
+        ret = tsk_set_kas_error(ret);
+        goto out;
+    }
+    if (encoded_type != KAS_UINT8) {
+        ret = tsk_trace_error(TSK_ERR_BAD_COLUMN_TYPE);
+        goto out;
     }
+    ret = decompress_column(encoded, encoded_len, array, len, type);
 out:
+    free_store_array(store, &encoded);
     return ret;
 }
 
+/* Write the specified column to the store. If TSK_DUMP_COMPRESS is set and
+ * compression reduces the size of the column, it is stored compressed. */
 static int
-write_table_cols(kastore_t *store, const write_table_col_t *write_cols,
-    tsk_flags_t TSK_UNUSED(options))
+store_put_column(kastore_t *store, const char *name, const void *array, size_t len,
+    int type, int put_flags, tsk_flags_t options)
 {
     int ret = 0;
-    const write_table_col_t *col;
+    char compressed_name[TSK_MAX_COL_NAME_LEN];
+    uint8_t *encoded = NULL;
+    size_t encoded_len = 0;
 
-    for (col = write_cols; col->name != NULL; col++) {
-        ret = kastore_puts(store, col->name, col->array, (size_t) col->len, col->type,
-            KAS_BORROWS_ARRAY);
+    if (options & TSK_DUMP_COMPRESS) {
+        ret = compress_column(array, len, type, &encoded, &encoded_len);
         if (ret != 0) {
-            ret = tsk_set_kas_error(ret);
             goto out;
         }
     }
+    if (encoded != NULL) {
+        compressed_column_name(name, compressed_name);
+        ret = kastore_oputs(store, compressed_name, encoded, encoded_len, KAS_UINT8, 0);
+        if (ret == 0) {
+            /* The store has taken ownership of the buffer */
+            encoded = NULL;
+        }
+    } else {
+        ret = kastore_puts(store, name, array, len, type, put_flags);
+    }
+    if (ret != 0) {
+        ret = tsk_set_kas_error(ret);
+        goto out;
+    }
 out:
+    tsk_safe_free(encoded);
     return ret;
 }
 
-static int
-write_table(kastore_t *store, const write_table_col_t *cols,
-    const write_table_ragged_col_t *ragged_cols, tsk_flags_t options)
+/* Table columns are allocated through the table's allocator, which may be
+ * NULL for the default allocation functions and growth policy. */
+static bool
+has_custom_allocator(const tsk_table_allocator_t *allocator)
 {
-    int ret = write_table_cols(store, cols, options);
+    return allocator != NULL && allocator->malloc != NULL;
+}
 
-    if (ret != 0) {
-        goto out;
+static void *
+column_malloc(const tsk_table_allocator_t *allocator, tsk_size_t size)
+{
+    /* Avoid malloc(0) as it's not portable */
+    if (size == 0) {
+        size = 1;
     }
-    ret = write_table_ragged_cols(store, ragged_cols, options);
-    if (ret != 0) {
-        goto out;
+#if TSK_MAX_SIZE > SIZE_MAX
+    if (size > SIZE_MAX) {
+        return NULL;
     }
-out:
-    return ret;
+#endif
+    if (has_custom_allocator(allocator)) {
+        return allocator->malloc((size_t) size, allocator->user_data);
+    }
+    return tsk_malloc(size);
 }
 
-/* Checks that the specified list of offsets is well-formed. */
-static int
-check_offsets(
-    tsk_size_t num_rows, const tsk_size_t *offsets, tsk_size_t length, bool check_length)
+static void *
+column_realloc(const tsk_table_allocator_t *allocator, void *ptr, tsk_size_t size)
 {
-    int ret = 0;
-    tsk_size_t j;
-
-    if (offsets[0] != 0) {
-        ret = tsk_trace_error(TSK_ERR_BAD_OFFSET);
-        goto out;
+    tsk_bug_assert(size > 0);
+#if TSK_MAX_SIZE > SIZE_MAX
+    if (size > SIZE_MAX) {
+        return NULL;
     }
-    if (check_length && offsets[num_rows] != length) {
-        ret = tsk_trace_error(TSK_ERR_BAD_OFFSET);
-        goto out;
+#endif
+    if (has_custom_allocator(allocator)) {
+        return allocator->realloc(ptr, (size_t) size, allocator->user_data);
     }
-    for (j = 0; j < num_rows; j++) {
-        if (offsets[j] > offsets[j + 1]) {
-            ret = tsk_trace_error(TSK_ERR_BAD_OFFSET);
-            goto out;
+    return tsk_realloc(ptr, size);
+}
+
+/* Columns that point into the memory mapped store of a table loaded with
+ * TSK_LOAD_MMAP are owned by the store, and are not freed. */
+static void
+free_column(
+    const tsk_table_allocator_t *allocator, const kastore_t *mapped_store, void **column)
+{
+    if (*column != NULL && !store_is_mapped_array(mapped_store, *column)) {
+        if (has_custom_allocator(allocator)) {
+            allocator->free(*column, allocator->user_data);
+        } else {
+            free(*column);
         }
     }
-    ret = 0;
-out:
-    return ret;
+    *column = NULL;
 }
 
 static int
-calculate_max_rows(tsk_size_t num_rows, tsk_size_t max_rows,
-    tsk_size_t max_rows_increment, tsk_size_t additional_rows,
-    tsk_size_t *ret_new_max_rows)
+alloc_empty_ragged_column(const tsk_table_allocator_t *allocator, tsk_size_t num_rows,
+    void **data_col, tsk_size_t **offset_col)
 {
-    tsk_size_t new_max_rows;
     int ret = 0;
 
-    if (check_table_overflow(num_rows, additional_rows)) {
-        ret = tsk_trace_error(TSK_ERR_TABLE_OVERFLOW);
+    *data_col = column_malloc(allocator, 1);
+    *offset_col = column_malloc(allocator, (num_rows + 1) * sizeof(tsk_size_t));
+    if (*data_col == NULL || *offset_col == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
-
-    if (num_rows + additional_rows <= max_rows) {
-        new_max_rows = max_rows;
-    } else {
-        if (max_rows_increment == 0) {
-            /* Doubling by default */
-            new_max_rows = TSK_MIN(max_rows * 2, TSK_MAX_ID + (tsk_size_t) 1);
-            /* Add some constraints to prevent very small allocations */
-            if (new_max_rows < 1024) {
-                new_max_rows = 1024;
-            }
-            /* Prevent allocating more than ~2 million additional rows unless needed*/
-            if (new_max_rows - max_rows > 2097152) {
-                new_max_rows = max_rows + 2097152;
-            }
-        } else {
-            /* Use user increment value */
-            if (check_table_overflow(max_rows, max_rows_increment)) {
-                ret = tsk_trace_error(TSK_ERR_TABLE_OVERFLOW);
-                goto out;
-            }
-            new_max_rows = max_rows + max_rows_increment;
-        }
-        new_max_rows = TSK_MAX(new_max_rows, num_rows + additional_rows);
-    }
-    *ret_new_max_rows = new_max_rows;
+    tsk_memset(*offset_col, 0, (num_rows + 1) * sizeof(tsk_size_t));
 out:
     return ret;
 }
 
 static int
-calculate_max_length(tsk_size_t current_length, tsk_size_t max_length,
-    tsk_size_t max_length_increment, tsk_size_t additional_length,
-    tsk_size_t *ret_new_max_length)
+read_table_cols(kastore_t *store, tsk_size_t *num_rows, read_table_col_t *cols,
+    tsk_flags_t TSK_UNUSED(flags))
 {
-    tsk_size_t new_max_length;
     int ret = 0;
+    size_t len;
+    int type;
+    read_table_col_t *col;
 
-    if (check_offset_overflow(current_length, additional_length)) {
-        ret = tsk_trace_error(TSK_ERR_COLUMN_OVERFLOW);
-        goto out;
-    }
-
-    if (current_length + additional_length <= max_length) {
-        new_max_length = max_length;
-    } else {
-        if (max_length_increment == 0) {
-            /* Doubling by default */
-            new_max_length = TSK_MIN(max_length * 2, TSK_MAX_SIZE);
-            /* Add some constraints to prevent very small allocations */
-            if (new_max_length < 65536) {
-                new_max_length = 65536;
+    for (col = cols; col->name != NULL; col++) {
+        ret = store_contains_column(store, col->name);
+        if (ret < 0) {
+            goto out;
+        }
+        if (ret == 1) {
+            ret = store_get_column(store, col->name, col->array_dest, &len, &type);
+            if (ret != 0) {
+                goto out;
             }
-            /* Prevent allocating more than 100MB additional unless needed*/
-            if (new_max_length - max_length > 104857600) {
-                new_max_length = max_length + 104857600;
+            if (*num_rows == TSK_NUM_ROWS_UNSET) {
+                *num_rows = (tsk_size_t) len;
+            } else {
+                if (*num_rows != (tsk_size_t) len) {
+                    ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+                    goto out;
+                }
             }
-            new_max_length = TSK_MAX(new_max_length, current_length + additional_length);
-        } else {
-            /* Use user increment value */
-            if (check_offset_overflow(max_length, max_length_increment)) {
-                /* Here we could allocate to the maximum size.
-                 * Instead we are erroring out as this is much easier to test.
-                 * The cost is that (at most) the last "max_length_increment"-1
-                 * bytes of the possible array space can't be used. */
-                ret = tsk_trace_error(TSK_ERR_COLUMN_OVERFLOW);
+            if (type != col->type) {
+                ret = tsk_trace_error(TSK_ERR_BAD_COLUMN_TYPE);
                 goto out;
             }
-            new_max_length = max_length + max_length_increment;
+        } else if (!(col->options & TSK_COL_OPTIONAL)) {
+            ret = tsk_trace_error(TSK_ERR_REQUIRED_COL_NOT_FOUND);
+            goto out;
         }
-        new_max_length = TSK_MAX(new_max_length, current_length + additional_length);
     }
-    *ret_new_max_length = new_max_length;
 out:
     return ret;
 }
 
 static int
-expand_column(void **column, tsk_size_t new_max_rows, size_t element_size)
+cast_offset_array(read_table_ragged_col_t *col, uint32_t *source, tsk_size_t num_rows)
 {
     int ret = 0;
-    void *tmp;
+    tsk_size_t len = num_rows + 1;
+    tsk_size_t j;
+    uint64_t *dest = tsk_malloc(len * sizeof(*dest));
 
-    tmp = tsk_realloc((void **) *column, new_max_rows * element_size);
-    if (tmp == NULL) {
+    if (dest == NULL) {
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
-    *column = tmp;
+    *col->offset_array_dest = dest;
+    for (j = 0; j < len; j++) {
+        dest[j] = source[j];
+    }
 out:
     return ret;
 }
 
 static int
-expand_ragged_column(tsk_size_t current_length, tsk_size_t additional_length,
-    tsk_size_t max_length_increment, tsk_size_t *max_length, void **column,
-    size_t element_size)
+read_table_ragged_cols(kastore_t *store, tsk_size_t *num_rows,
+    read_table_ragged_col_t *cols, tsk_flags_t flags)
 {
     int ret = 0;
-    tsk_size_t new_max_length;
-
-    ret = calculate_max_length(current_length, *max_length, max_length_increment,
-        additional_length, &new_max_length);
-    if (ret != 0) {
-        goto out;
-    }
+    size_t data_len = 0; // initial value unused, just to keep the compiler happy.
+    size_t offset_len;
+    int type;
+    read_table_ragged_col_t *col;
+    char offset_col_name[TSK_MAX_COL_NAME_LEN];
+    bool data_col_present, offset_col_present, skip;
+    void *store_offset_array = NULL;
+    tsk_size_t *offset_array;
 
-    if (new_max_length > *max_length) {
-        ret = expand_column(column, new_max_length, element_size);
-        if (ret != 0) {
+    for (col = cols; col->name != NULL; col++) {
+        /* Skipped columns are never read, but we still need their offsets
+         * to find the number of rows in tables with only ragged columns. */
+        skip = (flags & TSK_LOAD_SKIP_METADATA) && (col->options & TSK_COL_METADATA);
+        ret = store_contains_column(store, col->name);
+        if (ret < 0) {
+            goto out;
+        }
+        data_col_present = false;
+        if (ret == 1 && skip) {
+            data_col_present = true;
+        } else if (ret == 1) {
+            ret = store_get_column(
+                store, col->name, col->data_array_dest, &data_len, &type);
+            if (ret != 0) {
+                goto out;
+            }
+            if (type != col->data_type) {
+                ret = tsk_trace_error(TSK_ERR_BAD_COLUMN_TYPE);
+                goto out;
+            }
+            *col->data_len_dest = (tsk_size_t) data_len;
+            data_col_present = true;
+        } else if (!(col->options & TSK_COL_OPTIONAL)) {
+            ret = tsk_trace_error(TSK_ERR_REQUIRED_COL_NOT_FOUND);
             goto out;
         }
-        *max_length = new_max_length;
-    }
-out:
-    return ret;
-}
 
-/* TODO rename to copy_string or replace_and_copy_string */
-static int
-replace_string(
-    char **str, tsk_size_t *len, const char *new_str, const tsk_size_t new_len)
-{
-    int ret = 0;
-    tsk_safe_free(*str);
-    *str = NULL;
-    *len = new_len;
-    if (new_len > 0) {
-        *str = tsk_malloc(new_len * sizeof(char));
-        if (*str == NULL) {
-            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        assert(strlen(col->name) + strlen("_offset") + 2 < sizeof(offset_col_name));
+        strcpy(offset_col_name, col->name);
+        strcat(offset_col_name, "_offset");
+
+        ret = store_contains_column(store, offset_col_name);
+        if (ret < 0) {
             goto out;
         }
-        tsk_memcpy(*str, new_str, new_len * sizeof(char));
+        offset_col_present = ret == 1;
+        if (offset_col_present != data_col_present) {
+            ret = tsk_trace_error(TSK_ERR_BOTH_COLUMNS_REQUIRED);
+            goto out;
+        }
+        if (offset_col_present) {
+            ret = store_get_column(
+                store, offset_col_name, &store_offset_array, &offset_len, &type);
+            if (ret != 0) {
+                goto out;
+            }
+            /* A table with zero rows will still have an offset length of 1;
+             * catching this here prevents underflows in the logic below */
+            if (offset_len == 0) {
+                ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+                goto out;
+            }
+            /* Some tables have only ragged columns */
+            if (*num_rows == TSK_NUM_ROWS_UNSET) {
+                *num_rows = (tsk_size_t) offset_len - 1;
+            } else {
+                if (*num_rows != (tsk_size_t) offset_len - 1) {
+                    ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+                    goto out;
+                }
+            }
+            if (skip) {
+                free_store_array(store, &store_offset_array);
+                if (!(col->options & TSK_COL_OPTIONAL)) {
+                    ret = alloc_empty_ragged_column(
+                        NULL, *num_rows, col->data_array_dest, col->offset_array_dest);
+                    if (ret != 0) {
+                        goto out;
+                    }
+                    *col->data_len_dest = 0;
+                }
+            } else if (type == KAS_UINT64) {
+                *col->offset_array_dest = (uint64_t *) store_offset_array;
+                store_offset_array = NULL;
+            } else if (type == KAS_UINT32) {
+                ret = cast_offset_array(col, (uint32_t *) store_offset_array, *num_rows);
+                if (ret != 0) {
+                    goto out;
+                }
+                free_store_array(store, &store_offset_array);
+            } else {
+                ret = tsk_trace_error(TSK_ERR_BAD_COLUMN_TYPE);
+                goto out;
+            }
+            offset_array = *col->offset_array_dest;
+            if (!skip && offset_array[*num_rows] != (tsk_size_t) data_len) {
+                ret = tsk_trace_error(TSK_ERR_BAD_OFFSET);
+                goto out;
+            }
+        }
     }
 out:
+    free_store_array(store, &store_offset_array);
     return ret;
 }
 
 static int
-takeset_string(char **str, tsk_size_t *len, char *new_str, const tsk_size_t new_len)
-{
-    tsk_safe_free(*str);
-    *str = new_str;
-    *len = new_len;
-    return 0;
-}
-
-static int
-alloc_empty_ragged_column(tsk_size_t num_rows, void **data_col, tsk_size_t **offset_col)
+read_table_properties(
+    kastore_t *store, read_table_property_t *properties, tsk_flags_t flags)
 {
     int ret = 0;
+    size_t len;
+    int type;
+    read_table_property_t *property;
 
-    *data_col = tsk_malloc(1);
-    *offset_col = tsk_calloc(num_rows + 1, sizeof(tsk_size_t));
-    if (*data_col == NULL || *offset_col == NULL) {
-        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
-        goto out;
+    for (property = properties; property->name != NULL; property++) {
+        if ((flags & TSK_LOAD_SKIP_METADATA) && (property->options & TSK_COL_METADATA)) {
+            continue;
+        }
+        ret = store_contains_column(store, property->name);
+        if (ret < 0) {
+            goto out;
+        }
+        if (ret == 1) {
+            ret = store_get_column(
+                store, property->name, property->array_dest, &len, &type);
+            if (ret != 0) {
+                goto out;
+            }
+            if (type != property->type) {
+                ret = tsk_trace_error(TSK_ERR_BAD_COLUMN_TYPE);
+                goto out;
+            }
+            *property->len_dest = (tsk_size_t) len;
+        }
+        assert(property->options & TSK_COL_OPTIONAL);
     }
 out:
     return ret;
 }
 
 static int
-check_ragged_column(tsk_size_t num_rows, void *data, tsk_size_t *offset)
+read_table(kastore_t *store, tsk_size_t *num_rows, read_table_col_t *cols,
+    read_table_ragged_col_t *ragged_cols, read_table_property_t *properties,
+    tsk_flags_t options)
 {
     int ret = 0;
-    if ((data == NULL) != (offset == NULL)) {
-        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+
+    *num_rows = TSK_NUM_ROWS_UNSET;
+    if (cols != NULL) {
+        ret = read_table_cols(store, num_rows, cols, options);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    if (ragged_cols != NULL) {
+        ret = read_table_ragged_cols(store, num_rows, ragged_cols, options);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    if (*num_rows == TSK_NUM_ROWS_UNSET) {
+        ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
         goto out;
     }
-    if (data != NULL) {
-        ret = check_offsets(num_rows, offset, 0, false);
+    if (properties != NULL) {
+        ret = read_table_properties(store, properties, options);
         if (ret != 0) {
             goto out;
         }
@@ -683,938 +1076,1399 @@ out:
     return ret;
 }
 
-static int
-takeset_ragged_column(tsk_size_t num_rows, void *data, tsk_size_t *offset,
-    void **data_dest, tsk_size_t **offset_dest, tsk_size_t *length_dest)
+static void
+free_read_table_mem(const kastore_t *store, read_table_col_t *cols,
+    read_table_ragged_col_t *ragged_cols, read_table_property_t *properties)
 {
-    int ret = 0;
-    if (data == NULL) {
-        ret = alloc_empty_ragged_column(num_rows, (void *) data_dest, offset_dest);
-        if (ret != 0) {
-            goto out;
+    read_table_col_t *col;
+    read_table_ragged_col_t *ragged_col;
+    read_table_property_t *property;
+
+    if (cols != NULL) {
+        for (col = cols; col->name != NULL; col++) {
+            free_store_array(store, col->array_dest);
+        }
+    }
+    if (ragged_cols != NULL) {
+        for (ragged_col = ragged_cols; ragged_col->name != NULL; ragged_col++) {
+            free_store_array(store, ragged_col->data_array_dest);
+            free_store_array(store, (void **) ragged_col->offset_array_dest);
+        }
+    }
+    if (properties != NULL) {
+        for (property = properties; property->name != NULL; property++) {
+            free_store_array(store, property->array_dest);
         }
-    } else {
-        *data_dest = data;
-        *offset_dest = offset;
     }
-    *length_dest = (*offset_dest)[num_rows];
-out:
-    return ret;
 }
 
 static int
-takeset_optional_id_column(tsk_size_t num_rows, tsk_id_t *input, tsk_id_t **dest)
+write_offset_col(
+    kastore_t *store, const write_table_ragged_col_t *col, tsk_flags_t options)
 {
     int ret = 0;
-    tsk_size_t buffsize;
-    tsk_id_t *buff;
+    char offset_col_name[TSK_MAX_COL_NAME_LEN];
+    uint32_t *offset32 = NULL;
+    uint64_t *offset64 = NULL;
+    tsk_size_t len = col->num_rows + 1;
+    tsk_size_t j;
+    int32_t put_flags = 0;
+    int type;
+    const void *data;
+    /* When writing a range of rows the offsets don't start at zero */
+    tsk_size_t base = col->offset_array[0];
+    bool needs_64 = col->offset_array[col->num_rows] - base > UINT32_MAX;
 
-    if (input == NULL) {
-        buffsize = num_rows * sizeof(*buff);
-        buff = tsk_malloc(buffsize);
-        if (buff == NULL) {
+    assert(strlen(col->name) + strlen("_offset") + 2 < sizeof(offset_col_name));
+    strcpy(offset_col_name, col->name);
+    strcat(offset_col_name, "_offset");
+
+    if ((options & TSK_DUMP_FORCE_OFFSET_64 || needs_64) && base == 0) {
+        type = KAS_UINT64;
+        data = col->offset_array;
+        put_flags = KAS_BORROWS_ARRAY;
+    } else if (options & TSK_DUMP_FORCE_OFFSET_64 || needs_64) {
+        offset64 = tsk_malloc(len * sizeof(*offset64));
+        if (offset64 == NULL) {
             ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
             goto out;
         }
-        *dest = buff;
-        tsk_memset(buff, 0xff, buffsize);
+        for (j = 0; j < len; j++) {
+            offset64[j] = (uint64_t) (col->offset_array[j] - base);
+        }
+        type = KAS_UINT64;
+        data = offset64;
     } else {
-        *dest = input;
+        offset32 = tsk_malloc(len * sizeof(*offset32));
+        if (offset32 == NULL) {
+            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+            goto out;
+        }
+        for (j = 0; j < len; j++) {
+            offset32[j] = (uint32_t) (col->offset_array[j] - base);
+        }
+        type = KAS_UINT32;
+        data = offset32;
+        /* We've just allocated a temp buffer, so kas can't borrow so leave put_flags=0*/
+    }
+    ret = store_put_column(
+        store, offset_col_name, data, (size_t) len, type, put_flags, options);
+    if (ret != 0) {
+        goto out;
     }
 out:
+    tsk_safe_free(offset32);
+    tsk_safe_free(offset64);
     return ret;
 }
 
 static int
-write_metadata_schema_header(
-    FILE *out, const char *metadata_schema, tsk_size_t metadata_schema_length)
-{
-    const char *fmt = "#metadata_schema#\n"
-                      "%.*s\n"
-                      "#end#metadata_schema\n" TABLE_SEP;
-    return fprintf(out, fmt, (int) metadata_schema_length, metadata_schema);
-}
-
-/* Utilities for in-place subsetting columns */
-
-static tsk_size_t
-count_true(tsk_size_t num_rows, const tsk_bool_t *restrict keep)
+write_table_ragged_cols(
+    kastore_t *store, const write_table_ragged_col_t *write_cols, tsk_flags_t options)
 {
-    tsk_size_t j;
-    tsk_size_t count = 0;
+    int ret = 0;
+    const write_table_ragged_col_t *col;
 
-    for (j = 0; j < num_rows; j++) {
-        if (keep[j]) {
-            count++;
+    for (col = write_cols; col->name != NULL; col++) {
+        ret = store_put_column(store, col->name, col->data_array,
+            (size_t) col->data_len, col->data_type, KAS_BORROWS_ARRAY, options);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = write_offset_col(store, col, options);
+        if (ret != 0) {
+            goto out;
         }
     }
-    return count;
+out:
+    return ret;
 }
 
-static void
-keep_mask_to_id_map(
-    tsk_size_t num_rows, const tsk_bool_t *restrict keep, tsk_id_t *restrict id_map)
+static int
+write_table_cols(
+    kastore_t *store, const write_table_col_t *write_cols, tsk_flags_t options)
 {
-    tsk_size_t j;
-    tsk_id_t next_id = 0;
+    int ret = 0;
+    const write_table_col_t *col;
 
-    for (j = 0; j < num_rows; j++) {
-        id_map[j] = TSK_NULL;
-        if (keep[j]) {
-            id_map[j] = next_id;
-            next_id++;
+    for (col = write_cols; col->name != NULL; col++) {
+        ret = store_put_column(store, col->name, col->array, (size_t) col->len,
+            col->type, KAS_BORROWS_ARRAY, options);
+        if (ret != 0) {
+            goto out;
         }
     }
+out:
+    return ret;
 }
 
-static tsk_size_t
-subset_remap_id_column(tsk_id_t *restrict column, tsk_size_t num_rows,
-    const tsk_bool_t *restrict keep, const tsk_id_t *restrict id_map)
+static int
+write_table(kastore_t *store, const write_table_col_t *cols,
+    const write_table_ragged_col_t *ragged_cols, tsk_flags_t options)
 {
-    tsk_size_t j, k;
-    tsk_id_t value;
+    int ret = write_table_cols(store, cols, options);
 
-    k = 0;
-    for (j = 0; j < num_rows; j++) {
-        if (keep[j]) {
-            value = column[j];
-            if (value != TSK_NULL) {
-                value = id_map[value];
-            }
-            column[k] = value;
-            k++;
-        }
+    if (ret != 0) {
+        goto out;
     }
-    return k;
+    ret = write_table_ragged_cols(store, ragged_cols, options);
+    if (ret != 0) {
+        goto out;
+    }
+out:
+    return ret;
 }
 
-/* Trigger warning: C++ programmers should look away... This may be one of the
- * few cases where some macro funkiness is warranted, as these are exact
- * duplicates of the same function with just the type of the column
- * parameter changed. */
-
-static tsk_size_t
-subset_id_column(
-    tsk_id_t *restrict column, tsk_size_t num_rows, const tsk_bool_t *restrict keep)
+/* Checks that the specified list of offsets is well-formed. */
+static int
+check_offsets(
+    tsk_size_t num_rows, const tsk_size_t *offsets, tsk_size_t length, bool check_length)
 {
-    tsk_size_t j, k;
+    int ret = 0;
+    tsk_size_t j;
 
-    k = 0;
+    if (offsets[0] != 0) {
+        ret = tsk_trace_error(TSK_ERR_BAD_OFFSET);
+        goto out;
+    }
+    if (check_length && offsets[num_rows] != length) {
+        ret = tsk_trace_error(TSK_ERR_BAD_OFFSET);
+        goto out;
+    }
     for (j = 0; j < num_rows; j++) {
-        if (keep[j]) {
-            column[k] = column[j];
-            k++;
+        if (offsets[j] > offsets[j + 1]) {
+            ret = tsk_trace_error(TSK_ERR_BAD_OFFSET);
+            goto out;
         }
     }
-    return k;
+    ret = 0;
+out:
+    return ret;
 }
 
-static tsk_size_t
-subset_flags_column(
-    tsk_flags_t *restrict column, tsk_size_t num_rows, const tsk_bool_t *restrict keep)
+/* Checks the offsets of rows written into the space reserved at the end of a
+ * ragged column, which follow on from the current length of the column. */
+static int
+check_reserved_offsets(tsk_size_t num_rows, const tsk_size_t *offsets,
+    tsk_size_t length, tsk_size_t reserved_length)
 {
-    tsk_size_t j, k;
+    int ret = 0;
+    tsk_size_t j;
 
-    k = 0;
+    if (offsets[0] != length || offsets[num_rows] - length > reserved_length) {
+        ret = tsk_trace_error(TSK_ERR_BAD_OFFSET);
+        goto out;
+    }
     for (j = 0; j < num_rows; j++) {
-        if (keep[j]) {
-            column[k] = column[j];
-            k++;
+        if (offsets[j] > offsets[j + 1]) {
+            ret = tsk_trace_error(TSK_ERR_BAD_OFFSET);
+            goto out;
         }
     }
-    return k;
+out:
+    return ret;
 }
 
+/* Returns the specified size multiplied by the allocator's growth factor,
+ * or 0 if the allocator doesn't set one. */
 static tsk_size_t
-subset_double_column(
-    double *restrict column, tsk_size_t num_rows, const tsk_bool_t *restrict keep)
+grow_column_size(
+    const tsk_table_allocator_t *allocator, tsk_size_t size, tsk_size_t max_size)
 {
-    tsk_size_t j, k;
+    double new_size;
 
-    k = 0;
-    for (j = 0; j < num_rows; j++) {
-        if (keep[j]) {
-            column[k] = column[j];
-            k++;
-        }
+    if (allocator == NULL || allocator->growth_factor == 0) {
+        return 0;
     }
-    return k;
+    new_size = (double) size * allocator->growth_factor;
+    return new_size >= (double) max_size ? max_size : (tsk_size_t) new_size;
 }
 
-static tsk_size_t
-subset_ragged_char_column(char *restrict data, tsk_size_t *restrict offset_col,
-    tsk_size_t num_rows, const tsk_bool_t *restrict keep)
+static int
+calculate_max_rows(const tsk_table_allocator_t *allocator, tsk_size_t num_rows,
+    tsk_size_t max_rows, tsk_size_t max_rows_increment, tsk_size_t additional_rows,
+    tsk_size_t *ret_new_max_rows)
 {
-    tsk_size_t j, k, i, offset;
+    tsk_size_t new_max_rows;
+    int ret = 0;
 
-    k = 0;
-    offset = 0;
-    for (j = 0; j < num_rows; j++) {
-        if (keep[j]) {
-            offset_col[k] = offset;
-            /* Note: Unclear whether it's worth calling memcpy instead here?
-             * Need to be careful since the regions are overlapping */
-            for (i = offset_col[j]; i < offset_col[j + 1]; i++) {
-                data[offset] = data[i];
-                offset++;
-            }
-            k++;
-        }
+    if (check_table_overflow(num_rows, additional_rows)) {
+        ret = tsk_trace_error(TSK_ERR_TABLE_OVERFLOW);
+        goto out;
     }
-    offset_col[k] = offset;
-    return offset;
-}
-
-static tsk_size_t
-subset_ragged_double_column(double *restrict data, tsk_size_t *restrict offset_col,
-    tsk_size_t num_rows, const tsk_bool_t *restrict keep)
-{
-    tsk_size_t j, k, i, offset;
 
-    k = 0;
-    offset = 0;
-    for (j = 0; j < num_rows; j++) {
-        if (keep[j]) {
-            offset_col[k] = offset;
-            /* Note: Unclear whether it's worth calling memcpy instead here?
-             * Need to be careful since the regions are overlapping */
-            for (i = offset_col[j]; i < offset_col[j + 1]; i++) {
-                data[offset] = data[i];
-                offset++;
+    if (num_rows + additional_rows <= max_rows) {
+        new_max_rows = max_rows;
+    } else {
+        if (max_rows_increment == 0) {
+            new_max_rows
+                = grow_column_size(allocator, max_rows, TSK_MAX_ID + (tsk_size_t) 1);
+            if (new_max_rows == 0) {
+                /* Doubling by default */
+                new_max_rows = TSK_MIN(max_rows * 2, TSK_MAX_ID + (tsk_size_t) 1);
+                /* Prevent allocating more than ~2 million additional rows unless
+                 * needed*/
+                if (new_max_rows - max_rows > 2097152) {
+                    new_max_rows = max_rows + 2097152;
+                }
             }
-            k++;
+            /* Add some constraints to prevent very small allocations */
+            if (new_max_rows < 1024) {
+                new_max_rows = 1024;
+            }
+        } else {
+            /* Use user increment value */
+            if (check_table_overflow(max_rows, max_rows_increment)) {
+                ret = tsk_trace_error(TSK_ERR_TABLE_OVERFLOW);
+                goto out;
+            }
+            new_max_rows = max_rows + max_rows_increment;
         }
+        new_max_rows = TSK_MAX(new_max_rows, num_rows + additional_rows);
     }
-    offset_col[k] = offset;
-    return offset;
+    *ret_new_max_rows = new_max_rows;
+out:
+    return ret;
 }
 
-static tsk_size_t
-subset_remap_ragged_id_column(tsk_id_t *restrict data, tsk_size_t *restrict offset_col,
-    tsk_size_t num_rows, const tsk_bool_t *restrict keep,
-    const tsk_id_t *restrict id_map)
+static int
+calculate_max_length(const tsk_table_allocator_t *allocator,
+    tsk_size_t current_length, tsk_size_t max_length,
+    tsk_size_t max_length_increment, tsk_size_t additional_length,
+    tsk_size_t *ret_new_max_length)
 {
-    tsk_size_t j, k, i, offset;
-    tsk_id_t di;
+    tsk_size_t new_max_length;
+    int ret = 0;
 
-    k = 0;
-    offset = 0;
-    for (j = 0; j < num_rows; j++) {
-        if (keep[j]) {
-            offset_col[k] = offset;
-            for (i = offset_col[j]; i < offset_col[j + 1]; i++) {
-                di = data[i];
-                if (di != TSK_NULL) {
-                    di = id_map[di];
+    if (check_offset_overflow(current_length, additional_length)) {
+        ret = tsk_trace_error(TSK_ERR_COLUMN_OVERFLOW);
+        goto out;
+    }
+
+    if (current_length + additional_length <= max_length) {
+        new_max_length = max_length;
+    } else {
+        if (max_length_increment == 0) {
+            new_max_length = grow_column_size(allocator, max_length, TSK_MAX_SIZE);
+            if (new_max_length == 0) {
+                /* Doubling by default */
+                new_max_length = TSK_MIN(max_length * 2, TSK_MAX_SIZE);
+                /* Prevent allocating more than 100MB additional unless needed*/
+                if (new_max_length - max_length > 104857600) {
+                    new_max_length = max_length + 104857600;
                 }
-                data[offset] = di;
-                offset++;
             }
-            k++;
+            /* Add some constraints to prevent very small allocations */
+            if (new_max_length < 65536) {
+                new_max_length = 65536;
+            }
+            new_max_length = TSK_MAX(new_max_length, current_length + additional_length);
+        } else {
+            /* Use user increment value */
+            if (check_offset_overflow(max_length, max_length_increment)) {
+                /* Here we could allocate to the maximum size.
+                 * Instead we are erroring out as this is much easier to test.
+                 * The cost is that (at most) the last "max_length_increment"-1
+                 * bytes of the possible array space can't be used. */
+                ret = tsk_trace_error(TSK_ERR_COLUMN_OVERFLOW);
+                goto out;
+            }
+            new_max_length = max_length + max_length_increment;
         }
+        new_max_length = TSK_MAX(new_max_length, current_length + additional_length);
     }
-    offset_col[k] = offset;
-    return offset;
+    *ret_new_max_length = new_max_length;
+out:
+    return ret;
 }
 
-/*************************
- * reference sequence
- *************************/
-
-int
-tsk_reference_sequence_init(
-    tsk_reference_sequence_t *self, tsk_flags_t TSK_UNUSED(options))
+static int
+expand_column(void **column, tsk_size_t new_max_rows, size_t element_size)
 {
-    tsk_memset(self, 0, sizeof(*self));
-    return 0;
-}
+    int ret = 0;
+    void *tmp;
 
-int
-tsk_reference_sequence_free(tsk_reference_sequence_t *self)
-{
-    tsk_safe_free(self->data);
-    tsk_safe_free(self->url);
-    tsk_safe_free(self->metadata);
-    tsk_safe_free(self->metadata_schema);
-    return 0;
+    tmp = tsk_realloc((void **) *column, new_max_rows * element_size);
+    if (tmp == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    *column = tmp;
+out:
+    return ret;
 }
 
-bool
-tsk_reference_sequence_is_null(const tsk_reference_sequence_t *self)
+/* The columns of a table loaded with TSK_LOAD_MMAP point into a read-only
+ * mapping of the file, so any operation that writes to them fails. */
+static int
+check_table_writable(const kastore_t *mapped_store)
 {
-    return self->data_length == 0 && self->url_length == 0 && self->metadata_length == 0
-           && self->metadata_schema_length == 0;
+    int ret = 0;
+
+    if (mapped_store != NULL) {
+        ret = tsk_trace_error(TSK_ERR_CANT_MODIFY_MAPPED);
+    }
+    return ret;
 }
 
-bool
-tsk_reference_sequence_equals(const tsk_reference_sequence_t *self,
-    const tsk_reference_sequence_t *other, tsk_flags_t options)
+static int
+expand_table_column(const tsk_table_allocator_t *allocator,
+    const kastore_t *mapped_store, void **column, tsk_size_t new_max_rows,
+    size_t element_size)
 {
-    int ret
-        = self->data_length == other->data_length
-          && self->url_length == other->url_length
-          && tsk_memcmp(self->data, other->data, self->data_length * sizeof(char)) == 0
-          && tsk_memcmp(self->url, other->url, self->url_length * sizeof(char)) == 0;
+    int ret = 0;
+    void *tmp;
 
-    if (!(options & TSK_CMP_IGNORE_METADATA)) {
-        ret = ret && self->metadata_length == other->metadata_length
-              && self->metadata_schema_length == other->metadata_schema_length
-              && tsk_memcmp(self->metadata, other->metadata,
-                     self->metadata_length * sizeof(char))
-                     == 0
-              && tsk_memcmp(self->metadata_schema, other->metadata_schema,
-                     self->metadata_schema_length * sizeof(char))
-                     == 0;
+    ret = check_table_writable(mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+    tmp = column_realloc(allocator, *column, new_max_rows * element_size);
+    if (tmp == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
     }
+    *column = tmp;
+out:
     return ret;
 }
 
-int
-tsk_reference_sequence_copy(const tsk_reference_sequence_t *self,
-    tsk_reference_sequence_t *dest, tsk_flags_t options)
+static int
+expand_ragged_column(const tsk_table_allocator_t *allocator,
+    const kastore_t *mapped_store, tsk_size_t current_length,
+    tsk_size_t additional_length, tsk_size_t max_length_increment,
+    tsk_size_t *max_length, void **column, size_t element_size)
 {
     int ret = 0;
+    tsk_size_t new_max_length;
 
-    if (!(options & TSK_NO_INIT)) {
-        ret = tsk_reference_sequence_init(dest, 0);
-        if (ret != 0) {
-            goto out;
-        }
+    ret = check_table_writable(mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = calculate_max_length(allocator, current_length, *max_length,
+        max_length_increment, additional_length, &new_max_length);
+    if (ret != 0) {
+        goto out;
     }
 
-    if (tsk_reference_sequence_is_null(self)) {
-        /* This is a simple way to get any input into the NULL state */
-        tsk_reference_sequence_free(dest);
-    } else {
-        ret = tsk_reference_sequence_set_data(dest, self->data, self->data_length);
-        if (ret != 0) {
-            goto out;
-        }
-        ret = tsk_reference_sequence_set_url(dest, self->url, self->url_length);
-        if (ret != 0) {
-            goto out;
-        }
-        ret = tsk_reference_sequence_set_metadata(
-            dest, self->metadata, self->metadata_length);
-        if (ret != 0) {
-            goto out;
-        }
-        ret = tsk_reference_sequence_set_metadata_schema(
-            dest, self->metadata_schema, self->metadata_schema_length);
+    if (new_max_length > *max_length) {
+        ret = expand_table_column(
+            allocator, mapped_store, column, new_max_length, element_size);
         if (ret != 0) {
             goto out;
         }
+        *max_length = new_max_length;
     }
 out:
     return ret;
 }
 
-int
-tsk_reference_sequence_set_data(
-    tsk_reference_sequence_t *self, const char *data, tsk_size_t data_length)
-{
-    return replace_string(&self->data, &self->data_length, data, data_length);
-}
-
-int
-tsk_reference_sequence_set_url(
-    tsk_reference_sequence_t *self, const char *url, tsk_size_t url_length)
-{
-    return replace_string(&self->url, &self->url_length, url, url_length);
-}
-
-int
-tsk_reference_sequence_set_metadata(
-    tsk_reference_sequence_t *self, const char *metadata, tsk_size_t metadata_length)
-{
-    return replace_string(
-        &self->metadata, &self->metadata_length, metadata, metadata_length);
-}
-
-int
-tsk_reference_sequence_set_metadata_schema(tsk_reference_sequence_t *self,
-    const char *metadata_schema, tsk_size_t metadata_schema_length)
-{
-    return replace_string(&self->metadata_schema, &self->metadata_schema_length,
-        metadata_schema, metadata_schema_length);
-}
-
-int
-tsk_reference_sequence_takeset_data(
-    tsk_reference_sequence_t *self, char *data, tsk_size_t data_length)
-{
-    return takeset_string(&self->data, &self->data_length, data, data_length);
-}
-
-int
-tsk_reference_sequence_takeset_metadata(
-    tsk_reference_sequence_t *self, char *metadata, tsk_size_t metadata_length)
-{
-    return takeset_string(
-        &self->metadata, &self->metadata_length, metadata, metadata_length);
-}
-
-/*************************
- * individual table
- *************************/
-
-static void
-tsk_individual_table_free_columns(tsk_individual_table_t *self)
+/* TODO rename to copy_string or replace_and_copy_string */
+static int
+replace_string(
+    char **str, tsk_size_t *len, const char *new_str, const tsk_size_t new_len)
 {
-    tsk_safe_free(self->flags);
-    tsk_safe_free(self->location);
-    tsk_safe_free(self->location_offset);
-    tsk_safe_free(self->parents);
-    tsk_safe_free(self->parents_offset);
-    tsk_safe_free(self->metadata);
-    tsk_safe_free(self->metadata_offset);
+    int ret = 0;
+    tsk_safe_free(*str);
+    *str = NULL;
+    *len = new_len;
+    if (new_len > 0) {
+        *str = tsk_malloc(new_len * sizeof(char));
+        if (*str == NULL) {
+            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+            goto out;
+        }
+        tsk_memcpy(*str, new_str, new_len * sizeof(char));
+    }
+out:
+    return ret;
 }
 
-int
-tsk_individual_table_free(tsk_individual_table_t *self)
+static int
+takeset_string(char **str, tsk_size_t *len, char *new_str, const tsk_size_t new_len)
 {
-    tsk_individual_table_free_columns(self);
-    tsk_safe_free(self->metadata_schema);
+    tsk_safe_free(*str);
+    *str = new_str;
+    *len = new_len;
     return 0;
 }
 
 static int
-tsk_individual_table_expand_main_columns(
-    tsk_individual_table_t *self, tsk_size_t additional_rows)
+check_ragged_column(tsk_size_t num_rows, void *data, tsk_size_t *offset)
 {
     int ret = 0;
-    tsk_size_t new_max_rows;
-
-    ret = calculate_max_rows(self->num_rows, self->max_rows, self->max_rows_increment,
-        additional_rows, &new_max_rows);
-    if (ret != 0) {
+    if ((data == NULL) != (offset == NULL)) {
+        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
         goto out;
     }
-    if ((self->num_rows + additional_rows) > self->max_rows) {
-        ret = expand_column((void **) &self->flags, new_max_rows, sizeof(tsk_flags_t));
-        if (ret != 0) {
-            goto out;
-        }
-        ret = expand_column(
-            (void **) &self->location_offset, new_max_rows + 1, sizeof(tsk_size_t));
-        if (ret != 0) {
-            goto out;
-        }
-        ret = expand_column(
-            (void **) &self->parents_offset, new_max_rows + 1, sizeof(tsk_size_t));
-        if (ret != 0) {
-            goto out;
-        }
-        ret = expand_column(
-            (void **) &self->metadata_offset, new_max_rows + 1, sizeof(tsk_size_t));
+    if (data != NULL) {
+        ret = check_offsets(num_rows, offset, 0, false);
         if (ret != 0) {
             goto out;
         }
-        self->max_rows = new_max_rows;
     }
 out:
     return ret;
 }
 
 static int
-tsk_individual_table_expand_location(
-    tsk_individual_table_t *self, tsk_size_t additional_length)
+takeset_ragged_column(const tsk_table_allocator_t *allocator, tsk_size_t num_rows,
+    void *data, tsk_size_t *offset, void **data_dest, tsk_size_t **offset_dest,
+    tsk_size_t *length_dest)
 {
-    return expand_ragged_column(self->location_length, additional_length,
-        self->max_location_length_increment, &self->max_location_length,
-        (void **) &self->location, sizeof(*self->location));
+    int ret = 0;
+    if (data == NULL) {
+        ret = alloc_empty_ragged_column(
+            allocator, num_rows, (void *) data_dest, offset_dest);
+        if (ret != 0) {
+            goto out;
+        }
+    } else {
+        *data_dest = data;
+        *offset_dest = offset;
+    }
+    *length_dest = (*offset_dest)[num_rows];
+out:
+    return ret;
 }
 
 static int
-tsk_individual_table_expand_parents(
-    tsk_individual_table_t *self, tsk_size_t additional_length)
+takeset_optional_id_column(const tsk_table_allocator_t *allocator,
+    tsk_size_t num_rows, tsk_id_t *input, tsk_id_t **dest)
 {
-    return expand_ragged_column(self->parents_length, additional_length,
-        self->max_parents_length_increment, &self->max_parents_length,
-        (void **) &self->parents, sizeof(*self->parents));
+    int ret = 0;
+    tsk_size_t buffsize;
+    tsk_id_t *buff;
+
+    if (input == NULL) {
+        buffsize = num_rows * sizeof(*buff);
+        buff = column_malloc(allocator, buffsize);
+        if (buff == NULL) {
+            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+            goto out;
+        }
+        *dest = buff;
+        tsk_memset(buff, 0xff, buffsize);
+    } else {
+        *dest = input;
+    }
+out:
+    return ret;
 }
 
 static int
-tsk_individual_table_expand_metadata(
-    tsk_individual_table_t *self, tsk_size_t additional_length)
+write_metadata_schema_header(
+    FILE *out, const char *metadata_schema, tsk_size_t metadata_schema_length)
 {
-    return expand_ragged_column(self->metadata_length, additional_length,
-        self->max_metadata_length_increment, &self->max_metadata_length,
-        (void **) &self->metadata, sizeof(*self->metadata));
+    const char *fmt = "#metadata_schema#\n"
+                      "%.*s\n"
+                      "#end#metadata_schema\n" TABLE_SEP;
+    return fprintf(out, fmt, (int) metadata_schema_length, metadata_schema);
 }
 
-int
-tsk_individual_table_set_max_rows_increment(
-    tsk_individual_table_t *self, tsk_size_t max_rows_increment)
-{
-    self->max_rows_increment = max_rows_increment;
-    return 0;
-}
+/* Utilities for in-place subsetting columns */
 
-int
-tsk_individual_table_set_max_metadata_length_increment(
-    tsk_individual_table_t *self, tsk_size_t max_metadata_length_increment)
+static tsk_size_t
+count_true(tsk_size_t num_rows, const tsk_bool_t *restrict keep)
 {
-    self->max_metadata_length_increment = (tsk_size_t) max_metadata_length_increment;
-    return 0;
-}
+    tsk_size_t j;
+    tsk_size_t count = 0;
 
-int
-tsk_individual_table_set_max_location_length_increment(
-    tsk_individual_table_t *self, tsk_size_t max_location_length_increment)
-{
-    self->max_location_length_increment = (tsk_size_t) max_location_length_increment;
-    return 0;
+    for (j = 0; j < num_rows; j++) {
+        if (keep[j]) {
+            count++;
+        }
+    }
+    return count;
 }
 
-int
-tsk_individual_table_set_max_parents_length_increment(
-    tsk_individual_table_t *self, tsk_size_t max_parents_length_increment)
+static void
+keep_mask_to_id_map(
+    tsk_size_t num_rows, const tsk_bool_t *restrict keep, tsk_id_t *restrict id_map)
 {
-    self->max_parents_length_increment = (tsk_size_t) max_parents_length_increment;
-    return 0;
+    tsk_size_t j;
+    tsk_id_t next_id = 0;
+
+    for (j = 0; j < num_rows; j++) {
+        id_map[j] = TSK_NULL;
+        if (keep[j]) {
+            id_map[j] = next_id;
+            next_id++;
+        }
+    }
 }
 
-int
-tsk_individual_table_init(tsk_individual_table_t *self, tsk_flags_t TSK_UNUSED(options))
+static tsk_size_t
+subset_remap_id_column(tsk_id_t *restrict column, tsk_size_t num_rows,
+    const tsk_bool_t *restrict keep, const tsk_id_t *restrict id_map)
 {
-    int ret = 0;
+    tsk_size_t j, k;
+    tsk_id_t value;
 
-    tsk_memset(self, 0, sizeof(tsk_individual_table_t));
-    /* Allocate space for one row initially, ensuring we always have valid pointers
-     * even if the table is empty */
-    self->max_rows_increment = 1;
-    self->max_location_length_increment = 1;
-    self->max_parents_length_increment = 1;
-    self->max_metadata_length_increment = 1;
-    ret = tsk_individual_table_expand_main_columns(self, 1);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = tsk_individual_table_expand_location(self, 1);
-    if (ret != 0) {
-        goto out;
-    }
-    self->location_offset[0] = 0;
-    ret = tsk_individual_table_expand_parents(self, 1);
-    if (ret != 0) {
-        goto out;
-    }
-    self->parents_offset[0] = 0;
-    ret = tsk_individual_table_expand_metadata(self, 1);
-    if (ret != 0) {
-        goto out;
+    k = 0;
+    for (j = 0; j < num_rows; j++) {
+        if (keep[j]) {
+            value = column[j];
+            if (value != TSK_NULL) {
+                value = id_map[value];
+            }
+            column[k] = value;
+            k++;
+        }
     }
-    self->metadata_offset[0] = 0;
-    self->max_rows_increment = 0;
-    self->max_location_length_increment = 0;
-    self->max_parents_length_increment = 0;
-    self->max_metadata_length_increment = 0;
-    tsk_individual_table_set_metadata_schema(self, NULL, 0);
-out:
-    return ret;
+    return k;
 }
 
-int TSK_WARN_UNUSED
-tsk_individual_table_copy(const tsk_individual_table_t *self,
-    tsk_individual_table_t *dest, tsk_flags_t options)
+/* Trigger warning: C++ programmers should look away... This may be one of the
+ * few cases where some macro funkiness is warranted, as these are exact
+ * duplicates of the same function with just the type of the column
+ * parameter changed. */
+
+static tsk_size_t
+subset_id_column(
+    tsk_id_t *restrict column, tsk_size_t num_rows, const tsk_bool_t *restrict keep)
 {
-    int ret = 0;
+    tsk_size_t j, k;
 
-    if (!(options & TSK_NO_INIT)) {
-        ret = tsk_individual_table_init(dest, 0);
-        if (ret != 0) {
-            goto out;
+    k = 0;
+    for (j = 0; j < num_rows; j++) {
+        if (keep[j]) {
+            column[k] = column[j];
+            k++;
         }
     }
-    ret = tsk_individual_table_set_columns(dest, self->num_rows, self->flags,
-        self->location, self->location_offset, self->parents, self->parents_offset,
-        self->metadata, self->metadata_offset);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = tsk_individual_table_set_metadata_schema(
-        dest, self->metadata_schema, self->metadata_schema_length);
-out:
-    return ret;
+    return k;
 }
 
-int TSK_WARN_UNUSED
-tsk_individual_table_set_columns(tsk_individual_table_t *self, tsk_size_t num_rows,
-    const tsk_flags_t *flags, const double *location, const tsk_size_t *location_offset,
-    const tsk_id_t *parents, const tsk_size_t *parents_offset, const char *metadata,
-    const tsk_size_t *metadata_offset)
+static tsk_size_t
+subset_flags_column(
+    tsk_flags_t *restrict column, tsk_size_t num_rows, const tsk_bool_t *restrict keep)
 {
-    int ret;
+    tsk_size_t j, k;
 
-    ret = tsk_individual_table_clear(self);
-    if (ret != 0) {
-        goto out;
+    k = 0;
+    for (j = 0; j < num_rows; j++) {
+        if (keep[j]) {
+            column[k] = column[j];
+            k++;
+        }
     }
-    ret = tsk_individual_table_append_columns(self, num_rows, flags, location,
-        location_offset, parents, parents_offset, metadata, metadata_offset);
-out:
-    return ret;
+    return k;
 }
 
-int TSK_WARN_UNUSED
-tsk_individual_table_takeset_columns(tsk_individual_table_t *self, tsk_size_t num_rows,
-    tsk_flags_t *flags, double *location, tsk_size_t *location_offset, tsk_id_t *parents,
-    tsk_size_t *parents_offset, char *metadata, tsk_size_t *metadata_offset)
+static tsk_size_t
+subset_double_column(
+    double *restrict column, tsk_size_t num_rows, const tsk_bool_t *restrict keep)
 {
-    int ret = 0;
+    tsk_size_t j, k;
 
-    /* We need to check all the inputs before we start freeing or taking memory */
-    ret = check_ragged_column(num_rows, location, location_offset);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = check_ragged_column(num_rows, parents, parents_offset);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = check_ragged_column(num_rows, metadata, metadata_offset);
-    if (ret != 0) {
-        goto out;
+    k = 0;
+    for (j = 0; j < num_rows; j++) {
+        if (keep[j]) {
+            column[k] = column[j];
+            k++;
+        }
     }
+    return k;
+}
 
-    tsk_individual_table_free_columns(self);
-    self->num_rows = num_rows;
-    self->max_rows = num_rows;
+static tsk_size_t
+subset_ragged_char_column(char *restrict data, tsk_size_t *restrict offset_col,
+    tsk_size_t num_rows, const tsk_bool_t *restrict keep)
+{
+    tsk_size_t j, k, i, offset;
 
-    if (flags == NULL) {
-        /* Flags defaults to all zeros if not specified. The column is often
-         * unused so this is a worthwhile optimisation. */
-        self->flags = tsk_calloc(num_rows, sizeof(*self->flags));
-        if (self->flags == NULL) {
-            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
-            goto out;
+    k = 0;
+    offset = 0;
+    for (j = 0; j < num_rows; j++) {
+        if (keep[j]) {
+            offset_col[k] = offset;
+            /* Note: Unclear whether it's worth calling memcpy instead here?
+             * Need to be careful since the regions are overlapping */
+            for (i = offset_col[j]; i < offset_col[j + 1]; i++) {
+                data[offset] = data[i];
+                offset++;
+            }
+            k++;
         }
-    } else {
-        self->flags = flags;
     }
+    offset_col[k] = offset;
+    return offset;
+}
 
-    ret = takeset_ragged_column(num_rows, location, location_offset,
-        (void *) &self->location, &self->location_offset, &self->location_length);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = takeset_ragged_column(num_rows, parents, parents_offset,
-        (void *) &self->parents, &self->parents_offset, &self->parents_length);
-    if (ret != 0) {
-        goto out;
+static tsk_size_t
+subset_ragged_double_column(double *restrict data, tsk_size_t *restrict offset_col,
+    tsk_size_t num_rows, const tsk_bool_t *restrict keep)
+{
+    tsk_size_t j, k, i, offset;
+
+    k = 0;
+    offset = 0;
+    for (j = 0; j < num_rows; j++) {
+        if (keep[j]) {
+            offset_col[k] = offset;
+            /* Note: Unclear whether it's worth calling memcpy instead here?
+             * Need to be careful since the regions are overlapping */
+            for (i = offset_col[j]; i < offset_col[j + 1]; i++) {
+                data[offset] = data[i];
+                offset++;
+            }
+            k++;
+        }
     }
-    ret = takeset_ragged_column(num_rows, metadata, metadata_offset,
-        (void *) &self->metadata, &self->metadata_offset, &self->metadata_length);
-    if (ret != 0) {
-        goto out;
+    offset_col[k] = offset;
+    return offset;
+}
+
+static tsk_size_t
+subset_remap_ragged_id_column(tsk_id_t *restrict data, tsk_size_t *restrict offset_col,
+    tsk_size_t num_rows, const tsk_bool_t *restrict keep,
+    const tsk_id_t *restrict id_map)
+{
+    tsk_size_t j, k, i, offset;
+    tsk_id_t di;
+
+    k = 0;
+    offset = 0;
+    for (j = 0; j < num_rows; j++) {
+        if (keep[j]) {
+            offset_col[k] = offset;
+            for (i = offset_col[j]; i < offset_col[j + 1]; i++) {
+                di = data[i];
+                if (di != TSK_NULL) {
+                    di = id_map[di];
+                }
+                data[offset] = di;
+                offset++;
+            }
+            k++;
+        }
     }
-out:
-    return ret;
+    offset_col[k] = offset;
+    return offset;
 }
 
+/*************************
+ * reference sequence
+ *************************/
+
 int
-tsk_individual_table_append_columns(tsk_individual_table_t *self, tsk_size_t num_rows,
-    const tsk_flags_t *flags, const double *location, const tsk_size_t *location_offset,
-    const tsk_id_t *parents, const tsk_size_t *parents_offset, const char *metadata,
-    const tsk_size_t *metadata_offset)
+tsk_reference_sequence_init(
+    tsk_reference_sequence_t *self, tsk_flags_t TSK_UNUSED(options))
 {
-    int ret;
-    tsk_size_t j, metadata_length, location_length, parents_length;
+    tsk_memset(self, 0, sizeof(*self));
+    return 0;
+}
 
-    if (flags == NULL) {
-        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
-        goto out;
-    }
-    if ((location == NULL) != (location_offset == NULL)) {
-        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
-        goto out;
-    }
-    if ((parents == NULL) != (parents_offset == NULL)) {
-        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
-        goto out;
-    }
-    if ((metadata == NULL) != (metadata_offset == NULL)) {
-        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
-        goto out;
-    }
-    ret = tsk_individual_table_expand_main_columns(self, (tsk_size_t) num_rows);
-    if (ret != 0) {
-        goto out;
+int
+tsk_reference_sequence_free(tsk_reference_sequence_t *self)
+{
+    tsk_safe_free(self->data);
+    tsk_safe_free(self->url);
+    tsk_safe_free(self->metadata);
+    tsk_safe_free(self->metadata_schema);
+    return 0;
+}
+
+bool
+tsk_reference_sequence_is_null(const tsk_reference_sequence_t *self)
+{
+    return self->data_length == 0 && self->url_length == 0 && self->metadata_length == 0
+           && self->metadata_schema_length == 0;
+}
+
+bool
+tsk_reference_sequence_equals(const tsk_reference_sequence_t *self,
+    const tsk_reference_sequence_t *other, tsk_flags_t options)
+{
+    int ret
+        = self->data_length == other->data_length
+          && self->url_length == other->url_length
+          && tsk_memcmp(self->data, other->data, self->data_length * sizeof(char)) == 0
+          && tsk_memcmp(self->url, other->url, self->url_length * sizeof(char)) == 0;
+
+    if (!(options & TSK_CMP_IGNORE_METADATA)) {
+        ret = ret && self->metadata_length == other->metadata_length
+              && self->metadata_schema_length == other->metadata_schema_length
+              && tsk_memcmp(self->metadata, other->metadata,
+                     self->metadata_length * sizeof(char))
+                     == 0
+              && tsk_memcmp(self->metadata_schema, other->metadata_schema,
+                     self->metadata_schema_length * sizeof(char))
+                     == 0;
     }
-    tsk_memcpy(self->flags + self->num_rows, flags, num_rows * sizeof(tsk_flags_t));
-    if (location == NULL) {
-        for (j = 0; j < num_rows; j++) {
-            self->location_offset[self->num_rows + j + 1]
-                = (tsk_size_t) self->location_length;
-        }
-    } else {
-        ret = check_offsets(num_rows, location_offset, 0, false);
-        if (ret != 0) {
-            goto out;
-        }
-        for (j = 0; j < num_rows; j++) {
-            self->location_offset[self->num_rows + j]
-                = (tsk_size_t) self->location_length + location_offset[j];
-        }
-        location_length = location_offset[num_rows];
-        ret = tsk_individual_table_expand_location(self, location_length);
+    return ret;
+}
+
+int
+tsk_reference_sequence_copy(const tsk_reference_sequence_t *self,
+    tsk_reference_sequence_t *dest, tsk_flags_t options)
+{
+    int ret = 0;
+
+    if (!(options & TSK_NO_INIT)) {
+        ret = tsk_reference_sequence_init(dest, 0);
         if (ret != 0) {
             goto out;
         }
-        tsk_memcpy(self->location + self->location_length, location,
-            location_length * sizeof(double));
-        self->location_length += location_length;
     }
-    if (parents == NULL) {
-        for (j = 0; j < num_rows; j++) {
-            self->parents_offset[self->num_rows + j + 1]
-                = (tsk_size_t) self->parents_length;
-        }
+
+    if (tsk_reference_sequence_is_null(self)) {
+        /* This is a simple way to get any input into the NULL state */
+        tsk_reference_sequence_free(dest);
     } else {
-        ret = check_offsets(num_rows, parents_offset, 0, false);
+        ret = tsk_reference_sequence_set_data(dest, self->data, self->data_length);
         if (ret != 0) {
             goto out;
         }
-        for (j = 0; j < num_rows; j++) {
-            self->parents_offset[self->num_rows + j]
-                = (tsk_size_t) self->parents_length + parents_offset[j];
-        }
-        parents_length = parents_offset[num_rows];
-        ret = tsk_individual_table_expand_parents(self, parents_length);
+        ret = tsk_reference_sequence_set_url(dest, self->url, self->url_length);
         if (ret != 0) {
             goto out;
         }
-        tsk_memcpy(self->parents + self->parents_length, parents,
-            parents_length * sizeof(tsk_id_t));
-        self->parents_length += parents_length;
-    }
-    if (metadata == NULL) {
-        for (j = 0; j < num_rows; j++) {
-            self->metadata_offset[self->num_rows + j + 1]
-                = (tsk_size_t) self->metadata_length;
-        }
-    } else {
-        ret = check_offsets(num_rows, metadata_offset, 0, false);
+        ret = tsk_reference_sequence_set_metadata(
+            dest, self->metadata, self->metadata_length);
         if (ret != 0) {
             goto out;
         }
-        for (j = 0; j < num_rows; j++) {
-            self->metadata_offset[self->num_rows + j]
-                = (tsk_size_t) self->metadata_length + metadata_offset[j];
-        }
-        metadata_length = metadata_offset[num_rows];
-        ret = tsk_individual_table_expand_metadata(self, metadata_length);
+        ret = tsk_reference_sequence_set_metadata_schema(
+            dest, self->metadata_schema, self->metadata_schema_length);
         if (ret != 0) {
             goto out;
         }
-        tsk_memcpy(self->metadata + self->metadata_length, metadata,
-            metadata_length * sizeof(char));
-        self->metadata_length += metadata_length;
     }
-    self->num_rows += (tsk_size_t) num_rows;
-    self->location_offset[self->num_rows] = self->location_length;
-    self->parents_offset[self->num_rows] = self->parents_length;
-    self->metadata_offset[self->num_rows] = self->metadata_length;
 out:
     return ret;
 }
 
-static tsk_id_t
-tsk_individual_table_add_row_internal(tsk_individual_table_t *self, tsk_flags_t flags,
-    const double *location, tsk_size_t location_length, const tsk_id_t *parents,
-    const tsk_size_t parents_length, const char *metadata, tsk_size_t metadata_length)
+int
+tsk_reference_sequence_set_data(
+    tsk_reference_sequence_t *self, const char *data, tsk_size_t data_length)
 {
-    tsk_bug_assert(self->num_rows < self->max_rows);
-    tsk_bug_assert(self->parents_length + parents_length <= self->max_parents_length);
-    tsk_bug_assert(self->metadata_length + metadata_length <= self->max_metadata_length);
-    tsk_bug_assert(self->location_length + location_length <= self->max_location_length);
-    self->flags[self->num_rows] = flags;
-    tsk_memmove(self->location + self->location_length, location,
-        location_length * sizeof(*self->location));
-    self->location_offset[self->num_rows + 1] = self->location_length + location_length;
-    self->location_length += location_length;
-    tsk_memmove(self->parents + self->parents_length, parents,
-        parents_length * sizeof(*self->parents));
-    self->parents_offset[self->num_rows + 1] = self->parents_length + parents_length;
-    self->parents_length += parents_length;
-    tsk_memmove(self->metadata + self->metadata_length, metadata,
-        metadata_length * sizeof(*self->metadata));
-    self->metadata_offset[self->num_rows + 1] = self->metadata_length + metadata_length;
-    self->metadata_length += metadata_length;
-    self->num_rows++;
-    return (tsk_id_t) self->num_rows - 1;
+    return replace_string(&self->data, &self->data_length, data, data_length);
 }
 
-tsk_id_t
-tsk_individual_table_add_row(tsk_individual_table_t *self, tsk_flags_t flags,
-    const double *location, tsk_size_t location_length, const tsk_id_t *parents,
-    tsk_size_t parents_length, const char *metadata, tsk_size_t metadata_length)
+int
+tsk_reference_sequence_set_url(
+    tsk_reference_sequence_t *self, const char *url, tsk_size_t url_length)
 {
-    tsk_id_t ret = 0;
+    return replace_string(&self->url, &self->url_length, url, url_length);
+}
 
-    ret = tsk_individual_table_expand_main_columns(self, 1);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = tsk_individual_table_expand_location(self, location_length);
+int
+tsk_reference_sequence_set_metadata(
+    tsk_reference_sequence_t *self, const char *metadata, tsk_size_t metadata_length)
+{
+    return replace_string(
+        &self->metadata, &self->metadata_length, metadata, metadata_length);
+}
+
+int
+tsk_reference_sequence_set_metadata_schema(tsk_reference_sequence_t *self,
+    const char *metadata_schema, tsk_size_t metadata_schema_length)
+{
+    return replace_string(&self->metadata_schema, &self->metadata_schema_length,
+        metadata_schema, metadata_schema_length);
+}
+
+int
+tsk_reference_sequence_takeset_data(
+    tsk_reference_sequence_t *self, char *data, tsk_size_t data_length)
+{
+    return takeset_string(&self->data, &self->data_length, data, data_length);
+}
+
+int
+tsk_reference_sequence_takeset_metadata(
+    tsk_reference_sequence_t *self, char *metadata, tsk_size_t metadata_length)
+{
+    return takeset_string(
+        &self->metadata, &self->metadata_length, metadata, metadata_length);
+}
+
+/*************************
+ * individual table
+ *************************/
+
+static void
+tsk_individual_table_free_columns(tsk_individual_table_t *self)
+{
+    free_column(self->allocator, self->mapped_store, (void **) &self->flags);
+    free_column(self->allocator, self->mapped_store, (void **) &self->location);
+    free_column(self->allocator, self->mapped_store, (void **) &self->location_offset);
+    free_column(self->allocator, self->mapped_store, (void **) &self->parents);
+    free_column(self->allocator, self->mapped_store, (void **) &self->parents_offset);
+    free_column(self->allocator, self->mapped_store, (void **) &self->metadata);
+    free_column(self->allocator, self->mapped_store, (void **) &self->metadata_offset);
+}
+
+int
+tsk_individual_table_free(tsk_individual_table_t *self)
+{
+    tsk_individual_table_free_columns(self);
+    tsk_safe_free(self->metadata_schema);
+    return 0;
+}
+
+static int
+tsk_individual_table_expand_main_columns(
+    tsk_individual_table_t *self, tsk_size_t additional_rows)
+{
+    int ret = 0;
+    tsk_size_t new_max_rows;
+
+    ret = check_table_writable(self->mapped_store);
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_individual_table_expand_parents(self, parents_length);
+    ret = calculate_max_rows(self->allocator, self->num_rows, self->max_rows,
+        self->max_rows_increment, additional_rows, &new_max_rows);
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_individual_table_expand_metadata(self, metadata_length);
-    if (ret != 0) {
-        goto out;
+    if ((self->num_rows + additional_rows) > self->max_rows) {
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->flags, new_max_rows, sizeof(tsk_flags_t));
+        if (ret != 0) {
+            goto out;
+        }
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->location_offset, new_max_rows + 1, sizeof(tsk_size_t));
+        if (ret != 0) {
+            goto out;
+        }
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->parents_offset, new_max_rows + 1, sizeof(tsk_size_t));
+        if (ret != 0) {
+            goto out;
+        }
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->metadata_offset, new_max_rows + 1, sizeof(tsk_size_t));
+        if (ret != 0) {
+            goto out;
+        }
+        self->max_rows = new_max_rows;
     }
-    ret = tsk_individual_table_add_row_internal(self, flags, location, location_length,
-        parents, parents_length, metadata, metadata_length);
 out:
     return ret;
 }
 
 static int
-tsk_individual_table_update_row_rewrite(tsk_individual_table_t *self, tsk_id_t index,
-    tsk_flags_t flags, const double *location, tsk_size_t location_length,
-    const tsk_id_t *parents, tsk_size_t parents_length, const char *metadata,
-    tsk_size_t metadata_length)
+tsk_individual_table_expand_location(
+    tsk_individual_table_t *self, tsk_size_t additional_length)
 {
-    int ret = 0;
-    tsk_id_t j, ret_id;
-    tsk_individual_table_t copy;
-    tsk_size_t num_rows;
-    tsk_id_t *rows = NULL;
+    return expand_ragged_column(self->allocator, self->mapped_store,
+        self->location_length, additional_length, self->max_location_length_increment,
+        &self->max_location_length, (void **) &self->location, sizeof(*self->location));
+}
 
-    ret = tsk_individual_table_copy(self, &copy, 0);
-    if (ret != 0) {
-        goto out;
-    }
-    rows = tsk_malloc(self->num_rows * sizeof(*rows));
-    if (rows == NULL) {
-        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+static int
+tsk_individual_table_expand_parents(
+    tsk_individual_table_t *self, tsk_size_t additional_length)
+{
+    return expand_ragged_column(self->allocator, self->mapped_store,
+        self->parents_length, additional_length, self->max_parents_length_increment,
+        &self->max_parents_length, (void **) &self->parents, sizeof(*self->parents));
+}
+
+static int
+tsk_individual_table_expand_metadata(
+    tsk_individual_table_t *self, tsk_size_t additional_length)
+{
+    return expand_ragged_column(self->allocator, self->mapped_store,
+        self->metadata_length, additional_length, self->max_metadata_length_increment,
+        &self->max_metadata_length, (void **) &self->metadata, sizeof(*self->metadata));
+}
+
+int
+tsk_individual_table_set_max_rows_increment(
+    tsk_individual_table_t *self, tsk_size_t max_rows_increment)
+{
+    self->max_rows_increment = max_rows_increment;
+    return 0;
+}
+
+int
+tsk_individual_table_set_max_metadata_length_increment(
+    tsk_individual_table_t *self, tsk_size_t max_metadata_length_increment)
+{
+    self->max_metadata_length_increment = (tsk_size_t) max_metadata_length_increment;
+    return 0;
+}
+
+int
+tsk_individual_table_set_max_location_length_increment(
+    tsk_individual_table_t *self, tsk_size_t max_location_length_increment)
+{
+    self->max_location_length_increment = (tsk_size_t) max_location_length_increment;
+    return 0;
+}
+
+int
+tsk_individual_table_set_max_parents_length_increment(
+    tsk_individual_table_t *self, tsk_size_t max_parents_length_increment)
+{
+    self->max_parents_length_increment = (tsk_size_t) max_parents_length_increment;
+    return 0;
+}
+
+static int
+tsk_individual_table_init_allocator(tsk_individual_table_t *self,
+    tsk_flags_t TSK_UNUSED(options), const tsk_table_allocator_t *allocator)
+{
+    int ret = 0;
+
+    tsk_memset(self, 0, sizeof(tsk_individual_table_t));
+    self->allocator = allocator;
+    /* Allocate space for one row initially, ensuring we always have valid pointers
+     * even if the table is empty */
+    self->max_rows_increment = 1;
+    self->max_location_length_increment = 1;
+    self->max_parents_length_increment = 1;
+    self->max_metadata_length_increment = 1;
+    ret = tsk_individual_table_expand_main_columns(self, 1);
+    if (ret != 0) {
         goto out;
     }
-
-    ret = tsk_individual_table_truncate(self, (tsk_size_t) index);
-    tsk_bug_assert(ret == 0);
-    ret_id = tsk_individual_table_add_row(self, flags, location, location_length,
-        parents, parents_length, metadata, metadata_length);
-    if (ret_id < 0) {
-        ret = (int) ret_id;
+    ret = tsk_individual_table_expand_location(self, 1);
+    if (ret != 0) {
         goto out;
     }
-    num_rows = 0;
-    for (j = index + 1; j < (tsk_id_t) copy.num_rows; j++) {
-        rows[num_rows] = j;
-        num_rows++;
+    self->location_offset[0] = 0;
+    ret = tsk_individual_table_expand_parents(self, 1);
+    if (ret != 0) {
+        goto out;
     }
-    ret = tsk_individual_table_extend(self, &copy, num_rows, rows, 0);
+    self->parents_offset[0] = 0;
+    ret = tsk_individual_table_expand_metadata(self, 1);
     if (ret != 0) {
         goto out;
     }
+    self->metadata_offset[0] = 0;
+    self->max_rows_increment = 0;
+    self->max_location_length_increment = 0;
+    self->max_parents_length_increment = 0;
+    self->max_metadata_length_increment = 0;
+    tsk_individual_table_set_metadata_schema(self, NULL, 0);
 out:
-    tsk_individual_table_free(&copy);
-    tsk_safe_free(rows);
     return ret;
 }
 
 int
-tsk_individual_table_update_row(tsk_individual_table_t *self, tsk_id_t index,
-    tsk_flags_t flags, const double *location, tsk_size_t location_length,
-    const tsk_id_t *parents, tsk_size_t parents_length, const char *metadata,
-    tsk_size_t metadata_length)
+tsk_individual_table_init(tsk_individual_table_t *self, tsk_flags_t options)
+{
+    return tsk_individual_table_init_allocator(self, options, NULL);
+}
+
+int TSK_WARN_UNUSED
+tsk_individual_table_copy(const tsk_individual_table_t *self,
+    tsk_individual_table_t *dest, tsk_flags_t options)
 {
     int ret = 0;
-    tsk_individual_t current_row;
 
-    ret = tsk_individual_table_get_row(self, index, &current_row);
-    if (ret != 0) {
-        goto out;
-    }
-    if (current_row.location_length == location_length
-        && current_row.parents_length == parents_length
-        && current_row.metadata_length == metadata_length) {
-        self->flags[index] = flags;
-        /* Note: important to use tsk_memmove here as we may be provided pointers
-         * to the column memory as input via get_row */
-        tsk_memmove(&self->location[self->location_offset[index]], location,
-            location_length * sizeof(*location));
-        tsk_memmove(&self->parents[self->parents_offset[index]], parents,
-            parents_length * sizeof(*parents));
-        tsk_memmove(&self->metadata[self->metadata_offset[index]], metadata,
-            metadata_length * sizeof(*metadata));
-    } else {
-        ret = tsk_individual_table_update_row_rewrite(self, index, flags, location,
-            location_length, parents, parents_length, metadata, metadata_length);
+    if (!(options & TSK_NO_INIT)) {
+        ret = tsk_individual_table_init(dest, 0);
         if (ret != 0) {
             goto out;
         }
     }
+    ret = tsk_individual_table_set_columns(dest, self->num_rows, self->flags,
+        self->location, self->location_offset, self->parents, self->parents_offset,
+        self->metadata, self->metadata_offset);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_individual_table_set_metadata_schema(
+        dest, self->metadata_schema, self->metadata_schema_length);
 out:
     return ret;
 }
 
-int
-tsk_individual_table_clear(tsk_individual_table_t *self)
+int TSK_WARN_UNUSED
+tsk_individual_table_set_columns(tsk_individual_table_t *self, tsk_size_t num_rows,
+    const tsk_flags_t *flags, const double *location, const tsk_size_t *location_offset,
+    const tsk_id_t *parents, const tsk_size_t *parents_offset, const char *metadata,
+    const tsk_size_t *metadata_offset)
 {
-    return tsk_individual_table_truncate(self, 0);
+    int ret;
+
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_individual_table_clear(self);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_individual_table_append_columns(self, num_rows, flags, location,
+        location_offset, parents, parents_offset, metadata, metadata_offset);
+out:
+    return ret;
 }
 
-int
-tsk_individual_table_truncate(tsk_individual_table_t *self, tsk_size_t num_rows)
+int TSK_WARN_UNUSED
+tsk_individual_table_takeset_columns(tsk_individual_table_t *self, tsk_size_t num_rows,
+    tsk_flags_t *flags, double *location, tsk_size_t *location_offset, tsk_id_t *parents,
+    tsk_size_t *parents_offset, char *metadata, tsk_size_t *metadata_offset)
 {
     int ret = 0;
 
-    if (num_rows > self->num_rows) {
-        ret = tsk_trace_error(TSK_ERR_BAD_TABLE_POSITION);
+    /* We need to check all the inputs before we start freeing or taking memory */
+    ret = check_ragged_column(num_rows, location, location_offset);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = check_ragged_column(num_rows, parents, parents_offset);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = check_ragged_column(num_rows, metadata, metadata_offset);
+    if (ret != 0) {
         goto out;
     }
+
+    tsk_individual_table_free_columns(self);
     self->num_rows = num_rows;
-    self->location_length = self->location_offset[num_rows];
-    self->parents_length = self->parents_offset[num_rows];
-    self->metadata_length = self->metadata_offset[num_rows];
+    self->max_rows = num_rows;
+
+    if (flags == NULL) {
+        /* Flags defaults to all zeros if not specified. The column is often
+         * unused so this is a worthwhile optimisation. */
+        self->flags = column_malloc(self->allocator, num_rows * sizeof(*self->flags));
+        if (self->flags == NULL) {
+            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+            goto out;
+        }
+        tsk_memset(self->flags, 0, num_rows * sizeof(*self->flags));
+    } else {
+        self->flags = flags;
+    }
+
+    ret = takeset_ragged_column(self->allocator, num_rows, location, location_offset,
+        (void *) &self->location, &self->location_offset, &self->location_length);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = takeset_ragged_column(self->allocator, num_rows, parents, parents_offset,
+        (void *) &self->parents, &self->parents_offset, &self->parents_length);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = takeset_ragged_column(self->allocator, num_rows, metadata, metadata_offset,
+        (void *) &self->metadata, &self->metadata_offset, &self->metadata_length);
+    if (ret != 0) {
+        goto out;
+    }
 out:
     return ret;
 }
 
 int
-tsk_individual_table_extend(tsk_individual_table_t *self,
-    const tsk_individual_table_t *other, tsk_size_t num_rows,
-    const tsk_id_t *row_indexes, tsk_flags_t TSK_UNUSED(options))
+tsk_individual_table_append_columns(tsk_individual_table_t *self, tsk_size_t num_rows,
+    const tsk_flags_t *flags, const double *location, const tsk_size_t *location_offset,
+    const tsk_id_t *parents, const tsk_size_t *parents_offset, const char *metadata,
+    const tsk_size_t *metadata_offset)
 {
-    int ret = 0;
-    tsk_id_t ret_id;
-    tsk_size_t j;
-    tsk_individual_t individual;
+    int ret;
+    tsk_size_t j, metadata_length, location_length, parents_length;
 
-    if (self == other) {
-        ret = tsk_trace_error(TSK_ERR_CANNOT_EXTEND_FROM_SELF);
+    if (flags == NULL) {
+        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
         goto out;
     }
-
-    /* We know how much to expand the non-ragged columns, so do it ahead of time */
-    ret = tsk_individual_table_expand_main_columns(self, num_rows);
+    if ((location == NULL) != (location_offset == NULL)) {
+        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+        goto out;
+    }
+    if ((parents == NULL) != (parents_offset == NULL)) {
+        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+        goto out;
+    }
+    if ((metadata == NULL) != (metadata_offset == NULL)) {
+        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+        goto out;
+    }
+    ret = tsk_individual_table_expand_main_columns(self, (tsk_size_t) num_rows);
     if (ret != 0) {
         goto out;
     }
-    for (j = 0; j < num_rows; j++) {
-        ret = tsk_individual_table_get_row(
-            other, row_indexes == NULL ? (tsk_id_t) j : row_indexes[j], &individual);
+    tsk_memcpy(self->flags + self->num_rows, flags, num_rows * sizeof(tsk_flags_t));
+    if (location == NULL) {
+        for (j = 0; j < num_rows; j++) {
+            self->location_offset[self->num_rows + j + 1]
+                = (tsk_size_t) self->location_length;
+        }
+    } else {
+        ret = check_offsets(num_rows, location_offset, 0, false);
         if (ret != 0) {
             goto out;
         }
-        ret_id = tsk_individual_table_add_row(self, individual.flags,
-            individual.location, individual.location_length, individual.parents,
-            individual.parents_length, individual.metadata, individual.metadata_length);
-        if (ret_id < 0) {
-            ret = (int) ret_id;
+        for (j = 0; j < num_rows; j++) {
+            self->location_offset[self->num_rows + j]
+                = (tsk_size_t) self->location_length + location_offset[j];
+        }
+        location_length = location_offset[num_rows];
+        ret = tsk_individual_table_expand_location(self, location_length);
+        if (ret != 0) {
             goto out;
         }
+        tsk_memcpy(self->location + self->location_length, location,
+            location_length * sizeof(double));
+        self->location_length += location_length;
     }
-    ret = 0;
-out:
+    if (parents == NULL) {
+        for (j = 0; j < num_rows; j++) {
+            self->parents_offset[self->num_rows + j + 1]
+                = (tsk_size_t) self->parents_length;
+        }
+    } else {
+        ret = check_offsets(num_rows, parents_offset, 0, false);
+        if (ret != 0) {
+            goto out;
+        }
+        for (j = 0; j < num_rows; j++) {
+            self->parents_offset[self->num_rows + j]
+                = (tsk_size_t) self->parents_length + parents_offset[j];
+        }
+        parents_length = parents_offset[num_rows];
+        ret = tsk_individual_table_expand_parents(self, parents_length);
+        if (ret != 0) {
+            goto out;
+        }
+        tsk_memcpy(self->parents + self->parents_length, parents,
+            parents_length * sizeof(tsk_id_t));
+        self->parents_length += parents_length;
+    }
+    if (metadata == NULL) {
+        for (j = 0; j < num_rows; j++) {
+            self->metadata_offset[self->num_rows + j + 1]
+                = (tsk_size_t) self->metadata_length;
+        }
+    } else {
+        ret = check_offsets(num_rows, metadata_offset, 0, false);
+        if (ret != 0) {
+            goto out;
+        }
+        for (j = 0; j < num_rows; j++) {
+            self->metadata_offset[self->num_rows + j]
+                = (tsk_size_t) self->metadata_length + metadata_offset[j];
+        }
+        metadata_length = metadata_offset[num_rows];
+        ret = tsk_individual_table_expand_metadata(self, metadata_length);
+        if (ret != 0) {
+            goto out;
+        }
+        tsk_memcpy(self->metadata + self->metadata_length, metadata,
+            metadata_length * sizeof(char));
+        self->metadata_length += metadata_length;
+    }
+    self->num_rows += (tsk_size_t) num_rows;
+    self->location_offset[self->num_rows] = self->location_length;
+    self->parents_offset[self->num_rows] = self->parents_length;
+    self->metadata_offset[self->num_rows] = self->metadata_length;
+out:
+    return ret;
+}
+
+static tsk_id_t
+tsk_individual_table_add_row_internal(tsk_individual_table_t *self, tsk_flags_t flags,
+    const double *location, tsk_size_t location_length, const tsk_id_t *parents,
+    const tsk_size_t parents_length, const char *metadata, tsk_size_t metadata_length)
+{
+    tsk_bug_assert(self->num_rows < self->max_rows);
+    tsk_bug_assert(self->parents_length + parents_length <= self->max_parents_length);
+    tsk_bug_assert(self->metadata_length + metadata_length <= self->max_metadata_length);
+    tsk_bug_assert(self->location_length + location_length <= self->max_location_length);
+    self->flags[self->num_rows] = flags;
+    tsk_memmove(self->location + self->location_length, location,
+        location_length * sizeof(*self->location));
+    self->location_offset[self->num_rows + 1] = self->location_length + location_length;
+    self->location_length += location_length;
+    tsk_memmove(self->parents + self->parents_length, parents,
+        parents_length * sizeof(*self->parents));
+    self->parents_offset[self->num_rows + 1] = self->parents_length + parents_length;
+    self->parents_length += parents_length;
+    tsk_memmove(self->metadata + self->metadata_length, metadata,
+        metadata_length * sizeof(*self->metadata));
+    self->metadata_offset[self->num_rows + 1] = self->metadata_length + metadata_length;
+    self->metadata_length += metadata_length;
+    self->num_rows++;
+    return (tsk_id_t) self->num_rows - 1;
+}
+
+tsk_id_t
+tsk_individual_table_add_row(tsk_individual_table_t *self, tsk_flags_t flags,
+    const double *location, tsk_size_t location_length, const tsk_id_t *parents,
+    tsk_size_t parents_length, const char *metadata, tsk_size_t metadata_length)
+{
+    tsk_id_t ret = 0;
+
+    ret = tsk_individual_table_expand_main_columns(self, 1);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_individual_table_expand_location(self, location_length);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_individual_table_expand_parents(self, parents_length);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_individual_table_expand_metadata(self, metadata_length);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_individual_table_add_row_internal(self, flags, location, location_length,
+        parents, parents_length, metadata, metadata_length);
+out:
+    return ret;
+}
+
+static int
+tsk_individual_table_update_row_rewrite(tsk_individual_table_t *self, tsk_id_t index,
+    tsk_flags_t flags, const double *location, tsk_size_t location_length,
+    const tsk_id_t *parents, tsk_size_t parents_length, const char *metadata,
+    tsk_size_t metadata_length)
+{
+    int ret = 0;
+    tsk_id_t j, ret_id;
+    tsk_individual_table_t copy;
+    tsk_size_t num_rows;
+    tsk_id_t *rows = NULL;
+
+    ret = tsk_individual_table_copy(self, &copy, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    rows = tsk_malloc(self->num_rows * sizeof(*rows));
+    if (rows == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+
+    ret = tsk_individual_table_truncate(self, (tsk_size_t) index);
+    tsk_bug_assert(ret == 0);
+    ret_id = tsk_individual_table_add_row(self, flags, location, location_length,
+        parents, parents_length, metadata, metadata_length);
+    if (ret_id < 0) {
+        ret = (int) ret_id;
+        goto out;
+    }
+    num_rows = 0;
+    for (j = index + 1; j < (tsk_id_t) copy.num_rows; j++) {
+        rows[num_rows] = j;
+        num_rows++;
+    }
+    ret = tsk_individual_table_extend(self, &copy, num_rows, rows, 0);
+    if (ret != 0) {
+        goto out;
+    }
+out:
+    tsk_individual_table_free(&copy);
+    tsk_safe_free(rows);
+    return ret;
+}
+
+int
+tsk_individual_table_update_row(tsk_individual_table_t *self, tsk_id_t index,
+    tsk_flags_t flags, const double *location, tsk_size_t location_length,
+    const tsk_id_t *parents, tsk_size_t parents_length, const char *metadata,
+    tsk_size_t metadata_length)
+{
+    int ret = 0;
+    tsk_individual_t current_row;
+
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_individual_table_get_row(self, index, &current_row);
+    if (ret != 0) {
+        goto out;
+    }
+    if (current_row.location_length == location_length
+        && current_row.parents_length == parents_length
+        && current_row.metadata_length == metadata_length) {
+        self->flags[index] = flags;
+        /* Note: important to use tsk_memmove here as we may be provided pointers
+         * to the column memory as input via get_row */
+        tsk_memmove(&self->location[self->location_offset[index]], location,
+            location_length * sizeof(*location));
+        tsk_memmove(&self->parents[self->parents_offset[index]], parents,
+            parents_length * sizeof(*parents));
+        tsk_memmove(&self->metadata[self->metadata_offset[index]], metadata,
+            metadata_length * sizeof(*metadata));
+    } else {
+        ret = tsk_individual_table_update_row_rewrite(self, index, flags, location,
+            location_length, parents, parents_length, metadata, metadata_length);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+out:
+    return ret;
+}
+
+int
+tsk_individual_table_clear(tsk_individual_table_t *self)
+{
+    return tsk_individual_table_truncate(self, 0);
+}
+
+int
+tsk_individual_table_truncate(tsk_individual_table_t *self, tsk_size_t num_rows)
+{
+    int ret = 0;
+
+    if (num_rows > self->num_rows) {
+        ret = tsk_trace_error(TSK_ERR_BAD_TABLE_POSITION);
+        goto out;
+    }
+    self->num_rows = num_rows;
+    self->location_length = self->location_offset[num_rows];
+    self->parents_length = self->parents_offset[num_rows];
+    self->metadata_length = self->metadata_offset[num_rows];
+out:
+    return ret;
+}
+
+int
+tsk_individual_table_extend(tsk_individual_table_t *self,
+    const tsk_individual_table_t *other, tsk_size_t num_rows,
+    const tsk_id_t *row_indexes, tsk_flags_t TSK_UNUSED(options))
+{
+    int ret = 0;
+    tsk_id_t ret_id;
+    tsk_size_t j;
+    tsk_individual_t individual;
+
+    if (self == other) {
+        ret = tsk_trace_error(TSK_ERR_CANNOT_EXTEND_FROM_SELF);
+        goto out;
+    }
+
+    /* We know how much to expand the non-ragged columns, so do it ahead of time */
+    ret = tsk_individual_table_expand_main_columns(self, num_rows);
+    if (ret != 0) {
+        goto out;
+    }
+    for (j = 0; j < num_rows; j++) {
+        ret = tsk_individual_table_get_row(
+            other, row_indexes == NULL ? (tsk_id_t) j : row_indexes[j], &individual);
+        if (ret != 0) {
+            goto out;
+        }
+        ret_id = tsk_individual_table_add_row(self, individual.flags,
+            individual.location, individual.location_length, individual.parents,
+            individual.parents_length, individual.metadata, individual.metadata_length);
+        if (ret_id < 0) {
+            ret = (int) ret_id;
+            goto out;
+        }
+    }
+    ret = 0;
+out:
     return ret;
 }
 
@@ -1819,6 +2673,11 @@ tsk_individual_table_keep_rows(tsk_individual_table_t *self, const tsk_bool_t *k
     tsk_id_t *restrict parents = self->parents;
     tsk_size_t *restrict parents_offset = self->parents_offset;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+
     if (ret_id_map == NULL) {
         id_map = tsk_malloc(current_num_rows * sizeof(*id_map));
         if (id_map == NULL) {
@@ -1897,7 +2756,8 @@ tsk_individual_table_dump(
 }
 
 static int
-tsk_individual_table_load(tsk_individual_table_t *self, kastore_t *store)
+tsk_individual_table_load(
+    tsk_individual_table_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
     tsk_flags_t *flags = NULL;
@@ -1921,16 +2781,16 @@ tsk_individual_table_load(tsk_individual_table_t *self, kastore_t *store)
         { "individuals/parents", (void **) &parents, &parents_length,
             TSK_ID_STORAGE_TYPE, &parents_offset, TSK_COL_OPTIONAL },
         { "individuals/metadata", (void **) &metadata, &metadata_length, KAS_UINT8,
-            &metadata_offset, 0 },
+            &metadata_offset, TSK_COL_METADATA },
         { .name = NULL },
     };
     read_table_property_t properties[] = {
         { "individuals/metadata_schema", (void **) &metadata_schema,
-            &metadata_schema_length, KAS_UINT8, TSK_COL_OPTIONAL },
+            &metadata_schema_length, KAS_UINT8, TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
 
-    ret = read_table(store, &num_rows, cols, ragged_cols, properties, 0);
+    ret = read_table(store, &num_rows, cols, ragged_cols, properties, options);
     if (ret != 0) {
         goto out;
     }
@@ -1941,6 +2801,12 @@ tsk_individual_table_load(tsk_individual_table_t *self, kastore_t *store)
             goto out;
         }
     }
+    if (options & TSK_LOAD_COPY_COLUMNS) {
+        /* Copy into the existing columns, reusing their memory */
+        ret = tsk_individual_table_set_columns(self, num_rows, flags, location,
+            location_offset, parents, parents_offset, metadata, metadata_offset);
+        goto out;
+    }
     ret = tsk_individual_table_takeset_columns(self, num_rows, flags, location,
         location_offset, parents, parents_offset, metadata, metadata_offset);
     if (ret != 0) {
@@ -1955,7 +2821,7 @@ tsk_individual_table_load(tsk_individual_table_t *self, kastore_t *store)
     metadata_offset = NULL;
 
 out:
-    free_read_table_mem(cols, ragged_cols, properties);
+    free_read_table_mem(store, cols, ragged_cols, properties);
     return ret;
 }
 
@@ -1966,12 +2832,12 @@ out:
 static void
 tsk_node_table_free_columns(tsk_node_table_t *self)
 {
-    tsk_safe_free(self->flags);
-    tsk_safe_free(self->time);
-    tsk_safe_free(self->population);
-    tsk_safe_free(self->individual);
-    tsk_safe_free(self->metadata);
-    tsk_safe_free(self->metadata_offset);
+    free_column(self->allocator, self->mapped_store, (void **) &self->flags);
+    free_column(self->allocator, self->mapped_store, (void **) &self->time);
+    free_column(self->allocator, self->mapped_store, (void **) &self->population);
+    free_column(self->allocator, self->mapped_store, (void **) &self->individual);
+    free_column(self->allocator, self->mapped_store, (void **) &self->metadata);
+    free_column(self->allocator, self->mapped_store, (void **) &self->metadata_offset);
 }
 
 int
@@ -1988,30 +2854,38 @@ tsk_node_table_expand_main_columns(tsk_node_table_t *self, tsk_size_t additional
     int ret = 0;
     tsk_size_t new_max_rows;
 
-    ret = calculate_max_rows(self->num_rows, self->max_rows, self->max_rows_increment,
-        additional_rows, &new_max_rows);
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = calculate_max_rows(self->allocator, self->num_rows, self->max_rows,
+        self->max_rows_increment, additional_rows, &new_max_rows);
     if (ret != 0) {
         goto out;
     }
 
     if (new_max_rows > self->max_rows) {
-        ret = expand_column((void **) &self->flags, new_max_rows, sizeof(tsk_flags_t));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->flags, new_max_rows, sizeof(tsk_flags_t));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column((void **) &self->time, new_max_rows, sizeof(double));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->time, new_max_rows, sizeof(double));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column((void **) &self->population, new_max_rows, sizeof(tsk_id_t));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->population, new_max_rows, sizeof(tsk_id_t));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column((void **) &self->individual, new_max_rows, sizeof(tsk_id_t));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->individual, new_max_rows, sizeof(tsk_id_t));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column(
+        ret = expand_table_column(self->allocator, self->mapped_store,
             (void **) &self->metadata_offset, new_max_rows + 1, sizeof(tsk_size_t));
         if (ret != 0) {
             goto out;
@@ -2025,9 +2899,9 @@ out:
 static int
 tsk_node_table_expand_metadata(tsk_node_table_t *self, tsk_size_t additional_length)
 {
-    return expand_ragged_column(self->metadata_length, additional_length,
-        self->max_metadata_length_increment, &self->max_metadata_length,
-        (void **) &self->metadata, sizeof(*self->metadata));
+    return expand_ragged_column(self->allocator, self->mapped_store,
+        self->metadata_length, additional_length, self->max_metadata_length_increment,
+        &self->max_metadata_length, (void **) &self->metadata, sizeof(*self->metadata));
 }
 
 int
@@ -2046,12 +2920,14 @@ tsk_node_table_set_max_metadata_length_increment(
     return 0;
 }
 
-int
-tsk_node_table_init(tsk_node_table_t *self, tsk_flags_t TSK_UNUSED(options))
+static int
+tsk_node_table_init_allocator(tsk_node_table_t *self, tsk_flags_t TSK_UNUSED(options),
+    const tsk_table_allocator_t *allocator)
 {
     int ret = 0;
 
     tsk_memset(self, 0, sizeof(tsk_node_table_t));
+    self->allocator = allocator;
     /* Allocate space for one row initially, ensuring we always have valid pointers
      * even if the table is empty */
     self->max_rows_increment = 1;
@@ -2072,6 +2948,12 @@ out:
     return ret;
 }
 
+int
+tsk_node_table_init(tsk_node_table_t *self, tsk_flags_t options)
+{
+    return tsk_node_table_init_allocator(self, options, NULL);
+}
+
 int TSK_WARN_UNUSED
 tsk_node_table_copy(
     const tsk_node_table_t *self, tsk_node_table_t *dest, tsk_flags_t options)
@@ -2102,6 +2984,10 @@ tsk_node_table_set_columns(tsk_node_table_t *self, tsk_size_t num_rows,
 {
     int ret;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_node_table_clear(self);
     if (ret != 0) {
         goto out;
@@ -2135,16 +3021,18 @@ tsk_node_table_takeset_columns(tsk_node_table_t *self, tsk_size_t num_rows,
     self->flags = flags;
     self->time = time;
 
-    ret = takeset_optional_id_column(num_rows, population, &self->population);
+    ret = takeset_optional_id_column(
+        self->allocator, num_rows, population, &self->population);
     if (ret != 0) {
         goto out;
     }
-    ret = takeset_optional_id_column(num_rows, individual, &self->individual);
+    ret = takeset_optional_id_column(
+        self->allocator, num_rows, individual, &self->individual);
     if (ret != 0) {
         goto out;
     }
 
-    ret = takeset_ragged_column(num_rows, metadata, metadata_offset,
+    ret = takeset_ragged_column(self->allocator, num_rows, metadata, metadata_offset,
         (void *) &self->metadata, &self->metadata_offset, &self->metadata_length);
     if (ret != 0) {
         goto out;
@@ -2256,6 +3144,56 @@ out:
     return ret;
 }
 
+int TSK_WARN_UNUSED
+tsk_node_table_reserve_rows(tsk_node_table_t *self, tsk_size_t num_rows,
+    tsk_size_t metadata_length, tsk_node_table_batch_t *batch)
+{
+    int ret = 0;
+
+    tsk_memset(batch, 0, sizeof(*batch));
+    ret = tsk_node_table_expand_main_columns(self, num_rows);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_node_table_expand_metadata(self, metadata_length);
+    if (ret != 0) {
+        goto out;
+    }
+    batch->num_rows = num_rows;
+    batch->metadata_length = metadata_length;
+    batch->flags = self->flags + self->num_rows;
+    batch->time = self->time + self->num_rows;
+    batch->population = self->population + self->num_rows;
+    batch->individual = self->individual + self->num_rows;
+    batch->metadata = self->metadata + self->metadata_length;
+    batch->metadata_offset = self->metadata_offset + self->num_rows;
+out:
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_node_table_commit_rows(
+    tsk_node_table_t *self, const tsk_node_table_batch_t *batch, tsk_size_t num_rows)
+{
+    int ret = 0;
+
+    /* The reserved space moves if the table is modified */
+    if (num_rows > batch->num_rows || batch->flags != self->flags + self->num_rows
+        || batch->metadata != self->metadata + self->metadata_length) {
+        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+        goto out;
+    }
+    ret = check_reserved_offsets(
+        num_rows, batch->metadata_offset, self->metadata_length, batch->metadata_length);
+    if (ret != 0) {
+        goto out;
+    }
+    self->metadata_length = batch->metadata_offset[num_rows];
+    self->num_rows += num_rows;
+out:
+    return ret;
+}
+
 static int
 tsk_node_table_update_row_rewrite(tsk_node_table_t *self, tsk_id_t index,
     tsk_flags_t flags, double time, tsk_id_t population, tsk_id_t individual,
@@ -2308,6 +3246,10 @@ tsk_node_table_update_row(tsk_node_table_t *self, tsk_id_t index, tsk_flags_t fl
     int ret = 0;
     tsk_node_t current_row;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_node_table_get_row(self, index, &current_row);
     if (ret != 0) {
         goto out;
@@ -2528,6 +3470,11 @@ tsk_node_table_keep_rows(tsk_node_table_t *self, const tsk_bool_t *keep,
     int ret = 0;
     tsk_size_t remaining_rows;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+
     if (id_map != NULL) {
         keep_mask_to_id_map(self->num_rows, keep, id_map);
     }
@@ -2541,6 +3488,7 @@ tsk_node_table_keep_rows(tsk_node_table_t *self, const tsk_bool_t *keep,
             self->metadata, self->metadata_offset, self->num_rows, keep);
     }
     self->num_rows = remaining_rows;
+out:
     return ret;
 }
 
@@ -2568,7 +3516,8 @@ tsk_node_table_dump(const tsk_node_table_t *self, kastore_t *store, tsk_flags_t
 }
 
 static int
-tsk_node_table_load(tsk_node_table_t *self, kastore_t *store)
+tsk_node_table_load(
+    tsk_node_table_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
     char *metadata_schema = NULL;
@@ -2588,16 +3537,16 @@ tsk_node_table_load(tsk_node_table_t *self, kastore_t *store)
     };
     read_table_ragged_col_t ragged_cols[] = {
         { "nodes/metadata", (void **) &metadata, &metadata_length, KAS_UINT8,
-            &metadata_offset, 0 },
+            &metadata_offset, TSK_COL_METADATA },
         { .name = NULL },
     };
     read_table_property_t properties[] = {
         { "nodes/metadata_schema", (void **) &metadata_schema, &metadata_schema_length,
-            KAS_UINT8, TSK_COL_OPTIONAL },
+            KAS_UINT8, TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
 
-    ret = read_table(store, &num_rows, cols, ragged_cols, properties, 0);
+    ret = read_table(store, &num_rows, cols, ragged_cols, properties, options);
     if (ret != 0) {
         goto out;
     }
@@ -2608,6 +3557,11 @@ tsk_node_table_load(tsk_node_table_t *self, kastore_t *store)
             goto out;
         }
     }
+    if (options & TSK_LOAD_COPY_COLUMNS) {
+        ret = tsk_node_table_set_columns(self, num_rows, flags, time, population,
+            individual, metadata, metadata_offset);
+        goto out;
+    }
     ret = tsk_node_table_takeset_columns(
         self, num_rows, flags, time, population, individual, metadata, metadata_offset);
     if (ret != 0) {
@@ -2620,7 +3574,7 @@ tsk_node_table_load(tsk_node_table_t *self, kastore_t *store)
     metadata = NULL;
     metadata_offset = NULL;
 out:
-    free_read_table_mem(cols, ragged_cols, properties);
+    free_read_table_mem(store, cols, ragged_cols, properties);
     return ret;
 }
 
@@ -2631,12 +3585,12 @@ out:
 static void
 tsk_edge_table_free_columns(tsk_edge_table_t *self)
 {
-    tsk_safe_free(self->left);
-    tsk_safe_free(self->right);
-    tsk_safe_free(self->parent);
-    tsk_safe_free(self->child);
-    tsk_safe_free(self->metadata);
-    tsk_safe_free(self->metadata_offset);
+    free_column(self->allocator, self->mapped_store, (void **) &self->left);
+    free_column(self->allocator, self->mapped_store, (void **) &self->right);
+    free_column(self->allocator, self->mapped_store, (void **) &self->parent);
+    free_column(self->allocator, self->mapped_store, (void **) &self->child);
+    free_column(self->allocator, self->mapped_store, (void **) &self->metadata);
+    free_column(self->allocator, self->mapped_store, (void **) &self->metadata_offset);
 }
 
 int
@@ -2659,30 +3613,38 @@ tsk_edge_table_expand_main_columns(tsk_edge_table_t *self, tsk_size_t additional
     int ret = 0;
     tsk_size_t new_max_rows;
 
-    ret = calculate_max_rows(self->num_rows, self->max_rows, self->max_rows_increment,
-        additional_rows, &new_max_rows);
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = calculate_max_rows(self->allocator, self->num_rows, self->max_rows,
+        self->max_rows_increment, additional_rows, &new_max_rows);
     if (ret != 0) {
         goto out;
     }
     if ((self->num_rows + additional_rows) > self->max_rows) {
-        ret = expand_column((void **) &self->left, new_max_rows, sizeof(double));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->left, new_max_rows, sizeof(double));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column((void **) &self->right, new_max_rows, sizeof(double));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->right, new_max_rows, sizeof(double));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column((void **) &self->parent, new_max_rows, sizeof(tsk_id_t));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->parent, new_max_rows, sizeof(tsk_id_t));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column((void **) &self->child, new_max_rows, sizeof(tsk_id_t));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->child, new_max_rows, sizeof(tsk_id_t));
         if (ret != 0) {
             goto out;
         }
         if (tsk_edge_table_has_metadata(self)) {
-            ret = expand_column(
+            ret = expand_table_column(self->allocator, self->mapped_store,
                 (void **) &self->metadata_offset, new_max_rows + 1, sizeof(tsk_size_t));
             if (ret != 0) {
                 goto out;
@@ -2697,9 +3659,9 @@ out:
 static int
 tsk_edge_table_expand_metadata(tsk_edge_table_t *self, tsk_size_t additional_length)
 {
-    return expand_ragged_column(self->metadata_length, additional_length,
-        self->max_metadata_length_increment, &self->max_metadata_length,
-        (void **) &self->metadata, sizeof(*self->metadata));
+    return expand_ragged_column(self->allocator, self->mapped_store,
+        self->metadata_length, additional_length, self->max_metadata_length_increment,
+        &self->max_metadata_length, (void **) &self->metadata, sizeof(*self->metadata));
 }
 
 int
@@ -2718,12 +3680,14 @@ tsk_edge_table_set_max_metadata_length_increment(
     return 0;
 }
 
-int
-tsk_edge_table_init(tsk_edge_table_t *self, tsk_flags_t options)
+static int
+tsk_edge_table_init_allocator(tsk_edge_table_t *self, tsk_flags_t options,
+    const tsk_table_allocator_t *allocator)
 {
     int ret = 0;
 
     tsk_memset(self, 0, sizeof(*self));
+    self->allocator = allocator;
     self->options = options;
 
     /* Allocate space for one row initially, ensuring we always have valid
@@ -2748,6 +3712,12 @@ out:
     return ret;
 }
 
+int
+tsk_edge_table_init(tsk_edge_table_t *self, tsk_flags_t options)
+{
+    return tsk_edge_table_init_allocator(self, options, NULL);
+}
+
 tsk_id_t
 tsk_edge_table_add_row(tsk_edge_table_t *self, double left, double right,
     tsk_id_t parent, tsk_id_t child, const char *metadata, tsk_size_t metadata_length)
@@ -2788,6 +3758,67 @@ out:
     return ret;
 }
 
+int TSK_WARN_UNUSED
+tsk_edge_table_reserve_rows(tsk_edge_table_t *self, tsk_size_t num_rows,
+    tsk_size_t metadata_length, tsk_edge_table_batch_t *batch)
+{
+    int ret = 0;
+
+    tsk_memset(batch, 0, sizeof(*batch));
+    if (metadata_length > 0 && !tsk_edge_table_has_metadata(self)) {
+        ret = tsk_trace_error(TSK_ERR_METADATA_DISABLED);
+        goto out;
+    }
+    ret = tsk_edge_table_expand_main_columns(self, num_rows);
+    if (ret != 0) {
+        goto out;
+    }
+    batch->num_rows = num_rows;
+    batch->left = self->left + self->num_rows;
+    batch->right = self->right + self->num_rows;
+    batch->parent = self->parent + self->num_rows;
+    batch->child = self->child + self->num_rows;
+    if (tsk_edge_table_has_metadata(self)) {
+        ret = tsk_edge_table_expand_metadata(self, metadata_length);
+        if (ret != 0) {
+            goto out;
+        }
+        batch->metadata_length = metadata_length;
+        batch->metadata = self->metadata + self->metadata_length;
+        batch->metadata_offset = self->metadata_offset + self->num_rows;
+    }
+out:
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_edge_table_commit_rows(
+    tsk_edge_table_t *self, const tsk_edge_table_batch_t *batch, tsk_size_t num_rows)
+{
+    int ret = 0;
+
+    /* The reserved space moves if the table is modified */
+    if (num_rows > batch->num_rows || batch->left != self->left + self->num_rows) {
+        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+        goto out;
+    }
+    if (tsk_edge_table_has_metadata(self)) {
+        if (batch->metadata != self->metadata + self->metadata_length) {
+            ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+            goto out;
+        }
+        ret = check_reserved_offsets(num_rows, batch->metadata_offset,
+            self->metadata_length, batch->metadata_length);
+        if (ret != 0) {
+            goto out;
+        }
+        self->metadata_length = batch->metadata_offset[num_rows];
+    }
+    self->num_rows += num_rows;
+out:
+    return ret;
+}
+
 static int
 tsk_edge_table_update_row_rewrite(tsk_edge_table_t *self, tsk_id_t index, double left,
     double right, tsk_id_t parent, tsk_id_t child, const char *metadata,
@@ -2840,6 +3871,10 @@ tsk_edge_table_update_row(tsk_edge_table_t *self, tsk_id_t index, double left,
     int ret = 0;
     tsk_edge_t current_row;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_edge_table_get_row(self, index, &current_row);
     if (ret != 0) {
         goto out;
@@ -2910,6 +3945,10 @@ tsk_edge_table_set_columns(tsk_edge_table_t *self, tsk_size_t num_rows,
 {
     int ret = 0;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_edge_table_clear(self);
     if (ret != 0) {
         goto out;
@@ -2949,7 +3988,7 @@ tsk_edge_table_takeset_columns(tsk_edge_table_t *self, tsk_size_t num_rows, doub
     self->parent = parent;
     self->child = child;
 
-    ret = takeset_ragged_column(num_rows, metadata, metadata_offset,
+    ret = takeset_ragged_column(self->allocator, num_rows, metadata, metadata_offset,
         (void *) &self->metadata, &self->metadata_offset, &self->metadata_length);
     if (ret != 0) {
         goto out;
@@ -3220,6 +4259,11 @@ tsk_edge_table_keep_rows(tsk_edge_table_t *self, const tsk_bool_t *keep,
     int ret = 0;
     tsk_size_t remaining_rows;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+
     if (id_map != NULL) {
         keep_mask_to_id_map(self->num_rows, keep, id_map);
     }
@@ -3233,6 +4277,7 @@ tsk_edge_table_keep_rows(tsk_edge_table_t *self, const tsk_bool_t *keep,
             self->metadata, self->metadata_offset, self->num_rows, keep);
     }
     self->num_rows = remaining_rows;
+out:
     return ret;
 }
 
@@ -3273,7 +4318,8 @@ out:
 }
 
 static int
-tsk_edge_table_load(tsk_edge_table_t *self, kastore_t *store)
+tsk_edge_table_load(
+    tsk_edge_table_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
     char *metadata_schema = NULL;
@@ -3294,16 +4340,16 @@ tsk_edge_table_load(tsk_edge_table_t *self, kastore_t *store)
     };
     read_table_ragged_col_t ragged_cols[] = {
         { "edges/metadata", (void **) &metadata, &metadata_length, KAS_UINT8,
-            &metadata_offset, TSK_COL_OPTIONAL },
+            &metadata_offset, TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
     read_table_property_t properties[] = {
         { "edges/metadata_schema", (void **) &metadata_schema, &metadata_schema_length,
-            KAS_UINT8, TSK_COL_OPTIONAL },
+            KAS_UINT8, TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
 
-    ret = read_table(store, &num_rows, cols, ragged_cols, properties, 0);
+    ret = read_table(store, &num_rows, cols, ragged_cols, properties, options);
     if (ret != 0) {
         goto out;
     }
@@ -3314,6 +4360,11 @@ tsk_edge_table_load(tsk_edge_table_t *self, kastore_t *store)
             goto out;
         }
     }
+    if (options & TSK_LOAD_COPY_COLUMNS) {
+        ret = tsk_edge_table_set_columns(
+            self, num_rows, left, right, parent, child, metadata, metadata_offset);
+        goto out;
+    }
     ret = tsk_edge_table_takeset_columns(
         self, num_rows, left, right, parent, child, metadata, metadata_offset);
     if (ret != 0) {
@@ -3326,7 +4377,7 @@ tsk_edge_table_load(tsk_edge_table_t *self, kastore_t *store)
     metadata = NULL;
     metadata_offset = NULL;
 out:
-    free_read_table_mem(cols, ragged_cols, properties);
+    free_read_table_mem(store, cols, ragged_cols, properties);
     return ret;
 }
 
@@ -3338,6 +4389,10 @@ tsk_edge_table_squash(tsk_edge_table_t *self)
     tsk_edge_t *edges = NULL;
     tsk_size_t num_output_edges;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     if (self->metadata_length > 0) {
         ret = tsk_trace_error(TSK_ERR_CANT_PROCESS_EDGES_WITH_METADATA);
         goto out;
@@ -3382,11 +4437,12 @@ out:
 static void
 tsk_site_table_free_columns(tsk_site_table_t *self)
 {
-    tsk_safe_free(self->position);
-    tsk_safe_free(self->ancestral_state);
-    tsk_safe_free(self->ancestral_state_offset);
-    tsk_safe_free(self->metadata);
-    tsk_safe_free(self->metadata_offset);
+    free_column(self->allocator, self->mapped_store, (void **) &self->position);
+    free_column(self->allocator, self->mapped_store, (void **) &self->ancestral_state);
+    free_column(
+        self->allocator, self->mapped_store, (void **) &self->ancestral_state_offset);
+    free_column(self->allocator, self->mapped_store, (void **) &self->metadata);
+    free_column(self->allocator, self->mapped_store, (void **) &self->metadata_offset);
 }
 
 int
@@ -3403,22 +4459,28 @@ tsk_site_table_expand_main_columns(tsk_site_table_t *self, tsk_size_t additional
     int ret = 0;
     tsk_size_t new_max_rows;
 
-    ret = calculate_max_rows(self->num_rows, self->max_rows, self->max_rows_increment,
-        additional_rows, &new_max_rows);
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = calculate_max_rows(self->allocator, self->num_rows, self->max_rows,
+        self->max_rows_increment, additional_rows, &new_max_rows);
     if (ret != 0) {
         goto out;
     }
     if ((self->num_rows + additional_rows) > self->max_rows) {
-        ret = expand_column((void **) &self->position, new_max_rows, sizeof(double));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->position, new_max_rows, sizeof(double));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column((void **) &self->ancestral_state_offset, new_max_rows + 1,
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->ancestral_state_offset, new_max_rows + 1,
             sizeof(tsk_size_t));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column(
+        ret = expand_table_column(self->allocator, self->mapped_store,
             (void **) &self->metadata_offset, new_max_rows + 1, sizeof(tsk_size_t));
         if (ret != 0) {
             goto out;
@@ -3433,7 +4495,8 @@ static int
 tsk_site_table_expand_ancestral_state(
     tsk_site_table_t *self, tsk_size_t additional_length)
 {
-    return expand_ragged_column(self->ancestral_state_length, additional_length,
+    return expand_ragged_column(self->allocator, self->mapped_store,
+        self->ancestral_state_length, additional_length,
         self->max_ancestral_state_length_increment, &self->max_ancestral_state_length,
         (void **) &self->ancestral_state, sizeof(*self->ancestral_state));
 }
@@ -3441,9 +4504,9 @@ tsk_site_table_expand_ancestral_state(
 static int
 tsk_site_table_expand_metadata(tsk_site_table_t *self, tsk_size_t additional_length)
 {
-    return expand_ragged_column(self->metadata_length, additional_length,
-        self->max_metadata_length_increment, &self->max_metadata_length,
-        (void **) &self->metadata, sizeof(*self->metadata));
+    return expand_ragged_column(self->allocator, self->mapped_store,
+        self->metadata_length, additional_length, self->max_metadata_length_increment,
+        &self->max_metadata_length, (void **) &self->metadata, sizeof(*self->metadata));
 }
 
 int
@@ -3470,12 +4533,14 @@ tsk_site_table_set_max_ancestral_state_length_increment(
     return 0;
 }
 
-int
-tsk_site_table_init(tsk_site_table_t *self, tsk_flags_t TSK_UNUSED(options))
+static int
+tsk_site_table_init_allocator(tsk_site_table_t *self, tsk_flags_t TSK_UNUSED(options),
+    const tsk_table_allocator_t *allocator)
 {
     int ret = 0;
 
     tsk_memset(self, 0, sizeof(tsk_site_table_t));
+    self->allocator = allocator;
 
     /* Allocate space for one row initially, ensuring we always have valid pointers
      * even if the table is empty */
@@ -3504,6 +4569,12 @@ out:
     return ret;
 }
 
+int
+tsk_site_table_init(tsk_site_table_t *self, tsk_flags_t options)
+{
+    return tsk_site_table_init_allocator(self, options, NULL);
+}
+
 tsk_id_t
 tsk_site_table_add_row(tsk_site_table_t *self, double position,
     const char *ancestral_state, tsk_size_t ancestral_state_length, const char *metadata,
@@ -3598,6 +4669,10 @@ tsk_site_table_update_row(tsk_site_table_t *self, tsk_id_t index, double positio
     int ret = 0;
     tsk_site_t current_row;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_site_table_get_row(self, index, &current_row);
     if (ret != 0) {
         goto out;
@@ -3728,6 +4803,10 @@ tsk_site_table_set_columns(tsk_site_table_t *self, tsk_size_t num_rows,
 {
     int ret = 0;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_site_table_clear(self);
     if (ret != 0) {
         goto out;
@@ -3764,13 +4843,13 @@ tsk_site_table_takeset_columns(tsk_site_table_t *self, tsk_size_t num_rows,
     self->max_rows = num_rows;
     self->position = position;
 
-    ret = takeset_ragged_column(num_rows, ancestral_state, ancestral_state_offset,
-        (void *) &self->ancestral_state, &self->ancestral_state_offset,
-        &self->ancestral_state_length);
+    ret = takeset_ragged_column(self->allocator, num_rows, ancestral_state,
+        ancestral_state_offset, (void *) &self->ancestral_state,
+        &self->ancestral_state_offset, &self->ancestral_state_length);
     if (ret != 0) {
         goto out;
     }
-    ret = takeset_ragged_column(num_rows, metadata, metadata_offset,
+    ret = takeset_ragged_column(self->allocator, num_rows, metadata, metadata_offset,
         (void *) &self->metadata, &self->metadata_offset, &self->metadata_length);
     if (ret != 0) {
         goto out;
@@ -3978,6 +5057,11 @@ tsk_site_table_keep_rows(tsk_site_table_t *self, const tsk_bool_t *keep,
     int ret = 0;
     tsk_size_t remaining_rows;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+
     if (id_map != NULL) {
         keep_mask_to_id_map(self->num_rows, keep, id_map);
     }
@@ -3990,6 +5074,7 @@ tsk_site_table_keep_rows(tsk_site_table_t *self, const tsk_bool_t *keep,
             self->metadata, self->metadata_offset, self->num_rows, keep);
     }
     self->num_rows = remaining_rows;
+out:
     return ret;
 }
 
@@ -4015,7 +5100,8 @@ tsk_site_table_dump(const tsk_site_table_t *self, kastore_t *store, tsk_flags_t
 }
 
 static int
-tsk_site_table_load(tsk_site_table_t *self, kastore_t *store)
+tsk_site_table_load(
+    tsk_site_table_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
     char *metadata_schema = NULL;
@@ -4034,16 +5120,16 @@ tsk_site_table_load(tsk_site_table_t *self, kastore_t *store)
         { "sites/ancestral_state", (void **) &ancestral_state, &ancestral_state_length,
             KAS_UINT8, &ancestral_state_offset, 0 },
         { "sites/metadata", (void **) &metadata, &metadata_length, KAS_UINT8,
-            &metadata_offset, 0 },
+            &metadata_offset, TSK_COL_METADATA },
         { .name = NULL },
     };
     read_table_property_t properties[] = {
         { "sites/metadata_schema", (void **) &metadata_schema, &metadata_schema_length,
-            KAS_UINT8, TSK_COL_OPTIONAL },
+            KAS_UINT8, TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
 
-    ret = read_table(store, &num_rows, cols, ragged_cols, properties, 0);
+    ret = read_table(store, &num_rows, cols, ragged_cols, properties, options);
     if (ret != 0) {
         goto out;
     }
@@ -4054,6 +5140,11 @@ tsk_site_table_load(tsk_site_table_t *self, kastore_t *store)
             goto out;
         }
     }
+    if (options & TSK_LOAD_COPY_COLUMNS) {
+        ret = tsk_site_table_set_columns(self, num_rows, position, ancestral_state,
+            ancestral_state_offset, metadata, metadata_offset);
+        goto out;
+    }
     ret = tsk_site_table_takeset_columns(self, num_rows, position, ancestral_state,
         ancestral_state_offset, metadata, metadata_offset);
     if (ret != 0) {
@@ -4066,7 +5157,7 @@ tsk_site_table_load(tsk_site_table_t *self, kastore_t *store)
     metadata_offset = NULL;
 
 out:
-    free_read_table_mem(cols, ragged_cols, properties);
+    free_read_table_mem(store, cols, ragged_cols, properties);
     return ret;
 }
 
@@ -4077,14 +5168,15 @@ out:
 static void
 tsk_mutation_table_free_columns(tsk_mutation_table_t *self)
 {
-    tsk_safe_free(self->node);
-    tsk_safe_free(self->site);
-    tsk_safe_free(self->parent);
-    tsk_safe_free(self->time);
-    tsk_safe_free(self->derived_state);
-    tsk_safe_free(self->derived_state_offset);
-    tsk_safe_free(self->metadata);
-    tsk_safe_free(self->metadata_offset);
+    free_column(self->allocator, self->mapped_store, (void **) &self->node);
+    free_column(self->allocator, self->mapped_store, (void **) &self->site);
+    free_column(self->allocator, self->mapped_store, (void **) &self->parent);
+    free_column(self->allocator, self->mapped_store, (void **) &self->time);
+    free_column(self->allocator, self->mapped_store, (void **) &self->derived_state);
+    free_column(
+        self->allocator, self->mapped_store, (void **) &self->derived_state_offset);
+    free_column(self->allocator, self->mapped_store, (void **) &self->metadata);
+    free_column(self->allocator, self->mapped_store, (void **) &self->metadata_offset);
 }
 
 int
@@ -4102,34 +5194,42 @@ tsk_mutation_table_expand_main_columns(
     int ret = 0;
     tsk_size_t new_max_rows;
 
-    ret = calculate_max_rows(self->num_rows, self->max_rows, self->max_rows_increment,
-        additional_rows, &new_max_rows);
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = calculate_max_rows(self->allocator, self->num_rows, self->max_rows,
+        self->max_rows_increment, additional_rows, &new_max_rows);
     if (ret != 0) {
         goto out;
     }
     if ((self->num_rows + additional_rows) > self->max_rows) {
-        ret = expand_column((void **) &self->site, new_max_rows, sizeof(tsk_id_t));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->site, new_max_rows, sizeof(tsk_id_t));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column((void **) &self->node, new_max_rows, sizeof(tsk_id_t));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->node, new_max_rows, sizeof(tsk_id_t));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column((void **) &self->parent, new_max_rows, sizeof(tsk_id_t));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->parent, new_max_rows, sizeof(tsk_id_t));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column((void **) &self->time, new_max_rows, sizeof(double));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->time, new_max_rows, sizeof(double));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column(
+        ret = expand_table_column(self->allocator, self->mapped_store,
             (void **) &self->derived_state_offset, new_max_rows + 1, sizeof(tsk_size_t));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column(
+        ret = expand_table_column(self->allocator, self->mapped_store,
             (void **) &self->metadata_offset, new_max_rows + 1, sizeof(tsk_size_t));
         if (ret != 0) {
             goto out;
@@ -4144,7 +5244,8 @@ static int
 tsk_mutation_table_expand_derived_state(
     tsk_mutation_table_t *self, tsk_size_t additional_length)
 {
-    return expand_ragged_column(self->derived_state_length, additional_length,
+    return expand_ragged_column(self->allocator, self->mapped_store,
+        self->derived_state_length, additional_length,
         self->max_derived_state_length_increment, &self->max_derived_state_length,
         (void **) &self->derived_state, sizeof(*self->derived_state));
 }
@@ -4153,9 +5254,9 @@ static int
 tsk_mutation_table_expand_metadata(
     tsk_mutation_table_t *self, tsk_size_t additional_length)
 {
-    return expand_ragged_column(self->metadata_length, additional_length,
-        self->max_metadata_length_increment, &self->max_metadata_length,
-        (void **) &self->metadata, sizeof(*self->metadata));
+    return expand_ragged_column(self->allocator, self->mapped_store,
+        self->metadata_length, additional_length, self->max_metadata_length_increment,
+        &self->max_metadata_length, (void **) &self->metadata, sizeof(*self->metadata));
 }
 
 int
@@ -4182,12 +5283,14 @@ tsk_mutation_table_set_max_derived_state_length_increment(
     return 0;
 }
 
-int
-tsk_mutation_table_init(tsk_mutation_table_t *self, tsk_flags_t TSK_UNUSED(options))
+static int
+tsk_mutation_table_init_allocator(tsk_mutation_table_t *self,
+    tsk_flags_t TSK_UNUSED(options), const tsk_table_allocator_t *allocator)
 {
     int ret = 0;
 
     tsk_memset(self, 0, sizeof(tsk_mutation_table_t));
+    self->allocator = allocator;
 
     /* Allocate space for one row initially, ensuring we always have valid pointers
      * even if the table is empty */
@@ -4216,6 +5319,12 @@ out:
     return ret;
 }
 
+int
+tsk_mutation_table_init(tsk_mutation_table_t *self, tsk_flags_t options)
+{
+    return tsk_mutation_table_init_allocator(self, options, NULL);
+}
+
 tsk_id_t
 tsk_mutation_table_add_row(tsk_mutation_table_t *self, tsk_id_t site, tsk_id_t node,
     tsk_id_t parent, double time, const char *derived_state,
@@ -4313,6 +5422,10 @@ tsk_mutation_table_update_row(tsk_mutation_table_t *self, tsk_id_t index, tsk_id
     int ret = 0;
     tsk_mutation_t current_row;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_mutation_table_get_row(self, index, &current_row);
     if (ret != 0) {
         goto out;
@@ -4460,13 +5573,13 @@ tsk_mutation_table_takeset_columns(tsk_mutation_table_t *self, tsk_size_t num_ro
     self->site = site;
     self->node = node;
 
-    ret = takeset_optional_id_column(num_rows, parent, &self->parent);
+    ret = takeset_optional_id_column(self->allocator, num_rows, parent, &self->parent);
     if (ret != 0) {
         goto out;
     }
     if (time == NULL) {
         /* Time defaults to unknown time if not specified. */
-        self->time = tsk_malloc(num_rows * sizeof(*self->time));
+        self->time = column_malloc(self->allocator, num_rows * sizeof(*self->time));
         if (self->time == NULL) {
             ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
             goto out;
@@ -4479,13 +5592,13 @@ tsk_mutation_table_takeset_columns(tsk_mutation_table_t *self, tsk_size_t num_ro
         self->time = time;
     }
 
-    ret = takeset_ragged_column(num_rows, derived_state, derived_state_offset,
-        (void *) &self->derived_state, &self->derived_state_offset,
+    ret = takeset_ragged_column(self->allocator, num_rows, derived_state,
+        derived_state_offset, (void *) &self->derived_state, &self->derived_state_offset,
         &self->derived_state_length);
     if (ret != 0) {
         goto out;
     }
-    ret = takeset_ragged_column(num_rows, metadata, metadata_offset,
+    ret = takeset_ragged_column(self->allocator, num_rows, metadata, metadata_offset,
         (void *) &self->metadata, &self->metadata_offset, &self->metadata_length);
     if (ret != 0) {
         goto out;
@@ -4527,6 +5640,10 @@ tsk_mutation_table_set_columns(tsk_mutation_table_t *self, tsk_size_t num_rows,
 {
     int ret = 0;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_mutation_table_clear(self);
     if (ret != 0) {
         goto out;
@@ -4747,6 +5864,11 @@ tsk_mutation_table_keep_rows(tsk_mutation_table_t *self, const tsk_bool_t *keep,
     tsk_id_t *id_map = ret_id_map;
     tsk_id_t *restrict parent = self->parent;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+
     if (ret_id_map == NULL) {
         id_map = tsk_malloc(current_num_rows * sizeof(*id_map));
         if (id_map == NULL) {
@@ -4822,7 +5944,8 @@ tsk_mutation_table_dump(
 }
 
 static int
-tsk_mutation_table_load(tsk_mutation_table_t *self, kastore_t *store)
+tsk_mutation_table_load(
+    tsk_mutation_table_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
     tsk_id_t *node = NULL;
@@ -4847,16 +5970,16 @@ tsk_mutation_table_load(tsk_mutation_table_t *self, kastore_t *store)
         { "mutations/derived_state", (void **) &derived_state, &derived_state_length,
             KAS_UINT8, &derived_state_offset, 0 },
         { "mutations/metadata", (void **) &metadata, &metadata_length, KAS_UINT8,
-            &metadata_offset, 0 },
+            &metadata_offset, TSK_COL_METADATA },
         { .name = NULL },
     };
     read_table_property_t properties[] = {
         { "mutations/metadata_schema", (void **) &metadata_schema,
-            &metadata_schema_length, KAS_UINT8, TSK_COL_OPTIONAL },
+            &metadata_schema_length, KAS_UINT8, TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
 
-    ret = read_table(store, &num_rows, cols, ragged_cols, properties, 0);
+    ret = read_table(store, &num_rows, cols, ragged_cols, properties, options);
     if (ret != 0) {
         goto out;
     }
@@ -4867,6 +5990,11 @@ tsk_mutation_table_load(tsk_mutation_table_t *self, kastore_t *store)
             goto out;
         }
     }
+    if (options & TSK_LOAD_COPY_COLUMNS) {
+        ret = tsk_mutation_table_set_columns(self, num_rows, site, node, parent, time,
+            derived_state, derived_state_offset, metadata, metadata_offset);
+        goto out;
+    }
     ret = tsk_mutation_table_takeset_columns(self, num_rows, site, node, parent, time,
         derived_state, derived_state_offset, metadata, metadata_offset);
     if (ret != 0) {
@@ -4882,7 +6010,7 @@ tsk_mutation_table_load(tsk_mutation_table_t *self, kastore_t *store)
     metadata_offset = NULL;
 
 out:
-    free_read_table_mem(cols, ragged_cols, properties);
+    free_read_table_mem(store, cols, ragged_cols, properties);
     return ret;
 }
 
@@ -4893,14 +6021,14 @@ out:
 static void
 tsk_migration_table_free_columns(tsk_migration_table_t *self)
 {
-    tsk_safe_free(self->left);
-    tsk_safe_free(self->right);
-    tsk_safe_free(self->node);
-    tsk_safe_free(self->source);
-    tsk_safe_free(self->dest);
-    tsk_safe_free(self->time);
-    tsk_safe_free(self->metadata);
-    tsk_safe_free(self->metadata_offset);
+    free_column(self->allocator, self->mapped_store, (void **) &self->left);
+    free_column(self->allocator, self->mapped_store, (void **) &self->right);
+    free_column(self->allocator, self->mapped_store, (void **) &self->node);
+    free_column(self->allocator, self->mapped_store, (void **) &self->source);
+    free_column(self->allocator, self->mapped_store, (void **) &self->dest);
+    free_column(self->allocator, self->mapped_store, (void **) &self->time);
+    free_column(self->allocator, self->mapped_store, (void **) &self->metadata);
+    free_column(self->allocator, self->mapped_store, (void **) &self->metadata_offset);
 }
 
 int
@@ -4918,37 +6046,47 @@ tsk_migration_table_expand_main_columns(
     int ret = 0;
     tsk_size_t new_max_rows;
 
-    ret = calculate_max_rows(self->num_rows, self->max_rows, self->max_rows_increment,
-        additional_rows, &new_max_rows);
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = calculate_max_rows(self->allocator, self->num_rows, self->max_rows,
+        self->max_rows_increment, additional_rows, &new_max_rows);
     if (ret != 0) {
         goto out;
     }
     if ((self->num_rows + additional_rows) > self->max_rows) {
-        ret = expand_column((void **) &self->left, new_max_rows, sizeof(double));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->left, new_max_rows, sizeof(double));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column((void **) &self->right, new_max_rows, sizeof(double));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->right, new_max_rows, sizeof(double));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column((void **) &self->node, new_max_rows, sizeof(tsk_id_t));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->node, new_max_rows, sizeof(tsk_id_t));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column((void **) &self->source, new_max_rows, sizeof(tsk_id_t));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->source, new_max_rows, sizeof(tsk_id_t));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column((void **) &self->dest, new_max_rows, sizeof(tsk_id_t));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->dest, new_max_rows, sizeof(tsk_id_t));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column((void **) &self->time, new_max_rows, sizeof(double));
+        ret = expand_table_column(self->allocator, self->mapped_store,
+            (void **) &self->time, new_max_rows, sizeof(double));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column(
+        ret = expand_table_column(self->allocator, self->mapped_store,
             (void **) &self->metadata_offset, new_max_rows + 1, sizeof(tsk_size_t));
         if (ret != 0) {
             goto out;
@@ -4964,9 +6102,9 @@ static int
 tsk_migration_table_expand_metadata(
     tsk_migration_table_t *self, tsk_size_t additional_length)
 {
-    return expand_ragged_column(self->metadata_length, additional_length,
-        self->max_metadata_length_increment, &self->max_metadata_length,
-        (void **) &self->metadata, sizeof(*self->metadata));
+    return expand_ragged_column(self->allocator, self->mapped_store,
+        self->metadata_length, additional_length, self->max_metadata_length_increment,
+        &self->max_metadata_length, (void **) &self->metadata, sizeof(*self->metadata));
 }
 
 int
@@ -4985,12 +6123,14 @@ tsk_migration_table_set_max_metadata_length_increment(
     return 0;
 }
 
-int
-tsk_migration_table_init(tsk_migration_table_t *self, tsk_flags_t TSK_UNUSED(options))
+static int
+tsk_migration_table_init_allocator(tsk_migration_table_t *self,
+    tsk_flags_t TSK_UNUSED(options), const tsk_table_allocator_t *allocator)
 {
     int ret = 0;
 
     tsk_memset(self, 0, sizeof(tsk_migration_table_t));
+    self->allocator = allocator;
 
     /* Allocate space for one row initially, ensuring we always have valid pointers
      * even if the table is empty */
@@ -5012,6 +6152,12 @@ out:
     return ret;
 }
 
+int
+tsk_migration_table_init(tsk_migration_table_t *self, tsk_flags_t options)
+{
+    return tsk_migration_table_init_allocator(self, options, NULL);
+}
+
 int
 tsk_migration_table_append_columns(tsk_migration_table_t *self, tsk_size_t num_rows,
     const double *left, const double *right, const tsk_id_t *node,
@@ -5099,7 +6245,7 @@ tsk_migration_table_takeset_columns(tsk_migration_table_t *self, tsk_size_t num_
     self->dest = dest;
     self->time = time;
 
-    ret = takeset_ragged_column(num_rows, metadata, metadata_offset,
+    ret = takeset_ragged_column(self->allocator, num_rows, metadata, metadata_offset,
         (void *) &self->metadata, &self->metadata_offset, &self->metadata_length);
     if (ret != 0) {
         goto out;
@@ -5140,6 +6286,10 @@ tsk_migration_table_set_columns(tsk_migration_table_t *self, tsk_size_t num_rows
 {
     int ret;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_migration_table_clear(self);
     if (ret != 0) {
         goto out;
@@ -5236,6 +6386,10 @@ tsk_migration_table_update_row(tsk_migration_table_t *self, tsk_id_t index, doub
     int ret = 0;
     tsk_migration_t current_row;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_migration_table_get_row(self, index, &current_row);
     if (ret != 0) {
         goto out;
@@ -5447,6 +6601,11 @@ tsk_migration_table_keep_rows(tsk_migration_table_t *self, const tsk_bool_t *kee
     int ret = 0;
     tsk_size_t remaining_rows;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+
     if (id_map != NULL) {
         keep_mask_to_id_map(self->num_rows, keep, id_map);
     }
@@ -5462,6 +6621,7 @@ tsk_migration_table_keep_rows(tsk_migration_table_t *self, const tsk_bool_t *kee
             self->metadata, self->metadata_offset, self->num_rows, keep);
     }
     self->num_rows = remaining_rows;
+out:
     return ret;
 }
 
@@ -5491,7 +6651,8 @@ tsk_migration_table_dump(
 }
 
 static int
-tsk_migration_table_load(tsk_migration_table_t *self, kastore_t *store)
+tsk_migration_table_load(
+    tsk_migration_table_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
     tsk_id_t *source = NULL;
@@ -5516,16 +6677,16 @@ tsk_migration_table_load(tsk_migration_table_t *self, kastore_t *store)
     };
     read_table_ragged_col_t ragged_cols[] = {
         { "migrations/metadata", (void **) &metadata, &metadata_length, KAS_UINT8,
-            &metadata_offset, TSK_COL_OPTIONAL },
+            &metadata_offset, TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
     read_table_property_t properties[] = {
         { "migrations/metadata_schema", (void **) &metadata_schema,
-            &metadata_schema_length, KAS_UINT8, TSK_COL_OPTIONAL },
+            &metadata_schema_length, KAS_UINT8, TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
 
-    ret = read_table(store, &num_rows, cols, ragged_cols, properties, 0);
+    ret = read_table(store, &num_rows, cols, ragged_cols, properties, options);
     if (ret != 0) {
         goto out;
     }
@@ -5536,6 +6697,11 @@ tsk_migration_table_load(tsk_migration_table_t *self, kastore_t *store)
             goto out;
         }
     }
+    if (options & TSK_LOAD_COPY_COLUMNS) {
+        ret = tsk_migration_table_set_columns(self, num_rows, left, right, node, source,
+            dest, time, metadata, metadata_offset);
+        goto out;
+    }
     ret = tsk_migration_table_takeset_columns(self, num_rows, left, right, node, source,
         dest, time, metadata, metadata_offset);
     if (ret != 0) {
@@ -5551,7 +6717,7 @@ tsk_migration_table_load(tsk_migration_table_t *self, kastore_t *store)
     metadata_offset = NULL;
 
 out:
-    free_read_table_mem(cols, ragged_cols, properties);
+    free_read_table_mem(store, cols, ragged_cols, properties);
     return ret;
 }
 
@@ -5562,8 +6728,8 @@ out:
 static void
 tsk_population_table_free_columns(tsk_population_table_t *self)
 {
-    tsk_safe_free(self->metadata);
-    tsk_safe_free(self->metadata_offset);
+    free_column(self->allocator, self->mapped_store, (void **) &self->metadata);
+    free_column(self->allocator, self->mapped_store, (void **) &self->metadata_offset);
 }
 
 int
@@ -5581,13 +6747,17 @@ tsk_population_table_expand_main_columns(
     int ret = 0;
     tsk_size_t new_max_rows;
 
-    ret = calculate_max_rows(self->num_rows, self->max_rows, self->max_rows_increment,
-        additional_rows, &new_max_rows);
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = calculate_max_rows(self->allocator, self->num_rows, self->max_rows,
+        self->max_rows_increment, additional_rows, &new_max_rows);
     if (ret != 0) {
         goto out;
     }
     if ((self->num_rows + additional_rows) > self->max_rows) {
-        ret = expand_column(
+        ret = expand_table_column(self->allocator, self->mapped_store,
             (void **) &self->metadata_offset, new_max_rows + 1, sizeof(tsk_size_t));
         if (ret != 0) {
             goto out;
@@ -5602,9 +6772,9 @@ static int
 tsk_population_table_expand_metadata(
     tsk_population_table_t *self, tsk_size_t additional_length)
 {
-    return expand_ragged_column(self->metadata_length, additional_length,
-        self->max_metadata_length_increment, &self->max_metadata_length,
-        (void **) &self->metadata, sizeof(*self->metadata));
+    return expand_ragged_column(self->allocator, self->mapped_store,
+        self->metadata_length, additional_length, self->max_metadata_length_increment,
+        &self->max_metadata_length, (void **) &self->metadata, sizeof(*self->metadata));
 }
 
 int
@@ -5623,12 +6793,14 @@ tsk_population_table_set_max_metadata_length_increment(
     return 0;
 }
 
-int
-tsk_population_table_init(tsk_population_table_t *self, tsk_flags_t TSK_UNUSED(options))
+static int
+tsk_population_table_init_allocator(tsk_population_table_t *self,
+    tsk_flags_t TSK_UNUSED(options), const tsk_table_allocator_t *allocator)
 {
     int ret = 0;
 
     tsk_memset(self, 0, sizeof(tsk_population_table_t));
+    self->allocator = allocator;
     /* Allocate space for one row initially, ensuring we always have valid pointers
      * even if the table is empty */
     self->max_rows_increment = 1;
@@ -5649,6 +6821,12 @@ out:
     return ret;
 }
 
+int
+tsk_population_table_init(tsk_population_table_t *self, tsk_flags_t options)
+{
+    return tsk_population_table_init_allocator(self, options, NULL);
+}
+
 int TSK_WARN_UNUSED
 tsk_population_table_copy(const tsk_population_table_t *self,
     tsk_population_table_t *dest, tsk_flags_t options)
@@ -5678,6 +6856,10 @@ tsk_population_table_set_columns(tsk_population_table_t *self, tsk_size_t num_ro
 {
     int ret;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_population_table_clear(self);
     if (ret != 0) {
         goto out;
@@ -5746,7 +6928,7 @@ tsk_population_table_takeset_columns(tsk_population_table_t *self, tsk_size_t nu
     self->num_rows = num_rows;
     self->max_rows = num_rows;
 
-    ret = takeset_ragged_column(num_rows, metadata, metadata_offset,
+    ret = takeset_ragged_column(self->allocator, num_rows, metadata, metadata_offset,
         (void *) &self->metadata, &self->metadata_offset, &self->metadata_length);
     if (ret != 0) {
         goto out;
@@ -5839,6 +7021,10 @@ tsk_population_table_update_row(tsk_population_table_t *self, tsk_id_t index,
     int ret = 0;
     tsk_population_t current_row;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_population_table_get_row(self, index, &current_row);
     if (ret != 0) {
         goto out;
@@ -6040,6 +7226,11 @@ tsk_population_table_keep_rows(tsk_population_table_t *self, const tsk_bool_t *k
 {
     int ret = 0;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+
     if (id_map != NULL) {
         keep_mask_to_id_map(self->num_rows, keep, id_map);
     }
@@ -6049,6 +7240,7 @@ tsk_population_table_keep_rows(tsk_population_table_t *self, const tsk_bool_t *k
             self->metadata, self->metadata_offset, self->num_rows, keep);
     }
     self->num_rows = count_true(self->num_rows, keep);
+out:
     return ret;
 }
 
@@ -6071,7 +7263,8 @@ tsk_population_table_dump(
 }
 
 static int
-tsk_population_table_load(tsk_population_table_t *self, kastore_t *store)
+tsk_population_table_load(
+    tsk_population_table_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
     char *metadata = NULL;
@@ -6081,16 +7274,16 @@ tsk_population_table_load(tsk_population_table_t *self, kastore_t *store)
 
     read_table_ragged_col_t ragged_cols[] = {
         { "populations/metadata", (void **) &metadata, &metadata_length, KAS_UINT8,
-            &metadata_offset, 0 },
+            &metadata_offset, TSK_COL_METADATA },
         { .name = NULL },
     };
     read_table_property_t properties[] = {
         { "populations/metadata_schema", (void **) &metadata_schema,
-            &metadata_schema_length, KAS_UINT8, TSK_COL_OPTIONAL },
+            &metadata_schema_length, KAS_UINT8, TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
 
-    ret = read_table(store, &num_rows, NULL, ragged_cols, properties, 0);
+    ret = read_table(store, &num_rows, NULL, ragged_cols, properties, options);
     if (ret != 0) {
         goto out;
     }
@@ -6101,6 +7294,11 @@ tsk_population_table_load(tsk_population_table_t *self, kastore_t *store)
             goto out;
         }
     }
+    if (options & TSK_LOAD_COPY_COLUMNS) {
+        ret = tsk_population_table_set_columns(
+            self, num_rows, metadata, metadata_offset);
+        goto out;
+    }
     ret = tsk_population_table_takeset_columns(
         self, num_rows, metadata, metadata_offset);
     if (ret != 0) {
@@ -6110,7 +7308,7 @@ tsk_population_table_load(tsk_population_table_t *self, kastore_t *store)
     metadata_offset = NULL;
 
 out:
-    free_read_table_mem(NULL, ragged_cols, properties);
+    free_read_table_mem(store, NULL, ragged_cols, properties);
     return ret;
 }
 
@@ -6121,10 +7319,10 @@ out:
 static void
 tsk_provenance_table_free_columns(tsk_provenance_table_t *self)
 {
-    tsk_safe_free(self->timestamp);
-    tsk_safe_free(self->timestamp_offset);
-    tsk_safe_free(self->record);
-    tsk_safe_free(self->record_offset);
+    free_column(self->allocator, self->mapped_store, (void **) &self->timestamp);
+    free_column(self->allocator, self->mapped_store, (void **) &self->timestamp_offset);
+    free_column(self->allocator, self->mapped_store, (void **) &self->record);
+    free_column(self->allocator, self->mapped_store, (void **) &self->record_offset);
 }
 
 int
@@ -6141,18 +7339,22 @@ tsk_provenance_table_expand_main_columns(
     int ret = 0;
     tsk_size_t new_max_rows;
 
-    ret = calculate_max_rows(self->num_rows, self->max_rows, self->max_rows_increment,
-        additional_rows, &new_max_rows);
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = calculate_max_rows(self->allocator, self->num_rows, self->max_rows,
+        self->max_rows_increment, additional_rows, &new_max_rows);
     if (ret != 0) {
         goto out;
     }
     if ((self->num_rows + additional_rows) > self->max_rows) {
-        ret = expand_column(
+        ret = expand_table_column(self->allocator, self->mapped_store,
             (void **) &self->timestamp_offset, new_max_rows + 1, sizeof(tsk_size_t));
         if (ret != 0) {
             goto out;
         }
-        ret = expand_column(
+        ret = expand_table_column(self->allocator, self->mapped_store,
             (void **) &self->record_offset, new_max_rows + 1, sizeof(tsk_size_t));
         if (ret != 0) {
             goto out;
@@ -6167,17 +7369,18 @@ static int
 tsk_provenance_table_expand_timestamp(
     tsk_provenance_table_t *self, tsk_size_t additional_length)
 {
-    return expand_ragged_column(self->timestamp_length, additional_length,
-        self->max_timestamp_length_increment, &self->max_timestamp_length,
-        (void **) &self->timestamp, sizeof(*self->timestamp));
+    return expand_ragged_column(self->allocator, self->mapped_store,
+        self->timestamp_length, additional_length, self->max_timestamp_length_increment,
+        &self->max_timestamp_length, (void **) &self->timestamp,
+        sizeof(*self->timestamp));
 }
 
 static int
 tsk_provenance_table_expand_record(
     tsk_provenance_table_t *self, tsk_size_t additional_length)
 {
-    return expand_ragged_column(self->record_length, additional_length,
-        self->max_record_length_increment, &self->max_record_length,
+    return expand_ragged_column(self->allocator, self->mapped_store, self->record_length,
+        additional_length, self->max_record_length_increment, &self->max_record_length,
         (void **) &self->record, sizeof(*self->record));
 }
 
@@ -6205,12 +7408,14 @@ tsk_provenance_table_set_max_record_length_increment(
     return 0;
 }
 
-int
-tsk_provenance_table_init(tsk_provenance_table_t *self, tsk_flags_t TSK_UNUSED(options))
+static int
+tsk_provenance_table_init_allocator(tsk_provenance_table_t *self,
+    tsk_flags_t TSK_UNUSED(options), const tsk_table_allocator_t *allocator)
 {
     int ret = 0;
 
     tsk_memset(self, 0, sizeof(tsk_provenance_table_t));
+    self->allocator = allocator;
     /* Allocate space for one row initially, ensuring we always have valid pointers
      * even if the table is empty */
     self->max_rows_increment = 1;
@@ -6237,6 +7442,12 @@ out:
     return ret;
 }
 
+int
+tsk_provenance_table_init(tsk_provenance_table_t *self, tsk_flags_t options)
+{
+    return tsk_provenance_table_init_allocator(self, options, NULL);
+}
+
 int TSK_WARN_UNUSED
 tsk_provenance_table_copy(const tsk_provenance_table_t *self,
     tsk_provenance_table_t *dest, tsk_flags_t options)
@@ -6262,6 +7473,10 @@ tsk_provenance_table_set_columns(tsk_provenance_table_t *self, tsk_size_t num_ro
 {
     int ret;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_provenance_table_clear(self);
     if (ret != 0) {
         goto out;
@@ -6355,13 +7570,13 @@ tsk_provenance_table_takeset_columns(tsk_provenance_table_t *self, tsk_size_t nu
     self->num_rows = num_rows;
     self->max_rows = num_rows;
 
-    ret = takeset_ragged_column(num_rows, timestamp, timestamp_offset,
+    ret = takeset_ragged_column(self->allocator, num_rows, timestamp, timestamp_offset,
         (void *) &self->timestamp, &self->timestamp_offset, &self->timestamp_length);
     if (ret != 0) {
         goto out;
     }
-    ret = takeset_ragged_column(num_rows, record, record_offset, (void *) &self->record,
-        &self->record_offset, &self->record_length);
+    ret = takeset_ragged_column(self->allocator, num_rows, record, record_offset,
+        (void *) &self->record, &self->record_offset, &self->record_length);
     if (ret != 0) {
         goto out;
     }
@@ -6468,6 +7683,10 @@ tsk_provenance_table_update_row(tsk_provenance_table_t *self, tsk_id_t index,
     int ret = 0;
     tsk_provenance_t current_row;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_provenance_table_get_row(self, index, &current_row);
     if (ret != 0) {
         goto out;
@@ -6670,6 +7889,11 @@ tsk_provenance_table_keep_rows(tsk_provenance_table_t *self, const tsk_bool_t *k
 {
     int ret = 0;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+
     if (id_map != NULL) {
         keep_mask_to_id_map(self->num_rows, keep, id_map);
     }
@@ -6679,6 +7903,7 @@ tsk_provenance_table_keep_rows(tsk_provenance_table_t *self, const tsk_bool_t *k
         self->record, self->record_offset, self->num_rows, keep);
     self->num_rows = count_true(self->num_rows, keep);
 
+out:
     return ret;
 }
 
@@ -6698,7 +7923,8 @@ tsk_provenance_table_dump(
 }
 
 static int
-tsk_provenance_table_load(tsk_provenance_table_t *self, kastore_t *store)
+tsk_provenance_table_load(
+    tsk_provenance_table_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret;
     char *timestamp = NULL;
@@ -6715,10 +7941,15 @@ tsk_provenance_table_load(tsk_provenance_table_t *self, kastore_t *store)
         { .name = NULL },
     };
 
-    ret = read_table(store, &num_rows, NULL, ragged_cols, NULL, 0);
+    ret = read_table(store, &num_rows, NULL, ragged_cols, NULL, options);
     if (ret != 0) {
         goto out;
     }
+    if (options & TSK_LOAD_COPY_COLUMNS) {
+        ret = tsk_provenance_table_set_columns(
+            self, num_rows, timestamp, timestamp_offset, record, record_offset);
+        goto out;
+    }
     ret = tsk_provenance_table_takeset_columns(
         self, num_rows, timestamp, timestamp_offset, record, record_offset);
     if (ret != 0) {
@@ -6730,7 +7961,7 @@ tsk_provenance_table_load(tsk_provenance_table_t *self, kastore_t *store)
     record_offset = NULL;
 
 out:
-    free_read_table_mem(NULL, ragged_cols, NULL);
+    free_read_table_mem(store, NULL, ragged_cols, NULL);
     return ret;
 }
 
@@ -6925,8 +8156,9 @@ tsk_table_sorter_sort_edges(tsk_table_sorter_t *self, tsk_size_t start)
         }
     }
     qsort(sorted_edges, (size_t) n, sizeof(edge_sort_t), cmp_edge);
-    /* Copy the edges back into the table. */
-    metadata_offset = 0;
+    /* Copy the edges back into the table, leaving the metadata of the
+     * edges before start in place. */
+    metadata_offset = has_metadata ? edges->metadata_offset[start] : 0;
     for (j = 0; j < n; j++) {
         e = sorted_edges + j;
         k = start + j;
@@ -6947,8 +8179,411 @@ out:
     return ret;
 }
 
-static int
-tsk_table_sorter_sort_migrations(tsk_table_sorter_t *self, tsk_size_t start)
+/* The parallel edge sort orders parents by (time, ID), and packs the rank
+ * of the parent in this order and the child ID into a single integer key,
+ * which is sorted with a parallel least-significant-digit radix sort. As the
+ * radix sort is stable, edges with the same parent and child are left in
+ * their input order, and are then sorted by left coordinate. */
+
+#define EDGE_RADIX_BITS 8
+#define EDGE_RADIX_SIZE (1 << EDGE_RADIX_BITS)
+
+typedef struct {
+    uint64_t key;
+    tsk_size_t index;
+} edge_radix_key_t;
+
+typedef struct {
+    double time;
+    tsk_id_t id;
+} node_rank_sort_t;
+
+typedef struct {
+    tsk_size_t num_threads;
+    tsk_size_t num_edges;
+    tsk_size_t start;
+    tsk_edge_table_t *edges;
+    const tsk_id_t *node_rank;
+    unsigned int child_bits;
+    unsigned int shift;
+    edge_radix_key_t *keys;
+    edge_radix_key_t *buffer;
+    /* The bucket counts for each thread, which are converted into the
+     * offset of the thread's first key in each bucket before scattering */
+    tsk_size_t *counts;
+    double *left;
+    double *right;
+    tsk_id_t *parent;
+    tsk_id_t *child;
+    /* Copies of the metadata and offsets of the edges being sorted, if any */
+    char *metadata;
+    tsk_size_t *metadata_offset;
+} edge_radix_sort_t;
+
+static int
+cmp_node_rank(const void *a, const void *b)
+{
+    const node_rank_sort_t *ia = (const node_rank_sort_t *) a;
+    const node_rank_sort_t *ib = (const node_rank_sort_t *) b;
+    int ret = (ia->time > ib->time) - (ia->time < ib->time);
+
+    if (ret == 0) {
+        ret = (ia->id > ib->id) - (ia->id < ib->id);
+    }
+    return ret;
+}
+
+static int
+cmp_edge_radix_left(const void *a, const void *b)
+{
+    const edge_sort_t *ca = (const edge_sort_t *) a;
+    const edge_sort_t *cb = (const edge_sort_t *) b;
+    int ret = (ca->left > cb->left) - (ca->left < cb->left);
+
+    if (ret == 0) {
+        /* Keep the input order of identical edges, like the radix sort */
+        ret = (ca->metadata_offset > cb->metadata_offset)
+              - (ca->metadata_offset < cb->metadata_offset);
+    }
+    return ret;
+}
+
+static void
+edge_radix_sort_chunk(const edge_radix_sort_t *self, tsk_size_t thread_index,
+    tsk_size_t *chunk_start, tsk_size_t *chunk_end)
+{
+    *chunk_start = self->num_edges * thread_index / self->num_threads;
+    *chunk_end = self->num_edges * (thread_index + 1) / self->num_threads;
+}
+
+static void
+edge_radix_sort_make_keys(void *arg, tsk_size_t thread_index)
+{
+    edge_radix_sort_t *self = (edge_radix_sort_t *) arg;
+    const tsk_edge_table_t *edges = self->edges;
+    tsk_size_t j, k, chunk_start, chunk_end;
+
+    edge_radix_sort_chunk(self, thread_index, &chunk_start, &chunk_end);
+    for (j = chunk_start; j < chunk_end; j++) {
+        k = self->start + j;
+        self->keys[j].key
+            = ((uint64_t) self->node_rank[edges->parent[k]] << self->child_bits)
+              | (uint64_t) edges->child[k];
+        self->keys[j].index = j;
+        self->left[j] = edges->left[k];
+        self->right[j] = edges->right[k];
+        self->parent[j] = edges->parent[k];
+        self->child[j] = edges->child[k];
+    }
+}
+
+static void
+edge_radix_sort_count(void *arg, tsk_size_t thread_index)
+{
+    edge_radix_sort_t *self = (edge_radix_sort_t *) arg;
+    tsk_size_t *restrict counts = self->counts + thread_index * EDGE_RADIX_SIZE;
+    const edge_radix_key_t *restrict keys = self->keys;
+    const unsigned int shift = self->shift;
+    tsk_size_t j, chunk_start, chunk_end;
+
+    edge_radix_sort_chunk(self, thread_index, &chunk_start, &chunk_end);
+    tsk_memset(counts, 0, EDGE_RADIX_SIZE * sizeof(*counts));
+    for (j = chunk_start; j < chunk_end; j++) {
+        counts[(keys[j].key >> shift) & (EDGE_RADIX_SIZE - 1)]++;
+    }
+}
+
+static void
+edge_radix_sort_scatter(void *arg, tsk_size_t thread_index)
+{
+    edge_radix_sort_t *self = (edge_radix_sort_t *) arg;
+    tsk_size_t *restrict offsets = self->counts + thread_index * EDGE_RADIX_SIZE;
+    const edge_radix_key_t *restrict keys = self->keys;
+    edge_radix_key_t *restrict buffer = self->buffer;
+    const unsigned int shift = self->shift;
+    tsk_size_t j, chunk_start, chunk_end;
+
+    edge_radix_sort_chunk(self, thread_index, &chunk_start, &chunk_end);
+    for (j = chunk_start; j < chunk_end; j++) {
+        buffer[offsets[(keys[j].key >> shift) & (EDGE_RADIX_SIZE - 1)]++] = keys[j];
+    }
+}
+
+static void
+edge_radix_sort_gather(void *arg, tsk_size_t thread_index)
+{
+    edge_radix_sort_t *self = (edge_radix_sort_t *) arg;
+    tsk_edge_table_t *edges = self->edges;
+    tsk_size_t j, k, l, chunk_start, chunk_end;
+
+    edge_radix_sort_chunk(self, thread_index, &chunk_start, &chunk_end);
+    for (j = chunk_start; j < chunk_end; j++) {
+        k = self->start + j;
+        l = self->keys[j].index;
+        edges->left[k] = self->left[l];
+        edges->right[k] = self->right[l];
+        edges->parent[k] = self->parent[l];
+        edges->child[k] = self->child[l];
+    }
+}
+
+static void
+edge_radix_sort_gather_metadata(edge_radix_sort_t *self)
+{
+    tsk_edge_table_t *edges = self->edges;
+    const tsk_size_t *old_offset = self->metadata_offset;
+    tsk_size_t j, k, l, length;
+    tsk_size_t offset = old_offset[0];
+
+    for (j = 0; j < self->num_edges; j++) {
+        k = self->start + j;
+        l = self->keys[j].index;
+        length = old_offset[l + 1] - old_offset[l];
+        tsk_memcpy(edges->metadata + offset,
+            self->metadata + old_offset[l] - old_offset[0], length);
+        edges->metadata_offset[k] = offset;
+        offset += length;
+    }
+}
+
+/* Compute the rank of each node when ordered by (time, ID), which is the
+ * order of the parents of sorted edges. */
+static int
+edge_radix_sort_rank_nodes(const tsk_node_table_t *nodes, tsk_id_t *node_rank)
+{
+    int ret = 0;
+    tsk_size_t j;
+    node_rank_sort_t *sorted_nodes = tsk_malloc(nodes->num_rows * sizeof(*sorted_nodes));
+
+    if (sorted_nodes == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    for (j = 0; j < nodes->num_rows; j++) {
+        sorted_nodes[j].time = nodes->time[j];
+        sorted_nodes[j].id = (tsk_id_t) j;
+    }
+    qsort(sorted_nodes, (size_t) nodes->num_rows, sizeof(*sorted_nodes), cmp_node_rank);
+    for (j = 0; j < nodes->num_rows; j++) {
+        node_rank[sorted_nodes[j].id] = (tsk_id_t) j;
+    }
+out:
+    tsk_safe_free(sorted_nodes);
+    return ret;
+}
+
+/* Sort runs of keys with the same parent and child by left coordinate. */
+static int
+edge_radix_sort_runs(edge_radix_sort_t *self)
+{
+    int ret = 0;
+    tsk_size_t j, k, run_start;
+    tsk_size_t max_run_length = 0;
+    edge_sort_t *run = NULL;
+    edge_radix_key_t *keys = self->keys;
+
+    for (run_start = 0; run_start < self->num_edges; run_start = j) {
+        j = run_start + 1;
+        while (j < self->num_edges && keys[j].key == keys[run_start].key) {
+            j++;
+        }
+        if (j - run_start == 1) {
+            continue;
+        }
+        if (j - run_start > max_run_length) {
+            max_run_length = j - run_start;
+            tsk_safe_free(run);
+            run = tsk_malloc(max_run_length * sizeof(*run));
+            if (run == NULL) {
+                ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+                goto out;
+            }
+        }
+        for (k = run_start; k < j; k++) {
+            run[k - run_start].left = self->left[keys[k].index];
+            /* Use the metadata offset to hold the original index */
+            run[k - run_start].metadata_offset = keys[k].index;
+        }
+        qsort(run, (size_t) (j - run_start), sizeof(*run), cmp_edge_radix_left);
+        for (k = run_start; k < j; k++) {
+            keys[k].index = run[k - run_start].metadata_offset;
+        }
+    }
+out:
+    tsk_safe_free(run);
+    return ret;
+}
+
+/* Sort the lowest key_bits bits of the keys, leaving the result in
+ * self->keys. */
+static int
+edge_radix_sort_keys(edge_radix_sort_t *self, unsigned int key_bits)
+{
+    int ret = 0;
+    tsk_size_t j, k, total, bucket, bucket_start;
+    edge_radix_key_t *tmp;
+    bool skip;
+
+    for (self->shift = 0; self->shift < key_bits; self->shift += EDGE_RADIX_BITS) {
+        ret = tsk_thread_run_parallel(self->num_threads, edge_radix_sort_count, self);
+        if (ret != 0) {
+            goto out;
+        }
+        /* Convert the counts into offsets, skipping the pass if all of the
+         * keys have the same digit. */
+        total = 0;
+        skip = false;
+        for (bucket = 0; bucket < EDGE_RADIX_SIZE; bucket++) {
+            bucket_start = total;
+            for (k = 0; k < self->num_threads; k++) {
+                j = self->counts[k * EDGE_RADIX_SIZE + bucket];
+                self->counts[k * EDGE_RADIX_SIZE + bucket] = total;
+                total += j;
+            }
+            skip = skip || total - bucket_start == self->num_edges;
+        }
+        if (!skip) {
+            ret = tsk_thread_run_parallel(
+                self->num_threads, edge_radix_sort_scatter, self);
+            if (ret != 0) {
+                goto out;
+            }
+            tmp = self->keys;
+            self->keys = self->buffer;
+            self->buffer = tmp;
+        }
+    }
+out:
+    return ret;
+}
+
+static int
+edge_radix_sort_run(edge_radix_sort_t *self)
+{
+    int ret = 0;
+
+    ret = tsk_thread_run_parallel(self->num_threads, edge_radix_sort_make_keys, self);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = edge_radix_sort_keys(self, self->child_bits * 2);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = edge_radix_sort_runs(self);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_thread_run_parallel(self->num_threads, edge_radix_sort_gather, self);
+    if (ret != 0) {
+        goto out;
+    }
+    if (self->metadata != NULL) {
+        edge_radix_sort_gather_metadata(self);
+    }
+out:
+    return ret;
+}
+
+int
+tsk_table_sorter_sort_edges_parallel(tsk_table_sorter_t *self, tsk_size_t start)
+{
+    int ret = 0;
+    tsk_edge_table_t *edges = &self->tables->edges;
+    const tsk_size_t num_nodes = self->tables->nodes.num_rows;
+    tsk_size_t num_threads = TSK_MAX(self->num_threads, 1);
+    tsk_size_t n = edges->num_rows - start;
+    tsk_id_t *node_rank = NULL;
+    edge_radix_sort_t sort;
+    edge_radix_key_t *keys = NULL;
+    edge_radix_key_t *buffer = NULL;
+    double *left = NULL;
+    double *right = NULL;
+    tsk_id_t *parent = NULL;
+    tsk_id_t *child = NULL;
+    tsk_size_t *counts = NULL;
+    char *metadata = NULL;
+    tsk_size_t *metadata_offset = NULL;
+    tsk_size_t metadata_length;
+
+    tsk_memset(&sort, 0, sizeof(sort));
+    if (tsk_edge_table_has_metadata(edges)) {
+        metadata_length = edges->metadata_length - edges->metadata_offset[start];
+    } else {
+        metadata_length = 0;
+    }
+    /* Edges without metadata have zero length offsets, which are unchanged */
+    if (metadata_length > 0) {
+        metadata = tsk_malloc(metadata_length);
+        metadata_offset = tsk_malloc((n + 1) * sizeof(*metadata_offset));
+        if (metadata == NULL || metadata_offset == NULL) {
+            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+            goto out;
+        }
+        tsk_memcpy(metadata, edges->metadata + edges->metadata_offset[start],
+            metadata_length);
+        tsk_memcpy(metadata_offset, edges->metadata_offset + start,
+            (n + 1) * sizeof(*metadata_offset));
+        sort.metadata = metadata;
+        sort.metadata_offset = metadata_offset;
+    }
+    /* Don't use more threads than there is work for */
+    num_threads = TSK_MIN(num_threads, n / 4096 + 1);
+
+    node_rank = tsk_malloc(num_nodes * sizeof(*node_rank));
+    keys = tsk_malloc(n * sizeof(*keys));
+    buffer = tsk_malloc(n * sizeof(*buffer));
+    left = tsk_malloc(n * sizeof(*left));
+    right = tsk_malloc(n * sizeof(*right));
+    parent = tsk_malloc(n * sizeof(*parent));
+    child = tsk_malloc(n * sizeof(*child));
+    counts = tsk_malloc(num_threads * EDGE_RADIX_SIZE * sizeof(*counts));
+    if (node_rank == NULL || keys == NULL || buffer == NULL || left == NULL
+        || right == NULL || parent == NULL || child == NULL || counts == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    ret = edge_radix_sort_rank_nodes(&self->tables->nodes, node_rank);
+    if (ret != 0) {
+        goto out;
+    }
+
+    sort.num_threads = num_threads;
+    sort.num_edges = n;
+    sort.start = start;
+    sort.edges = edges;
+    sort.node_rank = node_rank;
+    /* Node IDs and ranks both fit in this many bits */
+    while (sort.child_bits < 32 && ((tsk_size_t) 1 << sort.child_bits) < num_nodes) {
+        sort.child_bits++;
+    }
+    sort.keys = keys;
+    sort.buffer = buffer;
+    sort.counts = counts;
+    sort.left = left;
+    sort.right = right;
+    sort.parent = parent;
+    sort.child = child;
+    ret = edge_radix_sort_run(&sort);
+    /* The keys and buffer may have been swapped */
+    keys = sort.keys;
+    buffer = sort.buffer;
+out:
+    tsk_safe_free(node_rank);
+    tsk_safe_free(keys);
+    tsk_safe_free(buffer);
+    tsk_safe_free(left);
+    tsk_safe_free(right);
+    tsk_safe_free(parent);
+    tsk_safe_free(child);
+    tsk_safe_free(counts);
+    tsk_safe_free(metadata);
+    tsk_safe_free(metadata_offset);
+    return ret;
+}
+
+static int
+tsk_table_sorter_sort_migrations(tsk_table_sorter_t *self, tsk_size_t start)
 {
     int ret = 0;
     const tsk_migration_table_t *migrations = &self->tables->migrations;
@@ -7046,28 +8681,17 @@ out:
     return ret;
 }
 
+/* Fill in the sort keys for the mutations in the specified table, mapping
+ * the site IDs through the sorter's site_id_map. */
 static int
-tsk_table_sorter_sort_mutations(tsk_table_sorter_t *self)
+tsk_table_sorter_make_mutation_keys(tsk_table_sorter_t *self,
+    const tsk_mutation_table_t *mutations, mutation_sort_t *sorted_mutations)
 {
     int ret = 0;
     tsk_size_t j;
-    tsk_id_t ret_id, parent, mapped_parent, p;
-    tsk_mutation_table_t *mutations = &self->tables->mutations;
-    tsk_node_table_t *nodes = &self->tables->nodes;
+    tsk_id_t p;
+    const tsk_node_table_t *nodes = &self->tables->nodes;
     tsk_size_t num_mutations = mutations->num_rows;
-    tsk_mutation_table_t copy;
-    mutation_sort_t *sorted_mutations
-        = tsk_malloc(num_mutations * sizeof(*sorted_mutations));
-    tsk_id_t *mutation_id_map = tsk_malloc(num_mutations * sizeof(*mutation_id_map));
-
-    ret = tsk_mutation_table_copy(mutations, &copy, 0);
-    if (ret != 0) {
-        goto out;
-    }
-    if (mutation_id_map == NULL || sorted_mutations == NULL) {
-        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
-        goto out;
-    }
 
     /* compute numbers of descendants for each mutation */
     for (j = 0; j < num_mutations; j++) {
@@ -7086,18 +8710,32 @@ tsk_table_sorter_sort_mutations(tsk_table_sorter_t *self)
     }
 
     for (j = 0; j < num_mutations; j++) {
-        tsk_mutation_table_get_row_unsafe(&copy, (tsk_id_t) j, &sorted_mutations[j].mut);
+        tsk_mutation_table_get_row_unsafe(
+            mutations, (tsk_id_t) j, &sorted_mutations[j].mut);
         sorted_mutations[j].mut.site = self->site_id_map[sorted_mutations[j].mut.site];
         sorted_mutations[j].node_time = nodes->time[sorted_mutations[j].mut.node];
     }
+out:
+    return ret;
+}
+
+/* Replace the rows of the sorter's mutation table with the specified sorted
+ * mutations, mapping the parent IDs to their new values. */
+static int
+tsk_table_sorter_write_mutations(tsk_table_sorter_t *self,
+    const mutation_sort_t *sorted_mutations, tsk_id_t *mutation_id_map)
+{
+    int ret = 0;
+    tsk_size_t j;
+    tsk_id_t ret_id, parent, mapped_parent;
+    tsk_mutation_table_t *mutations = &self->tables->mutations;
+    tsk_size_t num_mutations = mutations->num_rows;
+
     ret = tsk_mutation_table_clear(mutations);
     if (ret != 0) {
         goto out;
     }
 
-    qsort(sorted_mutations, (size_t) num_mutations, sizeof(*sorted_mutations),
-        cmp_mutation);
-
     /* Make a first pass through the sorted mutations to build the ID map. */
     for (j = 0; j < num_mutations; j++) {
         mutation_id_map[sorted_mutations[j].mut.id] = (tsk_id_t) j;
@@ -7120,7 +8758,36 @@ tsk_table_sorter_sort_mutations(tsk_table_sorter_t *self)
         }
     }
     ret = 0;
+out:
+    return ret;
+}
+
+static int
+tsk_table_sorter_sort_mutations(tsk_table_sorter_t *self)
+{
+    int ret = 0;
+    tsk_mutation_table_t *mutations = &self->tables->mutations;
+    tsk_size_t num_mutations = mutations->num_rows;
+    tsk_mutation_table_t copy;
+    mutation_sort_t *sorted_mutations
+        = tsk_malloc(num_mutations * sizeof(*sorted_mutations));
+    tsk_id_t *mutation_id_map = tsk_malloc(num_mutations * sizeof(*mutation_id_map));
 
+    ret = tsk_mutation_table_copy(mutations, &copy, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    if (mutation_id_map == NULL || sorted_mutations == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    ret = tsk_table_sorter_make_mutation_keys(self, &copy, sorted_mutations);
+    if (ret != 0) {
+        goto out;
+    }
+    qsort(sorted_mutations, (size_t) num_mutations, sizeof(*sorted_mutations),
+        cmp_mutation);
+    ret = tsk_table_sorter_write_mutations(self, sorted_mutations, mutation_id_map);
 out:
     tsk_safe_free(mutation_id_map);
     tsk_safe_free(sorted_mutations);
@@ -7128,42 +8795,260 @@ out:
     return ret;
 }
 
+/* The merge sort functions are used with TSK_SORT_MERGE, and sort the rows
+ * from start onwards before merging them with the rows before start in a
+ * single linear pass. The rows before start should already be sorted; if
+ * they are not (for example, because rows added after start change the
+ * number of descendants of earlier mutations) they are sorted as well, so
+ * that the result is always the same as a full sort. This is also the case
+ * when there are no rows after start. */
+
 static int
-tsk_individual_table_topological_sort(
-    tsk_individual_table_t *self, tsk_id_t *traversal_order, tsk_size_t *num_descendants)
+tsk_table_sorter_merge_edges(tsk_table_sorter_t *self, tsk_size_t start)
 {
     int ret = 0;
-    tsk_id_t i, j, p;
-    tsk_individual_t individual;
-    tsk_size_t num_individuals = self->num_rows;
-    tsk_size_t current_todo = 0;
-    tsk_size_t todo_insertion_point = 0;
-    tsk_size_t *incoming_edge_count
-        = tsk_malloc(num_individuals * sizeof(*incoming_edge_count));
-    bool count_descendants = (num_descendants != NULL);
-
-    if (incoming_edge_count == NULL) {
+    tsk_edge_table_t *edges = &self->tables->edges;
+    const double *restrict node_time = self->tables->nodes.time;
+    bool has_metadata = tsk_edge_table_has_metadata(edges);
+    tsk_size_t num_edges = edges->num_rows;
+    tsk_size_t prefix_metadata_length
+        = has_metadata ? edges->metadata_offset[start] : 0;
+    edge_sort_t *prefix = tsk_malloc(start * sizeof(*prefix));
+    char *prefix_metadata = tsk_malloc(prefix_metadata_length);
+    edge_sort_t suffix_edge;
+    const edge_sort_t *e;
+    const char *metadata;
+    tsk_size_t j, k, out, metadata_offset;
+    bool sorted = true;
+
+    if (prefix == NULL || prefix_metadata == NULL) {
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
-
-    for (i = 0; i < (tsk_id_t) num_individuals; i++) {
-        incoming_edge_count[i] = 0;
-        traversal_order[i] = TSK_NULL;
-        if (count_descendants) {
-            num_descendants[i] = 0;
+    tsk_memset(&suffix_edge, 0, sizeof(suffix_edge));
+    tsk_memcpy(prefix_metadata, edges->metadata, prefix_metadata_length);
+    for (j = 0; j < start; j++) {
+        prefix[j].left = edges->left[j];
+        prefix[j].right = edges->right[j];
+        prefix[j].parent = edges->parent[j];
+        prefix[j].child = edges->child[j];
+        prefix[j].time = node_time[prefix[j].parent];
+        if (has_metadata) {
+            prefix[j].metadata_offset = edges->metadata_offset[j];
+            prefix[j].metadata_length
+                = edges->metadata_offset[j + 1] - edges->metadata_offset[j];
         }
-    }
-
-    /* First find the set of individuals that have no children by creating
-     * an array of incoming edge counts */
-    for (i = 0; i < (tsk_id_t) self->parents_length; i++) {
-        if (self->parents[i] != TSK_NULL) {
-            incoming_edge_count[self->parents[i]]++;
+        if (j > 0 && cmp_edge(prefix + j - 1, prefix + j) > 0) {
+            sorted = false;
         }
     }
-    /* Use these as the starting points for checking all individuals,
-     * doing this in reverse makes the sort stable */
+    if (!sorted) {
+        qsort(prefix, (size_t) start, sizeof(*prefix), cmp_edge);
+    } else if (start == num_edges) {
+        goto out;
+    }
+
+    /* The rows are merged in place, reading the suffix from the table. The
+     * output position never passes the next unread suffix row, and once the
+     * prefix is exhausted the remaining suffix rows are already in place. */
+    j = 0;
+    k = start;
+    out = 0;
+    metadata_offset = 0;
+    while (j < start) {
+        if (k < num_edges) {
+            suffix_edge.left = edges->left[k];
+            suffix_edge.right = edges->right[k];
+            suffix_edge.parent = edges->parent[k];
+            suffix_edge.child = edges->child[k];
+            suffix_edge.time = node_time[suffix_edge.parent];
+            if (has_metadata) {
+                suffix_edge.metadata_offset = edges->metadata_offset[k];
+                suffix_edge.metadata_length
+                    = edges->metadata_offset[k + 1] - edges->metadata_offset[k];
+            }
+        }
+        if (k == num_edges || cmp_edge(prefix + j, &suffix_edge) <= 0) {
+            e = prefix + j;
+            metadata = prefix_metadata;
+            j++;
+        } else {
+            e = &suffix_edge;
+            metadata = edges->metadata;
+            k++;
+        }
+        edges->left[out] = e->left;
+        edges->right[out] = e->right;
+        edges->parent[out] = e->parent;
+        edges->child[out] = e->child;
+        if (has_metadata) {
+            tsk_memmove(edges->metadata + metadata_offset,
+                metadata + e->metadata_offset, e->metadata_length);
+            edges->metadata_offset[out] = metadata_offset;
+            metadata_offset += e->metadata_length;
+        }
+        out++;
+    }
+out:
+    tsk_safe_free(prefix);
+    tsk_safe_free(prefix_metadata);
+    return ret;
+}
+
+static int
+tsk_table_sorter_merge_sites(tsk_table_sorter_t *self, tsk_size_t start)
+{
+    int ret = 0;
+    tsk_id_t ret_id;
+    tsk_site_table_t *sites = &self->tables->sites;
+    tsk_site_table_t copy;
+    tsk_size_t j, k, out;
+    tsk_size_t num_sites = sites->num_rows;
+    tsk_site_t *sorted_sites = tsk_malloc(num_sites * sizeof(*sorted_sites));
+    const tsk_site_t *site;
+    bool sorted = true;
+
+    ret = tsk_site_table_copy(sites, &copy, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    if (sorted_sites == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    for (j = 0; j < num_sites; j++) {
+        tsk_site_table_get_row_unsafe(&copy, (tsk_id_t) j, sorted_sites + j);
+        if (j > 0 && j < start && cmp_site(sorted_sites + j - 1, sorted_sites + j) > 0) {
+            sorted = false;
+        }
+    }
+    if (!sorted) {
+        qsort(sorted_sites, (size_t) start, sizeof(*sorted_sites), cmp_site);
+    }
+    qsort(sorted_sites + start, (size_t) (num_sites - start), sizeof(*sorted_sites),
+        cmp_site);
+
+    tsk_site_table_clear(sites);
+    j = 0;
+    k = start;
+    for (out = 0; out < num_sites; out++) {
+        if (k == num_sites
+            || (j < start && cmp_site(sorted_sites + j, sorted_sites + k) <= 0)) {
+            site = sorted_sites + j;
+            j++;
+        } else {
+            site = sorted_sites + k;
+            k++;
+        }
+        self->site_id_map[site->id] = (tsk_id_t) out;
+        ret_id = tsk_site_table_add_row(sites, site->position, site->ancestral_state,
+            site->ancestral_state_length, site->metadata, site->metadata_length);
+        if (ret_id < 0) {
+            ret = (int) ret_id;
+            goto out;
+        }
+    }
+out:
+    tsk_safe_free(sorted_sites);
+    tsk_site_table_free(&copy);
+    return ret;
+}
+
+static int
+tsk_table_sorter_merge_mutations(tsk_table_sorter_t *self, tsk_size_t start)
+{
+    int ret = 0;
+    tsk_mutation_table_t *mutations = &self->tables->mutations;
+    tsk_size_t num_mutations = mutations->num_rows;
+    tsk_mutation_table_t copy;
+    tsk_size_t j, k, out;
+    mutation_sort_t *keys = tsk_malloc(num_mutations * sizeof(*keys));
+    mutation_sort_t *sorted_mutations
+        = tsk_malloc(num_mutations * sizeof(*sorted_mutations));
+    tsk_id_t *mutation_id_map = tsk_malloc(num_mutations * sizeof(*mutation_id_map));
+    bool sorted = true;
+
+    ret = tsk_mutation_table_copy(mutations, &copy, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    if (keys == NULL || sorted_mutations == NULL || mutation_id_map == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    ret = tsk_table_sorter_make_mutation_keys(self, &copy, keys);
+    if (ret != 0) {
+        goto out;
+    }
+    for (j = 1; j < start; j++) {
+        if (cmp_mutation(keys + j - 1, keys + j) > 0) {
+            sorted = false;
+            break;
+        }
+    }
+    if (!sorted) {
+        qsort(keys, (size_t) start, sizeof(*keys), cmp_mutation);
+    }
+    qsort(keys + start, (size_t) (num_mutations - start), sizeof(*keys),
+        cmp_mutation);
+
+    j = 0;
+    k = start;
+    for (out = 0; out < num_mutations; out++) {
+        if (k == num_mutations
+            || (j < start && cmp_mutation(keys + j, keys + k) <= 0)) {
+            sorted_mutations[out] = keys[j];
+            j++;
+        } else {
+            sorted_mutations[out] = keys[k];
+            k++;
+        }
+    }
+    ret = tsk_table_sorter_write_mutations(self, sorted_mutations, mutation_id_map);
+out:
+    tsk_safe_free(keys);
+    tsk_safe_free(sorted_mutations);
+    tsk_safe_free(mutation_id_map);
+    tsk_mutation_table_free(&copy);
+    return ret;
+}
+
+static int
+tsk_individual_table_topological_sort(
+    tsk_individual_table_t *self, tsk_id_t *traversal_order, tsk_size_t *num_descendants)
+{
+    int ret = 0;
+    tsk_id_t i, j, p;
+    tsk_individual_t individual;
+    tsk_size_t num_individuals = self->num_rows;
+    tsk_size_t current_todo = 0;
+    tsk_size_t todo_insertion_point = 0;
+    tsk_size_t *incoming_edge_count
+        = tsk_malloc(num_individuals * sizeof(*incoming_edge_count));
+    bool count_descendants = (num_descendants != NULL);
+
+    if (incoming_edge_count == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+
+    for (i = 0; i < (tsk_id_t) num_individuals; i++) {
+        incoming_edge_count[i] = 0;
+        traversal_order[i] = TSK_NULL;
+        if (count_descendants) {
+            num_descendants[i] = 0;
+        }
+    }
+
+    /* First find the set of individuals that have no children by creating
+     * an array of incoming edge counts */
+    for (i = 0; i < (tsk_id_t) self->parents_length; i++) {
+        if (self->parents[i] != TSK_NULL) {
+            incoming_edge_count[self->parents[i]]++;
+        }
+    }
+    /* Use these as the starting points for checking all individuals,
+     * doing this in reverse makes the sort stable */
     for (i = (tsk_id_t) num_individuals - 1; i >= 0; i--) {
         if (incoming_edge_count[i] == 0) {
             traversal_order[todo_insertion_point] = i;
@@ -7386,8 +9271,11 @@ tsk_table_sorter_run(tsk_table_sorter_t *self, const tsk_bookmark_t *start)
     int ret = 0;
     tsk_size_t edge_start = 0;
     tsk_size_t migration_start = 0;
+    tsk_size_t site_start = 0;
+    tsk_size_t mutation_start = 0;
     bool skip_sites = false;
     bool skip_individuals = false;
+    bool merge = !!(self->options & TSK_SORT_MERGE);
 
     if (start != NULL) {
         if (start->edges > self->tables->edges.num_rows) {
@@ -7401,12 +9289,23 @@ tsk_table_sorter_run(tsk_table_sorter_t *self, const tsk_bookmark_t *start)
         }
         migration_start = start->migrations;
 
-        /* We only allow sites and mutations to be specified as a way to
-         * skip sorting them entirely. Both sites and mutations must be
-         * equal to the number of rows */
-        if (start->sites == self->tables->sites.num_rows
+        /* Unless we are merging, we only allow sites and mutations to be
+         * specified as a way to skip sorting them entirely. Both sites and
+         * mutations must be equal to the number of rows */
+        if (!merge && start->sites == self->tables->sites.num_rows
             && start->mutations == self->tables->mutations.num_rows) {
             skip_sites = true;
+        } else if (merge) {
+            if (start->sites > self->tables->sites.num_rows) {
+                ret = tsk_trace_error(TSK_ERR_SITE_OUT_OF_BOUNDS);
+                goto out;
+            }
+            if (start->mutations > self->tables->mutations.num_rows) {
+                ret = tsk_trace_error(TSK_ERR_MUTATION_OUT_OF_BOUNDS);
+                goto out;
+            }
+            site_start = start->sites;
+            mutation_start = start->mutations;
         } else if (start->sites != 0 || start->mutations != 0) {
             ret = tsk_trace_error(TSK_ERR_SORT_OFFSET_NOT_SUPPORTED);
             goto out;
@@ -7423,6 +9322,12 @@ tsk_table_sorter_run(tsk_table_sorter_t *self, const tsk_bookmark_t *start)
         if (ret != 0) {
             goto out;
         }
+        if (merge && edge_start > 0) {
+            ret = tsk_table_sorter_merge_edges(self, edge_start);
+            if (ret != 0) {
+                goto out;
+            }
+        }
     }
     /* Avoid calling sort_migrations in the common case when it's a no-op */
     if (self->tables->migrations.num_rows > 0) {
@@ -7432,11 +9337,21 @@ tsk_table_sorter_run(tsk_table_sorter_t *self, const tsk_bookmark_t *start)
         }
     }
     if (!skip_sites) {
-        ret = tsk_table_sorter_sort_sites(self);
+        if (site_start > 0) {
+            ret = tsk_table_sorter_merge_sites(self, site_start);
+        } else {
+            ret = tsk_table_sorter_sort_sites(self);
+        }
         if (ret != 0) {
             goto out;
         }
-        ret = self->sort_mutations(self);
+        /* Custom mutation sorting functions always sort the full table */
+        if (mutation_start > 0
+            && self->sort_mutations == tsk_table_sorter_sort_mutations) {
+            ret = tsk_table_sorter_merge_mutations(self, mutation_start);
+        } else {
+            ret = self->sort_mutations(self);
+        }
         if (ret != 0) {
             goto out;
         }
@@ -7459,6 +9374,11 @@ tsk_table_sorter_init(
     tsk_id_t ret_id;
 
     tsk_memset(self, 0, sizeof(tsk_table_sorter_t));
+    self->options = options;
+    ret = check_table_writable(tables->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     if (!(options & TSK_NO_CHECK_INTEGRITY)) {
         ret_id = tsk_table_collection_check_integrity(tables, 0);
         if (ret_id != 0) {
@@ -7476,6 +9396,7 @@ tsk_table_sorter_init(
 
     /* Set the sort_edges and sort_mutations methods to the default. */
     self->sort_edges = tsk_table_sorter_sort_edges;
+    self->num_threads = 1;
     self->sort_mutations = tsk_table_sorter_sort_mutations;
     /* Default sort doesn't touch individuals */
     self->sort_individuals = NULL;
@@ -7527,7 +9448,7 @@ typedef struct {
     tsk_segment_t **overlapping;
 } segment_overlapper_t;
 
-typedef struct {
+typedef struct _simplifier_t {
     tsk_size_t num_samples;
     tsk_flags_t options;
     tsk_table_collection_t *tables;
@@ -7545,6 +9466,11 @@ typedef struct {
     tsk_size_t max_segment_queue_size;
     segment_overlapper_t segment_overlapper;
     tsk_blkalloc_t segment_heap;
+    /* Segments that are no longer part of any ancestry are kept in a free
+     * list and reused, so that the heap only grows with the live ancestry. */
+    tsk_segment_t *segment_free_list;
+    tsk_size_t num_segments;
+    tsk_size_t max_num_segments;
     /* Buffer for output edges. For each child we keep a linked list of
      * intervals, and also store the actual children that have been buffered. */
     tsk_blkalloc_t interval_list_heap;
@@ -7562,6 +9488,9 @@ typedef struct {
      * sites.*/
     double *position_lookup;
     int64_t edge_sort_offset;
+    /* The number of nodes and mutations that the maps have space for */
+    tsk_size_t max_nodes;
+    tsk_size_t max_mutations;
 } simplifier_t;
 
 static int
@@ -8972,12 +10901,14 @@ simplifier_check_state(simplifier_t *self)
     tsk_id_t child;
     double position, last_position;
     bool found;
-    tsk_size_t num_intervals;
+    tsk_size_t num_intervals, num_segments, num_free_segments;
 
+    num_segments = 0;
     for (j = 0; j < self->input_tables.nodes.num_rows; j++) {
         tsk_bug_assert((self->ancestor_map_head[j] == NULL)
                        == (self->ancestor_map_tail[j] == NULL));
         for (u = self->ancestor_map_head[j]; u != NULL; u = u->next) {
+            num_segments++;
             tsk_bug_assert(u->left < u->right);
             if (u->next != NULL) {
                 tsk_bug_assert(u->right <= u->next->left);
@@ -8989,6 +10920,14 @@ simplifier_check_state(simplifier_t *self)
             }
         }
     }
+    tsk_bug_assert(num_segments == self->num_segments);
+    tsk_bug_assert(num_segments <= self->max_num_segments);
+    num_free_segments = 0;
+    for (u = self->segment_free_list; u != NULL; u = u->next) {
+        num_free_segments++;
+    }
+    tsk_bug_assert(num_segments + num_free_segments
+                   == self->segment_heap.total_allocated / sizeof(tsk_segment_t));
 
     for (j = 0; j < self->segment_queue_size; j++) {
         tsk_bug_assert(self->segment_queue[j].left < self->segment_queue[j].right);
@@ -9082,6 +11021,8 @@ simplifier_print_state(simplifier_t *self, FILE *out)
     fprintf(out, "===\nmemory heaps\n==\n");
     fprintf(out, "segment_heap:\n");
     tsk_blkalloc_print_state(&self->segment_heap, out);
+    fprintf(out, "num_segments = %lld\n", (long long) self->num_segments);
+    fprintf(out, "max_num_segments = %lld\n", (long long) self->max_num_segments);
     fprintf(out, "interval_list_heap:\n");
     tsk_blkalloc_print_state(&self->interval_list_heap, out);
     fprintf(out, "===\nancestors\n==\n");
@@ -9143,10 +11084,17 @@ simplifier_alloc_segment(simplifier_t *self, double left, double right, tsk_id_t
 {
     tsk_segment_t *seg = NULL;
 
-    seg = tsk_blkalloc_get(&self->segment_heap, sizeof(*seg));
-    if (seg == NULL) {
-        goto out;
+    if (self->segment_free_list != NULL) {
+        seg = self->segment_free_list;
+        self->segment_free_list = seg->next;
+    } else {
+        seg = tsk_blkalloc_get(&self->segment_heap, sizeof(*seg));
+        if (seg == NULL) {
+            goto out;
+        }
     }
+    self->num_segments++;
+    self->max_num_segments = TSK_MAX(self->max_num_segments, self->num_segments);
     seg->next = NULL;
     seg->left = left;
     seg->right = right;
@@ -9155,6 +11103,15 @@ out:
     return seg;
 }
 
+static void
+simplifier_free_segment(simplifier_t *self, tsk_segment_t *seg)
+{
+    tsk_bug_assert(self->num_segments > 0);
+    seg->next = self->segment_free_list;
+    self->segment_free_list = seg;
+    self->num_segments--;
+}
+
 static interval_list_t *TSK_WARN_UNUSED
 simplifier_alloc_interval_list(simplifier_t *self, double left, double right)
 {
@@ -9242,6 +11199,7 @@ simplifier_init_position_lookup(simplifier_t *self)
     int ret = 0;
     tsk_size_t num_sites = self->input_tables.sites.num_rows;
 
+    tsk_safe_free(self->position_lookup);
     self->position_lookup = tsk_malloc((num_sites + 2) * sizeof(*self->position_lookup));
     if (self->position_lookup == NULL) {
         goto out;
@@ -9336,23 +11294,28 @@ simplifier_init_sites(simplifier_t *self)
     tsk_id_t node;
     mutation_id_list_t *list_node;
     tsk_size_t j;
+    tsk_size_t num_mutations = self->input_tables.mutations.num_rows;
+    tsk_size_t max_mutations = TSK_MAX(num_mutations, 1);
 
-    self->mutation_node_map
-        = tsk_calloc(self->input_tables.mutations.num_rows, sizeof(tsk_id_t));
-    self->node_mutation_list_mem
-        = tsk_malloc(self->input_tables.mutations.num_rows * sizeof(mutation_id_list_t));
-    self->node_mutation_list_map_head
-        = tsk_calloc(self->input_tables.nodes.num_rows, sizeof(mutation_id_list_t *));
-    self->node_mutation_list_map_tail
-        = tsk_calloc(self->input_tables.nodes.num_rows, sizeof(mutation_id_list_t *));
-    if (self->mutation_node_map == NULL || self->node_mutation_list_mem == NULL
-        || self->node_mutation_list_map_head == NULL
-        || self->node_mutation_list_map_tail == NULL) {
-        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
-        goto out;
+    if (max_mutations > self->max_mutations) {
+        ret = expand_column(
+            (void **) &self->mutation_node_map, max_mutations, sizeof(tsk_id_t));
+        if (ret != 0) {
+            goto out;
+        }
+        ret = expand_column((void **) &self->node_mutation_list_mem, max_mutations,
+            sizeof(mutation_id_list_t));
+        if (ret != 0) {
+            goto out;
+        }
+        self->max_mutations = max_mutations;
     }
-    tsk_memset(self->mutation_node_map, 0xff,
-        self->input_tables.mutations.num_rows * sizeof(tsk_id_t));
+    /* The node maps are allocated by simplifier_expand_node_maps */
+    tsk_memset(self->node_mutation_list_map_head, 0,
+        self->input_tables.nodes.num_rows * sizeof(mutation_id_list_t *));
+    tsk_memset(self->node_mutation_list_map_tail, 0,
+        self->input_tables.nodes.num_rows * sizeof(mutation_id_list_t *));
+    tsk_memset(self->mutation_node_map, 0xff, num_mutations * sizeof(tsk_id_t));
 
     for (j = 0; j < self->input_tables.mutations.num_rows; j++) {
         node = self->input_tables.mutations.node[j];
@@ -9444,7 +11407,7 @@ simplifier_init_tables(simplifier_t *self)
      * underlying column memory in these tables, and then being careful
      * not to free the table at the end.
      */
-    ret = tsk_table_collection_copy(self->tables, &self->input_tables, 0);
+    ret = tsk_table_collection_copy(self->tables, &self->input_tables, TSK_NO_INIT);
     if (ret != 0) {
         goto out;
     }
@@ -9522,33 +11485,14 @@ out:
     return ret;
 }
 
+/* Allocate the memory used by the simplifier that does not depend on the
+ * size of the tables. */
 static int
-simplifier_init(simplifier_t *self, const tsk_id_t *samples, tsk_size_t num_samples,
-    tsk_table_collection_t *tables, tsk_flags_t options)
+simplifier_alloc(simplifier_t *self)
 {
     int ret = 0;
-    tsk_size_t j;
-    tsk_id_t ret_id;
-    tsk_size_t num_nodes;
 
     tsk_memset(self, 0, sizeof(simplifier_t));
-    self->num_samples = num_samples;
-    self->options = options;
-    self->tables = tables;
-
-    /* TODO we can add a flag to skip these checks for when we know they are
-     * unnecessary */
-    /* TODO Current unit tests require TSK_CHECK_SITE_DUPLICATES but it's
-     * debateable whether we need it. If we remove, we definitely need explicit
-     * tests to ensure we're doing sensible things with duplicate sites.
-     * (Particularly, re TSK_SIMPLIFY_REDUCE_TO_SITE_TOPOLOGY.) */
-    ret_id = tsk_table_collection_check_integrity(tables,
-        TSK_CHECK_EDGE_ORDERING | TSK_CHECK_SITE_ORDERING | TSK_CHECK_SITE_DUPLICATES);
-    if (ret_id != 0) {
-        ret = (int) ret_id;
-        goto out;
-    }
-
     /* Allocate the heaps used for small objects-> Assuming 8K is a good chunk size
      */
     ret = tsk_blkalloc_init(&self->segment_heap, 8192);
@@ -9563,65 +11507,186 @@ simplifier_init(simplifier_t *self, const tsk_id_t *samples, tsk_size_t num_samp
     if (ret != 0) {
         goto out;
     }
-    num_nodes = tables->nodes.num_rows;
-    /* Make the maps and set the intial state */
-    self->ancestor_map_head = tsk_calloc(num_nodes, sizeof(tsk_segment_t *));
-    self->ancestor_map_tail = tsk_calloc(num_nodes, sizeof(tsk_segment_t *));
-    self->child_edge_map_head = tsk_calloc(num_nodes, sizeof(interval_list_t *));
-    self->child_edge_map_tail = tsk_calloc(num_nodes, sizeof(interval_list_t *));
-    self->node_id_map = tsk_malloc(num_nodes * sizeof(tsk_id_t));
-    self->buffered_children = tsk_malloc(num_nodes * sizeof(tsk_id_t));
-    self->is_sample = tsk_calloc(num_nodes, sizeof(bool));
+    ret = tsk_table_collection_init(&self->input_tables, 0);
+    if (ret != 0) {
+        goto out;
+    }
     self->max_segment_queue_size = 64;
     self->segment_queue
         = tsk_malloc(self->max_segment_queue_size * sizeof(tsk_segment_t));
-    if (self->ancestor_map_head == NULL || self->ancestor_map_tail == NULL
-        || self->child_edge_map_head == NULL || self->child_edge_map_tail == NULL
-        || self->node_id_map == NULL || self->is_sample == NULL
-        || self->segment_queue == NULL || self->buffered_children == NULL) {
+    if (self->segment_queue == NULL) {
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
+out:
+    return ret;
+}
 
-    /* Go through the samples to check for errors before we clear the tables. */
-    for (j = 0; j < self->num_samples; j++) {
-        if (samples[j] < 0 || samples[j] >= (tsk_id_t) num_nodes) {
-            ret = tsk_trace_error(TSK_ERR_NODE_OUT_OF_BOUNDS);
+/* Make sure the arrays indexed by node ID have space for at least
+ * num_nodes elements. */
+static int
+simplifier_expand_node_maps(simplifier_t *self, tsk_size_t num_nodes)
+{
+    int ret = 0;
+    tsk_size_t max_nodes = TSK_MAX(num_nodes, 1);
+
+    if (max_nodes > self->max_nodes) {
+        ret = expand_column(
+            (void **) &self->ancestor_map_head, max_nodes, sizeof(tsk_segment_t *));
+        if (ret != 0) {
             goto out;
         }
-        if (self->is_sample[samples[j]]) {
-            ret = tsk_trace_error(TSK_ERR_DUPLICATE_SAMPLE);
+        ret = expand_column(
+            (void **) &self->ancestor_map_tail, max_nodes, sizeof(tsk_segment_t *));
+        if (ret != 0) {
             goto out;
         }
-        self->is_sample[samples[j]] = true;
-    }
-    tsk_memset(self->node_id_map, 0xff, num_nodes * sizeof(tsk_id_t));
-
-    ret = simplifier_init_tables(self);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = simplifier_init_sites(self);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = simplifier_init_nodes(self, samples);
-    if (ret != 0) {
-        goto out;
-    }
-    if (self->options & TSK_SIMPLIFY_REDUCE_TO_SITE_TOPOLOGY) {
-        ret = simplifier_init_position_lookup(self);
+        ret = expand_column(
+            (void **) &self->child_edge_map_head, max_nodes, sizeof(interval_list_t *));
         if (ret != 0) {
             goto out;
         }
-    }
-
-    self->edge_sort_offset = TSK_NULL;
-out:
-    return ret;
-}
-
-static int
+        ret = expand_column(
+            (void **) &self->child_edge_map_tail, max_nodes, sizeof(interval_list_t *));
+        if (ret != 0) {
+            goto out;
+        }
+        ret = expand_column((void **) &self->node_id_map, max_nodes, sizeof(tsk_id_t));
+        if (ret != 0) {
+            goto out;
+        }
+        ret = expand_column(
+            (void **) &self->buffered_children, max_nodes, sizeof(tsk_id_t));
+        if (ret != 0) {
+            goto out;
+        }
+        ret = expand_column((void **) &self->is_sample, max_nodes, sizeof(bool));
+        if (ret != 0) {
+            goto out;
+        }
+        ret = expand_column((void **) &self->node_mutation_list_map_head, max_nodes,
+            sizeof(mutation_id_list_t *));
+        if (ret != 0) {
+            goto out;
+        }
+        ret = expand_column((void **) &self->node_mutation_list_map_tail, max_nodes,
+            sizeof(mutation_id_list_t *));
+        if (ret != 0) {
+            goto out;
+        }
+        self->max_nodes = max_nodes;
+    }
+out:
+    return ret;
+}
+
+/* Set up the simplifier to simplify the specified tables, reusing any memory
+ * allocated by previous calls. */
+static int
+simplifier_reset(simplifier_t *self, const tsk_id_t *samples, tsk_size_t num_samples,
+    tsk_table_collection_t *tables, tsk_flags_t options)
+{
+    int ret = 0;
+    tsk_size_t j;
+    tsk_id_t ret_id;
+    tsk_size_t num_nodes;
+
+    self->num_samples = num_samples;
+    self->options = options;
+    self->tables = tables;
+    self->segment_queue_size = 0;
+    self->num_buffered_children = 0;
+
+    /* TODO we can add a flag to skip these checks for when we know they are
+     * unnecessary */
+    /* TODO Current unit tests require TSK_CHECK_SITE_DUPLICATES but it's
+     * debateable whether we need it. If we remove, we definitely need explicit
+     * tests to ensure we're doing sensible things with duplicate sites.
+     * (Particularly, re TSK_SIMPLIFY_REDUCE_TO_SITE_TOPOLOGY.) */
+    ret_id = tsk_table_collection_check_integrity(tables,
+        TSK_CHECK_EDGE_ORDERING | TSK_CHECK_SITE_ORDERING | TSK_CHECK_SITE_DUPLICATES);
+    if (ret_id != 0) {
+        ret = (int) ret_id;
+        goto out;
+    }
+
+    ret = tsk_blkalloc_reset(&self->segment_heap);
+    if (ret != 0) {
+        goto out;
+    }
+    self->segment_free_list = NULL;
+    self->num_segments = 0;
+    self->max_num_segments = 0;
+    ret = tsk_blkalloc_reset(&self->interval_list_heap);
+    if (ret != 0) {
+        goto out;
+    }
+    num_nodes = tables->nodes.num_rows;
+    ret = simplifier_expand_node_maps(self, num_nodes);
+    if (ret != 0) {
+        goto out;
+    }
+    /* Set the intial state of the maps */
+    tsk_memset(self->ancestor_map_head, 0, num_nodes * sizeof(tsk_segment_t *));
+    tsk_memset(self->ancestor_map_tail, 0, num_nodes * sizeof(tsk_segment_t *));
+    tsk_memset(self->child_edge_map_head, 0, num_nodes * sizeof(interval_list_t *));
+    tsk_memset(self->child_edge_map_tail, 0, num_nodes * sizeof(interval_list_t *));
+    tsk_memset(self->is_sample, 0, num_nodes * sizeof(bool));
+
+    /* Go through the samples to check for errors before we clear the tables. */
+    for (j = 0; j < self->num_samples; j++) {
+        if (samples[j] < 0 || samples[j] >= (tsk_id_t) num_nodes) {
+            ret = tsk_trace_error(TSK_ERR_NODE_OUT_OF_BOUNDS);
+            goto out;
+        }
+        if (self->is_sample[samples[j]]) {
+            ret = tsk_trace_error(TSK_ERR_DUPLICATE_SAMPLE);
+            goto out;
+        }
+        self->is_sample[samples[j]] = true;
+    }
+    tsk_memset(self->node_id_map, 0xff, num_nodes * sizeof(tsk_id_t));
+
+    ret = simplifier_init_tables(self);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = simplifier_init_sites(self);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = simplifier_init_nodes(self, samples);
+    if (ret != 0) {
+        goto out;
+    }
+    if (self->options & TSK_SIMPLIFY_REDUCE_TO_SITE_TOPOLOGY) {
+        ret = simplifier_init_position_lookup(self);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+
+    self->edge_sort_offset = TSK_NULL;
+out:
+    return ret;
+}
+
+static int
+simplifier_init(simplifier_t *self, const tsk_id_t *samples, tsk_size_t num_samples,
+    tsk_table_collection_t *tables, tsk_flags_t options)
+{
+    int ret = 0;
+
+    ret = simplifier_alloc(self);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = simplifier_reset(self, samples, num_samples, tables, options);
+out:
+    return ret;
+}
+
+static int
 simplifier_free(simplifier_t *self)
 {
     tsk_table_collection_free(&self->input_tables);
@@ -9695,6 +11760,7 @@ simplifier_merge_ancestors(simplifier_t *self, tsk_id_t input_id)
         /* Free up the existing ancestry mapping. */
         x = self->ancestor_map_tail[input_id];
         tsk_bug_assert(x->left == 0 && x->right == self->tables->sequence_length);
+        simplifier_free_segment(self, x);
         self->ancestor_map_head[input_id] = NULL;
         self->ancestor_map_tail[input_id] = NULL;
     }
@@ -9827,7 +11893,7 @@ simplifier_extract_ancestry(
                 seg_right = x;
             } else {
                 seg_right = x->next;
-                // TODO free x
+                simplifier_free_segment(self, x);
             }
             if (x_prev == NULL) {
                 x_head = seg_right;
@@ -10359,8 +12425,8 @@ out:
 }
 
 static int
-tsk_table_collection_check_node_integrity(
-    const tsk_table_collection_t *self, tsk_flags_t options)
+tsk_table_collection_check_node_integrity(const tsk_table_collection_t *self,
+    tsk_flags_t options, tsk_size_t start, tsk_size_t end)
 {
     int ret = 0;
     tsk_size_t j;
@@ -10370,7 +12436,7 @@ tsk_table_collection_check_node_integrity(
     tsk_id_t num_individuals = (tsk_id_t) self->individuals.num_rows;
     const bool check_population_refs = !(options & TSK_NO_CHECK_POPULATION_REFS);
 
-    for (j = 0; j < self->nodes.num_rows; j++) {
+    for (j = start; j < end; j++) {
         node_time = self->nodes.time[j];
         if (!tsk_isfinite(node_time)) {
             ret = tsk_trace_error(TSK_ERR_TIME_NONFINITE);
@@ -10393,9 +12459,14 @@ out:
     return ret;
 }
 
+/* Checks the edges in rows [start, end). If parent_seen is NULL, the check
+ * that the edges for each parent are contiguous is skipped, and must be made
+ * separately by check_edge_contiguity. The row of any error is stored in
+ * error_row. */
 static int
-tsk_table_collection_check_edge_integrity(
-    const tsk_table_collection_t *self, tsk_flags_t options)
+tsk_table_collection_check_edge_integrity(const tsk_table_collection_t *self,
+    tsk_flags_t options, tsk_size_t start, tsk_size_t end, bool *parent_seen,
+    tsk_size_t *error_row)
 {
     int ret = 0;
     tsk_size_t j;
@@ -10406,21 +12477,22 @@ tsk_table_collection_check_edge_integrity(
     const tsk_edge_table_t edges = self->edges;
     const tsk_id_t num_nodes = (tsk_id_t) self->nodes.num_rows;
     const bool check_ordering = !!(options & TSK_CHECK_EDGE_ORDERING);
-    bool *parent_seen = NULL;
-
-    if (check_ordering) {
-        parent_seen = tsk_calloc((tsk_size_t) num_nodes, sizeof(*parent_seen));
-        if (parent_seen == NULL) {
-            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
-            goto out;
-        }
-    }
 
     /* Just keeping compiler happy; these values don't matter. */
     last_left = 0;
     last_parent = 0;
     last_child = 0;
-    for (j = 0; j < edges.num_rows; j++) {
+    j = start;
+    if (start > 0 && check_ordering) {
+        last_parent = edges.parent[start - 1];
+        last_child = edges.child[start - 1];
+        last_left = edges.left[start - 1];
+        if (last_parent < 0 || last_parent >= num_nodes) {
+            /* The error is reported for the previous row */
+            goto out;
+        }
+    }
+    for (j = start; j < end; j++) {
         parent = edges.parent[j];
         child = edges.child[j];
         left = edges.left[j];
@@ -10466,7 +12538,7 @@ tsk_table_collection_check_edge_integrity(
         }
 
         if (check_ordering) {
-            if (parent_seen[parent]) {
+            if (parent_seen != NULL && parent_seen[parent]) {
                 ret = tsk_trace_error(TSK_ERR_EDGES_NONCONTIGUOUS_PARENTS);
                 goto out;
             }
@@ -10491,7 +12563,7 @@ tsk_table_collection_check_edge_integrity(
                                 goto out;
                             }
                         }
-                    } else {
+                    } else if (parent_seen != NULL) {
                         parent_seen[last_parent] = true;
                     }
                 }
@@ -10502,13 +12574,47 @@ tsk_table_collection_check_edge_integrity(
         }
     }
 out:
-    tsk_safe_free(parent_seen);
+    *error_row = j;
+    return ret;
+}
+
+/* Checks that the edges for each parent are contiguous, as done by
+ * check_edge_integrity when given parent_seen. The other checks are not made,
+ * and the scan stops at the first edge with an invalid parent, where
+ * check_edge_integrity reports an error. */
+static int
+tsk_table_collection_check_edge_contiguity(
+    const tsk_table_collection_t *self, bool *parent_seen, tsk_size_t *error_row)
+{
+    int ret = 0;
+    tsk_size_t j;
+    tsk_id_t parent, last_parent;
+    const double *time = self->nodes.time;
+    const tsk_edge_table_t edges = self->edges;
+    const tsk_id_t num_nodes = (tsk_id_t) self->nodes.num_rows;
+
+    last_parent = 0;
+    for (j = 0; j < edges.num_rows; j++) {
+        parent = edges.parent[j];
+        if (parent < 0 || parent >= num_nodes) {
+            break;
+        }
+        if (parent_seen[parent]) {
+            ret = tsk_trace_error(TSK_ERR_EDGES_NONCONTIGUOUS_PARENTS);
+            break;
+        }
+        if (j > 0 && time[parent] == time[last_parent] && parent != last_parent) {
+            parent_seen[last_parent] = true;
+        }
+        last_parent = parent;
+    }
+    *error_row = j;
     return ret;
 }
 
 static int TSK_WARN_UNUSED
-tsk_table_collection_check_site_integrity(
-    const tsk_table_collection_t *self, tsk_flags_t options)
+tsk_table_collection_check_site_integrity(const tsk_table_collection_t *self,
+    tsk_flags_t options, tsk_size_t start, tsk_size_t end)
 {
     int ret = 0;
     tsk_size_t j;
@@ -10518,7 +12624,7 @@ tsk_table_collection_check_site_integrity(
     const bool check_site_ordering = !!(options & TSK_CHECK_SITE_ORDERING);
     const bool check_site_duplicates = !!(options & TSK_CHECK_SITE_DUPLICATES);
 
-    for (j = 0; j < sites.num_rows; j++) {
+    for (j = start; j < end; j++) {
         position = sites.position[j];
         /* Spatial requirements */
         if (!tsk_isfinite(position)) {
@@ -10545,8 +12651,8 @@ out:
 }
 
 static int TSK_WARN_UNUSED
-tsk_table_collection_check_mutation_integrity(
-    const tsk_table_collection_t *self, tsk_flags_t options)
+tsk_table_collection_check_mutation_integrity(const tsk_table_collection_t *self,
+    tsk_flags_t options, tsk_size_t start, tsk_size_t end)
 {
     int ret = 0;
     tsk_size_t j;
@@ -10563,7 +12669,19 @@ tsk_table_collection_check_mutation_integrity(
     int num_known_times = 0;
     int num_unknown_times = 0;
 
-    for (j = 0; j < mutations.num_rows; j++) {
+    if (start > 0) {
+        /* Rows before start have passed the checks, so the previous mutation
+         * tells us everything we need to know about the earlier mutations at
+         * its site: there can't be both known and unknown times. */
+        mutation_time = mutations.time[start - 1];
+        if (tsk_is_unknown_time(mutation_time)) {
+            num_unknown_times = 1;
+        } else {
+            num_known_times = 1;
+            last_known_time = mutation_time;
+        }
+    }
+    for (j = start; j < end; j++) {
         /* Basic reference integrity */
         if (mutations.site[j] < 0 || mutations.site[j] >= num_sites) {
             ret = tsk_trace_error(TSK_ERR_SITE_OUT_OF_BOUNDS);
@@ -10660,8 +12778,8 @@ out:
 }
 
 static int TSK_WARN_UNUSED
-tsk_table_collection_check_migration_integrity(
-    const tsk_table_collection_t *self, tsk_flags_t options)
+tsk_table_collection_check_migration_integrity(const tsk_table_collection_t *self,
+    tsk_flags_t options, tsk_size_t start, tsk_size_t end)
 {
     int ret = 0;
     tsk_size_t j;
@@ -10673,7 +12791,7 @@ tsk_table_collection_check_migration_integrity(
     const bool check_population_refs = !(options & TSK_NO_CHECK_POPULATION_REFS);
     const bool check_migration_ordering = !!(options & TSK_CHECK_MIGRATION_ORDERING);
 
-    for (j = 0; j < migrations.num_rows; j++) {
+    for (j = start; j < end; j++) {
         if (migrations.node[j] < 0 || migrations.node[j] >= num_nodes) {
             ret = tsk_trace_error(TSK_ERR_NODE_OUT_OF_BOUNDS);
             goto out;
@@ -10725,8 +12843,8 @@ out:
 }
 
 static int TSK_WARN_UNUSED
-tsk_table_collection_check_individual_integrity(
-    const tsk_table_collection_t *self, tsk_flags_t options)
+tsk_table_collection_check_individual_integrity(const tsk_table_collection_t *self,
+    tsk_flags_t options, tsk_size_t start, tsk_size_t end)
 {
     int ret = 0;
     tsk_size_t j, k;
@@ -10734,7 +12852,7 @@ tsk_table_collection_check_individual_integrity(
     const tsk_id_t num_individuals = (tsk_id_t) individuals.num_rows;
     const bool check_individual_ordering = options & TSK_CHECK_INDIVIDUAL_ORDERING;
 
-    for (j = 0; j < (tsk_size_t) num_individuals; j++) {
+    for (j = start; j < end; j++) {
         for (k = individuals.parents_offset[j]; k < individuals.parents_offset[j + 1];
             k++) {
             /* Check parent references are valid */
@@ -10855,682 +12973,2330 @@ tsk_table_collection_check_tree_integrity(const tsk_table_collection_t *self)
             ret = tsk_trace_error(TSK_ERR_TABLES_BAD_INDEXES);
             goto out;
         }
-        tree_left = tree_right;
-        /* This is technically possible; if we have 2**31 edges each defining
-         * a single tree, and there's a gap between each of these edges we
-         * would overflow this counter. */
-        if (num_trees == TSK_MAX_ID) {
-            ret = tsk_trace_error(TSK_ERR_TREE_OVERFLOW);
+        tree_left = tree_right;
+        /* This is technically possible; if we have 2**31 edges each defining
+         * a single tree, and there's a gap between each of these edges we
+         * would overflow this counter. */
+        if (num_trees == TSK_MAX_ID) {
+            ret = tsk_trace_error(TSK_ERR_TREE_OVERFLOW);
+            goto out;
+        }
+        num_trees++;
+    }
+    tsk_bug_assert(j == num_edges);
+    while (k < num_edges) {
+        /* At this point it must be that used_edges[O[k]] == 1,
+         * since otherwise we would have added a different edge twice,
+         * and so hit the error above. */
+        e = O[k];
+        if (edge_right[e] != sequence_length) {
+            ret = tsk_trace_error(TSK_ERR_TABLES_BAD_INDEXES);
+            goto out;
+        }
+        used_edges[e]++;
+        k++;
+    }
+    ret = num_trees;
+out:
+    /* Can't use tsk_safe_free because of restrict*/
+    if (parent != NULL) {
+        free(parent);
+    }
+    if (used_edges != NULL) {
+        free(used_edges);
+    }
+    return ret;
+}
+
+static int TSK_WARN_UNUSED
+tsk_table_collection_check_index_integrity(
+    const tsk_table_collection_t *self, tsk_size_t start, tsk_size_t end)
+{
+    int ret = 0;
+    tsk_size_t j;
+    const tsk_id_t num_edges = (tsk_id_t) self->edges.num_rows;
+    const tsk_id_t *edge_insertion_order = self->indexes.edge_insertion_order;
+    const tsk_id_t *edge_removal_order = self->indexes.edge_removal_order;
+
+    if (!tsk_table_collection_has_index(self, 0)) {
+        ret = tsk_trace_error(TSK_ERR_TABLES_NOT_INDEXED);
+        goto out;
+    }
+    for (j = start; j < end; j++) {
+        if (edge_insertion_order[j] < 0 || edge_insertion_order[j] >= num_edges) {
+            ret = tsk_trace_error(TSK_ERR_EDGE_OUT_OF_BOUNDS);
+            goto out;
+        }
+        if (edge_removal_order[j] < 0 || edge_removal_order[j] >= num_edges) {
+            ret = tsk_trace_error(TSK_ERR_EDGE_OUT_OF_BOUNDS);
+            goto out;
+        }
+    }
+out:
+    return ret;
+}
+
+static int TSK_WARN_UNUSED
+tsk_table_collection_compute_mutation_parents_to_array(
+    const tsk_table_collection_t *self, tsk_id_t *mutation_parent)
+{
+    int ret = 0;
+    const tsk_id_t *I, *O;
+    const tsk_edge_table_t edges = self->edges;
+    const tsk_node_table_t nodes = self->nodes;
+    const tsk_site_table_t sites = self->sites;
+    const tsk_mutation_table_t mutations = self->mutations;
+    const tsk_id_t M = (tsk_id_t) edges.num_rows;
+    tsk_id_t tj, tk;
+    tsk_id_t *parent = NULL;
+    tsk_id_t *bottom_mutation = NULL;
+    tsk_id_t u;
+    double left, right;
+    tsk_id_t site;
+    /* Using unsigned values here avoids potentially undefined behaviour */
+    tsk_size_t j, mutation, first_mutation;
+
+    parent = tsk_malloc(nodes.num_rows * sizeof(*parent));
+    bottom_mutation = tsk_malloc(nodes.num_rows * sizeof(*bottom_mutation));
+    if (parent == NULL || bottom_mutation == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    tsk_memset(parent, 0xff, nodes.num_rows * sizeof(*parent));
+    tsk_memset(bottom_mutation, 0xff, nodes.num_rows * sizeof(*bottom_mutation));
+    tsk_memset(mutation_parent, 0xff, self->mutations.num_rows * sizeof(tsk_id_t));
+
+    I = self->indexes.edge_insertion_order;
+    O = self->indexes.edge_removal_order;
+    tj = 0;
+    tk = 0;
+    site = 0;
+    mutation = 0;
+    left = 0;
+    while (tj < M || left < self->sequence_length) {
+        while (tk < M && edges.right[O[tk]] == left) {
+            parent[edges.child[O[tk]]] = TSK_NULL;
+            tk++;
+        }
+        while (tj < M && edges.left[I[tj]] == left) {
+            parent[edges.child[I[tj]]] = edges.parent[I[tj]];
+            tj++;
+        }
+        right = self->sequence_length;
+        if (tj < M) {
+            right = TSK_MIN(right, edges.left[I[tj]]);
+        }
+        if (tk < M) {
+            right = TSK_MIN(right, edges.right[O[tk]]);
+        }
+
+        /* Tree is now ready. We look at each site on this tree in turn */
+        while (site < (tsk_id_t) sites.num_rows && sites.position[site] < right) {
+            /* Create a mapping from mutations to nodes. If we see more than one
+             * mutation at a node, the previously seen one must be the parent
+             * of the current since we assume they are in order. */
+            first_mutation = mutation;
+            while (mutation < mutations.num_rows && mutations.site[mutation] == site) {
+                u = mutations.node[mutation];
+                if (bottom_mutation[u] != TSK_NULL) {
+                    mutation_parent[mutation] = bottom_mutation[u];
+                }
+                bottom_mutation[u] = (tsk_id_t) mutation;
+                mutation++;
+            }
+            /* Make the common case of 1 mutation fast */
+            if (mutation > first_mutation + 1) {
+                /* If we have more than one mutation, compute the parent for each
+                 * one by traversing up the tree until we find a node that has a
+                 * mutation. */
+                for (j = first_mutation; j < mutation; j++) {
+                    if (mutation_parent[j] == TSK_NULL) {
+                        u = parent[mutations.node[j]];
+                        while (u != TSK_NULL && bottom_mutation[u] == TSK_NULL) {
+                            u = parent[u];
+                        }
+                        if (u != TSK_NULL) {
+                            mutation_parent[j] = bottom_mutation[u];
+                        }
+                    }
+                }
+            }
+            /* Reset the mapping for the next site */
+            for (j = first_mutation; j < mutation; j++) {
+                u = mutations.node[j];
+                bottom_mutation[u] = TSK_NULL;
+                /* Check that we haven't violated the sortedness property */
+                if (mutation_parent[j] > (tsk_id_t) j) {
+                    ret = tsk_trace_error(TSK_ERR_MUTATION_PARENT_AFTER_CHILD);
+                    goto out;
+                }
+            }
+            site++;
+        }
+        /* Move on to the next tree */
+        left = right;
+    }
+
+out:
+    tsk_safe_free(parent);
+    tsk_safe_free(bottom_mutation);
+    return ret;
+}
+
+static int TSK_WARN_UNUSED
+tsk_table_collection_check_mutation_parents(const tsk_table_collection_t *self)
+{
+    int ret = 0;
+    tsk_mutation_table_t mutations = self->mutations;
+    tsk_id_t *new_parents = NULL;
+    tsk_size_t j;
+
+    if (mutations.num_rows == 0) {
+        return ret;
+    }
+
+    new_parents = tsk_malloc(mutations.num_rows * sizeof(*new_parents));
+    if (new_parents == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+
+    ret = tsk_table_collection_compute_mutation_parents_to_array(self, new_parents);
+    if (ret != 0) {
+        goto out;
+    }
+
+    for (j = 0; j < mutations.num_rows; j++) {
+        if (mutations.parent[j] != new_parents[j]) {
+            ret = tsk_trace_error(TSK_ERR_BAD_MUTATION_PARENT);
+            goto out;
+        }
+    }
+
+out:
+    tsk_safe_free(new_parents);
+    return ret;
+}
+
+static tsk_flags_t
+tsk_table_collection_check_integrity_options(tsk_flags_t options)
+{
+    if (options & TSK_CHECK_MUTATION_PARENTS) {
+        /* If we're checking mutation parents, we need to check the trees first */
+        options |= TSK_CHECK_TREES;
+    }
+
+    if (options & TSK_CHECK_TREES) {
+        /* Checking the trees implies these checks */
+        options |= TSK_CHECK_EDGE_ORDERING | TSK_CHECK_SITE_ORDERING
+                   | TSK_CHECK_SITE_DUPLICATES | TSK_CHECK_MUTATION_ORDERING
+                   | TSK_CHECK_MIGRATION_ORDERING | TSK_CHECK_INDEXES;
+    }
+    return options;
+}
+
+static tsk_id_t TSK_WARN_UNUSED
+tsk_table_collection_check_trees(
+    const tsk_table_collection_t *self, tsk_flags_t options)
+{
+    tsk_id_t ret = 0;
+    int mut_ret = 0;
+
+    if (options & TSK_CHECK_TREES) {
+        ret = tsk_table_collection_check_tree_integrity(self);
+        if (ret < 0) {
+            goto out;
+        }
+        /* This check requires tree integrity so do it last */
+        if (options & TSK_CHECK_MUTATION_PARENTS) {
+            mut_ret = tsk_table_collection_check_mutation_parents(self);
+            if (mut_ret != 0) {
+                ret = mut_ret;
+                goto out;
+            }
+        }
+    }
+out:
+    return ret;
+}
+
+tsk_id_t TSK_WARN_UNUSED
+tsk_table_collection_check_integrity(
+    const tsk_table_collection_t *self, tsk_flags_t options)
+{
+    tsk_id_t ret = 0;
+    tsk_size_t error_row;
+    bool *parent_seen = NULL;
+
+    options = tsk_table_collection_check_integrity_options(options);
+    if (!tsk_isfinite(self->sequence_length) || self->sequence_length <= 0) {
+        ret = tsk_trace_error(TSK_ERR_BAD_SEQUENCE_LENGTH);
+        goto out;
+    }
+    ret = tsk_table_collection_check_offsets(self);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_check_node_integrity(
+        self, options, 0, self->nodes.num_rows);
+    if (ret != 0) {
+        goto out;
+    }
+    if (options & TSK_CHECK_EDGE_ORDERING) {
+        parent_seen = tsk_calloc(self->nodes.num_rows, sizeof(*parent_seen));
+        if (parent_seen == NULL) {
+            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+            goto out;
+        }
+    }
+    ret = tsk_table_collection_check_edge_integrity(
+        self, options, 0, self->edges.num_rows, parent_seen, &error_row);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_check_site_integrity(
+        self, options, 0, self->sites.num_rows);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_check_mutation_integrity(
+        self, options, 0, self->mutations.num_rows);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_check_migration_integrity(
+        self, options, 0, self->migrations.num_rows);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_check_individual_integrity(
+        self, options, 0, self->individuals.num_rows);
+    if (ret != 0) {
+        goto out;
+    }
+
+    if (options & TSK_CHECK_INDEXES) {
+        ret = tsk_table_collection_check_index_integrity(self, 0, self->edges.num_rows);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    ret = tsk_table_collection_check_trees(self, options);
+out:
+    tsk_safe_free(parent_seen);
+    return ret;
+}
+
+/* Parallel integrity checking. The checks made by check_integrity before
+ * the trees are split into tasks over chunks of rows, which are run in order
+ * by a pool of threads. The error returned is the one from the earliest row
+ * in the earliest check, which is the error that check_integrity finds first.
+ * Once a task has failed, the tasks for later rows and checks are skipped.
+ */
+
+#define INTEGRITY_CHUNK_SIZE (1 << 16)
+
+/* The checks, in the order check_integrity makes them */
+#define INTEGRITY_CHECK_OFFSETS     0
+#define INTEGRITY_CHECK_NODES       1
+#define INTEGRITY_CHECK_EDGES       2
+#define INTEGRITY_CHECK_SITES       3
+#define INTEGRITY_CHECK_MUTATIONS   4
+#define INTEGRITY_CHECK_MIGRATIONS  5
+#define INTEGRITY_CHECK_INDIVIDUALS 6
+#define INTEGRITY_CHECK_INDEXES     7
+#define INTEGRITY_CHECK_NONE        8
+
+typedef struct {
+    int check;
+    tsk_size_t start;
+    tsk_size_t end;
+    /* The ragged column for offset checks */
+    const tsk_size_t *offsets;
+    tsk_size_t num_rows;
+    tsk_size_t length;
+    /* Whether this is the edge contiguity check */
+    bool contiguity;
+    int ret;
+    tsk_size_t error_row;
+} integrity_task_t;
+
+typedef struct {
+    const tsk_table_collection_t *tables;
+    tsk_flags_t options;
+    integrity_task_t *tasks;
+    tsk_size_t num_tasks;
+    tsk_size_t max_tasks;
+    bool *parent_seen;
+    tsk_mutex_t *mutex;
+    /* The following are protected by the mutex */
+    tsk_size_t next_task;
+    int failed_check;
+    tsk_size_t failed_row;
+} integrity_checker_t;
+
+static int
+integrity_checker_add_tasks(integrity_checker_t *self, int check,
+    tsk_size_t num_rows, const tsk_size_t *offsets, tsk_size_t length)
+{
+    int ret = 0;
+    tsk_size_t start = 0;
+    integrity_task_t *task;
+    void *p;
+
+    /* Every check has at least one task, even with no rows */
+    do {
+        if (self->num_tasks == self->max_tasks) {
+            self->max_tasks = TSK_MAX(2 * self->max_tasks, 64);
+            p = tsk_realloc(self->tasks, self->max_tasks * sizeof(*self->tasks));
+            if (p == NULL) {
+                ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+                goto out;
+            }
+            self->tasks = p;
+        }
+        task = &self->tasks[self->num_tasks];
+        tsk_memset(task, 0, sizeof(*task));
+        task->check = check;
+        task->start = start;
+        task->end = TSK_MIN(start + INTEGRITY_CHUNK_SIZE, num_rows);
+        task->offsets = offsets;
+        task->num_rows = num_rows;
+        task->length = length;
+        self->num_tasks++;
+        start = task->end;
+    } while (start < num_rows);
+out:
+    return ret;
+}
+
+static int
+integrity_checker_init(integrity_checker_t *self, const tsk_table_collection_t *tables,
+    tsk_flags_t options)
+{
+    int ret = 0;
+    tsk_size_t j;
+    const struct {
+        tsk_size_t num_rows;
+        const tsk_size_t *offsets;
+        tsk_size_t length;
+    } columns[] = {
+        { tables->nodes.num_rows, tables->nodes.metadata_offset,
+            tables->nodes.metadata_length },
+        { tables->sites.num_rows, tables->sites.ancestral_state_offset,
+            tables->sites.ancestral_state_length },
+        { tables->sites.num_rows, tables->sites.metadata_offset,
+            tables->sites.metadata_length },
+        { tables->mutations.num_rows, tables->mutations.derived_state_offset,
+            tables->mutations.derived_state_length },
+        { tables->mutations.num_rows, tables->mutations.metadata_offset,
+            tables->mutations.metadata_length },
+        { tables->individuals.num_rows, tables->individuals.metadata_offset,
+            tables->individuals.metadata_length },
+        { tables->provenances.num_rows, tables->provenances.timestamp_offset,
+            tables->provenances.timestamp_length },
+        { tables->provenances.num_rows, tables->provenances.record_offset,
+            tables->provenances.record_length },
+    };
+
+    tsk_memset(self, 0, sizeof(*self));
+    self->tables = tables;
+    self->options = options;
+    self->failed_check = INTEGRITY_CHECK_NONE;
+
+    ret = tsk_mutex_init(&self->mutex);
+    if (ret != 0) {
+        goto out;
+    }
+    for (j = 0; j < sizeof(columns) / sizeof(*columns); j++) {
+        ret = integrity_checker_add_tasks(self, INTEGRITY_CHECK_OFFSETS,
+            columns[j].num_rows, columns[j].offsets, columns[j].length);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    ret = integrity_checker_add_tasks(
+        self, INTEGRITY_CHECK_NODES, tables->nodes.num_rows, NULL, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    if (options & TSK_CHECK_EDGE_ORDERING) {
+        /* The edges of each parent must be contiguous, which is checked in a
+         * single pass alongside the chunks of edges. */
+        self->parent_seen = tsk_calloc(tables->nodes.num_rows, sizeof(bool));
+        if (self->parent_seen == NULL) {
+            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+            goto out;
+        }
+        ret = integrity_checker_add_tasks(self, INTEGRITY_CHECK_EDGES, 0, NULL, 0);
+        if (ret != 0) {
+            goto out;
+        }
+        self->tasks[self->num_tasks - 1].contiguity = true;
+    }
+    ret = integrity_checker_add_tasks(
+        self, INTEGRITY_CHECK_EDGES, tables->edges.num_rows, NULL, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = integrity_checker_add_tasks(
+        self, INTEGRITY_CHECK_SITES, tables->sites.num_rows, NULL, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = integrity_checker_add_tasks(
+        self, INTEGRITY_CHECK_MUTATIONS, tables->mutations.num_rows, NULL, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = integrity_checker_add_tasks(
+        self, INTEGRITY_CHECK_MIGRATIONS, tables->migrations.num_rows, NULL, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = integrity_checker_add_tasks(
+        self, INTEGRITY_CHECK_INDIVIDUALS, tables->individuals.num_rows, NULL, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    if (options & TSK_CHECK_INDEXES) {
+        ret = integrity_checker_add_tasks(
+            self, INTEGRITY_CHECK_INDEXES, tables->edges.num_rows, NULL, 0);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+out:
+    return ret;
+}
+
+static void
+integrity_checker_free(integrity_checker_t *self)
+{
+    tsk_safe_free(self->tasks);
+    tsk_safe_free(self->parent_seen);
+    if (self->mutex != NULL) {
+        tsk_mutex_free(self->mutex);
+    }
+}
+
+static int
+integrity_checker_check_offsets(const integrity_task_t *task)
+{
+    int ret = 0;
+    tsk_size_t j;
+
+    if (task->start == 0
+        && (task->offsets[0] != 0 || task->offsets[task->num_rows] != task->length)) {
+        ret = tsk_trace_error(TSK_ERR_BAD_OFFSET);
+        goto out;
+    }
+    for (j = task->start; j < task->end; j++) {
+        if (task->offsets[j] > task->offsets[j + 1]) {
+            ret = tsk_trace_error(TSK_ERR_BAD_OFFSET);
+            goto out;
+        }
+    }
+out:
+    return ret;
+}
+
+static void
+integrity_checker_run_task(integrity_checker_t *self, integrity_task_t *task)
+{
+    const tsk_table_collection_t *tables = self->tables;
+    const tsk_flags_t options = self->options;
+    int ret = 0;
+
+    task->error_row = task->start;
+    switch (task->check) {
+        case INTEGRITY_CHECK_OFFSETS:
+            ret = integrity_checker_check_offsets(task);
+            break;
+        case INTEGRITY_CHECK_NODES:
+            ret = tsk_table_collection_check_node_integrity(
+                tables, options, task->start, task->end);
+            break;
+        case INTEGRITY_CHECK_EDGES:
+            if (task->contiguity) {
+                ret = tsk_table_collection_check_edge_contiguity(
+                    tables, self->parent_seen, &task->error_row);
+            } else {
+                ret = tsk_table_collection_check_edge_integrity(tables, options,
+                    task->start, task->end, NULL, &task->error_row);
+            }
+            break;
+        case INTEGRITY_CHECK_SITES:
+            ret = tsk_table_collection_check_site_integrity(
+                tables, options, task->start, task->end);
+            break;
+        case INTEGRITY_CHECK_MUTATIONS:
+            ret = tsk_table_collection_check_mutation_integrity(
+                tables, options, task->start, task->end);
+            break;
+        case INTEGRITY_CHECK_MIGRATIONS:
+            ret = tsk_table_collection_check_migration_integrity(
+                tables, options, task->start, task->end);
+            break;
+        case INTEGRITY_CHECK_INDIVIDUALS:
+            ret = tsk_table_collection_check_individual_integrity(
+                tables, options, task->start, task->end);
+            break;
+        case INTEGRITY_CHECK_INDEXES:
+            ret = tsk_table_collection_check_index_integrity(
+                tables, task->start, task->end);
+            break;
+    }
+    task->ret = ret;
+}
+
+/* Returns true if an error has already been found in an earlier check, or
+ * at an earlier row of the same check, than any this task can find. */
+static bool
+integrity_checker_task_is_redundant(
+    const integrity_checker_t *self, const integrity_task_t *task)
+{
+    return self->failed_check < task->check
+           || (self->failed_check == task->check && self->failed_row < task->start);
+}
+
+static void
+integrity_checker_worker(void *arg, tsk_size_t TSK_UNUSED(thread_index))
+{
+    integrity_checker_t *self = (integrity_checker_t *) arg;
+    integrity_task_t *task;
+    bool redundant;
+
+    while (true) {
+        tsk_mutex_lock(self->mutex);
+        task = NULL;
+        redundant = false;
+        if (self->next_task < self->num_tasks) {
+            task = &self->tasks[self->next_task];
+            self->next_task++;
+            redundant = integrity_checker_task_is_redundant(self, task);
+        }
+        tsk_mutex_unlock(self->mutex);
+        if (task == NULL) {
+            break;
+        }
+        if (redundant) {
+            continue;
+        }
+        integrity_checker_run_task(self, task);
+        if (task->ret != 0) {
+            tsk_mutex_lock(self->mutex);
+            if (task->check < self->failed_check
+                || (task->check == self->failed_check
+                    && task->error_row < self->failed_row)) {
+                self->failed_check = task->check;
+                self->failed_row = task->error_row;
+            }
+            tsk_mutex_unlock(self->mutex);
+        }
+    }
+}
+
+/* Within a row, check_edge_integrity checks the contiguity of the parent's
+ * edges after the node and interval checks, and before the sort order. */
+static int
+integrity_task_stage(const integrity_task_t *task)
+{
+    int stage = 0;
+
+    if (task->contiguity) {
+        stage = 1;
+    } else if (task->ret == TSK_ERR_EDGES_NOT_SORTED_PARENT_TIME
+               || task->ret == TSK_ERR_EDGES_NOT_SORTED_CHILD
+               || task->ret == TSK_ERR_DUPLICATE_EDGES
+               || task->ret == TSK_ERR_EDGES_NOT_SORTED_LEFT) {
+        stage = 2;
+    }
+    return stage;
+}
+
+static int
+integrity_checker_run(integrity_checker_t *self, tsk_size_t num_threads)
+{
+    int ret = 0;
+    tsk_size_t j;
+    const integrity_task_t *task, *first = NULL;
+
+    ret = tsk_thread_run_parallel(
+        TSK_MIN(num_threads, self->num_tasks), integrity_checker_worker, self);
+    if (ret != 0) {
+        goto out;
+    }
+    for (j = 0; j < self->num_tasks; j++) {
+        task = &self->tasks[j];
+        if (task->ret != 0
+            && (first == NULL || task->check < first->check
+                || (task->check == first->check
+                    && (task->error_row < first->error_row
+                        || (task->error_row == first->error_row
+                            && integrity_task_stage(task)
+                                   < integrity_task_stage(first)))))) {
+            first = task;
+        }
+    }
+    if (first != NULL) {
+        ret = first->ret;
+    }
+out:
+    return ret;
+}
+
+tsk_id_t TSK_WARN_UNUSED
+tsk_table_collection_check_integrity_parallel(
+    const tsk_table_collection_t *self, tsk_flags_t options, tsk_size_t num_threads)
+{
+    tsk_id_t ret = 0;
+    integrity_checker_t checker;
+
+    tsk_memset(&checker, 0, sizeof(checker));
+    if (num_threads < 2) {
+        ret = tsk_table_collection_check_integrity(self, options);
+        goto out;
+    }
+    options = tsk_table_collection_check_integrity_options(options);
+    if (!tsk_isfinite(self->sequence_length) || self->sequence_length <= 0) {
+        ret = tsk_trace_error(TSK_ERR_BAD_SEQUENCE_LENGTH);
+        goto out;
+    }
+    ret = integrity_checker_init(&checker, self, options);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = integrity_checker_run(&checker, num_threads);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_check_trees(self, options);
+out:
+    integrity_checker_free(&checker);
+    return ret;
+}
+
+void
+tsk_table_collection_print_state(const tsk_table_collection_t *self, FILE *out)
+{
+    fprintf(out, "Table collection state\n");
+    fprintf(out, "sequence_length = %f\n", self->sequence_length);
+
+    write_metadata_schema_header(
+        out, self->metadata_schema, self->metadata_schema_length);
+    fprintf(out, "#metadata#\n");
+    fprintf(out, "%.*s\n", (int) self->metadata_length, self->metadata);
+    fprintf(out, "#end#metadata\n");
+    fprintf(out, "#time_units#\n");
+    fprintf(out, "%.*s\n", (int) self->time_units_length, self->time_units);
+    fprintf(out, "#end#time_units\n");
+    tsk_individual_table_print_state(&self->individuals, out);
+    tsk_node_table_print_state(&self->nodes, out);
+    tsk_edge_table_print_state(&self->edges, out);
+    tsk_migration_table_print_state(&self->migrations, out);
+    tsk_site_table_print_state(&self->sites, out);
+    tsk_mutation_table_print_state(&self->mutations, out);
+    tsk_population_table_print_state(&self->populations, out);
+    tsk_provenance_table_print_state(&self->provenances, out);
+}
+
+static int TSK_WARN_UNUSED
+tsk_table_collection_init_allocator(tsk_table_collection_t *self, tsk_flags_t options,
+    const tsk_table_allocator_t *allocator)
+{
+    int ret = 0;
+    tsk_flags_t edge_options = 0;
+
+    tsk_memset(self, 0, sizeof(*self));
+    self->allocator = allocator;
+    if (options & TSK_TC_NO_EDGE_METADATA) {
+        edge_options |= TSK_TABLE_NO_METADATA;
+    }
+
+    /* Set default time_units value */
+    ret = tsk_table_collection_set_time_units(
+        self, TSK_TIME_UNITS_UNKNOWN, strlen(TSK_TIME_UNITS_UNKNOWN));
+    if (ret != 0) {
+        goto out;
+    }
+
+    ret = tsk_node_table_init_allocator(&self->nodes, 0, allocator);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_edge_table_init_allocator(&self->edges, edge_options, allocator);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_migration_table_init_allocator(&self->migrations, 0, allocator);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_site_table_init_allocator(&self->sites, 0, allocator);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_mutation_table_init_allocator(&self->mutations, 0, allocator);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_individual_table_init_allocator(&self->individuals, 0, allocator);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_population_table_init_allocator(&self->populations, 0, allocator);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_provenance_table_init_allocator(&self->provenances, 0, allocator);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_reference_sequence_init(&self->reference_sequence, 0);
+    if (ret != 0) {
+        goto out;
+    }
+out:
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_init(tsk_table_collection_t *self, tsk_flags_t options)
+{
+    return tsk_table_collection_init_allocator(self, options, NULL);
+}
+
+/* Columns of the tables that point into the store are not freed by the
+ * tables, and are released when the store is closed. The indexes and
+ * derived arrays are the only other arrays that may point into the store;
+ * everything else is copied on load. */
+static void
+tsk_table_collection_set_mapped_store(
+    tsk_table_collection_t *self, const kastore_t *store)
+{
+    self->individuals.mapped_store = store;
+    self->nodes.mapped_store = store;
+    self->edges.mapped_store = store;
+    self->migrations.mapped_store = store;
+    self->sites.mapped_store = store;
+    self->mutations.mapped_store = store;
+    self->populations.mapped_store = store;
+    self->provenances.mapped_store = store;
+}
+
+int
+tsk_table_collection_free(tsk_table_collection_t *self)
+{
+    tsk_individual_table_free(&self->individuals);
+    tsk_node_table_free(&self->nodes);
+    tsk_edge_table_free(&self->edges);
+    tsk_migration_table_free(&self->migrations);
+    tsk_site_table_free(&self->sites);
+    tsk_mutation_table_free(&self->mutations);
+    tsk_population_table_free(&self->populations);
+    tsk_provenance_table_free(&self->provenances);
+    tsk_reference_sequence_free(&self->reference_sequence);
+    tsk_table_collection_drop_index(self, 0);
+    tsk_safe_free(self->file_uuid);
+    tsk_safe_free(self->time_units);
+    tsk_safe_free(self->metadata);
+    tsk_safe_free(self->metadata_schema);
+    if (self->mapped_store != NULL) {
+        kastore_close(self->mapped_store);
+        tsk_safe_free(self->mapped_store);
+    }
+    return 0;
+}
+
+static bool
+table_allocator_is_valid(const tsk_table_allocator_t *allocator)
+{
+    bool has_malloc = allocator->malloc != NULL;
+
+    /* The functions must be set together, as they share the same memory */
+    return has_malloc == (allocator->realloc != NULL)
+           && has_malloc == (allocator->free != NULL)
+           && (allocator->growth_factor == 0 || allocator->growth_factor > 1);
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_set_allocator(
+    tsk_table_collection_t *self, const tsk_table_allocator_t *allocator)
+{
+    int ret = 0;
+    tsk_flags_t options = 0;
+    tsk_table_collection_t tables;
+
+    tsk_memset(&tables, 0, sizeof(tables));
+    if (allocator != NULL && !table_allocator_is_valid(allocator)) {
+        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+        goto out;
+    }
+    if (!tsk_edge_table_has_metadata(&self->edges)) {
+        options |= TSK_TC_NO_EDGE_METADATA;
+    }
+    /* Copy the tables into columns from the new allocator, and then swap
+     * them in. This also moves memory mapped columns into memory. */
+    ret = tsk_table_collection_init_allocator(&tables, options, allocator);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_copy(self, &tables, TSK_NO_INIT | TSK_COPY_FILE_UUID);
+    if (ret != 0) {
+        goto out;
+    }
+    tsk_table_collection_free(self);
+    tsk_memcpy(self, &tables, sizeof(tables));
+    tsk_memset(&tables, 0, sizeof(tables));
+out:
+    tsk_table_collection_free(&tables);
+    return ret;
+}
+
+bool
+tsk_table_collection_equals(const tsk_table_collection_t *self,
+    const tsk_table_collection_t *other, tsk_flags_t options)
+{
+    bool ret = self->sequence_length == other->sequence_length
+               && self->time_units_length == other->time_units_length
+               && tsk_memcmp(self->time_units, other->time_units,
+                      self->time_units_length * sizeof(char))
+                      == 0;
+    if (!(options & TSK_CMP_IGNORE_TABLES)) {
+        ret = ret
+              && tsk_individual_table_equals(
+                  &self->individuals, &other->individuals, options)
+              && tsk_node_table_equals(&self->nodes, &other->nodes, options)
+              && tsk_edge_table_equals(&self->edges, &other->edges, options)
+              && tsk_migration_table_equals(
+                  &self->migrations, &other->migrations, options)
+              && tsk_site_table_equals(&self->sites, &other->sites, options)
+              && tsk_mutation_table_equals(&self->mutations, &other->mutations, options)
+              && tsk_population_table_equals(
+                  &self->populations, &other->populations, options);
+        /* TSK_CMP_IGNORE_TABLES implies TSK_CMP_IGNORE_PROVENANCE */
+        if (!(options & TSK_CMP_IGNORE_PROVENANCE)) {
+            ret = ret
+                  && tsk_provenance_table_equals(
+                      &self->provenances, &other->provenances, options);
+        }
+    }
+    /* TSK_CMP_IGNORE_TS_METADATA is implied by TSK_CMP_IGNORE_METADATA */
+    if (options & TSK_CMP_IGNORE_METADATA) {
+        options |= TSK_CMP_IGNORE_TS_METADATA;
+    }
+    if (!(options & TSK_CMP_IGNORE_TS_METADATA)) {
+        ret = ret
+              && (self->metadata_length == other->metadata_length
+                  && self->metadata_schema_length == other->metadata_schema_length
+                  && tsk_memcmp(self->metadata, other->metadata,
+                         self->metadata_length * sizeof(char))
+                         == 0
+                  && tsk_memcmp(self->metadata_schema, other->metadata_schema,
+                         self->metadata_schema_length * sizeof(char))
+                         == 0);
+    }
+
+    if (!(options & TSK_CMP_IGNORE_REFERENCE_SEQUENCE)) {
+        ret = ret
+              && tsk_reference_sequence_equals(
+                  &self->reference_sequence, &other->reference_sequence, options);
+    }
+    return ret;
+}
+
+int
+tsk_table_collection_set_time_units(
+    tsk_table_collection_t *self, const char *time_units, tsk_size_t time_units_length)
+{
+    return replace_string(
+        &self->time_units, &self->time_units_length, time_units, time_units_length);
+}
+
+int
+tsk_table_collection_set_metadata(
+    tsk_table_collection_t *self, const char *metadata, tsk_size_t metadata_length)
+{
+    return replace_string(
+        &self->metadata, &self->metadata_length, metadata, metadata_length);
+}
+
+int
+tsk_table_collection_takeset_metadata(
+    tsk_table_collection_t *self, char *metadata, tsk_size_t metadata_length)
+{
+    return takeset_string(
+        &self->metadata, &self->metadata_length, metadata, metadata_length);
+}
+
+int
+tsk_table_collection_set_metadata_schema(tsk_table_collection_t *self,
+    const char *metadata_schema, tsk_size_t metadata_schema_length)
+{
+    return replace_string(&self->metadata_schema, &self->metadata_schema_length,
+        metadata_schema, metadata_schema_length);
+}
+
+int
+tsk_table_collection_set_indexes(tsk_table_collection_t *self,
+    tsk_id_t *edge_insertion_order, tsk_id_t *edge_removal_order)
+{
+    int ret = 0;
+    tsk_size_t index_size = self->edges.num_rows * sizeof(tsk_id_t);
+
+    tsk_table_collection_drop_index(self, 0);
+    self->indexes.edge_insertion_order = tsk_malloc(index_size);
+    self->indexes.edge_removal_order = tsk_malloc(index_size);
+    if (self->indexes.edge_insertion_order == NULL
+        || self->indexes.edge_removal_order == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    tsk_memcpy(self->indexes.edge_insertion_order, edge_insertion_order, index_size);
+    tsk_memcpy(self->indexes.edge_removal_order, edge_removal_order, index_size);
+    self->indexes.num_edges = self->edges.num_rows;
+out:
+    return ret;
+}
+
+int
+tsk_table_collection_takeset_indexes(tsk_table_collection_t *self,
+    tsk_id_t *edge_insertion_order, tsk_id_t *edge_removal_order)
+{
+    int ret = 0;
+
+    if (edge_insertion_order == NULL || edge_removal_order == NULL) {
+        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+        goto out;
+    }
+    tsk_table_collection_drop_index(self, 0);
+    self->indexes.edge_insertion_order = edge_insertion_order;
+    self->indexes.edge_removal_order = edge_removal_order;
+    self->indexes.num_edges = self->edges.num_rows;
+out:
+    return ret;
+}
+
+bool
+tsk_table_collection_has_index(
+    const tsk_table_collection_t *self, tsk_flags_t TSK_UNUSED(options))
+{
+    return self->indexes.edge_insertion_order != NULL
+           && self->indexes.edge_removal_order != NULL
+           && self->indexes.num_edges == self->edges.num_rows;
+}
+
+bool
+tsk_table_collection_has_reference_sequence(const tsk_table_collection_t *self)
+{
+    return !tsk_reference_sequence_is_null(&self->reference_sequence);
+}
+
+int
+tsk_table_collection_drop_index(
+    tsk_table_collection_t *self, tsk_flags_t TSK_UNUSED(options))
+{
+    free_store_array(self->mapped_store, (void **) &self->indexes.edge_insertion_order);
+    free_store_array(self->mapped_store, (void **) &self->indexes.edge_removal_order);
+    self->indexes.num_edges = 0;
+    return 0;
+}
+
+/* Index building. Edges sorted by tsk_table_collection_sort are in
+ * (time[parent], parent, child, left) order, so the insertion order is a
+ * stable sort of the edges by left coordinate, and the removal order a stable
+ * sort by right coordinate of the edges in reverse. Both are computed with the
+ * radix sort used for sorting edges, on keys that have the same order as the
+ * coordinates. Edges that share a parent, child and right coordinate, which
+ * can't be present in a valid tree sequence, are removed in reverse order.
+ *
+ * The edge ordering requirements allow parents with the same time to be in
+ * any order, and in this case we sort the edges with qsort instead. */
+
+static int
+index_sort_qsort(tsk_table_collection_t *self)
+{
+    int ret = 0;
+    tsk_size_t j;
+    double *time = self->nodes.time;
+    index_sort_t *sort_buff = NULL;
+    tsk_id_t parent;
+
+    sort_buff = tsk_malloc(self->edges.num_rows * sizeof(index_sort_t));
+    if (sort_buff == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    /* sort by left and increasing time to give us the order in which
+     * records should be inserted */
+    for (j = 0; j < self->edges.num_rows; j++) {
+        sort_buff[j].index = (tsk_id_t) j;
+        sort_buff[j].first = self->edges.left[j];
+        parent = self->edges.parent[j];
+        sort_buff[j].second = time[parent];
+        sort_buff[j].third = parent;
+        sort_buff[j].fourth = self->edges.child[j];
+    }
+    qsort(
+        sort_buff, (size_t) self->edges.num_rows, sizeof(index_sort_t), cmp_index_sort);
+    for (j = 0; j < self->edges.num_rows; j++) {
+        self->indexes.edge_insertion_order[j] = sort_buff[j].index;
+    }
+    /* sort by right and decreasing parent time to give us the order in which
+     * records should be removed. */
+    for (j = 0; j < self->edges.num_rows; j++) {
+        sort_buff[j].index = (tsk_id_t) j;
+        sort_buff[j].first = self->edges.right[j];
+        parent = self->edges.parent[j];
+        sort_buff[j].second = -time[parent];
+        sort_buff[j].third = -parent;
+        sort_buff[j].fourth = -self->edges.child[j];
+    }
+    qsort(
+        sort_buff, (size_t) self->edges.num_rows, sizeof(index_sort_t), cmp_index_sort);
+    for (j = 0; j < self->edges.num_rows; j++) {
+        self->indexes.edge_removal_order[j] = sort_buff[j].index;
+    }
+out:
+    tsk_safe_free(sort_buff);
+    return ret;
+}
+
+/* Returns true if the parents of edges with the same parent time are in
+ * increasing ID order. */
+static bool
+index_sort_parents_ordered(const tsk_table_collection_t *self)
+{
+    const tsk_id_t *parent = self->edges.parent;
+    const double *time = self->nodes.time;
+    tsk_size_t j;
+
+    for (j = 1; j < self->edges.num_rows; j++) {
+        if (parent[j] < parent[j - 1] && time[parent[j]] == time[parent[j - 1]]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+typedef struct {
+    edge_radix_sort_t sort;
+    const double *position;
+    bool reverse;
+    tsk_id_t *order;
+    int ret;
+} index_radix_sort_t;
+
+/* Non-negative doubles have the same order as their bit patterns. Genome
+ * coordinates have been checked to be non-negative, and adding zero maps
+ * -0 to 0. */
+static inline uint64_t
+index_radix_sort_key(double position)
+{
+    uint64_t key;
+
+    position += 0.0;
+    tsk_memcpy(&key, &position, sizeof(key));
+    return key;
+}
+
+static void
+index_radix_sort_make_keys(void *arg, tsk_size_t thread_index)
+{
+    index_radix_sort_t *self = (index_radix_sort_t *) arg;
+    const tsk_size_t n = self->sort.num_edges;
+    edge_radix_key_t *restrict keys = self->sort.keys;
+    const double *restrict position = self->position;
+    tsk_size_t j, k, chunk_start, chunk_end;
+
+    edge_radix_sort_chunk(&self->sort, thread_index, &chunk_start, &chunk_end);
+    for (j = chunk_start; j < chunk_end; j++) {
+        k = self->reverse ? n - 1 - j : j;
+        keys[j].key = index_radix_sort_key(position[k]);
+        keys[j].index = k;
+    }
+}
+
+static void
+index_radix_sort_gather(void *arg, tsk_size_t thread_index)
+{
+    index_radix_sort_t *self = (index_radix_sort_t *) arg;
+    const edge_radix_key_t *restrict keys = self->sort.keys;
+    tsk_id_t *restrict order = self->order;
+    tsk_size_t j, chunk_start, chunk_end;
+
+    edge_radix_sort_chunk(&self->sort, thread_index, &chunk_start, &chunk_end);
+    for (j = chunk_start; j < chunk_end; j++) {
+        order[j] = (tsk_id_t) keys[j].index;
+    }
+}
+
+static int
+index_radix_sort_run(index_radix_sort_t *self)
+{
+    int ret = 0;
+    edge_radix_sort_t *sort = &self->sort;
+
+    ret = tsk_thread_run_parallel(sort->num_threads, index_radix_sort_make_keys, self);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = edge_radix_sort_keys(sort, 64);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_thread_run_parallel(sort->num_threads, index_radix_sort_gather, self);
+out:
+    return ret;
+}
+
+static void
+index_radix_sort_worker(void *arg, tsk_size_t j)
+{
+    index_radix_sort_t *sorts = (index_radix_sort_t *) arg;
+
+    sorts[j].ret = index_radix_sort_run(&sorts[j]);
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_build_index(tsk_table_collection_t *self, tsk_flags_t options)
+{
+    return tsk_table_collection_build_index_parallel(self, options, 1);
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_build_index_parallel(tsk_table_collection_t *self,
+    tsk_flags_t TSK_UNUSED(options), tsk_size_t num_threads)
+{
+    int ret = TSK_ERR_GENERIC;
+    tsk_id_t ret_id;
+    tsk_size_t j;
+    const tsk_size_t n = self->edges.num_rows;
+    /* The two sorts are run concurrently if there is more than one thread */
+    const bool concurrent = num_threads > 1;
+    const tsk_size_t num_buffers = concurrent ? 2 : 1;
+    index_radix_sort_t sorts[2];
+    edge_radix_key_t *keys[2] = { NULL, NULL };
+    edge_radix_key_t *buffer[2] = { NULL, NULL };
+    tsk_size_t *counts[2] = { NULL, NULL };
+
+    tsk_memset(sorts, 0, sizeof(sorts));
+    /* For build indexes to make sense we must have referential integrity and
+     * sorted edges */
+    ret_id = tsk_table_collection_check_integrity_parallel(
+        self, TSK_CHECK_EDGE_ORDERING, num_threads);
+    if (ret_id != 0) {
+        ret = (int) ret_id;
+        goto out;
+    }
+
+    tsk_table_collection_drop_index(self, 0);
+    self->indexes.edge_insertion_order = tsk_malloc(n * sizeof(tsk_id_t));
+    self->indexes.edge_removal_order = tsk_malloc(n * sizeof(tsk_id_t));
+    if (self->indexes.edge_insertion_order == NULL
+        || self->indexes.edge_removal_order == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+
+    if (!index_sort_parents_ordered(self)) {
+        ret = index_sort_qsort(self);
+        if (ret != 0) {
+            goto out;
+        }
+        self->indexes.num_edges = n;
+        goto out;
+    }
+
+    num_threads = concurrent ? num_threads / 2 : 1;
+    /* Don't use more threads than there is work for */
+    num_threads = TSK_MIN(num_threads, n / 4096 + 1);
+    for (j = 0; j < num_buffers; j++) {
+        keys[j] = tsk_malloc(n * sizeof(*keys[j]));
+        buffer[j] = tsk_malloc(n * sizeof(*buffer[j]));
+        counts[j] = tsk_malloc(num_threads * EDGE_RADIX_SIZE * sizeof(*counts[j]));
+        if (keys[j] == NULL || buffer[j] == NULL || counts[j] == NULL) {
+            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+            goto out;
+        }
+    }
+    for (j = 0; j < 2; j++) {
+        sorts[j].sort.num_threads = num_threads;
+        sorts[j].sort.num_edges = n;
+        sorts[j].sort.keys = keys[j % num_buffers];
+        sorts[j].sort.buffer = buffer[j % num_buffers];
+        sorts[j].sort.counts = counts[j % num_buffers];
+    }
+    /* sort by left and increasing time to give us the order in which
+     * records should be inserted */
+    sorts[0].position = self->edges.left;
+    sorts[0].order = self->indexes.edge_insertion_order;
+    /* sort by right and decreasing parent time to give us the order in which
+     * records should be removed. */
+    sorts[1].position = self->edges.right;
+    sorts[1].reverse = true;
+    sorts[1].order = self->indexes.edge_removal_order;
+
+    if (concurrent) {
+        ret = tsk_thread_run_parallel(2, index_radix_sort_worker, sorts);
+        if (ret != 0) {
+            goto out;
+        }
+    } else {
+        index_radix_sort_worker(sorts, 0);
+        index_radix_sort_worker(sorts, 1);
+    }
+    for (j = 0; j < 2; j++) {
+        if (sorts[j].ret != 0) {
+            ret = sorts[j].ret;
+            goto out;
+        }
+    }
+    self->indexes.num_edges = n;
+    ret = 0;
+out:
+    for (j = 0; j < 2; j++) {
+        tsk_safe_free(keys[j]);
+        tsk_safe_free(buffer[j]);
+        tsk_safe_free(counts[j]);
+    }
+    return ret;
+}
+
+static int TSK_WARN_UNUSED
+tsk_table_collection_set_file_uuid(tsk_table_collection_t *self, const char *uuid)
+{
+    int ret = 0;
+
+    tsk_safe_free(self->file_uuid);
+    self->file_uuid = NULL;
+
+    if (uuid != NULL) {
+        /* Allow space for \0 so we can print it as a string */
+        self->file_uuid = tsk_malloc(TSK_UUID_SIZE + 1);
+        if (self->file_uuid == NULL) {
+            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+            goto out;
+        }
+        tsk_memcpy(self->file_uuid, uuid, TSK_UUID_SIZE);
+        self->file_uuid[TSK_UUID_SIZE] = '\0';
+    }
+out:
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_copy(const tsk_table_collection_t *self,
+    tsk_table_collection_t *dest, tsk_flags_t options)
+{
+    int ret = 0;
+
+    if (!(options & TSK_NO_INIT)) {
+        ret = tsk_table_collection_init(dest, options);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    ret = tsk_node_table_copy(&self->nodes, &dest->nodes, TSK_NO_INIT);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_edge_table_copy(&self->edges, &dest->edges, TSK_NO_INIT);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_migration_table_copy(&self->migrations, &dest->migrations, TSK_NO_INIT);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_site_table_copy(&self->sites, &dest->sites, TSK_NO_INIT);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_mutation_table_copy(&self->mutations, &dest->mutations, TSK_NO_INIT);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_individual_table_copy(&self->individuals, &dest->individuals, TSK_NO_INIT);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_population_table_copy(&self->populations, &dest->populations, TSK_NO_INIT);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_provenance_table_copy(&self->provenances, &dest->provenances, TSK_NO_INIT);
+    if (ret != 0) {
+        goto out;
+    }
+    dest->sequence_length = self->sequence_length;
+    if (tsk_table_collection_has_index(self, 0)) {
+        ret = tsk_table_collection_set_indexes(
+            dest, self->indexes.edge_insertion_order, self->indexes.edge_removal_order);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    ret = tsk_table_collection_set_time_units(
+        dest, self->time_units, self->time_units_length);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_set_metadata(dest, self->metadata, self->metadata_length);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_set_metadata_schema(
+        dest, self->metadata_schema, self->metadata_schema_length);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_reference_sequence_copy(
+        &self->reference_sequence, &dest->reference_sequence, options);
+    if (ret != 0) {
+        goto out;
+    }
+    if (options & TSK_COPY_FILE_UUID) {
+        /* The UUID should only be generated on writing to a file (see the call
+         * to generate_uuid in tsk_table_collection_write_format_data) and
+         * no other writing access is supported. We only read the value from
+         * the file, and raise an error if it's the wrong length there. Thus,
+         * finding a UUID value of any other length here is undefined behaviour.
+         */
+        tsk_bug_assert(
+            self->file_uuid == NULL || strlen(self->file_uuid) == TSK_UUID_SIZE);
+        ret = tsk_table_collection_set_file_uuid(dest, self->file_uuid);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+out:
+    return ret;
+}
+
+static int TSK_WARN_UNUSED
+tsk_table_collection_read_format_data(
+    tsk_table_collection_t *self, kastore_t *store, tsk_flags_t options)
+{
+    int ret = 0;
+    size_t len;
+    uint32_t *version = NULL;
+    int8_t *format_name = NULL;
+    int8_t *uuid = NULL;
+    double *L = NULL;
+    char *time_units = NULL;
+    char *metadata = NULL;
+    char *metadata_schema = NULL;
+    size_t time_units_length, metadata_length, metadata_schema_length;
+    /* TODO we could simplify this function quite a bit if we use the
+     * read_table_properties infrastructure. We would need to add the
+     * ability to have non-optional columns to that though. */
+
+    ret = kastore_gets_int8(store, "format/name", &format_name, &len);
+    if (ret != 0) {
+        ret = tsk_set_kas_error(ret);
+        goto out;
+    }
+    if (len != TSK_FILE_FORMAT_NAME_LENGTH) {
+        ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+        goto out;
+    }
+    if (tsk_memcmp(TSK_FILE_FORMAT_NAME, format_name, TSK_FILE_FORMAT_NAME_LENGTH)
+        != 0) {
+        ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+        goto out;
+    }
+
+    ret = kastore_gets_uint32(store, "format/version", &version, &len);
+    if (ret != 0) {
+        ret = tsk_set_kas_error(ret);
+        goto out;
+    }
+    if (len != 2) {
+        ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+        goto out;
+    }
+    if (version[0] < TSK_FILE_FORMAT_VERSION_MAJOR) {
+        ret = tsk_trace_error(TSK_ERR_FILE_VERSION_TOO_OLD);
+        goto out;
+    }
+    if (version[0] > TSK_FILE_FORMAT_COMPRESSED_VERSION_MAJOR) {
+        ret = tsk_trace_error(TSK_ERR_FILE_VERSION_TOO_NEW);
+        goto out;
+    }
+
+    ret = kastore_gets_float64(store, "sequence_length", &L, &len);
+    if (ret != 0) {
+        ret = tsk_set_kas_error(ret);
+        goto out;
+    }
+    if (len != 1) {
+        ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+        goto out;
+    }
+    if (L[0] <= 0.0) {
+        ret = tsk_trace_error(TSK_ERR_BAD_SEQUENCE_LENGTH);
+        goto out;
+    }
+    self->sequence_length = L[0];
+
+    ret = kastore_gets_int8(store, "uuid", &uuid, &len);
+    if (ret != 0) {
+        ret = tsk_set_kas_error(ret);
+        goto out;
+    }
+    if (len != TSK_UUID_SIZE) {
+        ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+        goto out;
+    }
+    ret = tsk_table_collection_set_file_uuid(self, (const char *) uuid);
+    if (ret != 0) {
+        goto out;
+    }
+
+    ret = kastore_containss(store, "time_units");
+    if (ret < 0) {
+        ret = tsk_set_kas_error(ret);
+        goto out;
+    }
+    if (ret == 1) {
+        ret = kastore_gets_int8(
+            store, "time_units", (int8_t **) &time_units, &time_units_length);
+        if (ret != 0) {
+            ret = tsk_set_kas_error(ret);
+            goto out;
+        }
+        ret = tsk_table_collection_set_time_units(
+            self, time_units, (tsk_size_t) time_units_length);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    ret = kastore_containss(store, "metadata");
+    if (ret < 0) {
+        ret = tsk_set_kas_error(ret);
+        goto out;
+    }
+    if (ret == 1) {
+        ret = kastore_gets_int8(
+            store, "metadata", (int8_t **) &metadata, &metadata_length);
+        if (ret != 0) {
+            ret = tsk_set_kas_error(ret);
             goto out;
         }
-        num_trees++;
+        if (options & (TSK_LOAD_COPY_COLUMNS | TSK_LOAD_MMAP)) {
+            ret = tsk_table_collection_set_metadata(
+                self, metadata, (tsk_size_t) metadata_length);
+            if (ret != 0) {
+                goto out;
+            }
+        } else {
+            ret = tsk_table_collection_takeset_metadata(
+                self, metadata, (tsk_size_t) metadata_length);
+            if (ret != 0) {
+                goto out;
+            }
+            metadata = NULL;
+        }
     }
-    tsk_bug_assert(j == num_edges);
-    while (k < num_edges) {
-        /* At this point it must be that used_edges[O[k]] == 1,
-         * since otherwise we would have added a different edge twice,
-         * and so hit the error above. */
-        e = O[k];
-        if (edge_right[e] != sequence_length) {
-            ret = tsk_trace_error(TSK_ERR_TABLES_BAD_INDEXES);
+
+    ret = kastore_containss(store, "metadata_schema");
+    if (ret < 0) {
+        ret = tsk_set_kas_error(ret);
+        goto out;
+    }
+    if (ret == 1) {
+        ret = kastore_gets_int8(store, "metadata_schema", (int8_t **) &metadata_schema,
+            (size_t *) &metadata_schema_length);
+        if (ret != 0) {
+            ret = tsk_set_kas_error(ret);
+            goto out;
+        }
+        ret = tsk_table_collection_set_metadata_schema(
+            self, metadata_schema, (tsk_size_t) metadata_schema_length);
+        if (ret != 0) {
             goto out;
         }
-        used_edges[e]++;
-        k++;
     }
-    ret = num_trees;
+
 out:
-    /* Can't use tsk_safe_free because of restrict*/
-    if (parent != NULL) {
-        free(parent);
+    if ((ret ^ (1 << TSK_KAS_ERR_BIT)) == KAS_ERR_KEY_NOT_FOUND) {
+        ret = tsk_trace_error(TSK_ERR_REQUIRED_COL_NOT_FOUND);
     }
-    if (used_edges != NULL) {
-        free(used_edges);
+    free_store_array(store, (void **) &version);
+    free_store_array(store, (void **) &format_name);
+    free_store_array(store, (void **) &uuid);
+    free_store_array(store, (void **) &L);
+    free_store_array(store, (void **) &time_units);
+    free_store_array(store, (void **) &metadata_schema);
+    free_store_array(store, (void **) &metadata);
+    return ret;
+}
+
+static int TSK_WARN_UNUSED
+tsk_table_collection_dump_indexes(
+    const tsk_table_collection_t *self, kastore_t *store, tsk_flags_t options)
+{
+    int ret = 0;
+    write_table_col_t cols[] = {
+        { "indexes/edge_insertion_order", NULL, self->indexes.num_edges,
+            TSK_ID_STORAGE_TYPE },
+        { "indexes/edge_removal_order", NULL, self->indexes.num_edges,
+            TSK_ID_STORAGE_TYPE },
+        { .name = NULL },
+    };
+
+    if (tsk_table_collection_has_index(self, 0)) {
+        cols[0].array = self->indexes.edge_insertion_order;
+        cols[1].array = self->indexes.edge_removal_order;
+        ret = write_table_cols(store, cols, options);
     }
     return ret;
 }
 
 static int TSK_WARN_UNUSED
-tsk_table_collection_check_index_integrity(const tsk_table_collection_t *self)
+tsk_table_collection_load_indexes(
+    tsk_table_collection_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
-    tsk_id_t j;
-    const tsk_id_t num_edges = (tsk_id_t) self->edges.num_rows;
-    const tsk_id_t *edge_insertion_order = self->indexes.edge_insertion_order;
-    const tsk_id_t *edge_removal_order = self->indexes.edge_removal_order;
+    tsk_id_t *edge_insertion_order = NULL;
+    tsk_id_t *edge_removal_order = NULL;
+    tsk_size_t num_rows;
 
-    if (!tsk_table_collection_has_index(self, 0)) {
-        ret = tsk_trace_error(TSK_ERR_TABLES_NOT_INDEXED);
+    read_table_col_t cols[] = {
+        { "indexes/edge_insertion_order", (void **) &edge_insertion_order,
+            TSK_ID_STORAGE_TYPE, TSK_COL_OPTIONAL },
+        { "indexes/edge_removal_order", (void **) &edge_removal_order,
+            TSK_ID_STORAGE_TYPE, TSK_COL_OPTIONAL },
+        { .name = NULL },
+    };
+
+    num_rows = TSK_NUM_ROWS_UNSET;
+    ret = read_table_cols(store, &num_rows, cols, 0);
+    if (ret != 0) {
         goto out;
     }
-    for (j = 0; j < num_edges; j++) {
-        if (edge_insertion_order[j] < 0 || edge_insertion_order[j] >= num_edges) {
-            ret = tsk_trace_error(TSK_ERR_EDGE_OUT_OF_BOUNDS);
+
+    if ((edge_insertion_order == NULL) != (edge_removal_order == NULL)) {
+        ret = tsk_trace_error(TSK_ERR_BOTH_COLUMNS_REQUIRED);
+        goto out;
+    }
+    if (edge_insertion_order != NULL) {
+        if (num_rows != self->edges.num_rows) {
+            ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
             goto out;
         }
-        if (edge_removal_order[j] < 0 || edge_removal_order[j] >= num_edges) {
-            ret = tsk_trace_error(TSK_ERR_EDGE_OUT_OF_BOUNDS);
+        if (options & TSK_LOAD_COPY_COLUMNS) {
+            ret = tsk_table_collection_set_indexes(
+                self, edge_insertion_order, edge_removal_order);
+            goto out;
+        }
+        ret = tsk_table_collection_takeset_indexes(
+            self, edge_insertion_order, edge_removal_order);
+        if (ret != 0) {
             goto out;
         }
     }
+    edge_insertion_order = NULL;
+    edge_removal_order = NULL;
 out:
+    free_store_array(store, (void **) &edge_insertion_order);
+    free_store_array(store, (void **) &edge_removal_order);
     return ret;
 }
 
-static int TSK_WARN_UNUSED
-tsk_table_collection_compute_mutation_parents_to_array(
-    const tsk_table_collection_t *self, tsk_id_t *mutation_parent)
+static int
+tsk_table_collection_load_reference_sequence(
+    tsk_table_collection_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
-    const tsk_id_t *I, *O;
-    const tsk_edge_table_t edges = self->edges;
-    const tsk_node_table_t nodes = self->nodes;
-    const tsk_site_table_t sites = self->sites;
-    const tsk_mutation_table_t mutations = self->mutations;
-    const tsk_id_t M = (tsk_id_t) edges.num_rows;
-    tsk_id_t tj, tk;
-    tsk_id_t *parent = NULL;
-    tsk_id_t *bottom_mutation = NULL;
-    tsk_id_t u;
-    double left, right;
-    tsk_id_t site;
-    /* Using unsigned values here avoids potentially undefined behaviour */
-    tsk_size_t j, mutation, first_mutation;
+    char *data = NULL;
+    char *url = NULL;
+    char *metadata = NULL;
+    char *metadata_schema = NULL;
+    tsk_size_t data_length = 0, url_length, metadata_length, metadata_schema_length;
+    /* Mapped arrays are copied, so that they can be replaced like any others */
+    const bool copy = options & (TSK_LOAD_COPY_COLUMNS | TSK_LOAD_MMAP);
 
-    parent = tsk_malloc(nodes.num_rows * sizeof(*parent));
-    bottom_mutation = tsk_malloc(nodes.num_rows * sizeof(*bottom_mutation));
-    if (parent == NULL || bottom_mutation == NULL) {
-        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+    read_table_property_t properties[] = {
+        { "reference_sequence/data", (void **) &data, &data_length, KAS_UINT8,
+            TSK_COL_OPTIONAL },
+        { "reference_sequence/url", (void **) &url, &url_length, KAS_UINT8,
+            TSK_COL_OPTIONAL },
+        { "reference_sequence/metadata", (void **) &metadata, &metadata_length,
+            KAS_UINT8, TSK_COL_OPTIONAL },
+        { "reference_sequence/metadata_schema", (void **) &metadata_schema,
+            &metadata_schema_length, KAS_UINT8, TSK_COL_OPTIONAL },
+        { .name = NULL },
+    };
+
+    ret = read_table_properties(store, properties, 0);
+    if (ret != 0) {
         goto out;
     }
-    tsk_memset(parent, 0xff, nodes.num_rows * sizeof(*parent));
-    tsk_memset(bottom_mutation, 0xff, nodes.num_rows * sizeof(*bottom_mutation));
-    tsk_memset(mutation_parent, 0xff, self->mutations.num_rows * sizeof(tsk_id_t));
-
-    I = self->indexes.edge_insertion_order;
-    O = self->indexes.edge_removal_order;
-    tj = 0;
-    tk = 0;
-    site = 0;
-    mutation = 0;
-    left = 0;
-    while (tj < M || left < self->sequence_length) {
-        while (tk < M && edges.right[O[tk]] == left) {
-            parent[edges.child[O[tk]]] = TSK_NULL;
-            tk++;
+    if (data != NULL && copy) {
+        ret = tsk_reference_sequence_set_data(
+            &self->reference_sequence, data, (tsk_size_t) data_length);
+        if (ret != 0) {
+            goto out;
         }
-        while (tj < M && edges.left[I[tj]] == left) {
-            parent[edges.child[I[tj]]] = edges.parent[I[tj]];
-            tj++;
+    } else if (data != NULL) {
+        ret = tsk_reference_sequence_takeset_data(
+            &self->reference_sequence, data, (tsk_size_t) data_length);
+        if (ret != 0) {
+            goto out;
         }
-        right = self->sequence_length;
-        if (tj < M) {
-            right = TSK_MIN(right, edges.left[I[tj]]);
+        data = NULL;
+    }
+    if (metadata != NULL && copy) {
+        ret = tsk_reference_sequence_set_metadata(
+            &self->reference_sequence, metadata, (tsk_size_t) metadata_length);
+        if (ret != 0) {
+            goto out;
         }
-        if (tk < M) {
-            right = TSK_MIN(right, edges.right[O[tk]]);
+    } else if (metadata != NULL) {
+        ret = tsk_reference_sequence_takeset_metadata(
+            &self->reference_sequence, metadata, (tsk_size_t) metadata_length);
+        if (ret != 0) {
+            goto out;
         }
-
-        /* Tree is now ready. We look at each site on this tree in turn */
-        while (site < (tsk_id_t) sites.num_rows && sites.position[site] < right) {
-            /* Create a mapping from mutations to nodes. If we see more than one
-             * mutation at a node, the previously seen one must be the parent
-             * of the current since we assume they are in order. */
-            first_mutation = mutation;
-            while (mutation < mutations.num_rows && mutations.site[mutation] == site) {
-                u = mutations.node[mutation];
-                if (bottom_mutation[u] != TSK_NULL) {
-                    mutation_parent[mutation] = bottom_mutation[u];
-                }
-                bottom_mutation[u] = (tsk_id_t) mutation;
-                mutation++;
-            }
-            /* Make the common case of 1 mutation fast */
-            if (mutation > first_mutation + 1) {
-                /* If we have more than one mutation, compute the parent for each
-                 * one by traversing up the tree until we find a node that has a
-                 * mutation. */
-                for (j = first_mutation; j < mutation; j++) {
-                    if (mutation_parent[j] == TSK_NULL) {
-                        u = parent[mutations.node[j]];
-                        while (u != TSK_NULL && bottom_mutation[u] == TSK_NULL) {
-                            u = parent[u];
-                        }
-                        if (u != TSK_NULL) {
-                            mutation_parent[j] = bottom_mutation[u];
-                        }
-                    }
-                }
-            }
-            /* Reset the mapping for the next site */
-            for (j = first_mutation; j < mutation; j++) {
-                u = mutations.node[j];
-                bottom_mutation[u] = TSK_NULL;
-                /* Check that we haven't violated the sortedness property */
-                if (mutation_parent[j] > (tsk_id_t) j) {
-                    ret = tsk_trace_error(TSK_ERR_MUTATION_PARENT_AFTER_CHILD);
-                    goto out;
-                }
-            }
-            site++;
+        metadata = NULL;
+    }
+    if (metadata_schema != NULL) {
+        ret = tsk_reference_sequence_set_metadata_schema(&self->reference_sequence,
+            metadata_schema, (tsk_size_t) metadata_schema_length);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    if (url != NULL) {
+        ret = tsk_reference_sequence_set_url(
+            &self->reference_sequence, url, (tsk_size_t) url_length);
+        if (ret != 0) {
+            goto out;
         }
-        /* Move on to the next tree */
-        left = right;
     }
 
 out:
-    tsk_safe_free(parent);
-    tsk_safe_free(bottom_mutation);
+    free_read_table_mem(store, NULL, NULL, properties);
     return ret;
 }
 
+/* Read the table collection from the specified open store. */
 static int TSK_WARN_UNUSED
-tsk_table_collection_check_mutation_parents(const tsk_table_collection_t *self)
+tsk_table_collection_load_store(
+    tsk_table_collection_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
-    tsk_mutation_table_t mutations = self->mutations;
-    tsk_id_t *new_parents = NULL;
-    tsk_size_t j;
-
-    if (mutations.num_rows == 0) {
-        return ret;
-    }
 
-    new_parents = tsk_malloc(mutations.num_rows * sizeof(*new_parents));
-    if (new_parents == NULL) {
-        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
-        goto out;
+    if (self->allocator != NULL) {
+        /* The arrays returned by the store aren't from the table allocator */
+        options |= TSK_LOAD_COPY_COLUMNS;
     }
-
-    ret = tsk_table_collection_compute_mutation_parents_to_array(self, new_parents);
+    ret = tsk_table_collection_read_format_data(self, store, options);
     if (ret != 0) {
         goto out;
     }
-
-    for (j = 0; j < mutations.num_rows; j++) {
-        if (mutations.parent[j] != new_parents[j]) {
-            ret = tsk_trace_error(TSK_ERR_BAD_MUTATION_PARENT);
+    if (!(options & TSK_LOAD_SKIP_TABLES)) {
+        ret = tsk_node_table_load(&self->nodes, store, options);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_edge_table_load(&self->edges, store, options);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_site_table_load(&self->sites, store, options);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_mutation_table_load(&self->mutations, store, options);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_migration_table_load(&self->migrations, store, options);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_individual_table_load(&self->individuals, store, options);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_population_table_load(&self->populations, store, options);
+        if (ret != 0) {
+            goto out;
+        }
+        if (!(options & TSK_LOAD_SKIP_PROVENANCES)) {
+            ret = tsk_provenance_table_load(&self->provenances, store, options);
+            if (ret != 0) {
+                goto out;
+            }
+        }
+        ret = tsk_table_collection_load_indexes(self, store, options);
+        if (ret != 0) {
+            goto out;
+        }
+    } else {
+        ret = tsk_table_collection_build_index(self, 0);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    if (!(options & TSK_LOAD_SKIP_REFERENCE_SEQUENCE)) {
+        ret = tsk_table_collection_load_reference_sequence(self, store, options);
+        if (ret != 0) {
             goto out;
         }
     }
-
 out:
-    tsk_safe_free(new_parents);
     return ret;
 }
 
-tsk_id_t TSK_WARN_UNUSED
-tsk_table_collection_check_integrity(
-    const tsk_table_collection_t *self, tsk_flags_t options)
+/* Read the derived arrays stored alongside the tables under the "derived/"
+ * prefix. Arrays are only read if they were written to the same file as the
+ * tables, as recorded by the file uuid; arrays that are not found are left
+ * NULL. Unless the store is memory mapped, the caller owns the arrays. */
+static int TSK_WARN_UNUSED
+tsk_table_collection_load_derived_arrays(tsk_table_collection_t *self,
+    kastore_t *store, tsk_derived_array_t *arrays, tsk_size_t num_arrays)
 {
-    tsk_id_t ret = 0;
-    int mut_ret = 0;
-
-    if (options & TSK_CHECK_MUTATION_PARENTS) {
-        /* If we're checking mutation parents, we need to check the trees first */
-        options |= TSK_CHECK_TREES;
-    }
-
-    if (options & TSK_CHECK_TREES) {
-        /* Checking the trees implies these checks */
-        options |= TSK_CHECK_EDGE_ORDERING | TSK_CHECK_SITE_ORDERING
-                   | TSK_CHECK_SITE_DUPLICATES | TSK_CHECK_MUTATION_ORDERING
-                   | TSK_CHECK_MIGRATION_ORDERING | TSK_CHECK_INDEXES;
-    }
+    int ret = 0;
+    int type;
+    size_t len;
+    tsk_size_t j;
+    char *uuid = NULL;
+    char name[TSK_MAX_COL_NAME_LEN];
 
-    if (!tsk_isfinite(self->sequence_length) || self->sequence_length <= 0) {
-        ret = tsk_trace_error(TSK_ERR_BAD_SEQUENCE_LENGTH);
-        goto out;
-    }
-    ret = tsk_table_collection_check_offsets(self);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = tsk_table_collection_check_node_integrity(self, options);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = tsk_table_collection_check_edge_integrity(self, options);
-    if (ret != 0) {
-        goto out;
+    for (j = 0; j < num_arrays; j++) {
+        arrays[j].array = NULL;
+        arrays[j].length = 0;
     }
-    ret = tsk_table_collection_check_site_integrity(self, options);
-    if (ret != 0) {
+    if (self->file_uuid == NULL || !kastore_containss(store, "derived/uuid")) {
         goto out;
     }
-    ret = tsk_table_collection_check_mutation_integrity(self, options);
+    ret = kastore_gets(store, "derived/uuid", (void **) &uuid, &len, &type);
     if (ret != 0) {
+        ret = tsk_set_kas_error(ret);
         goto out;
     }
-    ret = tsk_table_collection_check_migration_integrity(self, options);
-    if (ret != 0) {
+    if (type != KAS_INT8) {
+        ret = tsk_trace_error(TSK_ERR_BAD_COLUMN_TYPE);
         goto out;
     }
-    ret = tsk_table_collection_check_individual_integrity(self, options);
-    if (ret != 0) {
+    if (len != TSK_UUID_SIZE || memcmp(uuid, self->file_uuid, TSK_UUID_SIZE) != 0) {
+        /* The arrays are stale, and must be recomputed */
         goto out;
     }
-
-    if (options & TSK_CHECK_INDEXES) {
-        ret = tsk_table_collection_check_index_integrity(self);
+    for (j = 0; j < num_arrays; j++) {
+        if (snprintf(name, sizeof(name), "derived/%s", arrays[j].name)
+            >= (int) sizeof(name)) {
+            ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+            goto out;
+        }
+        if (!kastore_containss(store, name)) {
+            continue;
+        }
+        ret = kastore_gets(store, name, &arrays[j].array, &len, &type);
         if (ret != 0) {
+            ret = tsk_set_kas_error(ret);
             goto out;
         }
-    }
-    if (options & TSK_CHECK_TREES) {
-        ret = tsk_table_collection_check_tree_integrity(self);
-        if (ret < 0) {
+        arrays[j].length = (tsk_size_t) len;
+        if (type != arrays[j].type) {
+            ret = tsk_trace_error(TSK_ERR_BAD_COLUMN_TYPE);
             goto out;
         }
-        /* This check requires tree integrity so do it last */
-        if (options & TSK_CHECK_MUTATION_PARENTS) {
-            mut_ret = tsk_table_collection_check_mutation_parents(self);
-            if (mut_ret != 0) {
-                ret = mut_ret;
-                goto out;
+    }
+out:
+    if (self->mapped_store == NULL) {
+        tsk_safe_free(uuid);
+    }
+    if (ret != 0) {
+        for (j = 0; j < num_arrays; j++) {
+            if (self->mapped_store == NULL) {
+                tsk_safe_free(arrays[j].array);
             }
+            arrays[j].array = NULL;
         }
     }
-out:
     return ret;
 }
 
-void
-tsk_table_collection_print_state(const tsk_table_collection_t *self, FILE *out)
-{
-    fprintf(out, "Table collection state\n");
-    fprintf(out, "sequence_length = %f\n", self->sequence_length);
-
-    write_metadata_schema_header(
-        out, self->metadata_schema, self->metadata_schema_length);
-    fprintf(out, "#metadata#\n");
-    fprintf(out, "%.*s\n", (int) self->metadata_length, self->metadata);
-    fprintf(out, "#end#metadata\n");
-    fprintf(out, "#time_units#\n");
-    fprintf(out, "%.*s\n", (int) self->time_units_length, self->time_units);
-    fprintf(out, "#end#time_units\n");
-    tsk_individual_table_print_state(&self->individuals, out);
-    tsk_node_table_print_state(&self->nodes, out);
-    tsk_edge_table_print_state(&self->edges, out);
-    tsk_migration_table_print_state(&self->migrations, out);
-    tsk_site_table_print_state(&self->sites, out);
-    tsk_mutation_table_print_state(&self->mutations, out);
-    tsk_population_table_print_state(&self->populations, out);
-    tsk_provenance_table_print_state(&self->provenances, out);
-}
-
-int TSK_WARN_UNUSED
-tsk_table_collection_init(tsk_table_collection_t *self, tsk_flags_t options)
+static int TSK_WARN_UNUSED
+tsk_table_collection_loadf_inited(tsk_table_collection_t *self, FILE *file,
+    tsk_derived_array_t *derived, tsk_size_t num_derived, tsk_size_t num_threads,
+    tsk_flags_t options)
 {
     int ret = 0;
-    tsk_flags_t edge_options = 0;
-
-    tsk_memset(self, 0, sizeof(*self));
-    if (options & TSK_TC_NO_EDGE_METADATA) {
-        edge_options |= TSK_TABLE_NO_METADATA;
-    }
+    kastore_t local_store;
+    kastore_t *store = &local_store;
 
-    /* Set default time_units value */
-    ret = tsk_table_collection_set_time_units(
-        self, TSK_TIME_UNITS_UNKNOWN, strlen(TSK_TIME_UNITS_UNKNOWN));
-    if (ret != 0) {
-        goto out;
+    int kas_flags = KAS_READ_ALL;
+    if (options
+        & (TSK_LOAD_SKIP_TABLES | TSK_LOAD_SKIP_REFERENCE_SEQUENCE
+            | TSK_LOAD_SKIP_METADATA | TSK_LOAD_SKIP_PROVENANCES)) {
+        /* Only read the arrays that we access from the file */
+        kas_flags = 0;
     }
+    kas_flags = kas_flags | KAS_GET_TAKES_OWNERSHIP;
 
-    ret = tsk_node_table_init(&self->nodes, 0);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = tsk_edge_table_init(&self->edges, edge_options);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = tsk_migration_table_init(&self->migrations, 0);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = tsk_site_table_init(&self->sites, 0);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = tsk_mutation_table_init(&self->mutations, 0);
-    if (ret != 0) {
+    tsk_memset(&local_store, 0, sizeof(local_store));
+    if (self->mapped_store != NULL
+        || (self->allocator != NULL && (options & TSK_LOAD_MMAP))) {
+        /* Overwriting the columns of a mapped collection would free them, and
+         * mapped columns can't come from the table allocator */
+        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
         goto out;
     }
-    ret = tsk_individual_table_init(&self->individuals, 0);
-    if (ret != 0) {
-        goto out;
+    if (options & TSK_LOAD_MMAP) {
+        /* The store must outlive this function, as the columns point into
+         * the mapping. It is closed in tsk_table_collection_free. */
+        self->mapped_store = tsk_malloc(sizeof(*self->mapped_store));
+        if (self->mapped_store == NULL) {
+            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+            goto out;
+        }
+        tsk_memset(self->mapped_store, 0, sizeof(*self->mapped_store));
+        store = self->mapped_store;
+        tsk_table_collection_set_mapped_store(self, store);
+        kas_flags = KAS_READ_MMAP;
     }
-    ret = tsk_population_table_init(&self->populations, 0);
-    if (ret != 0) {
-        goto out;
+    if (options & TSK_LOAD_VERIFY) {
+        kas_flags |= KAS_VERIFY;
     }
-    ret = tsk_provenance_table_init(&self->provenances, 0);
+    ret = kastore_openf_threads(
+        store, file, "r", kas_flags, (int) TSK_MIN(num_threads, INT_MAX));
+
     if (ret != 0) {
+        if (ret == KAS_ERR_EOF) {
+            /* KAS_ERR_EOF means that we tried to read a store from the stream
+             * and we hit EOF immediately without reading any bytes. We signal
+             * this back to the client, which allows it to read an indefinite
+             * number of stores from a stream */
+            ret = tsk_trace_error(TSK_ERR_EOF);
+        } else {
+            ret = tsk_set_kas_error(ret);
+        }
         goto out;
     }
-    ret = tsk_reference_sequence_init(&self->reference_sequence, 0);
+    ret = tsk_table_collection_load_store(self, store, options);
     if (ret != 0) {
         goto out;
     }
-out:
-    return ret;
-}
-
-int
-tsk_table_collection_free(tsk_table_collection_t *self)
-{
-    tsk_individual_table_free(&self->individuals);
-    tsk_node_table_free(&self->nodes);
-    tsk_edge_table_free(&self->edges);
-    tsk_migration_table_free(&self->migrations);
-    tsk_site_table_free(&self->sites);
-    tsk_mutation_table_free(&self->mutations);
-    tsk_population_table_free(&self->populations);
-    tsk_provenance_table_free(&self->provenances);
-    tsk_reference_sequence_free(&self->reference_sequence);
-    tsk_safe_free(self->indexes.edge_insertion_order);
-    tsk_safe_free(self->indexes.edge_removal_order);
-    tsk_safe_free(self->file_uuid);
-    tsk_safe_free(self->time_units);
-    tsk_safe_free(self->metadata);
-    tsk_safe_free(self->metadata_schema);
-    return 0;
-}
-
-bool
-tsk_table_collection_equals(const tsk_table_collection_t *self,
-    const tsk_table_collection_t *other, tsk_flags_t options)
-{
-    bool ret = self->sequence_length == other->sequence_length
-               && self->time_units_length == other->time_units_length
-               && tsk_memcmp(self->time_units, other->time_units,
-                      self->time_units_length * sizeof(char))
-                      == 0;
-    if (!(options & TSK_CMP_IGNORE_TABLES)) {
-        ret = ret
-              && tsk_individual_table_equals(
-                  &self->individuals, &other->individuals, options)
-              && tsk_node_table_equals(&self->nodes, &other->nodes, options)
-              && tsk_edge_table_equals(&self->edges, &other->edges, options)
-              && tsk_migration_table_equals(
-                  &self->migrations, &other->migrations, options)
-              && tsk_site_table_equals(&self->sites, &other->sites, options)
-              && tsk_mutation_table_equals(&self->mutations, &other->mutations, options)
-              && tsk_population_table_equals(
-                  &self->populations, &other->populations, options);
-        /* TSK_CMP_IGNORE_TABLES implies TSK_CMP_IGNORE_PROVENANCE */
-        if (!(options & TSK_CMP_IGNORE_PROVENANCE)) {
-            ret = ret
-                  && tsk_provenance_table_equals(
-                      &self->provenances, &other->provenances, options);
-        }
-    }
-    /* TSK_CMP_IGNORE_TS_METADATA is implied by TSK_CMP_IGNORE_METADATA */
-    if (options & TSK_CMP_IGNORE_METADATA) {
-        options |= TSK_CMP_IGNORE_TS_METADATA;
+    if (num_derived > 0 && !(options & TSK_LOAD_SKIP_TABLES)) {
+        ret = tsk_table_collection_load_derived_arrays(
+            self, store, derived, num_derived);
+        if (ret != 0) {
+            goto out;
+        }
     }
-    if (!(options & TSK_CMP_IGNORE_TS_METADATA)) {
-        ret = ret
-              && (self->metadata_length == other->metadata_length
-                  && self->metadata_schema_length == other->metadata_schema_length
-                  && tsk_memcmp(self->metadata, other->metadata,
-                         self->metadata_length * sizeof(char))
-                         == 0
-                  && tsk_memcmp(self->metadata_schema, other->metadata_schema,
-                         self->metadata_schema_length * sizeof(char))
-                         == 0);
+    ret = kastore_close(&local_store);
+    if (ret != 0) {
+        goto out;
     }
+out:
+    /* If we're exiting on an error, we ignore any further errors that might come
+     * from kastore. In the nominal case, closing an already-closed store is a
+     * safe noop. A mapped store is left open, as it is released along with
+     * the columns that point into it. */
+    kastore_close(&local_store);
+    return ret;
+}
 
-    if (!(options & TSK_CMP_IGNORE_REFERENCE_SEQUENCE)) {
-        ret = ret
-              && tsk_reference_sequence_equals(
-                  &self->reference_sequence, &other->reference_sequence, options);
+static int TSK_WARN_UNUSED
+tsk_table_collection_loadf_internal(tsk_table_collection_t *self, FILE *file,
+    tsk_derived_array_t *derived, tsk_size_t num_derived, tsk_flags_t options)
+{
+    int ret = 0;
+
+    if (!(options & TSK_NO_INIT)) {
+        ret = tsk_table_collection_init(self, options);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    ret = tsk_table_collection_loadf_inited(
+        self, file, derived, num_derived, 1, options);
+    if (ret != 0) {
+        goto out;
     }
+out:
     return ret;
 }
 
-int
-tsk_table_collection_set_time_units(
-    tsk_table_collection_t *self, const char *time_units, tsk_size_t time_units_length)
+int TSK_WARN_UNUSED
+tsk_table_collection_loadf(tsk_table_collection_t *self, FILE *file, tsk_flags_t options)
 {
-    return replace_string(
-        &self->time_units, &self->time_units_length, time_units, time_units_length);
+    return tsk_table_collection_loadf_internal(self, file, NULL, 0, options);
 }
 
-int
-tsk_table_collection_set_metadata(
-    tsk_table_collection_t *self, const char *metadata, tsk_size_t metadata_length)
+int TSK_WARN_UNUSED
+tsk_table_collection_loadf_derived(tsk_table_collection_t *self, FILE *file,
+    tsk_derived_array_t *arrays, tsk_size_t num_arrays, tsk_flags_t options)
 {
-    return replace_string(
-        &self->metadata, &self->metadata_length, metadata, metadata_length);
+    return tsk_table_collection_loadf_internal(self, file, arrays, num_arrays, options);
 }
 
-int
-tsk_table_collection_takeset_metadata(
-    tsk_table_collection_t *self, char *metadata, tsk_size_t metadata_length)
+int TSK_WARN_UNUSED
+tsk_table_collection_reader_init(
+    tsk_table_collection_reader_t *self, FILE *file, tsk_flags_t options)
 {
-    return takeset_string(
-        &self->metadata, &self->metadata_length, metadata, metadata_length);
+    int ret = 0;
+
+    tsk_memset(self, 0, sizeof(*self));
+    self->file = file;
+    self->options = options;
+    ret = tsk_table_collection_init(&self->tables, options & TSK_TC_NO_EDGE_METADATA);
+    if (ret != 0) {
+        goto out;
+    }
+    if (options & TSK_LOAD_MMAP) {
+        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+        goto out;
+    }
+out:
+    return ret;
 }
 
 int
-tsk_table_collection_set_metadata_schema(tsk_table_collection_t *self,
-    const char *metadata_schema, tsk_size_t metadata_schema_length)
+tsk_table_collection_reader_free(tsk_table_collection_reader_t *self)
 {
-    return replace_string(&self->metadata_schema, &self->metadata_schema_length,
-        metadata_schema, metadata_schema_length);
+    tsk_table_collection_free(&self->tables);
+    tsk_safe_free(self->buffer);
+    return 0;
 }
 
-int
-tsk_table_collection_set_indexes(tsk_table_collection_t *self,
-    tsk_id_t *edge_insertion_order, tsk_id_t *edge_removal_order)
+/* Return the tables to the state of a newly initialised collection, keeping
+ * the memory allocated for the columns. */
+static int TSK_WARN_UNUSED
+tsk_table_collection_reader_reset(tsk_table_collection_reader_t *self)
 {
     int ret = 0;
-    tsk_size_t index_size = self->edges.num_rows * sizeof(tsk_id_t);
+    tsk_table_collection_t *tables = &self->tables;
+    tsk_flags_t clear_options = TSK_CLEAR_PROVENANCE | TSK_CLEAR_METADATA_SCHEMAS
+                                | TSK_CLEAR_TS_METADATA_AND_SCHEMA;
 
-    tsk_table_collection_drop_index(self, 0);
-    self->indexes.edge_insertion_order = tsk_malloc(index_size);
-    self->indexes.edge_removal_order = tsk_malloc(index_size);
-    if (self->indexes.edge_insertion_order == NULL
-        || self->indexes.edge_removal_order == NULL) {
-        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+    ret = tsk_table_collection_clear(tables, clear_options);
+    if (ret != 0) {
         goto out;
     }
-    tsk_memcpy(self->indexes.edge_insertion_order, edge_insertion_order, index_size);
-    tsk_memcpy(self->indexes.edge_removal_order, edge_removal_order, index_size);
-    self->indexes.num_edges = self->edges.num_rows;
+    ret = tsk_table_collection_set_time_units(
+        tables, TSK_TIME_UNITS_UNKNOWN, strlen(TSK_TIME_UNITS_UNKNOWN));
+    if (ret != 0) {
+        goto out;
+    }
+    tsk_reference_sequence_free(&tables->reference_sequence);
+    ret = tsk_reference_sequence_init(&tables->reference_sequence, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    tables->sequence_length = 0;
 out:
     return ret;
 }
 
-int
-tsk_table_collection_takeset_indexes(tsk_table_collection_t *self,
-    tsk_id_t *edge_insertion_order, tsk_id_t *edge_removal_order)
+int TSK_WARN_UNUSED
+tsk_table_collection_reader_next(tsk_table_collection_reader_t *self)
 {
     int ret = 0;
+    kastore_t store;
 
-    if (edge_insertion_order == NULL || edge_removal_order == NULL) {
-        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+    tsk_memset(&store, 0, sizeof(store));
+    ret = tsk_table_collection_reader_reset(self);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = kastore_openf_buffer(&store, self->file, &self->buffer, &self->buffer_size,
+        (self->options & TSK_LOAD_VERIFY) ? KAS_VERIFY : 0);
+    if (ret != 0) {
+        if (ret == KAS_ERR_EOF) {
+            ret = tsk_trace_error(TSK_ERR_EOF);
+        } else {
+            ret = tsk_set_kas_error(ret);
+        }
+        goto out;
+    }
+    ret = tsk_table_collection_load_store(
+        &self->tables, &store, self->options | TSK_LOAD_COPY_COLUMNS);
+    if (ret != 0) {
         goto out;
     }
-    tsk_table_collection_drop_index(self, 0);
-    self->indexes.edge_insertion_order = edge_insertion_order;
-    self->indexes.edge_removal_order = edge_removal_order;
-    self->indexes.num_edges = self->edges.num_rows;
 out:
+    /* The arrays in the store point into our buffer, so closing it only
+     * frees the item bookkeeping. */
+    kastore_close(&store);
     return ret;
 }
 
-bool
-tsk_table_collection_has_index(
-    const tsk_table_collection_t *self, tsk_flags_t TSK_UNUSED(options))
+static int TSK_WARN_UNUSED
+tsk_table_collection_load_internal(tsk_table_collection_t *self, const char *filename,
+    tsk_derived_array_t *derived, tsk_size_t num_derived, tsk_size_t num_threads,
+    tsk_flags_t options)
 {
-    return self->indexes.edge_insertion_order != NULL
-           && self->indexes.edge_removal_order != NULL
-           && self->indexes.num_edges == self->edges.num_rows;
+    int ret = 0;
+    FILE *file = NULL;
+
+    if (!(options & TSK_NO_INIT)) {
+        ret = tsk_table_collection_init(self, options);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    file = fopen(filename, "rb");
+    if (file == NULL) {
+        ret = tsk_trace_error(TSK_ERR_IO);
+        goto out;
+    }
+    ret = tsk_table_collection_loadf_inited(
+        self, file, derived, num_derived, num_threads, options);
+    if (ret != 0) {
+        goto out;
+    }
+    if (fclose(file) != 0) {
+        ret = tsk_trace_error(TSK_ERR_IO);
+        goto out;
+    }
+    file = NULL;
+out:
+    if (file != NULL) {
+        /* Ignore any additional errors we might get when closing the file
+         * in error conditions */
+        fclose(file);
+    }
+    return ret;
 }
 
-bool
-tsk_table_collection_has_reference_sequence(const tsk_table_collection_t *self)
+int TSK_WARN_UNUSED
+tsk_table_collection_load(
+    tsk_table_collection_t *self, const char *filename, tsk_flags_t options)
 {
-    return !tsk_reference_sequence_is_null(&self->reference_sequence);
+    return tsk_table_collection_load_internal(self, filename, NULL, 0, 1, options);
 }
 
-int
-tsk_table_collection_drop_index(
-    tsk_table_collection_t *self, tsk_flags_t TSK_UNUSED(options))
+int TSK_WARN_UNUSED
+tsk_table_collection_load_parallel(tsk_table_collection_t *self, const char *filename,
+    tsk_size_t num_threads, tsk_flags_t options)
 {
-    tsk_safe_free(self->indexes.edge_insertion_order);
-    tsk_safe_free(self->indexes.edge_removal_order);
-    self->indexes.edge_insertion_order = NULL;
-    self->indexes.edge_removal_order = NULL;
-    self->indexes.num_edges = 0;
-    return 0;
+    return tsk_table_collection_load_internal(
+        self, filename, NULL, 0, num_threads, options);
 }
 
 int TSK_WARN_UNUSED
-tsk_table_collection_build_index(
-    tsk_table_collection_t *self, tsk_flags_t TSK_UNUSED(options))
+tsk_table_collection_load_derived(tsk_table_collection_t *self, const char *filename,
+    tsk_derived_array_t *arrays, tsk_size_t num_arrays, tsk_flags_t options)
 {
-    int ret = TSK_ERR_GENERIC;
-    tsk_id_t ret_id;
-    tsk_size_t j;
-    double *time = self->nodes.time;
-    index_sort_t *sort_buff = NULL;
-    tsk_id_t parent;
+    return tsk_table_collection_load_internal(
+        self, filename, arrays, num_arrays, 1, options);
+}
 
-    /* For build indexes to make sense we must have referential integrity and
-     * sorted edges */
-    ret_id = tsk_table_collection_check_integrity(self, TSK_CHECK_EDGE_ORDERING);
-    if (ret_id != 0) {
-        ret = (int) ret_id;
-        goto out;
-    }
+/* Returns the index of the first element of the sorted array that is >= value. */
+static tsk_size_t
+search_sorted_id(const tsk_id_t *array, tsk_size_t size, tsk_id_t value)
+{
+    tsk_size_t lower = 0;
+    tsk_size_t upper = size;
+    tsk_size_t mid;
 
-    tsk_table_collection_drop_index(self, 0);
-    self->indexes.edge_insertion_order
-        = tsk_malloc(self->edges.num_rows * sizeof(tsk_id_t));
-    self->indexes.edge_removal_order
-        = tsk_malloc(self->edges.num_rows * sizeof(tsk_id_t));
-    sort_buff = tsk_malloc(self->edges.num_rows * sizeof(index_sort_t));
-    if (self->indexes.edge_insertion_order == NULL
-        || self->indexes.edge_removal_order == NULL || sort_buff == NULL) {
-        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
-        goto out;
+    while (lower < upper) {
+        mid = lower + (upper - lower) / 2;
+        if (array[mid] < value) {
+            lower = mid + 1;
+        } else {
+            upper = mid;
+        }
     }
+    return lower;
+}
 
-    /* sort by left and increasing time to give us the order in which
-     * records should be inserted */
-    for (j = 0; j < self->edges.num_rows; j++) {
-        sort_buff[j].index = (tsk_id_t) j;
-        sort_buff[j].first = self->edges.left[j];
-        parent = self->edges.parent[j];
-        sort_buff[j].second = time[parent];
-        sort_buff[j].third = parent;
-        sort_buff[j].fourth = self->edges.child[j];
-    }
-    qsort(
-        sort_buff, (size_t) self->edges.num_rows, sizeof(index_sort_t), cmp_index_sort);
-    for (j = 0; j < self->edges.num_rows; j++) {
-        self->indexes.edge_insertion_order[j] = sort_buff[j].index;
-    }
-    /* sort by right and decreasing parent time to give us the order in which
-     * records should be removed. */
-    for (j = 0; j < self->edges.num_rows; j++) {
-        sort_buff[j].index = (tsk_id_t) j;
-        sort_buff[j].first = self->edges.right[j];
-        parent = self->edges.parent[j];
-        sort_buff[j].second = -time[parent];
-        sort_buff[j].third = -parent;
-        sort_buff[j].fourth = -self->edges.child[j];
-    }
-    qsort(
-        sort_buff, (size_t) self->edges.num_rows, sizeof(index_sort_t), cmp_index_sort);
-    for (j = 0; j < self->edges.num_rows; j++) {
-        self->indexes.edge_removal_order[j] = sort_buff[j].index;
+/* Copy the edges that overlap [left, right) into dest, clipping their
+ * coordinates to the interval. Filtering and clipping preserve the
+ * sortedness of the table. */
+static int TSK_WARN_UNUSED
+tsk_table_collection_copy_interval_edges(const tsk_table_collection_t *self,
+    tsk_table_collection_t *dest, double left, double right)
+{
+    int ret = 0;
+    tsk_id_t ret_id;
+    tsk_size_t j;
+    const tsk_edge_table_t *edges = &self->edges;
+
+    for (j = 0; j < edges->num_rows; j++) {
+        if (edges->left[j] < right && edges->right[j] > left) {
+            ret_id = tsk_edge_table_add_row(&dest->edges, TSK_MAX(edges->left[j], left),
+                TSK_MIN(edges->right[j], right), edges->parent[j], edges->child[j],
+                edges->metadata + edges->metadata_offset[j],
+                edges->metadata_offset[j + 1] - edges->metadata_offset[j]);
+            if (ret_id < 0) {
+                ret = (int) ret_id;
+                goto out;
+            }
+        }
     }
-    self->indexes.num_edges = self->edges.num_rows;
-    ret = 0;
 out:
-    tsk_safe_free(sort_buff);
     return ret;
 }
 
+/* As for edges, copy the migrations that overlap [left, right) into dest. */
 static int TSK_WARN_UNUSED
-tsk_table_collection_set_file_uuid(tsk_table_collection_t *self, const char *uuid)
+tsk_table_collection_copy_interval_migrations(const tsk_table_collection_t *self,
+    tsk_table_collection_t *dest, double left, double right)
 {
     int ret = 0;
+    tsk_id_t ret_id;
+    tsk_size_t j;
+    const tsk_migration_table_t *migrations = &self->migrations;
+
+    for (j = 0; j < migrations->num_rows; j++) {
+        if (migrations->left[j] < right && migrations->right[j] > left) {
+            ret_id = tsk_migration_table_add_row(&dest->migrations,
+                TSK_MAX(migrations->left[j], left), TSK_MIN(migrations->right[j], right),
+                migrations->node[j], migrations->source[j], migrations->dest[j],
+                migrations->time[j],
+                migrations->metadata + migrations->metadata_offset[j],
+                migrations->metadata_offset[j + 1] - migrations->metadata_offset[j]);
+            if (ret_id < 0) {
+                ret = (int) ret_id;
+                goto out;
+            }
+        }
+    }
+out:
+    return ret;
+}
 
-    tsk_safe_free(self->file_uuid);
-    self->file_uuid = NULL;
-
-    if (uuid != NULL) {
-        /* Allow space for \0 so we can print it as a string */
-        self->file_uuid = tsk_malloc(TSK_UUID_SIZE + 1);
-        if (self->file_uuid == NULL) {
-            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+/* Copy the sites in [left, right) and their mutations into dest. As both
+ * tables are sorted, the rows to copy are found by binary search. */
+static int TSK_WARN_UNUSED
+tsk_table_collection_copy_interval_sites(const tsk_table_collection_t *self,
+    tsk_table_collection_t *dest, double left, double right)
+{
+    int ret = 0;
+    tsk_id_t ret_id, parent;
+    tsk_size_t j, site_start, site_end, mutation_start, mutation_end;
+    const tsk_site_table_t *sites = &self->sites;
+    const tsk_mutation_table_t *mutations = &self->mutations;
+
+    site_start = tsk_search_sorted(sites->position, sites->num_rows, left);
+    site_end = tsk_search_sorted(sites->position, sites->num_rows, right);
+    mutation_start
+        = search_sorted_id(mutations->site, mutations->num_rows, (tsk_id_t) site_start);
+    mutation_end
+        = search_sorted_id(mutations->site, mutations->num_rows, (tsk_id_t) site_end);
+
+    for (j = site_start; j < site_end; j++) {
+        ret_id = tsk_site_table_add_row(&dest->sites, sites->position[j],
+            sites->ancestral_state + sites->ancestral_state_offset[j],
+            sites->ancestral_state_offset[j + 1] - sites->ancestral_state_offset[j],
+            sites->metadata + sites->metadata_offset[j],
+            sites->metadata_offset[j + 1] - sites->metadata_offset[j]);
+        if (ret_id < 0) {
+            ret = (int) ret_id;
+            goto out;
+        }
+    }
+    for (j = mutation_start; j < mutation_end; j++) {
+        /* Parents are at the same site, and so within the range */
+        parent = mutations->parent[j];
+        if (parent < TSK_NULL || parent >= (tsk_id_t) mutations->num_rows) {
+            ret = tsk_trace_error(TSK_ERR_MUTATION_OUT_OF_BOUNDS);
+            goto out;
+        }
+        if (parent == (tsk_id_t) j) {
+            ret = tsk_trace_error(TSK_ERR_MUTATION_PARENT_EQUAL);
+            goto out;
+        }
+        if (parent > (tsk_id_t) j) {
+            ret = tsk_trace_error(TSK_ERR_MUTATION_PARENT_AFTER_CHILD);
+            goto out;
+        }
+        if (parent != TSK_NULL) {
+            if (parent < (tsk_id_t) mutation_start) {
+                ret = tsk_trace_error(TSK_ERR_MUTATION_PARENT_DIFFERENT_SITE);
+                goto out;
+            }
+            parent -= (tsk_id_t) mutation_start;
+        }
+        ret_id = tsk_mutation_table_add_row(&dest->mutations,
+            mutations->site[j] - (tsk_id_t) site_start, mutations->node[j], parent,
+            mutations->time[j],
+            mutations->derived_state + mutations->derived_state_offset[j],
+            mutations->derived_state_offset[j + 1] - mutations->derived_state_offset[j],
+            mutations->metadata + mutations->metadata_offset[j],
+            mutations->metadata_offset[j + 1] - mutations->metadata_offset[j]);
+        if (ret_id < 0) {
+            ret = (int) ret_id;
             goto out;
         }
-        tsk_memcpy(self->file_uuid, uuid, TSK_UUID_SIZE);
-        self->file_uuid[TSK_UUID_SIZE] = '\0';
     }
 out:
     return ret;
 }
 
-int TSK_WARN_UNUSED
-tsk_table_collection_copy(const tsk_table_collection_t *self,
-    tsk_table_collection_t *dest, tsk_flags_t options)
+/* Copy the parts of the specified sorted table collection that are within
+ * [left, right) into the initialised collection dest, keeping all nodes,
+ * individuals, populations and provenances. */
+static int TSK_WARN_UNUSED
+tsk_table_collection_copy_interval(const tsk_table_collection_t *self,
+    tsk_table_collection_t *dest, double left, double right)
 {
     int ret = 0;
 
-    if (!(options & TSK_NO_INIT)) {
-        ret = tsk_table_collection_init(dest, options);
-        if (ret != 0) {
-            goto out;
-        }
+    ret = tsk_table_collection_clear(dest, TSK_CLEAR_METADATA_SCHEMAS
+                                               | TSK_CLEAR_TS_METADATA_AND_SCHEMA
+                                               | TSK_CLEAR_PROVENANCE);
+    if (ret != 0) {
+        goto out;
     }
     ret = tsk_node_table_copy(&self->nodes, &dest->nodes, TSK_NO_INIT);
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_edge_table_copy(&self->edges, &dest->edges, TSK_NO_INIT);
+    ret = tsk_individual_table_copy(&self->individuals, &dest->individuals, TSK_NO_INIT);
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_migration_table_copy(&self->migrations, &dest->migrations, TSK_NO_INIT);
+    ret = tsk_population_table_copy(&self->populations, &dest->populations, TSK_NO_INIT);
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_site_table_copy(&self->sites, &dest->sites, TSK_NO_INIT);
+    ret = tsk_provenance_table_copy(&self->provenances, &dest->provenances, TSK_NO_INIT);
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_mutation_table_copy(&self->mutations, &dest->mutations, TSK_NO_INIT);
+    ret = tsk_edge_table_set_metadata_schema(&dest->edges,
+        self->edges.metadata_schema, self->edges.metadata_schema_length);
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_individual_table_copy(&self->individuals, &dest->individuals, TSK_NO_INIT);
+    ret = tsk_migration_table_set_metadata_schema(&dest->migrations,
+        self->migrations.metadata_schema, self->migrations.metadata_schema_length);
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_population_table_copy(&self->populations, &dest->populations, TSK_NO_INIT);
+    ret = tsk_site_table_set_metadata_schema(&dest->sites,
+        self->sites.metadata_schema, self->sites.metadata_schema_length);
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_provenance_table_copy(&self->provenances, &dest->provenances, TSK_NO_INIT);
+    ret = tsk_mutation_table_set_metadata_schema(&dest->mutations,
+        self->mutations.metadata_schema, self->mutations.metadata_schema_length);
     if (ret != 0) {
         goto out;
     }
-    dest->sequence_length = self->sequence_length;
-    if (tsk_table_collection_has_index(self, 0)) {
-        ret = tsk_table_collection_set_indexes(
-            dest, self->indexes.edge_insertion_order, self->indexes.edge_removal_order);
-        if (ret != 0) {
-            goto out;
-        }
+    ret = tsk_table_collection_copy_interval_edges(self, dest, left, right);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_copy_interval_migrations(self, dest, left, right);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_copy_interval_sites(self, dest, left, right);
+    if (ret != 0) {
+        goto out;
     }
+    dest->sequence_length = self->sequence_length;
     ret = tsk_table_collection_set_time_units(
         dest, self->time_units, self->time_units_length);
     if (ret != 0) {
@@ -11546,20 +15312,12 @@ tsk_table_collection_copy(const tsk_table_collection_t *self,
         goto out;
     }
     ret = tsk_reference_sequence_copy(
-        &self->reference_sequence, &dest->reference_sequence, options);
+        &self->reference_sequence, &dest->reference_sequence, TSK_NO_INIT);
     if (ret != 0) {
         goto out;
     }
-    if (options & TSK_COPY_FILE_UUID) {
-        /* The UUID should only be generated on writing to a file (see the call
-         * to generate_uuid in tsk_table_collection_write_format_data) and
-         * no other writing access is supported. We only read the value from
-         * the file, and raise an error if it's the wrong length there. Thus,
-         * finding a UUID value of any other length here is undefined behaviour.
-         */
-        tsk_bug_assert(
-            self->file_uuid == NULL || strlen(self->file_uuid) == TSK_UUID_SIZE);
-        ret = tsk_table_collection_set_file_uuid(dest, self->file_uuid);
+    if (tsk_table_collection_has_index(self, 0)) {
+        ret = tsk_table_collection_build_index(dest, 0);
         if (ret != 0) {
             goto out;
         }
@@ -11568,616 +15326,1204 @@ out:
     return ret;
 }
 
-static int TSK_WARN_UNUSED
-tsk_table_collection_read_format_data(tsk_table_collection_t *self, kastore_t *store)
+int TSK_WARN_UNUSED
+tsk_table_collection_load_interval(tsk_table_collection_t *self, const char *filename,
+    double left, double right, tsk_flags_t options)
 {
     int ret = 0;
-    size_t len;
-    uint32_t *version = NULL;
-    int8_t *format_name = NULL;
-    int8_t *uuid = NULL;
-    double *L = NULL;
-    char *time_units = NULL;
-    char *metadata = NULL;
-    char *metadata_schema = NULL;
-    size_t time_units_length, metadata_length, metadata_schema_length;
-    /* TODO we could simplify this function quite a bit if we use the
-     * read_table_properties infrastructure. We would need to add the
-     * ability to have non-optional columns to that though. */
+    tsk_id_t ret_id;
+    tsk_table_collection_t source;
+    tsk_flags_t load_options = options & ~(TSK_NO_INIT | TSK_LOAD_MMAP);
 
-    ret = kastore_gets_int8(store, "format/name", &format_name, &len);
+    tsk_memset(&source, 0, sizeof(source));
+    if (!(options & TSK_NO_INIT)) {
+        ret = tsk_table_collection_init(self, options);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    if (self->mapped_store != NULL) {
+        /* Mapped columns cannot be extended */
+        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+        goto out;
+    }
+#if !defined(_WIN32)
+    /* Map the file so that only the pages holding the columns we read are
+     * brought into memory; the sites and mutations outside the interval
+     * are never touched. */
+    load_options |= TSK_LOAD_MMAP;
+#endif
+    ret = tsk_table_collection_load(&source, filename, load_options);
     if (ret != 0) {
-        ret = tsk_set_kas_error(ret);
         goto out;
     }
-    if (len != TSK_FILE_FORMAT_NAME_LENGTH) {
-        ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+    if (!(tsk_isfinite(left) && tsk_isfinite(right) && 0 <= left && left < right
+            && right <= source.sequence_length)) {
+        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
         goto out;
     }
-    if (tsk_memcmp(TSK_FILE_FORMAT_NAME, format_name, TSK_FILE_FORMAT_NAME_LENGTH)
-        != 0) {
-        ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+    ret = tsk_table_collection_copy_interval(&source, self, left, right);
+    if (ret != 0) {
+        goto out;
+    }
+    /* The rows are found assuming that the tables are sorted, so check
+     * that this was the case for the rows that we kept. */
+    ret_id = tsk_table_collection_check_integrity(
+        self, TSK_CHECK_SITE_ORDERING | TSK_CHECK_MUTATION_ORDERING);
+    if (ret_id < 0) {
+        ret = (int) ret_id;
         goto out;
     }
+out:
+    tsk_table_collection_free(&source);
+    return ret;
+}
 
-    ret = kastore_gets_uint32(store, "format/version", &version, &len);
+/* Append the rows of the specified collection to the tables of this one, and
+ * replace its metadata with that of the other collection. */
+static int TSK_WARN_UNUSED
+tsk_table_collection_append_increment(tsk_table_collection_t *self,
+    const tsk_table_collection_t *other, tsk_flags_t options)
+{
+    int ret = 0;
+    bool edge_metadata = tsk_edge_table_has_metadata(&self->edges)
+                         && tsk_edge_table_has_metadata(&other->edges);
+
+    ret = tsk_individual_table_append_columns(&self->individuals,
+        other->individuals.num_rows, other->individuals.flags,
+        other->individuals.location, other->individuals.location_offset,
+        other->individuals.parents, other->individuals.parents_offset,
+        other->individuals.metadata, other->individuals.metadata_offset);
     if (ret != 0) {
-        ret = tsk_set_kas_error(ret);
         goto out;
     }
-    if (len != 2) {
-        ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+    ret = tsk_node_table_append_columns(&self->nodes, other->nodes.num_rows,
+        other->nodes.flags, other->nodes.time, other->nodes.population,
+        other->nodes.individual, other->nodes.metadata, other->nodes.metadata_offset);
+    if (ret != 0) {
         goto out;
     }
-    if (version[0] < TSK_FILE_FORMAT_VERSION_MAJOR) {
-        ret = tsk_trace_error(TSK_ERR_FILE_VERSION_TOO_OLD);
+    ret = tsk_edge_table_append_columns(&self->edges, other->edges.num_rows,
+        other->edges.left, other->edges.right, other->edges.parent, other->edges.child,
+        edge_metadata ? other->edges.metadata : NULL,
+        edge_metadata ? other->edges.metadata_offset : NULL);
+    if (ret != 0) {
         goto out;
     }
-    if (version[0] > TSK_FILE_FORMAT_VERSION_MAJOR) {
-        ret = tsk_trace_error(TSK_ERR_FILE_VERSION_TOO_NEW);
+    ret = tsk_migration_table_append_columns(&self->migrations,
+        other->migrations.num_rows, other->migrations.left, other->migrations.right,
+        other->migrations.node, other->migrations.source, other->migrations.dest,
+        other->migrations.time, other->migrations.metadata,
+        other->migrations.metadata_offset);
+    if (ret != 0) {
         goto out;
     }
-
-    ret = kastore_gets_float64(store, "sequence_length", &L, &len);
+    ret = tsk_site_table_append_columns(&self->sites, other->sites.num_rows,
+        other->sites.position, other->sites.ancestral_state,
+        other->sites.ancestral_state_offset, other->sites.metadata,
+        other->sites.metadata_offset);
     if (ret != 0) {
-        ret = tsk_set_kas_error(ret);
         goto out;
     }
-    if (len != 1) {
-        ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+    ret = tsk_mutation_table_append_columns(&self->mutations, other->mutations.num_rows,
+        other->mutations.site, other->mutations.node, other->mutations.parent,
+        other->mutations.time, other->mutations.derived_state,
+        other->mutations.derived_state_offset, other->mutations.metadata,
+        other->mutations.metadata_offset);
+    if (ret != 0) {
         goto out;
     }
-    if (L[0] <= 0.0) {
-        ret = tsk_trace_error(TSK_ERR_BAD_SEQUENCE_LENGTH);
+    ret = tsk_population_table_append_columns(&self->populations,
+        other->populations.num_rows, other->populations.metadata,
+        other->populations.metadata_offset);
+    if (ret != 0) {
         goto out;
     }
-    self->sequence_length = L[0];
+    if (!(options & TSK_LOAD_SKIP_PROVENANCES)) {
+        ret = tsk_provenance_table_append_columns(&self->provenances,
+            other->provenances.num_rows, other->provenances.timestamp,
+            other->provenances.timestamp_offset, other->provenances.record,
+            other->provenances.record_offset);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    if (other->edges.num_rows > 0) {
+        ret = tsk_table_collection_drop_index(self, 0);
+        if (ret != 0) {
+            goto out;
+        }
+    }
 
-    ret = kastore_gets_int8(store, "uuid", &uuid, &len);
+    self->sequence_length = other->sequence_length;
+    ret = tsk_table_collection_set_time_units(
+        self, other->time_units, other->time_units_length);
     if (ret != 0) {
-        ret = tsk_set_kas_error(ret);
         goto out;
     }
-    if (len != TSK_UUID_SIZE) {
-        ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+    ret = tsk_table_collection_set_metadata(
+        self, other->metadata, other->metadata_length);
+    if (ret != 0) {
         goto out;
     }
-    ret = tsk_table_collection_set_file_uuid(self, (const char *) uuid);
+    ret = tsk_table_collection_set_metadata_schema(
+        self, other->metadata_schema, other->metadata_schema_length);
     if (ret != 0) {
         goto out;
     }
-
-    ret = kastore_containss(store, "time_units");
-    if (ret < 0) {
-        ret = tsk_set_kas_error(ret);
+    ret = tsk_individual_table_set_metadata_schema(&self->individuals,
+        other->individuals.metadata_schema, other->individuals.metadata_schema_length);
+    if (ret != 0) {
         goto out;
     }
-    if (ret == 1) {
-        ret = kastore_gets_int8(
-            store, "time_units", (int8_t **) &time_units, &time_units_length);
-        if (ret != 0) {
+    ret = tsk_node_table_set_metadata_schema(&self->nodes, other->nodes.metadata_schema,
+        other->nodes.metadata_schema_length);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_edge_table_set_metadata_schema(&self->edges, other->edges.metadata_schema,
+        other->edges.metadata_schema_length);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_migration_table_set_metadata_schema(&self->migrations,
+        other->migrations.metadata_schema, other->migrations.metadata_schema_length);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_site_table_set_metadata_schema(&self->sites, other->sites.metadata_schema,
+        other->sites.metadata_schema_length);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_mutation_table_set_metadata_schema(&self->mutations,
+        other->mutations.metadata_schema, other->mutations.metadata_schema_length);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_population_table_set_metadata_schema(&self->populations,
+        other->populations.metadata_schema, other->populations.metadata_schema_length);
+out:
+    return ret;
+}
+
+/* Open the next store in a file of increments. Stores are always read in full,
+ * so that the stream is left positioned at the start of the following store. */
+static int TSK_WARN_UNUSED
+tsk_table_collection_openf_increment(kastore_t *store, FILE *file, tsk_flags_t options)
+{
+    int kas_flags = KAS_READ_ALL | KAS_GET_TAKES_OWNERSHIP;
+    int ret;
+
+    if (options & TSK_LOAD_VERIFY) {
+        kas_flags |= KAS_VERIFY;
+    }
+    ret = kastore_openf(store, file, "r", kas_flags);
+
+    if (ret != 0) {
+        if (ret == KAS_ERR_EOF) {
+            ret = tsk_trace_error(TSK_ERR_EOF);
+        } else {
             ret = tsk_set_kas_error(ret);
-            goto out;
-        }
-        ret = tsk_table_collection_set_time_units(
-            self, time_units, (tsk_size_t) time_units_length);
-        if (ret != 0) {
-            goto out;
         }
     }
-    ret = kastore_containss(store, "metadata");
-    if (ret < 0) {
+    return ret;
+}
+
+/* Read the next increment from the stream and append it to the collection.
+ * Returns TSK_ERR_EOF if there are no more increments. */
+static int TSK_WARN_UNUSED
+tsk_table_collection_loadf_increment(
+    tsk_table_collection_t *self, FILE *file, tsk_flags_t options)
+{
+    int ret = 0;
+    kastore_t store;
+    tsk_table_collection_t increment;
+    uint64_t *start = NULL;
+    tsk_size_t expected[TSK_NUM_BOOKMARK_TABLES];
+    tsk_bookmark_t position;
+    size_t j, len;
+
+    tsk_memset(&store, 0, sizeof(store));
+    ret = tsk_table_collection_init(&increment, options & TSK_TC_NO_EDGE_METADATA);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_openf_increment(&store, file, options);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = kastore_gets_uint64(&store, "increment/start", &start, &len);
+    if (ret == KAS_ERR_KEY_NOT_FOUND || (ret == 0 && len != TSK_NUM_BOOKMARK_TABLES)) {
+        ret = tsk_trace_error(TSK_ERR_BAD_INCREMENT);
+        goto out;
+    }
+    if (ret != 0) {
         ret = tsk_set_kas_error(ret);
         goto out;
     }
-    if (ret == 1) {
-        ret = kastore_gets_int8(
-            store, "metadata", (int8_t **) &metadata, &metadata_length);
-        if (ret != 0) {
-            ret = tsk_set_kas_error(ret);
+    /* The increment must follow on from the rows already loaded */
+    tsk_table_collection_record_num_rows(self, &position);
+    if (options & TSK_LOAD_SKIP_PROVENANCES) {
+        position.provenances = (tsk_size_t) start[TSK_NUM_BOOKMARK_TABLES - 1];
+    }
+    bookmark_to_array(&position, expected);
+    for (j = 0; j < TSK_NUM_BOOKMARK_TABLES; j++) {
+        if (start[j] != expected[j]) {
+            ret = tsk_trace_error(TSK_ERR_BAD_INCREMENT);
             goto out;
         }
-        ret = tsk_table_collection_takeset_metadata(
-            self, metadata, (tsk_size_t) metadata_length);
+    }
+    ret = tsk_table_collection_load_store(&increment, &store, options);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_append_increment(self, &increment, options);
+    if (ret != 0) {
+        goto out;
+    }
+out:
+    kastore_close(&store);
+    tsk_safe_free(start);
+    tsk_table_collection_free(&increment);
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_load_increments(
+    tsk_table_collection_t *self, const char *filename, tsk_flags_t options)
+{
+    int ret = 0;
+    FILE *file = NULL;
+    kastore_t store;
+
+    tsk_memset(&store, 0, sizeof(store));
+    if (!(options & TSK_NO_INIT)) {
+        ret = tsk_table_collection_init(self, options);
         if (ret != 0) {
             goto out;
         }
-        metadata = NULL;
     }
-
-    ret = kastore_containss(store, "metadata_schema");
-    if (ret < 0) {
+    if (options & TSK_LOAD_MMAP) {
+        /* Mapped columns cannot be extended */
+        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+        goto out;
+    }
+    file = fopen(filename, "rb");
+    if (file == NULL) {
+        ret = tsk_trace_error(TSK_ERR_IO);
+        goto out;
+    }
+    ret = tsk_table_collection_openf_increment(&store, file, options);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_load_store(self, &store, options);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = kastore_close(&store);
+    if (ret != 0) {
         ret = tsk_set_kas_error(ret);
         goto out;
     }
-    if (ret == 1) {
-        ret = kastore_gets_int8(store, "metadata_schema", (int8_t **) &metadata_schema,
-            (size_t *) &metadata_schema_length);
-        if (ret != 0) {
-            ret = tsk_set_kas_error(ret);
-            goto out;
+    while (!(options & TSK_LOAD_SKIP_TABLES)) {
+        ret = tsk_table_collection_loadf_increment(self, file, options);
+        if (ret == TSK_ERR_EOF) {
+            ret = 0;
+            break;
         }
-        ret = tsk_table_collection_set_metadata_schema(
-            self, metadata_schema, (tsk_size_t) metadata_schema_length);
         if (ret != 0) {
             goto out;
         }
     }
-
+    if (fclose(file) != 0) {
+        ret = tsk_trace_error(TSK_ERR_IO);
+        goto out;
+    }
+    file = NULL;
 out:
-    if ((ret ^ (1 << TSK_KAS_ERR_BIT)) == KAS_ERR_KEY_NOT_FOUND) {
-        ret = tsk_trace_error(TSK_ERR_REQUIRED_COL_NOT_FOUND);
+    kastore_close(&store);
+    if (file != NULL) {
+        fclose(file);
     }
-    tsk_safe_free(version);
-    tsk_safe_free(format_name);
-    tsk_safe_free(uuid);
-    tsk_safe_free(L);
-    tsk_safe_free(time_units);
-    tsk_safe_free(metadata_schema);
-    tsk_safe_free(metadata);
     return ret;
 }
 
 static int TSK_WARN_UNUSED
-tsk_table_collection_dump_indexes(const tsk_table_collection_t *self, kastore_t *store,
-    tsk_flags_t TSK_UNUSED(options))
+tsk_table_collection_dump_reference_sequence(const tsk_table_collection_t *self,
+    kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
-    write_table_col_t cols[] = {
-        { "indexes/edge_insertion_order", NULL, self->indexes.num_edges,
-            TSK_ID_STORAGE_TYPE },
-        { "indexes/edge_removal_order", NULL, self->indexes.num_edges,
-            TSK_ID_STORAGE_TYPE },
+    const tsk_reference_sequence_t *ref = &self->reference_sequence;
+    write_table_col_t write_cols[] = {
+        { "reference_sequence/data", (void *) ref->data, ref->data_length, KAS_UINT8 },
+        { "reference_sequence/url", (void *) ref->url, ref->url_length, KAS_UINT8 },
+        { "reference_sequence/metadata", (void *) ref->metadata, ref->metadata_length,
+            KAS_UINT8 },
+        { "reference_sequence/metadata_schema", (void *) ref->metadata_schema,
+            ref->metadata_schema_length, KAS_UINT8 },
         { .name = NULL },
     };
-
-    if (tsk_table_collection_has_index(self, 0)) {
-        cols[0].array = self->indexes.edge_insertion_order;
-        cols[1].array = self->indexes.edge_removal_order;
-        ret = write_table_cols(store, cols, 0);
+    if (tsk_table_collection_has_reference_sequence(self)) {
+        ret = write_table_cols(store, write_cols, options);
     }
     return ret;
 }
 
+/* Write the specified derived arrays under the "derived/" prefix, along with
+ * the uuid of the file that they are written to. Derived arrays are never
+ * compressed, as the arrays read from a memory mapped store are borrowed. */
 static int TSK_WARN_UNUSED
-tsk_table_collection_load_indexes(tsk_table_collection_t *self, kastore_t *store)
+tsk_table_collection_dump_derived_arrays(kastore_t *store, const char *uuid,
+    const tsk_derived_array_t *arrays, tsk_size_t num_arrays)
 {
     int ret = 0;
-    tsk_id_t *edge_insertion_order = NULL;
-    tsk_id_t *edge_removal_order = NULL;
-    tsk_size_t num_rows;
-
-    read_table_col_t cols[] = {
-        { "indexes/edge_insertion_order", (void **) &edge_insertion_order,
-            TSK_ID_STORAGE_TYPE, TSK_COL_OPTIONAL },
-        { "indexes/edge_removal_order", (void **) &edge_removal_order,
-            TSK_ID_STORAGE_TYPE, TSK_COL_OPTIONAL },
+    tsk_size_t j;
+    char name[TSK_MAX_COL_NAME_LEN];
+    write_table_col_t cols[] = {
+        { "derived/uuid", (const void *) uuid, TSK_UUID_SIZE, KAS_INT8 },
         { .name = NULL },
     };
 
-    num_rows = TSK_NUM_ROWS_UNSET;
-    ret = read_table_cols(store, &num_rows, cols, 0);
+    ret = write_table_cols(store, cols, 0);
     if (ret != 0) {
         goto out;
     }
-
-    if ((edge_insertion_order == NULL) != (edge_removal_order == NULL)) {
-        ret = tsk_trace_error(TSK_ERR_BOTH_COLUMNS_REQUIRED);
-        goto out;
-    }
-    if (edge_insertion_order != NULL) {
-        if (num_rows != self->edges.num_rows) {
-            ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+    for (j = 0; j < num_arrays; j++) {
+        if (snprintf(name, sizeof(name), "derived/%s", arrays[j].name)
+            >= (int) sizeof(name)) {
+            ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
             goto out;
         }
-        ret = tsk_table_collection_takeset_indexes(
-            self, edge_insertion_order, edge_removal_order);
+        cols[0].name = name;
+        cols[0].array = arrays[j].array;
+        cols[0].len = arrays[j].length;
+        cols[0].type = arrays[j].type;
+        ret = write_table_cols(store, cols, 0);
         if (ret != 0) {
             goto out;
         }
     }
-    edge_insertion_order = NULL;
-    edge_removal_order = NULL;
 out:
-    tsk_safe_free(edge_insertion_order);
-    tsk_safe_free(edge_removal_order);
     return ret;
 }
 
-static int
-tsk_table_collection_load_reference_sequence(
-    tsk_table_collection_t *self, kastore_t *store)
+/* Write the table collection to the specified stream. If start is not NULL
+ * the collection is an increment holding the rows following the specified
+ * bookmark, which is recorded in the file. Any derived arrays are stored
+ * alongside the tables. */
+static int TSK_WARN_UNUSED
+tsk_table_collection_dumpf_internal(const tsk_table_collection_t *self, FILE *file,
+    const tsk_bookmark_t *start, const tsk_derived_array_t *derived,
+    tsk_size_t num_derived, tsk_size_t num_threads, tsk_flags_t options)
 {
     int ret = 0;
-    char *data = NULL;
-    char *url = NULL;
-    char *metadata = NULL;
-    char *metadata_schema = NULL;
-    tsk_size_t data_length = 0, url_length, metadata_length, metadata_schema_length;
-
-    read_table_property_t properties[] = {
-        { "reference_sequence/data", (void **) &data, &data_length, KAS_UINT8,
-            TSK_COL_OPTIONAL },
-        { "reference_sequence/url", (void **) &url, &url_length, KAS_UINT8,
-            TSK_COL_OPTIONAL },
-        { "reference_sequence/metadata", (void **) &metadata, &metadata_length,
-            KAS_UINT8, TSK_COL_OPTIONAL },
-        { "reference_sequence/metadata_schema", (void **) &metadata_schema,
-            &metadata_schema_length, KAS_UINT8, TSK_COL_OPTIONAL },
+    int kas_flags = 0;
+    kastore_t store;
+    char uuid[TSK_UUID_SIZE + 1]; // Must include space for trailing null.
+    tsk_size_t increment_start[TSK_NUM_BOOKMARK_TABLES];
+    uint32_t version[]
+        = { TSK_FILE_FORMAT_VERSION_MAJOR, TSK_FILE_FORMAT_VERSION_MINOR };
+    write_table_col_t increment_columns[] = {
+        { "increment/start", (void *) increment_start, TSK_NUM_BOOKMARK_TABLES,
+            TSK_SIZE_STORAGE_TYPE },
+        { .name = NULL },
+    };
+    write_table_col_t format_columns[] = {
+        { "format/name", (const void *) &TSK_FILE_FORMAT_NAME,
+            TSK_FILE_FORMAT_NAME_LENGTH, KAS_INT8 },
+        { "format/version", (const void *) version, 2, KAS_UINT32 },
+        { "sequence_length", (const void *) &self->sequence_length, 1, KAS_FLOAT64 },
+        { "uuid", (void *) uuid, TSK_UUID_SIZE, KAS_INT8 },
+        { "time_units", (void *) self->time_units, self->time_units_length, KAS_INT8 },
+        { "metadata", (void *) self->metadata, self->metadata_length, KAS_INT8 },
+        { "metadata_schema", (void *) self->metadata_schema,
+            self->metadata_schema_length, KAS_INT8 },
         { .name = NULL },
     };
 
-    ret = read_table_properties(store, properties, 0);
+    tsk_memset(&store, 0, sizeof(store));
+
+    if (options & TSK_DUMP_NO_CHECKSUMS) {
+        kas_flags = KAS_NO_CHECKSUMS;
+    }
+    ret = kastore_openf_threads(
+        &store, file, "w", kas_flags, (int) TSK_MIN(num_threads, INT_MAX));
     if (ret != 0) {
+        ret = tsk_set_kas_error(ret);
         goto out;
     }
-    if (data != NULL) {
-        ret = tsk_reference_sequence_takeset_data(
-            &self->reference_sequence, data, (tsk_size_t) data_length);
-        if (ret != 0) {
-            goto out;
-        }
-        data = NULL;
+
+    /* Write format data */
+    ret = tsk_generate_uuid(uuid, 0);
+    if (ret != 0) {
+        goto out;
     }
-    if (metadata != NULL) {
-        ret = tsk_reference_sequence_takeset_metadata(
-            &self->reference_sequence, metadata, (tsk_size_t) metadata_length);
-        if (ret != 0) {
-            goto out;
-        }
-        metadata = NULL;
+
+    if (options & TSK_DUMP_COMPRESS) {
+        version[0] = TSK_FILE_FORMAT_COMPRESSED_VERSION_MAJOR;
     }
-    if (metadata_schema != NULL) {
-        ret = tsk_reference_sequence_set_metadata_schema(&self->reference_sequence,
-            metadata_schema, (tsk_size_t) metadata_schema_length);
+    /* The format data is read directly from the store, so is never compressed */
+    ret = write_table_cols(&store, format_columns, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    if (start != NULL) {
+        bookmark_to_array(start, increment_start);
+        ret = write_table_cols(&store, increment_columns, 0);
         if (ret != 0) {
             goto out;
         }
     }
-    if (url != NULL) {
-        ret = tsk_reference_sequence_set_url(
-            &self->reference_sequence, url, (tsk_size_t) url_length);
+    if (num_derived > 0) {
+        ret = tsk_table_collection_dump_derived_arrays(
+            &store, uuid, derived, num_derived);
         if (ret != 0) {
             goto out;
         }
     }
 
+    /* All of these functions will set the kas_error internally, so we don't have
+     * to modify the return value. */
+    ret = tsk_node_table_dump(&self->nodes, &store, options);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_edge_table_dump(&self->edges, &store, options);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_site_table_dump(&self->sites, &store, options);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_migration_table_dump(&self->migrations, &store, options);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_mutation_table_dump(&self->mutations, &store, options);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_individual_table_dump(&self->individuals, &store, options);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_population_table_dump(&self->populations, &store, options);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_provenance_table_dump(&self->provenances, &store, options);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_dump_indexes(self, &store, options);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_dump_reference_sequence(self, &store, options);
+    if (ret != 0) {
+        goto out;
+    }
+
+    ret = kastore_close(&store);
+    if (ret != 0) {
+        ret = tsk_set_kas_error(ret);
+        goto out;
+    }
 out:
-    free_read_table_mem(NULL, NULL, properties);
+    /* It's safe to close a kastore twice. */
+    if (ret != 0) {
+        kastore_close(&store);
+    }
     return ret;
 }
 
 static int TSK_WARN_UNUSED
-tsk_table_collection_loadf_inited(
-    tsk_table_collection_t *self, FILE *file, tsk_flags_t options)
+tsk_table_collection_dump_internal(const tsk_table_collection_t *self,
+    const char *filename, const tsk_derived_array_t *derived, tsk_size_t num_derived,
+    tsk_size_t num_threads, tsk_flags_t options)
 {
     int ret = 0;
-    kastore_t store;
+    FILE *file = fopen(filename, "wb");
 
-    int kas_flags = KAS_READ_ALL;
-    if ((options & TSK_LOAD_SKIP_TABLES)
-        || (options & TSK_LOAD_SKIP_REFERENCE_SEQUENCE)) {
-        kas_flags = 0;
+    if (file == NULL) {
+        ret = tsk_trace_error(TSK_ERR_IO);
+        goto out;
     }
-    kas_flags = kas_flags | KAS_GET_TAKES_OWNERSHIP;
-    ret = kastore_openf(&store, file, "r", kas_flags);
-
+    ret = tsk_table_collection_dumpf_internal(
+        self, file, NULL, derived, num_derived, num_threads, options);
     if (ret != 0) {
-        if (ret == KAS_ERR_EOF) {
-            /* KAS_ERR_EOF means that we tried to read a store from the stream
-             * and we hit EOF immediately without reading any bytes. We signal
-             * this back to the client, which allows it to read an indefinite
-             * number of stores from a stream */
-            ret = tsk_trace_error(TSK_ERR_EOF);
-        } else {
-            ret = tsk_set_kas_error(ret);
-        }
         goto out;
     }
-    ret = tsk_table_collection_read_format_data(self, &store);
-    if (ret != 0) {
+    if (fclose(file) != 0) {
+        ret = tsk_trace_error(TSK_ERR_IO);
+        goto out;
+    }
+    file = NULL;
+out:
+    if (file != NULL) {
+        /* Ignore any additional errors we might get when closing the file
+         * in error conditions */
+        fclose(file);
+        /* If an error occurred make sure that the filename is removed */
+        remove(filename);
+    }
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_dump(
+    const tsk_table_collection_t *self, const char *filename, tsk_flags_t options)
+{
+    return tsk_table_collection_dump_internal(self, filename, NULL, 0, 1, options);
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_dump_parallel(const tsk_table_collection_t *self,
+    const char *filename, tsk_size_t num_threads, tsk_flags_t options)
+{
+    return tsk_table_collection_dump_internal(
+        self, filename, NULL, 0, num_threads, options);
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_dump_derived(const tsk_table_collection_t *self,
+    const char *filename, const tsk_derived_array_t *arrays, tsk_size_t num_arrays,
+    tsk_flags_t options)
+{
+    return tsk_table_collection_dump_internal(
+        self, filename, arrays, num_arrays, 1, options);
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_dumpf(
+    const tsk_table_collection_t *self, FILE *file, tsk_flags_t options)
+{
+    return tsk_table_collection_dumpf_internal(self, file, NULL, NULL, 0, 1, options);
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_dumpf_derived(const tsk_table_collection_t *self, FILE *file,
+    const tsk_derived_array_t *arrays, tsk_size_t num_arrays, tsk_flags_t options)
+{
+    return tsk_table_collection_dumpf_internal(
+        self, file, NULL, arrays, num_arrays, 1, options);
+}
+
+/* Point a ragged column of a table view at the rows from start onwards. */
+static void
+view_ragged_column_tail(
+    void **data, tsk_size_t *length, tsk_size_t **offset, tsk_size_t start, size_t size)
+{
+    tsk_size_t base = (*offset)[start];
+
+    *data = (char *) *data + base * size;
+    *length -= base;
+    *offset += start;
+}
+
+/* Make a shallow copy of the table collection whose tables hold only the rows
+ * following the specified bookmark. The view shares memory with the original
+ * collection and must not be modified or freed. Indexes and the reference
+ * sequence are not included. */
+static int
+tsk_table_collection_tail_view(const tsk_table_collection_t *self,
+    const tsk_bookmark_t *start, tsk_table_collection_t *view)
+{
+    int ret = 0;
+    tsk_individual_table_t *individuals = &view->individuals;
+    tsk_node_table_t *nodes = &view->nodes;
+    tsk_edge_table_t *edges = &view->edges;
+    tsk_migration_table_t *migrations = &view->migrations;
+    tsk_site_table_t *sites = &view->sites;
+    tsk_mutation_table_t *mutations = &view->mutations;
+    tsk_population_table_t *populations = &view->populations;
+    tsk_provenance_table_t *provenances = &view->provenances;
+
+    if (start->individuals > self->individuals.num_rows
+        || start->nodes > self->nodes.num_rows || start->edges > self->edges.num_rows
+        || start->migrations > self->migrations.num_rows
+        || start->sites > self->sites.num_rows
+        || start->mutations > self->mutations.num_rows
+        || start->populations > self->populations.num_rows
+        || start->provenances > self->provenances.num_rows) {
+        ret = tsk_trace_error(TSK_ERR_BAD_TABLE_POSITION);
         goto out;
     }
-    if (!(options & TSK_LOAD_SKIP_TABLES)) {
-        ret = tsk_node_table_load(&self->nodes, &store);
-        if (ret != 0) {
-            goto out;
-        }
-        ret = tsk_edge_table_load(&self->edges, &store);
-        if (ret != 0) {
-            goto out;
-        }
-        ret = tsk_site_table_load(&self->sites, &store);
-        if (ret != 0) {
-            goto out;
-        }
-        ret = tsk_mutation_table_load(&self->mutations, &store);
-        if (ret != 0) {
-            goto out;
-        }
-        ret = tsk_migration_table_load(&self->migrations, &store);
-        if (ret != 0) {
-            goto out;
-        }
-        ret = tsk_individual_table_load(&self->individuals, &store);
-        if (ret != 0) {
-            goto out;
-        }
-        ret = tsk_population_table_load(&self->populations, &store);
+    *view = *self;
+    tsk_memset(&view->indexes, 0, sizeof(view->indexes));
+    tsk_memset(&view->reference_sequence, 0, sizeof(view->reference_sequence));
+
+    individuals->num_rows -= start->individuals;
+    individuals->flags += start->individuals;
+    view_ragged_column_tail((void **) &individuals->location,
+        &individuals->location_length, &individuals->location_offset,
+        start->individuals, sizeof(*individuals->location));
+    view_ragged_column_tail((void **) &individuals->parents,
+        &individuals->parents_length, &individuals->parents_offset,
+        start->individuals, sizeof(*individuals->parents));
+    view_ragged_column_tail((void **) &individuals->metadata,
+        &individuals->metadata_length, &individuals->metadata_offset,
+        start->individuals, sizeof(char));
+
+    nodes->num_rows -= start->nodes;
+    nodes->flags += start->nodes;
+    nodes->time += start->nodes;
+    nodes->population += start->nodes;
+    nodes->individual += start->nodes;
+    view_ragged_column_tail((void **) &nodes->metadata, &nodes->metadata_length,
+        &nodes->metadata_offset, start->nodes, sizeof(char));
+
+    edges->num_rows -= start->edges;
+    edges->left += start->edges;
+    edges->right += start->edges;
+    edges->parent += start->edges;
+    edges->child += start->edges;
+    if (tsk_edge_table_has_metadata(edges)) {
+        view_ragged_column_tail((void **) &edges->metadata, &edges->metadata_length,
+            &edges->metadata_offset, start->edges, sizeof(char));
+    }
+
+    migrations->num_rows -= start->migrations;
+    migrations->left += start->migrations;
+    migrations->right += start->migrations;
+    migrations->node += start->migrations;
+    migrations->source += start->migrations;
+    migrations->dest += start->migrations;
+    migrations->time += start->migrations;
+    view_ragged_column_tail((void **) &migrations->metadata,
+        &migrations->metadata_length, &migrations->metadata_offset, start->migrations,
+        sizeof(char));
+
+    sites->num_rows -= start->sites;
+    sites->position += start->sites;
+    view_ragged_column_tail((void **) &sites->ancestral_state,
+        &sites->ancestral_state_length, &sites->ancestral_state_offset, start->sites,
+        sizeof(char));
+    view_ragged_column_tail((void **) &sites->metadata, &sites->metadata_length,
+        &sites->metadata_offset, start->sites, sizeof(char));
+
+    mutations->num_rows -= start->mutations;
+    mutations->site += start->mutations;
+    mutations->node += start->mutations;
+    mutations->parent += start->mutations;
+    mutations->time += start->mutations;
+    view_ragged_column_tail((void **) &mutations->derived_state,
+        &mutations->derived_state_length, &mutations->derived_state_offset,
+        start->mutations, sizeof(char));
+    view_ragged_column_tail((void **) &mutations->metadata,
+        &mutations->metadata_length, &mutations->metadata_offset, start->mutations,
+        sizeof(char));
+
+    populations->num_rows -= start->populations;
+    view_ragged_column_tail((void **) &populations->metadata,
+        &populations->metadata_length, &populations->metadata_offset,
+        start->populations, sizeof(char));
+
+    provenances->num_rows -= start->provenances;
+    view_ragged_column_tail((void **) &provenances->timestamp,
+        &provenances->timestamp_length, &provenances->timestamp_offset,
+        start->provenances, sizeof(char));
+    view_ragged_column_tail((void **) &provenances->record,
+        &provenances->record_length, &provenances->record_offset, start->provenances,
+        sizeof(char));
+out:
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_dump_increment(const tsk_table_collection_t *self,
+    const char *filename, tsk_bookmark_t *bookmark, tsk_flags_t options)
+{
+    int ret = 0;
+    FILE *file = NULL;
+    tsk_table_collection_t view;
+    tsk_bookmark_t zero;
+
+    tsk_memset(&zero, 0, sizeof(zero));
+    if (tsk_memcmp(bookmark, &zero, sizeof(zero)) == 0) {
+        /* The first increment holds the complete collection */
+        ret = tsk_table_collection_dump(self, filename, options);
         if (ret != 0) {
             goto out;
         }
-        ret = tsk_provenance_table_load(&self->provenances, &store);
+    } else {
+        ret = tsk_table_collection_tail_view(self, bookmark, &view);
         if (ret != 0) {
             goto out;
         }
-        ret = tsk_table_collection_load_indexes(self, &store);
-        if (ret != 0) {
+        file = fopen(filename, "ab");
+        if (file == NULL) {
+            ret = tsk_trace_error(TSK_ERR_IO);
             goto out;
         }
-    } else {
-        ret = tsk_table_collection_build_index(self, 0);
+        ret = tsk_table_collection_dumpf_internal(
+            &view, file, bookmark, NULL, 0, 1, options);
         if (ret != 0) {
             goto out;
         }
-    }
-    if (!(options & TSK_LOAD_SKIP_REFERENCE_SEQUENCE)) {
-        ret = tsk_table_collection_load_reference_sequence(self, &store);
-        if (ret != 0) {
+        if (fclose(file) != 0) {
+            file = NULL;
+            ret = tsk_trace_error(TSK_ERR_IO);
             goto out;
         }
+        file = NULL;
     }
-    ret = kastore_close(&store);
-    if (ret != 0) {
-        goto out;
-    }
+    tsk_table_collection_record_num_rows(self, bookmark);
 out:
-    /* If we're exiting on an error, we ignore any further errors that might come
-     * from kastore. In the nominal case, closing an already-closed store is a
-     * safe noop */
-    kastore_close(&store);
+    if (file != NULL) {
+        fclose(file);
+    }
     return ret;
 }
 
 int TSK_WARN_UNUSED
-tsk_table_collection_loadf(tsk_table_collection_t *self, FILE *file, tsk_flags_t options)
+tsk_table_collection_simplify(tsk_table_collection_t *self, const tsk_id_t *samples,
+    tsk_size_t num_samples, tsk_flags_t options, tsk_id_t *node_map)
 {
     int ret = 0;
+    simplifier_t simplifier;
+    tsk_id_t *local_samples = NULL;
+    tsk_id_t u;
 
-    if (!(options & TSK_NO_INIT)) {
-        ret = tsk_table_collection_init(self, options);
-        if (ret != 0) {
-            goto out;
-        }
-    }
-    ret = tsk_table_collection_loadf_inited(self, file, options);
+    /* Avoid calling to simplifier_free with uninit'd memory on error branches */
+    tsk_memset(&simplifier, 0, sizeof(simplifier_t));
+
+    ret = check_table_writable(self->mapped_store);
     if (ret != 0) {
         goto out;
     }
-out:
-    return ret;
-}
+    if ((options & TSK_SIMPLIFY_KEEP_UNARY)
+        && (options & TSK_SIMPLIFY_KEEP_UNARY_IN_INDIVIDUALS)) {
+        ret = tsk_trace_error(TSK_ERR_KEEP_UNARY_MUTUALLY_EXCLUSIVE);
+        goto out;
+    }
 
-int TSK_WARN_UNUSED
-tsk_table_collection_load(
-    tsk_table_collection_t *self, const char *filename, tsk_flags_t options)
-{
-    int ret = 0;
-    FILE *file = NULL;
+    /* For now we don't bother with edge metadata, but it can easily be
+     * implemented. */
+    if (self->edges.metadata_length > 0) {
+        ret = tsk_trace_error(TSK_ERR_CANT_PROCESS_EDGES_WITH_METADATA);
+        goto out;
+    }
 
-    if (!(options & TSK_NO_INIT)) {
-        ret = tsk_table_collection_init(self, options);
-        if (ret != 0) {
+    if (samples == NULL) {
+        local_samples = tsk_malloc(self->nodes.num_rows * sizeof(*local_samples));
+        if (local_samples == NULL) {
+            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
             goto out;
         }
+        num_samples = 0;
+        for (u = 0; u < (tsk_id_t) self->nodes.num_rows; u++) {
+            if (!!(self->nodes.flags[u] & TSK_NODE_IS_SAMPLE)) {
+                local_samples[num_samples] = u;
+                num_samples++;
+            }
+        }
+        samples = local_samples;
     }
-    file = fopen(filename, "rb");
-    if (file == NULL) {
-        ret = tsk_trace_error(TSK_ERR_IO);
+
+    ret = simplifier_init(&simplifier, samples, num_samples, self, options);
+    if (ret != 0) {
         goto out;
     }
-    ret = tsk_table_collection_loadf_inited(self, file, options);
+    ret = simplifier_run(&simplifier, node_map);
     if (ret != 0) {
         goto out;
     }
-    if (fclose(file) != 0) {
-        ret = tsk_trace_error(TSK_ERR_IO);
-        goto out;
+    if (!!(options & TSK_DEBUG)) {
+        simplifier_print_state(&simplifier, tsk_get_debug_stream());
     }
-    file = NULL;
+    /* The indexes are invalidated now so drop them */
+    ret = tsk_table_collection_drop_index(self, 0);
 out:
-    if (file != NULL) {
-        /* Ignore any additional errors we might get when closing the file
-         * in error conditions */
-        fclose(file);
-    }
+    simplifier_free(&simplifier);
+    tsk_safe_free(local_samples);
     return ret;
 }
 
-static int TSK_WARN_UNUSED
-tsk_table_collection_dump_reference_sequence(const tsk_table_collection_t *self,
-    kastore_t *store, tsk_flags_t TSK_UNUSED(options))
+/* Parallel simplify splits the genome into intervals holding roughly equal
+ * numbers of edges, and simplifies the edges, sites and mutations within
+ * each interval independently, keeping all nodes so that node IDs are the
+ * same in every interval. The outputs are then joined and simplified once
+ * more to filter the nodes, which assigns the same IDs as simplifying the
+ * input directly. As the intervals are already simplified, this final step
+ * only needs to process the much smaller output tables. */
+
+/* The number of edge left coordinates sampled per interval when choosing
+ * the breakpoints */
+#define PARALLEL_SIMPLIFY_SAMPLES_PER_INTERVAL 64
+
+typedef struct {
+    tsk_table_collection_t *tables;
+    const tsk_id_t *samples;
+    tsk_size_t num_samples;
+    tsk_flags_t options;
+    tsk_size_t num_intervals;
+    double *breakpoints;
+    tsk_table_collection_t *interval_tables;
+    int *interval_ret;
+} parallel_simplifier_t;
+
+static int
+cmp_position(const void *a, const void *b)
 {
-    int ret = 0;
-    const tsk_reference_sequence_t *ref = &self->reference_sequence;
-    write_table_col_t write_cols[] = {
-        { "reference_sequence/data", (void *) ref->data, ref->data_length, KAS_UINT8 },
-        { "reference_sequence/url", (void *) ref->url, ref->url_length, KAS_UINT8 },
-        { "reference_sequence/metadata", (void *) ref->metadata, ref->metadata_length,
-            KAS_UINT8 },
-        { "reference_sequence/metadata_schema", (void *) ref->metadata_schema,
-            ref->metadata_schema_length, KAS_UINT8 },
-        { .name = NULL },
-    };
-    if (tsk_table_collection_has_reference_sequence(self)) {
-        ret = write_table_cols(store, write_cols, 0);
-    }
-    return ret;
+    const double *ia = (const double *) a;
+    const double *ib = (const double *) b;
+    return (*ia > *ib) - (*ia < *ib);
 }
 
-int TSK_WARN_UNUSED
-tsk_table_collection_dump(
-    const tsk_table_collection_t *self, const char *filename, tsk_flags_t options)
+static int
+parallel_simplifier_init(parallel_simplifier_t *self, tsk_table_collection_t *tables,
+    const tsk_id_t *samples, tsk_size_t num_samples, tsk_flags_t options,
+    tsk_size_t max_intervals)
 {
     int ret = 0;
-    FILE *file = fopen(filename, "wb");
+    const tsk_edge_table_t *edges = &tables->edges;
+    tsk_size_t num_positions = TSK_MIN(
+        edges->num_rows, max_intervals * PARALLEL_SIMPLIFY_SAMPLES_PER_INTERVAL);
+    double *positions = tsk_malloc(num_positions * sizeof(*positions));
+    tsk_size_t j, k;
+    double x;
 
-    if (file == NULL) {
-        ret = tsk_trace_error(TSK_ERR_IO);
+    tsk_memset(self, 0, sizeof(*self));
+    self->tables = tables;
+    self->samples = samples;
+    self->num_samples = num_samples;
+    self->options = options;
+    self->breakpoints = tsk_malloc((max_intervals + 1) * sizeof(*self->breakpoints));
+    if (positions == NULL || self->breakpoints == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
-    ret = tsk_table_collection_dumpf(self, file, options);
-    if (ret != 0) {
-        goto out;
+    /* Edges are sorted by time, so a strided sample of their left
+     * coordinates is spread evenly along the genome */
+    for (j = 0; j < num_positions; j++) {
+        positions[j] = edges->left[j * edges->num_rows / num_positions];
     }
-    if (fclose(file) != 0) {
-        ret = tsk_trace_error(TSK_ERR_IO);
+    qsort(positions, (size_t) num_positions, sizeof(*positions), cmp_position);
+    self->breakpoints[0] = 0;
+    k = 1;
+    for (j = 1; j < max_intervals; j++) {
+        x = positions[j * num_positions / max_intervals];
+        if (x > self->breakpoints[k - 1] && x < tables->sequence_length) {
+            self->breakpoints[k] = x;
+            k++;
+        }
+    }
+    self->breakpoints[k] = tables->sequence_length;
+    self->num_intervals = k;
+
+    self->interval_tables
+        = tsk_calloc(self->num_intervals, sizeof(*self->interval_tables));
+    self->interval_ret = tsk_calloc(self->num_intervals, sizeof(*self->interval_ret));
+    if (self->interval_tables == NULL || self->interval_ret == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
-    file = NULL;
-out:
-    if (file != NULL) {
-        /* Ignore any additional errors we might get when closing the file
-         * in error conditions */
-        fclose(file);
-        /* If an error occurred make sure that the filename is removed */
-        remove(filename);
+    for (j = 0; j < self->num_intervals; j++) {
+        ret = tsk_table_collection_init(&self->interval_tables[j], 0);
+        if (ret != 0) {
+            goto out;
+        }
+        self->interval_tables[j].sequence_length = tables->sequence_length;
     }
+out:
+    tsk_safe_free(positions);
     return ret;
 }
 
-int TSK_WARN_UNUSED
-tsk_table_collection_dumpf(
-    const tsk_table_collection_t *self, FILE *file, tsk_flags_t options)
+static void
+parallel_simplifier_free(parallel_simplifier_t *self)
 {
-    int ret = 0;
-    kastore_t store;
-    char uuid[TSK_UUID_SIZE + 1]; // Must include space for trailing null.
-    write_table_col_t format_columns[] = {
-        { "format/name", (const void *) &TSK_FILE_FORMAT_NAME,
-            TSK_FILE_FORMAT_NAME_LENGTH, KAS_INT8 },
-        { "format/version",
-            (const void *) &(uint32_t[]) {
-                TSK_FILE_FORMAT_VERSION_MAJOR, TSK_FILE_FORMAT_VERSION_MINOR },
-            2, KAS_UINT32 },
-        { "sequence_length", (const void *) &self->sequence_length, 1, KAS_FLOAT64 },
-        { "uuid", (void *) uuid, TSK_UUID_SIZE, KAS_INT8 },
-        { "time_units", (void *) self->time_units, self->time_units_length, KAS_INT8 },
-        { "metadata", (void *) self->metadata, self->metadata_length, KAS_INT8 },
-        { "metadata_schema", (void *) self->metadata_schema,
-            self->metadata_schema_length, KAS_INT8 },
-        { .name = NULL },
-    };
+    tsk_size_t j;
 
-    tsk_memset(&store, 0, sizeof(store));
+    if (self->interval_tables != NULL) {
+        for (j = 0; j < self->num_intervals; j++) {
+            tsk_table_collection_free(&self->interval_tables[j]);
+        }
+    }
+    tsk_safe_free(self->interval_tables);
+    tsk_safe_free(self->interval_ret);
+    tsk_safe_free(self->breakpoints);
+}
 
-    ret = kastore_openf(&store, file, "w", 0);
+static int
+parallel_simplifier_simplify_interval(parallel_simplifier_t *self, tsk_size_t j)
+{
+    int ret = 0;
+    const tsk_table_collection_t *tables = self->tables;
+    tsk_table_collection_t *dest = &self->interval_tables[j];
+    bool keep_individuals = !!(self->options & TSK_SIMPLIFY_KEEP_UNARY_IN_INDIVIDUALS);
+    tsk_flags_t options = self->options
+                          & (TSK_SIMPLIFY_KEEP_UNARY | TSK_SIMPLIFY_KEEP_INPUT_ROOTS
+                                | TSK_SIMPLIFY_KEEP_UNARY_IN_INDIVIDUALS);
+
+    /* Simplify only needs the node flags and times, and the individuals
+     * when keeping unary nodes in individuals. */
+    ret = tsk_node_table_set_columns(&dest->nodes, tables->nodes.num_rows,
+        tables->nodes.flags, tables->nodes.time, NULL,
+        keep_individuals ? tables->nodes.individual : NULL, NULL, NULL);
     if (ret != 0) {
-        ret = tsk_set_kas_error(ret);
         goto out;
     }
-
-    /* Write format data */
-    ret = tsk_generate_uuid(uuid, 0);
+    if (keep_individuals) {
+        ret = tsk_individual_table_copy(
+            &tables->individuals, &dest->individuals, TSK_NO_INIT);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    ret = tsk_table_collection_copy_interval_edges(
+        tables, dest, self->breakpoints[j], self->breakpoints[j + 1]);
     if (ret != 0) {
         goto out;
     }
-
-    ret = write_table_cols(&store, format_columns, options);
+    ret = tsk_table_collection_copy_interval_sites(
+        tables, dest, self->breakpoints[j], self->breakpoints[j + 1]);
     if (ret != 0) {
         goto out;
     }
+    ret = tsk_table_collection_simplify(dest, self->samples, self->num_samples,
+        options | TSK_SIMPLIFY_NO_FILTER_NODES | TSK_SIMPLIFY_NO_UPDATE_SAMPLE_FLAGS,
+        NULL);
+out:
+    return ret;
+}
 
-    /* All of these functions will set the kas_error internally, so we don't have
-     * to modify the return value. */
-    ret = tsk_node_table_dump(&self->nodes, &store, options);
+static void
+parallel_simplifier_worker(void *arg, tsk_size_t j)
+{
+    parallel_simplifier_t *self = (parallel_simplifier_t *) arg;
+
+    self->interval_ret[j] = parallel_simplifier_simplify_interval(self, j);
+}
+
+/* Replace the edges, sites and mutations of the input tables with those of
+ * the simplified intervals. */
+static int
+parallel_simplifier_join(parallel_simplifier_t *self)
+{
+    int ret = 0;
+    tsk_table_collection_t *tables = self->tables;
+    const tsk_table_collection_t *source;
+    tsk_bookmark_t start;
+    tsk_size_t j, k, site_offset, mutation_offset;
+
+    ret = tsk_edge_table_clear(&tables->edges);
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_edge_table_dump(&self->edges, &store, options);
+    ret = tsk_site_table_clear(&tables->sites);
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_site_table_dump(&self->sites, &store, options);
+    ret = tsk_mutation_table_clear(&tables->mutations);
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_migration_table_dump(&self->migrations, &store, options);
-    if (ret != 0) {
-        goto out;
+    for (j = 0; j < self->num_intervals; j++) {
+        source = &self->interval_tables[j];
+        tsk_memset(&start, 0, sizeof(start));
+        start.edges = tables->edges.num_rows;
+        site_offset = tables->sites.num_rows;
+        mutation_offset = tables->mutations.num_rows;
+
+        ret = tsk_edge_table_extend(
+            &tables->edges, &source->edges, source->edges.num_rows, NULL, 0);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_site_table_extend(
+            &tables->sites, &source->sites, source->sites.num_rows, NULL, 0);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_mutation_table_extend(
+            &tables->mutations, &source->mutations, source->mutations.num_rows, NULL, 0);
+        if (ret != 0) {
+            goto out;
+        }
+        for (k = mutation_offset; k < tables->mutations.num_rows; k++) {
+            tables->mutations.site[k] += (tsk_id_t) site_offset;
+            if (tables->mutations.parent[k] != TSK_NULL) {
+                tables->mutations.parent[k] += (tsk_id_t) mutation_offset;
+            }
+        }
+        /* The sites and mutations of each interval follow those of the
+         * previous one, but the edges must be merged */
+        if (start.edges > 0) {
+            start.sites = tables->sites.num_rows;
+            start.mutations = tables->mutations.num_rows;
+            ret = tsk_table_collection_sort(
+                tables, &start, TSK_SORT_MERGE | TSK_NO_CHECK_INTEGRITY);
+            if (ret != 0) {
+                goto out;
+            }
+        }
     }
-    ret = tsk_mutation_table_dump(&self->mutations, &store, options);
+out:
+    return ret;
+}
+
+static int
+parallel_simplifier_run(parallel_simplifier_t *self)
+{
+    int ret = 0;
+    tsk_size_t j;
+
+    ret = tsk_thread_run_parallel(
+        self->num_intervals, parallel_simplifier_worker, (void *) self);
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_individual_table_dump(&self->individuals, &store, options);
-    if (ret != 0) {
-        goto out;
+    for (j = 0; j < self->num_intervals; j++) {
+        if (self->interval_ret[j] != 0) {
+            ret = self->interval_ret[j];
+            goto out;
+        }
     }
-    ret = tsk_population_table_dump(&self->populations, &store, options);
+    ret = parallel_simplifier_join(self);
+out:
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_simplify_parallel(tsk_table_collection_t *self,
+    const tsk_id_t *samples, tsk_size_t num_samples, tsk_flags_t options,
+    tsk_id_t *node_map, tsk_size_t num_threads)
+{
+    int ret = 0;
+    tsk_id_t ret_id, parent;
+    parallel_simplifier_t simplifier;
+    /* Simplify doesn't support migrations, so we leave it to report the error
+     * rather than copying the migrations into the interval tables. */
+    bool split = num_threads > 1 && self->edges.num_rows > 0
+                 && self->migrations.num_rows == 0;
+    tsk_size_t j;
+
+    tsk_memset(&simplifier, 0, sizeof(simplifier));
+    ret = check_table_writable(self->mapped_store);
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_provenance_table_dump(&self->provenances, &store, options);
-    if (ret != 0) {
-        goto out;
+    if (split) {
+        /* Simplify checks these requirements again, but we must check them
+         * before relying on the tables being sorted to split them. */
+        ret_id = tsk_table_collection_check_integrity(self,
+            TSK_CHECK_EDGE_ORDERING | TSK_CHECK_SITE_ORDERING
+                | TSK_CHECK_SITE_DUPLICATES);
+        if (ret_id != 0) {
+            ret = (int) ret_id;
+            goto out;
+        }
+        /* Reducing to site topology depends on the sites on either side of
+         * each edge, and so the genome cannot be split. We also need the
+         * mutations to be grouped by site and to follow their parents,
+         * which simplify doesn't require. */
+        if (options & TSK_SIMPLIFY_REDUCE_TO_SITE_TOPOLOGY) {
+            split = false;
+        }
+        for (j = 0; j < self->mutations.num_rows; j++) {
+            parent = self->mutations.parent[j];
+            if ((j > 0 && self->mutations.site[j] < self->mutations.site[j - 1])
+                || (parent != TSK_NULL
+                       && (parent >= (tsk_id_t) j
+                              || self->mutations.site[parent]
+                                     != self->mutations.site[j]))) {
+                split = false;
+                break;
+            }
+        }
     }
-    ret = tsk_table_collection_dump_indexes(self, &store, options);
-    if (ret != 0) {
-        goto out;
+    if (split) {
+        ret = parallel_simplifier_init(
+            &simplifier, self, samples, num_samples, options, num_threads);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = parallel_simplifier_run(&simplifier);
+        if (ret != 0) {
+            goto out;
+        }
     }
-    ret = tsk_table_collection_dump_reference_sequence(self, &store, options);
-    if (ret != 0) {
+    ret = tsk_table_collection_simplify(self, samples, num_samples, options, node_map);
+out:
+    parallel_simplifier_free(&simplifier);
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_incremental_simplifier_init(tsk_incremental_simplifier_t *self,
+    tsk_table_collection_t *tables, tsk_flags_t options)
+{
+    int ret = 0;
+
+    tsk_memset(self, 0, sizeof(*self));
+    self->tables = tables;
+    self->options = options;
+    if ((options & TSK_SIMPLIFY_KEEP_UNARY)
+        && (options & TSK_SIMPLIFY_KEEP_UNARY_IN_INDIVIDUALS)) {
+        ret = tsk_trace_error(TSK_ERR_KEEP_UNARY_MUTUALLY_EXCLUSIVE);
         goto out;
     }
-
-    ret = kastore_close(&store);
-    if (ret != 0) {
-        ret = tsk_set_kas_error(ret);
+    self->simplifier = tsk_malloc(sizeof(*self->simplifier));
+    if (self->simplifier == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
+    ret = simplifier_alloc(self->simplifier);
 out:
-    /* It's safe to close a kastore twice. */
-    if (ret != 0) {
-        kastore_close(&store);
-    }
     return ret;
 }
 
+int
+tsk_incremental_simplifier_free(tsk_incremental_simplifier_t *self)
+{
+    if (self->simplifier != NULL) {
+        simplifier_free(self->simplifier);
+    }
+    tsk_safe_free(self->simplifier);
+    return 0;
+}
+
 int TSK_WARN_UNUSED
-tsk_table_collection_simplify(tsk_table_collection_t *self, const tsk_id_t *samples,
-    tsk_size_t num_samples, tsk_flags_t options, tsk_id_t *node_map)
+tsk_incremental_simplifier_run(tsk_incremental_simplifier_t *self,
+    const tsk_id_t *samples, tsk_size_t num_samples, tsk_id_t *node_map)
 {
     int ret = 0;
-    simplifier_t simplifier;
+    tsk_table_collection_t *tables = self->tables;
+    tsk_bookmark_t start = self->sorted;
     tsk_id_t *local_samples = NULL;
     tsk_id_t u;
 
-    /* Avoid calling to simplifier_free with uninit'd memory on error branches */
-    tsk_memset(&simplifier, 0, sizeof(simplifier_t));
-
-    if ((options & TSK_SIMPLIFY_KEEP_UNARY)
-        && (options & TSK_SIMPLIFY_KEEP_UNARY_IN_INDIVIDUALS)) {
-        ret = tsk_trace_error(TSK_ERR_KEEP_UNARY_MUTUALLY_EXCLUSIVE);
+    if (tables->edges.metadata_length > 0) {
+        ret = tsk_trace_error(TSK_ERR_CANT_PROCESS_EDGES_WITH_METADATA);
         goto out;
     }
-
-    /* For now we don't bother with edge metadata, but it can easily be
-     * implemented. */
-    if (self->edges.metadata_length > 0) {
-        ret = tsk_trace_error(TSK_ERR_CANT_PROCESS_EDGES_WITH_METADATA);
+    /* The rows output by the last call are sorted, so we only need to sort
+     * the rows added since then. If rows have been removed we can't know
+     * which rows are sorted. */
+    if (start.edges > tables->edges.num_rows || start.sites > tables->sites.num_rows
+        || start.mutations > tables->mutations.num_rows) {
+        tsk_memset(&start, 0, sizeof(start));
+    }
+    start.migrations = 0;
+    ret = tsk_table_collection_sort(tables, &start, TSK_SORT_MERGE);
+    if (ret != 0) {
         goto out;
     }
 
     if (samples == NULL) {
-        local_samples = tsk_malloc(self->nodes.num_rows * sizeof(*local_samples));
+        local_samples = tsk_malloc(tables->nodes.num_rows * sizeof(*local_samples));
         if (local_samples == NULL) {
             ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
             goto out;
         }
         num_samples = 0;
-        for (u = 0; u < (tsk_id_t) self->nodes.num_rows; u++) {
-            if (!!(self->nodes.flags[u] & TSK_NODE_IS_SAMPLE)) {
+        for (u = 0; u < (tsk_id_t) tables->nodes.num_rows; u++) {
+            if (!!(tables->nodes.flags[u] & TSK_NODE_IS_SAMPLE)) {
                 local_samples[num_samples] = u;
                 num_samples++;
             }
@@ -12185,21 +16531,27 @@ tsk_table_collection_simplify(tsk_table_collection_t *self, const tsk_id_t *samp
         samples = local_samples;
     }
 
-    ret = simplifier_init(&simplifier, samples, num_samples, self, options);
+    ret = simplifier_reset(
+        self->simplifier, samples, num_samples, tables, self->options);
     if (ret != 0) {
         goto out;
     }
-    ret = simplifier_run(&simplifier, node_map);
+    ret = simplifier_run(self->simplifier, node_map);
     if (ret != 0) {
         goto out;
     }
-    if (!!(options & TSK_DEBUG)) {
-        simplifier_print_state(&simplifier, tsk_get_debug_stream());
+    self->max_num_segments = self->simplifier->max_num_segments;
+    self->num_segments = self->simplifier->num_segments;
+    if (!!(self->options & TSK_DEBUG)) {
+        simplifier_print_state(self->simplifier, tsk_get_debug_stream());
     }
     /* The indexes are invalidated now so drop them */
-    ret = tsk_table_collection_drop_index(self, 0);
+    ret = tsk_table_collection_drop_index(tables, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_record_num_rows(tables, &self->sorted);
 out:
-    simplifier_free(&simplifier);
     tsk_safe_free(local_samples);
     return ret;
 }
@@ -12384,6 +16736,10 @@ tsk_table_collection_deduplicate_sites(
     if (ret != 0) {
         goto out;
     }
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     ret_id = tsk_table_collection_check_integrity(self, TSK_CHECK_SITE_ORDERING);
     if (ret_id != 0) {
         ret = (int) ret_id;
@@ -12440,6 +16796,10 @@ tsk_table_collection_compute_mutation_parents(
     tsk_id_t *parent_backup = NULL;
     bool restore_parents = false;
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     if (!(options & TSK_NO_CHECK_INTEGRITY)) {
         if (mutations->num_rows > 0) {
             /* We need to wipe the parent column before computing, as otherwise invalid
@@ -12503,6 +16863,10 @@ tsk_table_collection_compute_mutation_times(
     tsk_size_t j, mutation, first_mutation;
     tsk_bookmark_t skip_edges = { 0, 0, self->edges.num_rows, 0, 0, 0, 0, 0 };
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     /* The random param is for future usage */
     if (random != NULL) {
         ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
@@ -12609,6 +16973,304 @@ out:
     return ret;
 }
 
+/* Computing mutation parents and times together. The mutations are split
+ * into blocks of whole sites, and the parent array of the tree containing
+ * the first site of each block is found by inserting the edges that span
+ * it, as in tsk_tree_seek. The trees are then iterated over incrementally
+ * as far as the last site of the block. Each block has its own parent and
+ * working arrays, so the blocks can be processed in parallel. */
+
+typedef struct {
+    tsk_size_t start;
+    tsk_size_t end;
+    int ret;
+    /* Whether any of the mutation times are out of order */
+    bool unsorted;
+    /* Whether any of the mutation parents are after the child */
+    bool parent_after_child;
+} mutation_block_t;
+
+typedef struct {
+    tsk_table_collection_t *tables;
+    tsk_size_t num_blocks;
+    mutation_block_t *blocks;
+} mutation_sweep_t;
+
+static int
+mutation_sweep_run_block(const tsk_table_collection_t *self, mutation_block_t *block)
+{
+    int ret = 0;
+    const tsk_id_t *restrict I = self->indexes.edge_insertion_order;
+    const tsk_id_t *restrict O = self->indexes.edge_removal_order;
+    const tsk_edge_table_t edges = self->edges;
+    const tsk_node_table_t nodes = self->nodes;
+    const tsk_site_table_t sites = self->sites;
+    const tsk_mutation_table_t mutations = self->mutations;
+    const tsk_size_t M = edges.num_rows;
+    const double L = self->sequence_length;
+    tsk_id_t *parent = tsk_malloc(nodes.num_rows * sizeof(*parent));
+    tsk_id_t *bottom_mutation = tsk_malloc(nodes.num_rows * sizeof(*bottom_mutation));
+    double *numerator = tsk_calloc(nodes.num_rows, sizeof(*numerator));
+    double *denominator = tsk_calloc(nodes.num_rows, sizeof(*denominator));
+    tsk_size_t j, tj, tk, mutation, first_mutation;
+    tsk_id_t u, site;
+    double position, left, right, parent_time;
+
+    if (parent == NULL || bottom_mutation == NULL || numerator == NULL
+        || denominator == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    tsk_memset(parent, 0xff, nodes.num_rows * sizeof(*parent));
+    tsk_memset(bottom_mutation, 0xff, nodes.num_rows * sizeof(*bottom_mutation));
+    if (block->start == block->end) {
+        goto out;
+    }
+
+    /* Seek to the tree containing the first site */
+    position = sites.position[mutations.site[block->start]];
+    for (tj = 0; tj < M && edges.left[I[tj]] <= position; tj++) {
+        if (edges.right[I[tj]] > position) {
+            parent[edges.child[I[tj]]] = edges.parent[I[tj]];
+        }
+    }
+    for (tk = 0; tk < M && edges.right[O[tk]] <= position; tk++)
+        ;
+    right = L;
+    if (tj < M) {
+        right = TSK_MIN(right, edges.left[I[tj]]);
+    }
+    if (tk < M) {
+        right = TSK_MIN(right, edges.right[O[tk]]);
+    }
+
+    mutation = block->start;
+    while (mutation < block->end) {
+        site = mutations.site[mutation];
+        position = sites.position[site];
+        /* Move on to the tree containing this site */
+        while (position >= right) {
+            left = right;
+            while (tk < M && edges.right[O[tk]] == left) {
+                parent[edges.child[O[tk]]] = TSK_NULL;
+                tk++;
+            }
+            while (tj < M && edges.left[I[tj]] == left) {
+                parent[edges.child[I[tj]]] = edges.parent[I[tj]];
+                tj++;
+            }
+            right = L;
+            if (tj < M) {
+                right = TSK_MIN(right, edges.left[I[tj]]);
+            }
+            if (tk < M) {
+                right = TSK_MIN(right, edges.right[O[tk]]);
+            }
+        }
+
+        /* Count the mutations above each node, and map each node to its last
+         * mutation. If we see more than one mutation at a node, the previously
+         * seen one must be the parent of the current since we assume they are
+         * in order. */
+        first_mutation = mutation;
+        while (mutation < block->end && mutations.site[mutation] == site) {
+            u = mutations.node[mutation];
+            denominator[u]++;
+            mutations.parent[mutation] = bottom_mutation[u];
+            bottom_mutation[u] = (tsk_id_t) mutation;
+            mutation++;
+        }
+        for (j = first_mutation; j < mutation; j++) {
+            u = mutations.node[j];
+            /* Assign times as in compute_mutation_times */
+            numerator[u]++;
+            if (parent[u] == TSK_NULL) {
+                /* This mutation is above a root */
+                mutations.time[j] = nodes.time[u];
+            } else {
+                parent_time = nodes.time[parent[u]];
+                mutations.time[j] = parent_time
+                                    - (parent_time - nodes.time[u]) * numerator[u]
+                                          / (denominator[u] + 1);
+            }
+            if (j > first_mutation && mutations.time[j] > mutations.time[j - 1]) {
+                block->unsorted = true;
+            }
+            /* Traverse up the tree to find the parent of the first mutation
+             * at each node, as in compute_mutation_parents. */
+            if (mutation > first_mutation + 1 && mutations.parent[j] == TSK_NULL) {
+                u = parent[u];
+                while (u != TSK_NULL && bottom_mutation[u] == TSK_NULL) {
+                    u = parent[u];
+                }
+                if (u != TSK_NULL) {
+                    mutations.parent[j] = bottom_mutation[u];
+                }
+            }
+        }
+        /* Reset the book-keeping for the next site */
+        for (j = first_mutation; j < mutation; j++) {
+            u = mutations.node[j];
+            numerator[u] = 0;
+            denominator[u] = 0;
+            bottom_mutation[u] = TSK_NULL;
+            if (mutations.parent[j] > (tsk_id_t) j) {
+                block->parent_after_child = true;
+            }
+        }
+    }
+out:
+    tsk_safe_free(parent);
+    tsk_safe_free(bottom_mutation);
+    tsk_safe_free(numerator);
+    tsk_safe_free(denominator);
+    return ret;
+}
+
+static void
+mutation_sweep_worker(void *arg, tsk_size_t j)
+{
+    mutation_sweep_t *self = (mutation_sweep_t *) arg;
+
+    self->blocks[j].ret = mutation_sweep_run_block(self->tables, &self->blocks[j]);
+}
+
+static int
+mutation_sweep_run(mutation_sweep_t *self, tsk_size_t num_threads)
+{
+    int ret = 0;
+    const tsk_mutation_table_t *mutations = &self->tables->mutations;
+    const tsk_size_t num_mutations = mutations->num_rows;
+    tsk_size_t j, start;
+
+    /* Don't use more threads than there is work for */
+    self->num_blocks = TSK_MAX(1, TSK_MIN(num_threads, num_mutations / 1024 + 1));
+    self->blocks = tsk_calloc(self->num_blocks, sizeof(*self->blocks));
+    if (self->blocks == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    for (j = 0; j < self->num_blocks; j++) {
+        /* Blocks start at the first mutation of a site */
+        start = num_mutations * j / self->num_blocks;
+        if (j > 0) {
+            start = TSK_MAX(start, self->blocks[j - 1].start);
+            while (start > 0 && start < num_mutations
+                   && mutations->site[start] == mutations->site[start - 1]) {
+                start++;
+            }
+            self->blocks[j - 1].end = start;
+        }
+        self->blocks[j].start = start;
+    }
+    self->blocks[self->num_blocks - 1].end = num_mutations;
+
+    ret = tsk_thread_run_parallel(self->num_blocks, mutation_sweep_worker, self);
+    if (ret != 0) {
+        goto out;
+    }
+    for (j = 0; j < self->num_blocks; j++) {
+        if (self->blocks[j].ret != 0) {
+            ret = self->blocks[j].ret;
+            goto out;
+        }
+    }
+out:
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_compute_mutation_parents_and_times(tsk_table_collection_t *self,
+    tsk_flags_t TSK_UNUSED(options), tsk_size_t num_threads)
+{
+    int ret = 0;
+    tsk_id_t ret_id;
+    tsk_mutation_table_t *mutations = &self->mutations;
+    tsk_id_t *parent_backup = NULL;
+    double *time_backup = NULL;
+    mutation_sweep_t sweep;
+    tsk_bookmark_t skip_edges = { 0, 0, self->edges.num_rows, 0, 0, 0, 0, 0 };
+    bool unsorted = false;
+    bool parent_after_child = false;
+    tsk_size_t j;
+
+    tsk_memset(&sweep, 0, sizeof(sweep));
+    sweep.tables = self;
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
+    /* Clear the parents and times so that the integrity checks succeed,
+     * keeping copies to restore on error. */
+    parent_backup = tsk_malloc(mutations->num_rows * sizeof(*parent_backup));
+    time_backup = tsk_malloc(mutations->num_rows * sizeof(*time_backup));
+    if (parent_backup == NULL || time_backup == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    tsk_memcpy(
+        parent_backup, mutations->parent, mutations->num_rows * sizeof(*parent_backup));
+    tsk_memcpy(time_backup, mutations->time, mutations->num_rows * sizeof(*time_backup));
+    for (j = 0; j < mutations->num_rows; j++) {
+        mutations->parent[j] = TSK_NULL;
+        mutations->time[j] = TSK_UNKNOWN_TIME;
+    }
+    ret_id = tsk_table_collection_check_integrity_parallel(
+        self, TSK_CHECK_TREES, num_threads);
+    if (ret_id < 0) {
+        ret = (int) ret_id;
+        goto out;
+    }
+
+    ret = mutation_sweep_run(&sweep, num_threads);
+    if (ret != 0) {
+        goto out;
+    }
+    for (j = 0; j < sweep.num_blocks; j++) {
+        unsorted = unsorted || sweep.blocks[j].unsorted;
+        parent_after_child = parent_after_child || sweep.blocks[j].parent_after_child;
+    }
+    if (unsorted) {
+        /* The new times have invalidated the order of the mutations, so we
+         * sort them as compute_mutation_times does, and compute the parents
+         * again in the new order. */
+        for (j = 0; j < mutations->num_rows; j++) {
+            mutations->parent[j] = TSK_NULL;
+        }
+        ret = tsk_table_collection_sort(self, &skip_edges, 0);
+        if (ret != 0) {
+            goto out;
+        }
+        /* Sorting drops the indexes, although the edges are unchanged */
+        ret = tsk_table_collection_build_index_parallel(self, 0, num_threads);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_table_collection_compute_mutation_parents_to_array(
+            self, mutations->parent);
+        if (ret != 0) {
+            goto out;
+        }
+    } else if (parent_after_child) {
+        ret = tsk_trace_error(TSK_ERR_MUTATION_PARENT_AFTER_CHILD);
+        goto out;
+    }
+out:
+    /* If the mutations were sorted the number of rows is unchanged, but the
+     * backups no longer correspond to them, so we only restore if the sort
+     * hasn't been reached. */
+    if (ret != 0 && parent_backup != NULL && time_backup != NULL && !unsorted) {
+        tsk_memcpy(mutations->parent, parent_backup,
+            mutations->num_rows * sizeof(*parent_backup));
+        tsk_memcpy(
+            mutations->time, time_backup, mutations->num_rows * sizeof(*time_backup));
+    }
+    tsk_safe_free(parent_backup);
+    tsk_safe_free(time_backup);
+    tsk_safe_free(sweep.blocks);
+    return ret;
+}
+
 int TSK_WARN_UNUSED
 tsk_table_collection_delete_older(
     tsk_table_collection_t *self, double time, tsk_flags_t TSK_UNUSED(options))
@@ -12629,6 +17291,10 @@ tsk_table_collection_delete_older(
     memset(&mutations, 0, sizeof(mutations));
     memset(&migrations, 0, sizeof(migrations));
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_edge_table_copy(&self->edges, &edges, 0);
     if (ret != 0) {
         goto out;
@@ -12933,6 +17599,10 @@ tsk_table_collection_subset(tsk_table_collection_t *self, const tsk_id_t *nodes,
     if (ret != 0) {
         goto out;
     }
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     /* Not calling TSK_CHECK_TREES so casting to int is safe */
     ret = (int) tsk_table_collection_check_integrity(self, 0);
     if (ret != 0) {
@@ -13229,6 +17899,10 @@ tsk_table_collection_union(tsk_table_collection_t *self,
     bool all_edges = !!(options & TSK_UNION_ALL_EDGES);
     bool all_mutations = !!(options & TSK_UNION_ALL_MUTATIONS);
 
+    ret = check_table_writable(self->mapped_store);
+    if (ret != 0) {
+        goto out;
+    }
     /* Not calling TSK_CHECK_TREES so casting to int is safe */
     ret = (int) tsk_table_collection_check_integrity(self, 0);
     if (ret != 0) {
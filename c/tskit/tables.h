@@ -264,6 +264,27 @@ typedef struct {
 /* Table definitions */
 /****************************************************************************/
 
+/**
+@brief Memory allocation for table columns.
+
+@rst
+See :c:func:`tsk_table_collection_set_allocator` for details.
+@endrst
+*/
+typedef struct {
+    /** @brief Allocates size bytes, or NULL to use the default. */
+    void *(*malloc)(size_t size, void *user_data);
+    /** @brief Resizes an allocation to size bytes, or NULL to use the default. */
+    void *(*realloc)(void *ptr, size_t size, void *user_data);
+    /** @brief Frees an allocation, or NULL to use the default. */
+    void (*free)(void *ptr, void *user_data);
+    /** @brief Passed to the functions above. */
+    void *user_data;
+    /** @brief The factor by which full columns grow. If 0, columns double in
+     * size up to a limit on the additional size, as usual. */
+    double growth_factor;
+} tsk_table_allocator_t;
+
 /**
 @brief The individual table.
 
@@ -306,6 +327,10 @@ typedef struct {
     tsk_size_t *metadata_offset;
     /** @brief The metadata schema */
     char *metadata_schema;
+    /* Private; the allocator used for the columns, or NULL for the default */
+    const tsk_table_allocator_t *allocator;
+    /* Private; the store that columns loaded with TSK_LOAD_MMAP point into */
+    const kastore_t *mapped_store;
 } tsk_individual_table_t;
 
 /**
@@ -340,6 +365,10 @@ typedef struct {
     tsk_size_t *metadata_offset;
     /** @brief The metadata schema */
     char *metadata_schema;
+    /* Private; the allocator used for the columns, or NULL for the default */
+    const tsk_table_allocator_t *allocator;
+    /* Private; the store that columns loaded with TSK_LOAD_MMAP point into */
+    const kastore_t *mapped_store;
 } tsk_node_table_t;
 
 /**
@@ -376,6 +405,10 @@ typedef struct {
     char *metadata_schema;
     /** @brief Flags for this table */
     tsk_flags_t options;
+    /* Private; the allocator used for the columns, or NULL for the default */
+    const tsk_table_allocator_t *allocator;
+    /* Private; the store that columns loaded with TSK_LOAD_MMAP point into */
+    const kastore_t *mapped_store;
 } tsk_edge_table_t;
 
 /**
@@ -414,6 +447,10 @@ typedef struct {
     tsk_size_t *metadata_offset;
     /** @brief The metadata schema */
     char *metadata_schema;
+    /* Private; the allocator used for the columns, or NULL for the default */
+    const tsk_table_allocator_t *allocator;
+    /* Private; the store that columns loaded with TSK_LOAD_MMAP point into */
+    const kastore_t *mapped_store;
 } tsk_migration_table_t;
 
 /**
@@ -449,6 +486,10 @@ typedef struct {
     tsk_size_t *metadata_offset;
     /** @brief The metadata schema */
     char *metadata_schema;
+    /* Private; the allocator used for the columns, or NULL for the default */
+    const tsk_table_allocator_t *allocator;
+    /* Private; the store that columns loaded with TSK_LOAD_MMAP point into */
+    const kastore_t *mapped_store;
 } tsk_site_table_t;
 
 /**
@@ -490,6 +531,10 @@ typedef struct {
     tsk_size_t *metadata_offset;
     /** @brief The metadata schema */
     char *metadata_schema;
+    /* Private; the allocator used for the columns, or NULL for the default */
+    const tsk_table_allocator_t *allocator;
+    /* Private; the store that columns loaded with TSK_LOAD_MMAP point into */
+    const kastore_t *mapped_store;
 } tsk_mutation_table_t;
 
 /**
@@ -516,6 +561,10 @@ typedef struct {
     tsk_size_t *metadata_offset;
     /** @brief The metadata schema */
     char *metadata_schema;
+    /* Private; the allocator used for the columns, or NULL for the default */
+    const tsk_table_allocator_t *allocator;
+    /* Private; the store that columns loaded with TSK_LOAD_MMAP point into */
+    const kastore_t *mapped_store;
 } tsk_population_table_t;
 
 /**
@@ -547,8 +596,65 @@ typedef struct {
     char *record;
     /** @brief The record_offset column. */
     tsk_size_t *record_offset;
+    /* Private; the allocator used for the columns, or NULL for the default */
+    const tsk_table_allocator_t *allocator;
+    /* Private; the store that columns loaded with TSK_LOAD_MMAP point into */
+    const kastore_t *mapped_store;
 } tsk_provenance_table_t;
 
+/**
+@brief Space reserved for appending rows to a node table.
+
+@rst
+See :c:func:`tsk_node_table_reserve_rows` for details.
+@endrst
+*/
+typedef struct {
+    /** @brief The number of rows reserved. */
+    tsk_size_t num_rows;
+    /** @brief The number of bytes of metadata reserved. */
+    tsk_size_t metadata_length;
+    /** @brief The flags of the reserved rows. */
+    tsk_flags_t *flags;
+    /** @brief The time of the reserved rows. */
+    double *time;
+    /** @brief The population of the reserved rows. */
+    tsk_id_t *population;
+    /** @brief The individual of the reserved rows. */
+    tsk_id_t *individual;
+    /** @brief The reserved metadata. */
+    char *metadata;
+    /** @brief The metadata offsets of the reserved rows, num_rows + 1 in total. */
+    tsk_size_t *metadata_offset;
+} tsk_node_table_batch_t;
+
+/**
+@brief Space reserved for appending rows to an edge table.
+
+@rst
+See :c:func:`tsk_edge_table_reserve_rows` for details.
+@endrst
+*/
+typedef struct {
+    /** @brief The number of rows reserved. */
+    tsk_size_t num_rows;
+    /** @brief The number of bytes of metadata reserved. */
+    tsk_size_t metadata_length;
+    /** @brief The left coordinate of the reserved rows. */
+    double *left;
+    /** @brief The right coordinate of the reserved rows. */
+    double *right;
+    /** @brief The parent of the reserved rows. */
+    tsk_id_t *parent;
+    /** @brief The child of the reserved rows. */
+    tsk_id_t *child;
+    /** @brief The reserved metadata, or NULL if the table has no metadata. */
+    char *metadata;
+    /** @brief The metadata offsets of the reserved rows, num_rows + 1 in total,
+     * or NULL if the table has no metadata. */
+    tsk_size_t *metadata_offset;
+} tsk_edge_table_batch_t;
+
 typedef struct {
     char *data;
     tsk_size_t data_length;
@@ -598,6 +704,10 @@ typedef struct {
         tsk_id_t *edge_removal_order;
         tsk_size_t num_edges;
     } indexes;
+    /* Private; the memory mapped store backing columns loaded with TSK_LOAD_MMAP */
+    kastore_t *mapped_store;
+    /* Private; the allocator used for the table columns, or NULL for the default */
+    const tsk_table_allocator_t *allocator;
 } tsk_table_collection_t;
 
 /**
@@ -622,6 +732,32 @@ typedef struct {
     tsk_size_t provenances;
 } tsk_bookmark_t;
 
+/* Private; an array derived from the tables, which may be stored alongside
+ * them in a file. */
+typedef struct {
+    const char *name;
+    void *array;
+    tsk_size_t length;
+    int type;
+} tsk_derived_array_t;
+
+/**
+@brief Reads a sequence of table collections from a stream.
+
+@rst
+See :c:func:`tsk_table_collection_reader_init` for details.
+@endrst
+*/
+typedef struct {
+    /** @brief The most recently read table collection. */
+    tsk_table_collection_t tables;
+    /* Private */
+    FILE *file;
+    tsk_flags_t options;
+    void *buffer;
+    size_t buffer_size;
+} tsk_table_collection_reader_t;
+
 /**
 @brief Low-level table sorting method.
 */
@@ -638,8 +774,36 @@ typedef struct _tsk_table_sorter_t {
     void *user_data;
     /** @brief Mapping from input site IDs to output site IDs */
     tsk_id_t *site_id_map;
+    /** @brief The maximum number of threads used by
+     * tsk_table_sorter_sort_edges_parallel. */
+    tsk_size_t num_threads;
+    /** @brief The options the sorter was initialised with. */
+    tsk_flags_t options;
 } tsk_table_sorter_t;
 
+/**
+@brief A simplifier that keeps its state between calls.
+
+@rst
+See :c:func:`tsk_incremental_simplifier_init` for details.
+@endrst
+*/
+typedef struct {
+    /** @brief The tables that are simplified. */
+    tsk_table_collection_t *tables;
+    /** @brief The simplify options. */
+    tsk_flags_t options;
+    /** @brief The maximum number of ancestry segments in use at any point
+     * during the last call to :c:func:`tsk_incremental_simplifier_run`. */
+    tsk_size_t max_num_segments;
+    /** @brief The number of ancestry segments still in use at the end of the
+     * last call to :c:func:`tsk_incremental_simplifier_run`. */
+    tsk_size_t num_segments;
+    /* private */
+    tsk_bookmark_t sorted;
+    struct _simplifier_t *simplifier;
+} tsk_incremental_simplifier_t;
+
 /* Structs for IBD finding.
  * TODO: document properly
  * */
@@ -830,6 +994,77 @@ with error TSK_ERR_METADATA_DISABLED.
 @endrst
 */
 #define TSK_TC_NO_EDGE_METADATA (1 << 3)
+/**
+@rst
+Memory map the file rather than reading it into memory, so that columns
+refer directly to the file's contents. The resulting tables must be
+treated as read-only; see :c:func:`tsk_table_collection_load` for details.
+@endrst
+*/
+#define TSK_LOAD_MMAP (1 << 4)
+/**
+Do not load the metadata or metadata schemas of the tables, leaving
+all rows with empty metadata.
+*/
+#define TSK_LOAD_SKIP_METADATA (1 << 5)
+/** Do not load the provenance table, leaving it with zero rows. */
+#define TSK_LOAD_SKIP_PROVENANCES (1 << 6)
+/**
+@rst
+Adopt the tree sequence indexes stored in the file by
+:c:macro:`TSK_DUMP_TREESEQ_INDEXES` rather than computing them, if they
+were written along with the tables. Only used by :c:func:`tsk_treeseq_load`
+and :c:func:`tsk_treeseq_loadf`; see :c:func:`tsk_treeseq_load` for details.
+@endrst
+*/
+#define TSK_LOAD_TREESEQ_INDEXES (1 << 7)
+/**
+@rst
+Verify the checksum of each array as it is read from the file, failing
+with a kastore error if the stored bytes have been corrupted. Arrays in
+files written before checksums were added are not verified.
+@endrst
+*/
+#define TSK_LOAD_VERIFY (1 << 8)
+/**
+@rst
+Build the site and mutation structs of the loaded tree sequence on first
+use, as for the :c:macro:`TSK_TS_INIT_LAZY` option to
+:c:func:`tsk_treeseq_init`. Only used by :c:func:`tsk_treeseq_load` and
+:c:func:`tsk_treeseq_loadf`.
+@endrst
+*/
+#define TSK_LOAD_LAZY (1 << 9)
+/** @} */
+
+/**
+@defgroup API_FLAGS_DUMP_GROUP Flags used by dump methods.
+@{
+*/
+/**
+Compress the columns in the file. Integer columns are delta encoded and
+floating point and text columns are compressed with an LZ77 scheme. Files
+written with this option have a higher major file format version, so that
+earlier versions of tskit, which cannot read them, fail with
+:c:macro:`TSK_ERR_FILE_VERSION_TOO_NEW`.
+*/
+#define TSK_DUMP_COMPRESS (1 << 0)
+/**
+@rst
+Store the indexes computed when initialising a tree sequence in the file,
+so that they can be adopted by :c:macro:`TSK_LOAD_TREESEQ_INDEXES`. Only
+used by :c:func:`tsk_treeseq_dump` and :c:func:`tsk_treeseq_dumpf`.
+@endrst
+*/
+#define TSK_DUMP_TREESEQ_INDEXES (1 << 1)
+/**
+@rst
+Do not store a checksum with each array in the file. This avoids a pass
+over the data when writing, but corruption of the file cannot then be
+detected by :c:macro:`TSK_LOAD_VERIFY`.
+@endrst
+*/
+#define TSK_DUMP_NO_CHECKSUMS (1 << 2)
 /** @} */
 
 /* Flags for dump tables */
@@ -911,6 +1146,25 @@ top-level information of the table collections being compared.
 #define TSK_CMP_IGNORE_REFERENCE_SEQUENCE (1 << 5)
 /** @} */
 
+/**
+@defgroup API_FLAGS_SORT_GROUP Flags used by :c:func:`tsk_table_collection_sort`.
+@{
+*/
+/**
+@rst
+Sort only the rows from the specified start position onwards in the
+``edge``, ``site`` and ``mutation`` tables, and then merge them with the
+rows before the start position. This requires time linear in the number
+of rows plus the time to sort the new rows, rather than the time to sort
+all rows. The rows before the start position are expected to be sorted
+already, but this is checked, and they are also sorted if necessary, so
+that the result is always the same as a full sort. This includes the case
+where there are no rows after the start position.
+@endrst
+*/
+#define TSK_SORT_MERGE (1 << 0)
+/** @} */
+
 /**
 @defgroup API_FLAGS_CLEAR_GROUP Flags used by :c:func:`tsk_table_collection_clear`.
 @{
@@ -1404,6 +1658,58 @@ tsk_id_t tsk_node_table_add_row(tsk_node_table_t *self, tsk_flags_t flags, doubl
     tsk_id_t population, tsk_id_t individual, const char *metadata,
     tsk_size_t metadata_length);
 
+/**
+@brief Reserves space for appending rows to this node table.
+
+@rst
+Grows the columns of the table so that ``num_rows`` rows with
+``metadata_length`` bytes of metadata in total can be appended, and sets
+the fields of ``batch`` to point at the reserved space. The values of the
+new rows are then written directly into the ``batch`` arrays, and the rows
+are added to the table by :c:func:`tsk_node_table_commit_rows`.
+
+The offsets of the new rows follow on from the offsets in the table, so
+``batch->metadata_offset[0]`` is set to the current length of the metadata
+column. The metadata of row ``j`` of the batch is written to the column
+between ``batch->metadata_offset[j]`` and ``batch->metadata_offset[j + 1]``,
+which is at ``batch->metadata + batch->metadata_offset[j] -
+batch->metadata_offset[0]``.
+
+The table must not be modified between reserving and committing the rows,
+as this may move the reserved space.
+@endrst
+
+@param self A pointer to a tsk_node_table_t object.
+@param num_rows The number of rows to reserve.
+@param metadata_length The number of bytes of metadata to reserve.
+@param batch A pointer to a tsk_node_table_batch_t, which is filled in
+    with the reserved space.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_node_table_reserve_rows(tsk_node_table_t *self, tsk_size_t num_rows,
+    tsk_size_t metadata_length, tsk_node_table_batch_t *batch);
+
+/**
+@brief Adds rows written into reserved space to this node table.
+
+@rst
+Adds the first ``num_rows`` rows written into the space reserved by
+:c:func:`tsk_node_table_reserve_rows`. Fails with :c:macro:`TSK_ERR_BAD_OFFSET`
+if the metadata offsets of these rows are decreasing or exceed the reserved
+metadata, and with :c:macro:`TSK_ERR_BAD_PARAM_VALUE` if ``num_rows``
+exceeds the number of rows reserved or the table was modified since they
+were reserved. The values in the rows are not otherwise checked.
+@endrst
+
+@param self A pointer to a tsk_node_table_t object.
+@param batch A pointer to the tsk_node_table_batch_t filled in by
+    :c:func:`tsk_node_table_reserve_rows`.
+@param num_rows The number of rows to add.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_node_table_commit_rows(
+    tsk_node_table_t *self, const tsk_node_table_batch_t *batch, tsk_size_t num_rows);
+
 /**
 @brief Updates the row at the specified index.
 
@@ -1751,6 +2057,41 @@ for details of the columns in this table.
 tsk_id_t tsk_edge_table_add_row(tsk_edge_table_t *self, double left, double right,
     tsk_id_t parent, tsk_id_t child, const char *metadata, tsk_size_t metadata_length);
 
+/**
+@brief Reserves space for appending rows to this edge table.
+
+@rst
+Works in the same way as :c:func:`tsk_node_table_reserve_rows`. If the table
+was initialised with :c:macro:`TSK_TABLE_NO_METADATA`, ``metadata_length``
+must be 0 and the metadata fields of ``batch`` are NULL.
+@endrst
+
+@param self A pointer to a tsk_edge_table_t object.
+@param num_rows The number of rows to reserve.
+@param metadata_length The number of bytes of metadata to reserve.
+@param batch A pointer to a tsk_edge_table_batch_t, which is filled in
+    with the reserved space.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_edge_table_reserve_rows(tsk_edge_table_t *self, tsk_size_t num_rows,
+    tsk_size_t metadata_length, tsk_edge_table_batch_t *batch);
+
+/**
+@brief Adds rows written into reserved space to this edge table.
+
+@rst
+Works in the same way as :c:func:`tsk_node_table_commit_rows`.
+@endrst
+
+@param self A pointer to a tsk_edge_table_t object.
+@param batch A pointer to the tsk_edge_table_batch_t filled in by
+    :c:func:`tsk_edge_table_reserve_rows`.
+@param num_rows The number of rows to add.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_edge_table_commit_rows(
+    tsk_edge_table_t *self, const tsk_edge_table_batch_t *batch, tsk_size_t num_rows);
+
 /**
 @brief Updates the row at the specified index.
 
@@ -3871,6 +4212,44 @@ int tsk_table_collection_init(tsk_table_collection_t *self, tsk_flags_t options)
 */
 int tsk_table_collection_free(tsk_table_collection_t *self);
 
+/**
+@brief Set the allocator used for the columns of the tables.
+
+@rst
+By default, table columns are allocated with ``malloc`` and ``realloc``, and
+grow by doubling their size up to a limit on the additional space. After
+this call, the columns of all tables in the collection are allocated with
+the functions in the specified allocator, and grow according to its policy.
+This can be used to keep the tables in a pre-reserved arena or in memory
+backed by huge pages, and to avoid copying very large columns on realloc.
+
+The ``malloc``, ``realloc`` and ``free`` functions must either all be set or
+all be NULL, in which case the default functions are used with the
+allocator's growth policy. If ``growth_factor`` is non-zero it must be
+greater than 1, and full columns are then multiplied in size by this factor
+without a limit on the additional space. Columns are allocated with the
+sizes they need; aligning the addresses or sizes of allocations, for example
+to huge pages, is the job of the allocator's functions.
+
+The existing contents of the tables are copied into columns allocated with
+the new allocator, which is kept until the tables are freed or reinitialised.
+The allocator is not copied, and must remain valid for as long as it is used.
+Specify NULL to return to the default allocator.
+
+Arrays passed to the ``takeset_columns`` functions of the tables in the
+collection must be allocated with the allocator's ``malloc`` function.
+Columns that are loaded from a file are copied into memory from the
+allocator, so that the :c:macro:`TSK_LOAD_MMAP` option is not supported;
+loading must use the :c:macro:`TSK_NO_INIT` option to keep the allocator.
+@endrst
+
+@param self A pointer to a tsk_table_collection_t object.
+@param allocator A pointer to a tsk_table_allocator_t, or NULL.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_table_collection_set_allocator(
+    tsk_table_collection_t *self, const tsk_table_allocator_t *allocator);
+
 /**
 @brief Clears data tables (and optionally provenances and metadata) in
 this table collection.
@@ -3992,6 +4371,35 @@ the table collection will be read, leaving all tables with zero rows and no
 metadata or schema.
 If the :c:macro:`TSK_LOAD_SKIP_REFERENCE_SEQUENCE` option is set, the table collection is
 read without loading the reference sequence.
+If the :c:macro:`TSK_LOAD_SKIP_METADATA` option is set, the metadata columns and
+metadata schemas of the tables are not read, leaving every row with empty
+metadata; top-level and reference sequence metadata are still loaded.
+If the :c:macro:`TSK_LOAD_SKIP_PROVENANCES` option is set, the provenance table
+is not read and has zero rows.
+When any of these options are set, only the parts of the file that are required
+are read, which can greatly reduce the time and memory needed to load files
+with large amounts of metadata or provenance.
+
+If the :c:macro:`TSK_LOAD_MMAP` option is set, the file is memory mapped and
+the table columns point directly into the mapping wherever the stored data can
+be used as-is, avoiding the cost of copying the data into memory. The mapping
+is released by :c:func:`tsk_table_collection_free`. The mapping is read-only,
+so that its pages are shared with other processes reading the same file.
+Adding rows to tables loaded in this way, updating or removing rows, and
+operations that modify the tables in place, such as
+:c:func:`tsk_table_collection_sort` and :c:func:`tsk_table_collection_simplify`,
+fail with :c:macro:`TSK_ERR_CANT_MODIFY_MAPPED`; use
+:c:func:`tsk_table_collection_copy` to obtain a modifiable copy. Memory
+mapping is only supported for regular files on POSIX systems, and cannot be
+combined with :c:macro:`TSK_NO_INIT` on a table collection that was itself
+memory mapped.
+
+If the :c:macro:`TSK_LOAD_VERIFY` option is set, the checksum stored with
+each array is checked against the data that is read, and a kastore error
+is returned if they differ. Checksums are written by the dump methods
+unless the :c:macro:`TSK_DUMP_NO_CHECKSUMS` option is set; arrays without
+a checksum, including those in files written by earlier versions, are not
+verified.
 
 **Options**
 
@@ -4001,6 +4409,10 @@ flags:
 - :c:macro:`TSK_NO_INIT`
 - :c:macro:`TSK_LOAD_SKIP_TABLES`
 - :c:macro:`TSK_LOAD_SKIP_REFERENCE_SEQUENCE`
+- :c:macro:`TSK_LOAD_SKIP_METADATA`
+- :c:macro:`TSK_LOAD_SKIP_PROVENANCES`
+- :c:macro:`TSK_LOAD_MMAP`
+- :c:macro:`TSK_LOAD_VERIFY`
 
 **Examples**
 
@@ -4026,6 +4438,104 @@ flags:
 int tsk_table_collection_load(
     tsk_table_collection_t *self, const char *filename, tsk_flags_t options);
 
+/**
+@brief Load a table collection from a file path using multiple threads.
+
+@rst
+Behaves exactly like :c:func:`tsk_table_collection_load`, except that
+up to ``num_threads`` threads are used to read the column data from the file
+concurrently. This can substantially reduce load times on storage that
+cannot be saturated by a single reader, such as NVMe drives. The options
+are the same as for :c:func:`tsk_table_collection_load`.
+
+Concurrent reads are only performed when the complete file is read, i.e.,
+when none of the ``TSK_LOAD_SKIP_*`` options or :c:macro:`TSK_LOAD_MMAP`
+are specified, and only on POSIX systems. Otherwise, or if ``num_threads``
+is less than 2, the file is read sequentially.
+@endrst
+
+@param self A pointer to an uninitialised tsk_table_collection_t object
+    if the TSK_NO_INIT option is not set (default), or an initialised
+    tsk_table_collection_t otherwise.
+@param filename A NULL terminated string containing the filename.
+@param num_threads The maximum number of threads to use.
+@param options Bitwise options. See above for details.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_table_collection_load_parallel(tsk_table_collection_t *self,
+    const char *filename, tsk_size_t num_threads, tsk_flags_t options);
+
+/**
+@brief Load the part of a table collection within a genomic interval.
+
+@rst
+Loads the tables from the specified file, keeping only the parts that are
+within the half-open genomic interval ``[left, right)``. Edges and
+migrations that overlap the interval are kept, with their coordinates
+clipped to the interval, and the sites within the interval are kept along
+with their mutations. The node, individual, population and provenance
+tables, the top-level metadata and the reference sequence are loaded in
+full, and the sequence length is unchanged, so that node IDs are the same
+as in the file and the result can be used to initialise a tree sequence
+whose trees outside the interval are empty.
+
+On POSIX systems the file is memory mapped while it is read, and the sites
+and mutations within the interval are found by binary search, so that only
+the parts of the site and mutation columns within the interval are read
+from disk. The edge and migration coordinates are read in full. The
+resulting tables are independent of the file, and may be modified.
+
+The tables in the file must be sorted, as is the case for any file written
+from a tree sequence. The edge indexes are rebuilt for the kept edges if
+they were present in the file.
+
+The options are the same as for :c:func:`tsk_table_collection_load`, except
+that :c:macro:`TSK_LOAD_MMAP` has no additional effect.
+@endrst
+
+@param self A pointer to an uninitialised tsk_table_collection_t object
+    if the TSK_NO_INIT option is not set (default), or an initialised
+    tsk_table_collection_t otherwise.
+@param filename A NULL terminated string containing the filename.
+@param left The left coordinate of the interval to load.
+@param right The right coordinate of the interval to load.
+@param options Bitwise options. See above for details.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_table_collection_load_interval(tsk_table_collection_t *self,
+    const char *filename, double left, double right, tsk_flags_t options);
+
+/**
+@brief Load a table collection from a file of increments.
+
+@rst
+Reads the complete table collection written by the first call to
+:c:func:`tsk_table_collection_dump_increment` from the specified file, and
+then appends the rows of each subsequent increment to its tables. The
+sequence length, time units, metadata and metadata schemas are taken from the
+last increment. If any edges were appended the collection is not indexed.
+
+A :c:macro:`TSK_ERR_BAD_INCREMENT` error is returned if the increments do not
+each start at the end of the rows that precede them. Files written with
+:c:func:`tsk_table_collection_dump` are also accepted, and loaded as for
+:c:func:`tsk_table_collection_load`.
+
+**Options**
+
+The options are as for :c:func:`tsk_table_collection_load`, except that
+:c:macro:`TSK_LOAD_MMAP` is not supported.
+@endrst
+
+@param self A pointer to an uninitialised tsk_table_collection_t object
+    if the TSK_NO_INIT option is not set (default), or an initialised
+    tsk_table_collection_t otherwise.
+@param filename A NULL terminated string containing the filename.
+@param options Bitwise options. See above for details.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_table_collection_load_increments(
+    tsk_table_collection_t *self, const char *filename, tsk_flags_t options);
+
 /**
 @brief Load a table collection from a stream.
 
@@ -4056,11 +4566,17 @@ Please note that this streaming behaviour is not supported if the
 set. If the :c:macro:`TSK_LOAD_SKIP_TABLES` option is set, only the non-table information
 from the table collection will be read, leaving all tables with zero rows and no metadata
 or schema. If the :c:macro:`TSK_LOAD_SKIP_REFERENCE_SEQUENCE` option is set, the table
-collection is read without loading the reference sequence. When attempting to read from a
-stream with multiple table collection definitions and either of these two options set,
+collection is read without loading the reference sequence. The same applies to
+:c:macro:`TSK_LOAD_SKIP_METADATA` and :c:macro:`TSK_LOAD_SKIP_PROVENANCES`; see
+:c:func:`tsk_table_collection_load` for details. When attempting to read from a
+stream with multiple table collection definitions and any of these options set,
 the requested information from the first table collection will be read on the first call
 to :c:func:`tsk_table_collection_loadf`, with subsequent calls leading to errors.
 
+The :c:macro:`TSK_LOAD_MMAP` option is supported only when the stream is a
+regular file positioned at an 8 byte aligned offset; see
+:c:func:`tsk_table_collection_load` for details.
+
 **Options**
 
 Options can be specified by providing one or more of the following bitwise
@@ -4069,6 +4585,10 @@ flags:
 - :c:macro:`TSK_NO_INIT`
 - :c:macro:`TSK_LOAD_SKIP_TABLES`
 - :c:macro:`TSK_LOAD_SKIP_REFERENCE_SEQUENCE`
+- :c:macro:`TSK_LOAD_SKIP_METADATA`
+- :c:macro:`TSK_LOAD_SKIP_PROVENANCES`
+- :c:macro:`TSK_LOAD_MMAP`
+- :c:macro:`TSK_LOAD_VERIFY`
 @endrst
 
 @param self A pointer to an uninitialised tsk_table_collection_t object
@@ -4083,6 +4603,81 @@ flags:
 int tsk_table_collection_loadf(
     tsk_table_collection_t *self, FILE *file, tsk_flags_t options);
 
+/**
+@brief Initialise a reader for a stream of table collections.
+
+@rst
+Initialises a reader for the table collections stored sequentially in the
+specified stream, which are then read in turn by calling
+:c:func:`tsk_table_collection_reader_next`. This is equivalent to calling
+:c:func:`tsk_table_collection_loadf` repeatedly with the same table
+collection, but the memory used is recycled from one table collection to the
+next: each is read from the stream into a single buffer, and its columns are
+copied into the existing tables of the reader. Once the buffer and tables are
+large enough to hold the table collections in the stream, reading a table
+collection allocates very little memory.
+
+The stream can be an arbitrary file descriptor, for example a pipe or a
+network socket. No seek operations are performed, and each table
+collection is read in full, so that streaming is also supported with the
+:c:macro:`TSK_LOAD_SKIP_TABLES`, :c:macro:`TSK_LOAD_SKIP_REFERENCE_SEQUENCE`,
+:c:macro:`TSK_LOAD_SKIP_METADATA` and :c:macro:`TSK_LOAD_SKIP_PROVENANCES`
+options. The :c:macro:`TSK_LOAD_MMAP` option is not supported.
+
+The resources allocated must be freed using
+:c:func:`tsk_table_collection_reader_free` even in error conditions.
+
+**Options**
+
+Options can be specified by providing one or more of the following bitwise
+flags:
+
+- :c:macro:`TSK_LOAD_SKIP_TABLES`
+- :c:macro:`TSK_LOAD_SKIP_REFERENCE_SEQUENCE`
+- :c:macro:`TSK_LOAD_SKIP_METADATA`
+- :c:macro:`TSK_LOAD_SKIP_PROVENANCES`
+- :c:macro:`TSK_LOAD_VERIFY`
+- :c:macro:`TSK_TC_NO_EDGE_METADATA`
+@endrst
+
+@param self A pointer to an uninitialised tsk_table_collection_reader_t object.
+@param file A FILE stream opened in an appropriate mode for reading.
+@param options Bitwise options. See above for details.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_table_collection_reader_init(
+    tsk_table_collection_reader_t *self, FILE *file, tsk_flags_t options);
+
+/**
+@brief Read the next table collection from the stream.
+
+@rst
+Reads the next table collection from the stream into the ``tables`` member
+of the reader, replacing its previous contents. The tables may be modified
+by the caller between calls, but remain owned by the reader. If the stream
+contains no more table collection definitions the error value
+:c:macro:`TSK_ERR_EOF` is returned; as for :c:func:`tsk_table_collection_loadf`
+this only happens when zero bytes are read from the stream. After any other
+error the contents of the tables are unspecified.
+@endrst
+
+@param self A pointer to an initialised tsk_table_collection_reader_t object.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_table_collection_reader_next(tsk_table_collection_reader_t *self);
+
+/**
+@brief Free the internal memory for the specified reader.
+
+@rst
+The stream is not closed.
+@endrst
+
+@param self A pointer to an initialised tsk_table_collection_reader_t object.
+@return Always returns 0.
+*/
+int tsk_table_collection_reader_free(tsk_table_collection_reader_t *self);
+
 /**
 @brief Write a table collection to file.
 
@@ -4092,6 +4687,15 @@ Writes the data from this table collection to the specified file.
 If an error occurs the file path is deleted, ensuring that only complete
 and well formed files will be written.
 
+**Options**
+
+Options can be specified by providing the following bitwise flags:
+
+- :c:macro:`TSK_DUMP_COMPRESS`
+
+Compressed files are decompressed transparently by
+:c:func:`tsk_table_collection_load`.
+
 **Examples**
 
 .. code-block:: c
@@ -4110,13 +4714,33 @@ and well formed files will be written.
 
 @param self A pointer to an initialised tsk_table_collection_t object.
 @param filename A NULL terminated string containing the filename.
-@param options Bitwise options. Currently unused; should be
-    set to zero to ensure compatibility with later versions of tskit.
+@param options Bitwise options. See above for details.
 @return Return 0 on success or a negative value on failure.
 */
 int tsk_table_collection_dump(
     const tsk_table_collection_t *self, const char *filename, tsk_flags_t options);
 
+/**
+@brief Write a table collection to file using multiple threads.
+
+@rst
+Behaves exactly like :c:func:`tsk_table_collection_dump`, except that
+up to ``num_threads`` threads are used to write the column data to the file
+concurrently. The resulting file is identical to that written by
+:c:func:`tsk_table_collection_dump`. On systems without positional IO
+(i.e., Windows), or if ``num_threads`` is less than 2, the file is written
+sequentially.
+@endrst
+
+@param self A pointer to an initialised tsk_table_collection_t object.
+@param filename A NULL terminated string containing the filename.
+@param num_threads The maximum number of threads to use.
+@param options Bitwise options. See :c:func:`tsk_table_collection_dump`.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_table_collection_dump_parallel(const tsk_table_collection_t *self,
+    const char *filename, tsk_size_t num_threads, tsk_flags_t options);
+
 /**
 @brief Write a table collection to a stream.
 
@@ -4132,13 +4756,51 @@ of how to sequentially dump and load tree sequences from a stream.
 @param self A pointer to an initialised tsk_table_collection_t object.
 @param file A FILE stream opened in an appropriate mode for writing (e.g.
     "w", "a", "r+" or "w+").
-@param options Bitwise options. Currently unused; should be
-    set to zero to ensure compatibility with later versions of tskit.
+@param options Bitwise options. See :c:func:`tsk_table_collection_dump`.
 @return Return 0 on success or a negative value on failure.
 */
 int tsk_table_collection_dumpf(
     const tsk_table_collection_t *self, FILE *file, tsk_flags_t options);
 
+/**
+@brief Append the rows added since a bookmark to a file of increments.
+
+@rst
+Writes the rows of this table collection following the specified bookmark to
+the end of the specified file, and then updates the bookmark to record the
+current number of rows in each table. This allows a table collection that is
+only ever appended to (such as in a forward simulation) to be checkpointed at a
+cost proportional to the number of new rows rather than the total size. The
+complete collection can be reassembled using
+:c:func:`tsk_table_collection_load_increments`.
+
+If all the entries in the bookmark are zero the file is created (or truncated)
+and the complete collection is written, exactly as for
+:c:func:`tsk_table_collection_dump`. Otherwise, the rows following the bookmark
+are appended to the file as a separate store, along with the current sequence
+length, time units, metadata and metadata schemas. The reference sequence and
+indexes are only written with the complete collection.
+
+Rows preceding the bookmark must not have been modified since they were
+written. If an error occurs the bookmark is not updated, and the end of the
+file may contain an incomplete increment.
+
+**Options**
+
+As for :c:func:`tsk_table_collection_dump`.
+@endrst
+
+@param self A pointer to an initialised tsk_table_collection_t object.
+@param filename A NULL terminated string containing the filename.
+@param bookmark A pointer to a tsk_bookmark_t recording the number of rows in
+    each table that have already been written to the file. This is updated on
+    success.
+@param options Bitwise options. See :c:func:`tsk_table_collection_dump`.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_table_collection_dump_increment(const tsk_table_collection_t *self,
+    const char *filename, tsk_bookmark_t *bookmark, tsk_flags_t options);
+
 /**
 @brief Record the number of rows in each table in the specified tsk_bookmark_t object.
 
@@ -4198,7 +4860,16 @@ and ``provenance``) are ignored and can be set to arbitrary values.
     ``migration``, start position results in an error. The start positions for the
     ``site``, ``mutation`` and ``individual`` tables can either be 0 or the length of the
     respective tables, allowing these tables to either be fully sorted, or not sorted at
-    all.
+    all. When :c:macro:`TSK_SORT_MERGE` is specified, any start position can be
+    given for the ``site`` and ``mutation`` tables, and the rows before it are
+    checked and sorted if necessary, even if it is the length of the table.
+
+By default, the rows before the start position in the ``edge`` table are left
+where they are, and only the rows after it are sorted. If the
+:c:macro:`TSK_SORT_MERGE` option is specified, the rows after the start position
+in the ``edge``, ``site`` and ``mutation`` tables are sorted and then merged
+with the rows before it, so that the whole of each table is sorted. This is
+useful when new rows are appended to sorted tables, as in forward simulations.
 
 The table collection will always be unindexed after sort successfully completes.
 
@@ -4218,6 +4889,9 @@ flags:
     guarantee reference integrity within the table collection. References
     to rows not in the table or bad offsets will result in undefined
     behaviour.
+:c:macro:`TSK_SORT_MERGE`
+    Merge the newly sorted rows with the rows before the start position
+    (see above).
 @endrst
 
 @param self A pointer to a tsk_table_collection_t object.
@@ -4358,6 +5032,93 @@ flags:
 int tsk_table_collection_simplify(tsk_table_collection_t *self, const tsk_id_t *samples,
     tsk_size_t num_samples, tsk_flags_t options, tsk_id_t *node_map);
 
+/**
+@brief Simplify the tables using multiple threads.
+
+@rst
+Simplifies the table collection in the same way as
+:c:func:`tsk_table_collection_simplify`, with the same result, but divides the
+work between up to ``num_threads`` threads. The genome is split into intervals
+containing similar numbers of edges, and the edges, sites and mutations in
+each interval are simplified independently. The simplified intervals are then
+joined and simplified again to filter and renumber the nodes, which only
+requires processing the (usually much smaller) simplified tables.
+
+The tables are simplified directly, without splitting the genome, if
+``num_threads`` is less than two, if the
+:c:macro:`TSK_SIMPLIFY_REDUCE_TO_SITE_TOPOLOGY` option is specified, or if the
+mutations are not grouped by site.
+@endrst
+
+@param self A pointer to a tsk_table_collection_t object.
+@param samples Either NULL or an array of num_samples distinct and valid node IDs.
+    See :c:func:`tsk_table_collection_simplify`.
+@param num_samples The number of node IDs in the input samples array. Ignored
+    if the samples array is NULL.
+@param options Simplify options; see :c:func:`tsk_table_collection_simplify`.
+@param node_map If not NULL, this array will be filled to define the mapping
+    between nodes IDs in the table collection before and after simplification.
+@param num_threads The maximum number of threads to use.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_table_collection_simplify_parallel(tsk_table_collection_t *self,
+    const tsk_id_t *samples, tsk_size_t num_samples, tsk_flags_t options,
+    tsk_id_t *node_map, tsk_size_t num_threads);
+
+/**
+@brief Initialise a simplifier that is run repeatedly on the same tables.
+
+@rst
+Forward simulations typically add rows to a table collection and simplify it
+at regular intervals. An incremental simplifier keeps the memory it uses
+between calls to :c:func:`tsk_incremental_simplifier_run`, so that it only
+needs to be allocated again when the tables grow. It also records the number
+of rows in the tables after each call; as these rows are sorted, only the
+rows added after them need to be sorted before the next call (see
+:c:macro:`TSK_SORT_MERGE`). The rows output by the previous call must not be
+modified, but rows can be removed, in which case all rows are sorted.
+
+The result of each call is the same as sorting the tables with
+:c:func:`tsk_table_collection_sort` and then calling
+:c:func:`tsk_table_collection_simplify` with the same options.
+@endrst
+
+@param self A pointer to an uninitialised tsk_incremental_simplifier_t object.
+@param tables A pointer to the tsk_table_collection_t object to simplify.
+@param options Simplify options; see :c:func:`tsk_table_collection_simplify`.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_incremental_simplifier_init(tsk_incremental_simplifier_t *self,
+    tsk_table_collection_t *tables, tsk_flags_t options);
+
+/**
+@brief Sort and simplify the tables.
+
+@rst
+Sorts the rows added to the tables since the previous call and simplifies
+them. See :c:func:`tsk_incremental_simplifier_init` for details.
+@endrst
+
+@param self A pointer to a tsk_incremental_simplifier_t object.
+@param samples Either NULL or an array of num_samples distinct and valid node IDs.
+    See :c:func:`tsk_table_collection_simplify`.
+@param num_samples The number of node IDs in the input samples array. Ignored
+    if the samples array is NULL.
+@param node_map If not NULL, this array will be filled to define the mapping
+    between nodes IDs in the table collection before and after simplification.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_incremental_simplifier_run(tsk_incremental_simplifier_t *self,
+    const tsk_id_t *samples, tsk_size_t num_samples, tsk_id_t *node_map);
+
+/**
+@brief Free the internal memory for the specified simplifier.
+
+@param self A pointer to an initialised tsk_incremental_simplifier_t object.
+@return Always returns 0.
+*/
+int tsk_incremental_simplifier_free(tsk_incremental_simplifier_t *self);
+
 /**
 @brief Subsets and reorders a table collection according to an array of nodes.
 
@@ -4552,6 +5313,27 @@ collection. Any existing index is first dropped using
 */
 int tsk_table_collection_build_index(tsk_table_collection_t *self, tsk_flags_t options);
 
+/**
+@brief Builds indexes for this table collection using multiple threads.
+
+@rst
+Builds the same indexes as :c:func:`tsk_table_collection_build_index`,
+sorting the edges for the insertion and removal orders concurrently. Each
+sort is split between half of the ``num_threads`` threads, and the integrity
+checks are made with :c:func:`tsk_table_collection_check_integrity_parallel`.
+Threads are only used on POSIX systems; otherwise, or if ``num_threads`` is
+less than 2, this is equivalent to :c:func:`tsk_table_collection_build_index`.
+@endrst
+
+@param self A pointer to a tsk_table_collection_t object.
+@param options Bitwise options. Currently unused; should be
+    set to zero to ensure compatibility with later versions of tskit.
+@param num_threads The maximum number of threads to use.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_table_collection_build_index_parallel(
+    tsk_table_collection_t *self, tsk_flags_t options, tsk_size_t num_threads);
+
 /**
 @brief Runs integrity checks on this table collection.
 
@@ -4602,6 +5384,37 @@ flags:
 tsk_id_t tsk_table_collection_check_integrity(
     const tsk_table_collection_t *self, tsk_flags_t options);
 
+/**
+@brief Check the integrity of this table collection using multiple threads.
+
+@rst
+Makes the same checks as :c:func:`tsk_table_collection_check_integrity`,
+dividing the checks on each table into chunks of rows that are made
+concurrently using up to ``num_threads`` threads. Once an error has been found,
+the remaining chunks of later rows and tables are skipped. The value returned
+is always the same as that of :c:func:`tsk_table_collection_check_integrity`:
+if there are several problems, the error returned is the one that the
+sequential checks would find first.
+
+The checks on the trees required by :c:macro:`TSK_CHECK_TREES` and
+:c:macro:`TSK_CHECK_MUTATION_PARENTS` are made sequentially after the
+checks on the tables. Threads are only used on POSIX systems; otherwise, or if
+``num_threads`` is less than 2, this is equivalent to
+:c:func:`tsk_table_collection_check_integrity`.
+@endrst
+
+@param self A pointer to a tsk_table_collection_t object.
+@param options Bitwise options, as for
+    :c:func:`tsk_table_collection_check_integrity`.
+@param num_threads The maximum number of threads to use.
+@return Return a negative error value on if any problems are detected
+   in the tree sequence. If the TSK_CHECK_TREES option is provided,
+   the number of trees in the tree sequence will be returned, on
+   success.
+*/
+tsk_id_t tsk_table_collection_check_integrity_parallel(
+    const tsk_table_collection_t *self, tsk_flags_t options, tsk_size_t num_threads);
+
 /** @} */
 
 /* Undocumented methods */
@@ -4632,12 +5445,33 @@ int tsk_table_collection_compute_mutation_parents(
     tsk_table_collection_t *self, tsk_flags_t options);
 int tsk_table_collection_compute_mutation_times(
     tsk_table_collection_t *self, double *random, tsk_flags_t options);
+/* Equivalent to setting all mutation parents to TSK_NULL and calling
+ * compute_mutation_times, build_index and compute_mutation_parents, computing
+ * the times and parents in a single pass over the trees. Blocks of mutations
+ * are processed concurrently using up to num_threads threads. */
+int tsk_table_collection_compute_mutation_parents_and_times(
+    tsk_table_collection_t *self, tsk_flags_t options, tsk_size_t num_threads);
 int tsk_table_collection_delete_older(
     tsk_table_collection_t *self, double time, tsk_flags_t options);
 
 int tsk_table_collection_set_indexes(tsk_table_collection_t *self,
     tsk_id_t *edge_insertion_order, tsk_id_t *edge_removal_order);
 
+/* Dump and load arrays derived from the tables along with them. Loaded arrays
+ * are only returned if they were written to the same file as the tables, and
+ * are left NULL otherwise. The caller owns the loaded arrays, unless the
+ * tables were loaded with TSK_LOAD_MMAP, in which case they point into the
+ * mapping and are released along with the tables. */
+int tsk_table_collection_dump_derived(const tsk_table_collection_t *self,
+    const char *filename, const tsk_derived_array_t *arrays, tsk_size_t num_arrays,
+    tsk_flags_t options);
+int tsk_table_collection_dumpf_derived(const tsk_table_collection_t *self, FILE *file,
+    const tsk_derived_array_t *arrays, tsk_size_t num_arrays, tsk_flags_t options);
+int tsk_table_collection_load_derived(tsk_table_collection_t *self, const char *filename,
+    tsk_derived_array_t *arrays, tsk_size_t num_arrays, tsk_flags_t options);
+int tsk_table_collection_loadf_derived(tsk_table_collection_t *self, FILE *file,
+    tsk_derived_array_t *arrays, tsk_size_t num_arrays, tsk_flags_t options);
+
 int tsk_table_collection_takeset_metadata(
     tsk_table_collection_t *self, char *metadata, tsk_size_t metadata_length);
 int tsk_table_collection_takeset_indexes(tsk_table_collection_t *self,
@@ -4708,7 +5542,7 @@ int tsk_reference_sequence_takeset_metadata(
 This must be called before any operations are performed on the
 table sorter and initialises all fields. The ``edge_sort`` function
 is set to the default method using qsort. The ``user_data``
-field is set to NULL.
+field is set to NULL and ``num_threads`` to 1.
 This method supports the same options as
 :c:func:`tsk_table_collection_sort`.
 
@@ -4755,6 +5589,40 @@ See :c:func:`tsk_table_collection_sort` for details on the ``start`` parameter.
 */
 int tsk_table_sorter_run(struct _tsk_table_sorter_t *self, const tsk_bookmark_t *start);
 
+/**
+@brief Sorts edges using multiple threads.
+
+@rst
+An edge sorting function that can be assigned to the ``sort_edges`` field
+of a sorter in place of the default. Edges are sorted into the same order
+as the default, using up to ``num_threads`` threads, as set in the sorter.
+Rather than comparing edges, the rank of each parent in the ordering of
+nodes by time and ID is packed with the child ID into an integer key, which
+is sorted with a parallel radix sort; edges with the same parent and child
+are then sorted by left coordinate. This is substantially faster than the
+default for large numbers of edges, even when a single thread is used.
+Edge metadata, if present, is moved into place on the calling thread.
+
+**Examples**
+
+.. code-block:: c
+
+    tsk_table_sorter_t sorter;
+    ret = tsk_table_sorter_init(&sorter, &tables, 0);
+    sorter.sort_edges = tsk_table_sorter_sort_edges_parallel;
+    sorter.num_threads = 8;
+    ret = tsk_table_sorter_run(&sorter, NULL);
+    tsk_table_sorter_free(&sorter);
+
+@endrst
+
+@param self A pointer to a tsk_table_sorter_t object.
+@param start The offset in the edge table at which sorting starts.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_table_sorter_sort_edges_parallel(
+    struct _tsk_table_sorter_t *self, tsk_size_t start);
+
 /**
 @brief Free the internal memory for the specified table sorter.
 
@@ -43,6 +43,18 @@ is_discrete(double x)
  * tree sequence
  * ======================================================== */
 
+/* The state used to build the site and mutation structs of a tree sequence
+ * initialised with TSK_TS_INIT_LAZY. This is allocated separately from the
+ * tree sequence, so that the structs can be built through it by functions
+ * that only have a const reference to the tree sequence.
+ */
+struct _tsk_treeseq_lazy_sites_t {
+    tsk_treeseq_t *tree_sequence;
+    tsk_mutex_t *mutex;
+    /* Set once the structs are built; written with the lock held */
+    int built;
+};
+
 static void
 tsk_treeseq_check_state(const tsk_treeseq_t *self)
 {
@@ -51,6 +63,10 @@ tsk_treeseq_check_state(const tsk_treeseq_t *self)
     tsk_site_t site;
     tsk_id_t site_id = 0;
 
+    if (self->tree_sites == NULL) {
+        /* The sites of a lazily initialised tree sequence are not built yet */
+        return;
+    }
     for (j = 0; j < self->num_trees; j++) {
         for (k = 0; k < self->tree_sites_length[j]; k++) {
             site = self->tree_sites[j][k];
@@ -78,7 +94,7 @@ tsk_treeseq_print_state(const tsk_treeseq_t *self, FILE *out)
     }
     tsk_table_collection_print_state(self->tables, out);
     fprintf(out, "tree_sites = \n");
-    for (j = 0; j < self->num_trees; j++) {
+    for (j = 0; j < self->num_trees && self->tree_sites != NULL; j++) {
         fprintf(out, "tree %lld\t%lld sites\n", (long long) j,
             (long long) self->tree_sites_length[j]);
         for (k = 0; k < self->tree_sites_length[j]; k++) {
@@ -103,9 +119,31 @@ tsk_treeseq_print_state(const tsk_treeseq_t *self, FILE *out)
     tsk_treeseq_check_state(self);
 }
 
+static void
+tsk_treeseq_free_checkpoints(tsk_treeseq_t *self)
+{
+    tsk_tree_checkpoints_t *checkpoints = &self->checkpoints;
+
+    tsk_safe_free(checkpoints->edges_offset);
+    tsk_safe_free(checkpoints->edges);
+    tsk_safe_free(checkpoints->insertion_index);
+    tsk_safe_free(checkpoints->removal_index);
+    tsk_memset(checkpoints, 0, sizeof(*checkpoints));
+}
+
 int
 tsk_treeseq_free(tsk_treeseq_t *self)
 {
+    if (self->mapped_indexes) {
+        /* These point into the mapped store, which is released with the tables */
+        self->samples = NULL;
+        self->sample_index_map = NULL;
+        self->breakpoints = NULL;
+        self->tree_sites_length = NULL;
+        self->individual_nodes_mem = NULL;
+        self->individual_nodes_length = NULL;
+        self->mutation_edge = NULL;
+    }
     if (self->tables != NULL) {
         tsk_table_collection_free(self->tables);
     }
@@ -122,21 +160,51 @@ tsk_treeseq_free(tsk_treeseq_t *self)
     tsk_safe_free(self->individual_nodes_mem);
     tsk_safe_free(self->individual_nodes_length);
     tsk_safe_free(self->individual_nodes);
+    tsk_safe_free(self->mutation_edge);
+    if (self->lazy_sites != NULL) {
+        if (self->lazy_sites->mutex != NULL) {
+            tsk_mutex_free(self->lazy_sites->mutex);
+        }
+        tsk_safe_free(self->lazy_sites);
+    }
+    tsk_treeseq_free_checkpoints(self);
     return 0;
 }
 
+/* Properties of the tree sequence found by each of the phases of
+ * tsk_treeseq_init. These are merged into the tree sequence once the phases
+ * have finished, so that the phases can be run concurrently. */
+typedef struct {
+    bool discrete_genome;
+    bool discrete_time;
+    double min_time;
+    double max_time;
+} treeseq_properties_t;
+
+static void
+treeseq_properties_init(treeseq_properties_t *self)
+{
+    self->discrete_genome = true;
+    self->discrete_time = true;
+    self->min_time = INFINITY;
+    self->max_time = -INFINITY;
+}
+
+static void
+tsk_treeseq_merge_properties(tsk_treeseq_t *self, const treeseq_properties_t *properties)
+{
+    self->discrete_genome = self->discrete_genome && properties->discrete_genome;
+    self->discrete_time = self->discrete_time && properties->discrete_time;
+    self->min_time = TSK_MIN(self->min_time, properties->min_time);
+    self->max_time = TSK_MAX(self->max_time, properties->max_time);
+}
+
 static int
-tsk_treeseq_init_sites(tsk_treeseq_t *self)
+tsk_treeseq_alloc_sites(tsk_treeseq_t *self)
 {
-    tsk_id_t j, k;
     int ret = 0;
-    tsk_size_t offset = 0;
     const tsk_size_t num_mutations = self->tables->mutations.num_rows;
     const tsk_size_t num_sites = self->tables->sites.num_rows;
-    const tsk_id_t *restrict mutation_site = self->tables->mutations.site;
-    const double *restrict site_position = self->tables->sites.position;
-    bool discrete_sites = true;
-    tsk_mutation_t *mutation;
 
     self->site_mutations_mem
         = tsk_malloc(num_mutations * sizeof(*self->site_mutations_mem));
@@ -149,35 +217,201 @@ tsk_treeseq_init_sites(tsk_treeseq_t *self)
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
+out:
+    return ret;
+}
 
-    for (k = 0; k < (tsk_id_t) num_mutations; k++) {
-        mutation = self->site_mutations_mem + k;
-        ret = tsk_treeseq_get_mutation(self, k, mutation);
-        if (ret != 0) {
-            goto out;
-        }
+static void
+tsk_treeseq_set_inherited_state(const tsk_treeseq_t *self, tsk_mutation_t *mutation)
+{
+    const tsk_id_t site_id = mutation->site;
+    const tsk_id_t parent_id = mutation->parent;
+    const tsk_size_t *restrict sites_ancestral_state_offset
+        = self->tables->sites.ancestral_state_offset;
+    const tsk_size_t *restrict mutations_derived_state_offset
+        = self->tables->mutations.derived_state_offset;
+
+    if (parent_id == TSK_NULL) {
+        /* No parent: inherited state is the site's ancestral state */
+        mutation->inherited_state = self->tables->sites.ancestral_state
+                                    + sites_ancestral_state_offset[site_id];
+        mutation->inherited_state_length = sites_ancestral_state_offset[site_id + 1]
+                                           - sites_ancestral_state_offset[site_id];
+    } else {
+        /* Has parent: inherited state is parent's derived state */
+        mutation->inherited_state = self->tables->mutations.derived_state
+                                    + mutations_derived_state_offset[parent_id];
+        mutation->inherited_state_length = mutations_derived_state_offset[parent_id + 1]
+                                           - mutations_derived_state_offset[parent_id];
     }
+}
+
+/* Fills in the sites with IDs in [start, stop) and their mutations, whose
+ * edges are taken from the mutation_edge array.
+ */
+static int
+tsk_treeseq_init_sites(tsk_treeseq_t *self, const tsk_id_t *mutation_edge,
+    tsk_id_t start, tsk_id_t stop)
+{
+    tsk_id_t j, k, mid, high;
+    int ret = 0;
+    const tsk_id_t num_mutations = (tsk_id_t) self->tables->mutations.num_rows;
+    const tsk_id_t *restrict mutation_site = self->tables->mutations.site;
+    tsk_mutation_t *mutation;
+    tsk_site_t *site;
+
+    /* Mutations are sorted by site, so find the first mutation at start */
     k = 0;
-    for (j = 0; j < (tsk_id_t) num_sites; j++) {
-        discrete_sites = discrete_sites && is_discrete(site_position[j]);
-        self->site_mutations[j] = self->site_mutations_mem + offset;
+    high = num_mutations;
+    while (k < high) {
+        mid = k + (high - k) / 2;
+        if (mutation_site[mid] < start) {
+            k = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    for (j = start; j < stop; j++) {
+        self->site_mutations[j] = self->site_mutations_mem + k;
         self->site_mutations_length[j] = 0;
         /* Go through all mutations for this site */
-        while (k < (tsk_id_t) num_mutations && mutation_site[k] == j) {
+        while (k < num_mutations && mutation_site[k] == j) {
+            mutation = self->site_mutations_mem + k;
+            ret = tsk_mutation_table_get_row(&self->tables->mutations, k, mutation);
+            if (ret != 0) {
+                goto out;
+            }
+            mutation->edge = mutation_edge[k];
+            tsk_treeseq_set_inherited_state(self, mutation);
             self->site_mutations_length[j]++;
-            offset++;
             k++;
         }
-        ret = tsk_treeseq_get_site(self, j, self->tree_sites_mem + j);
+        site = self->tree_sites_mem + j;
+        ret = tsk_site_table_get_row(&self->tables->sites, j, site);
         if (ret != 0) {
             goto out;
         }
+        site->mutations = self->site_mutations[j];
+        site->mutations_length = self->site_mutations_length[j];
     }
-    self->discrete_genome = self->discrete_genome && discrete_sites;
 out:
     return ret;
 }
 
+/* Sets the pointers to the sites on each tree, once the number of sites on
+ * each tree is known and the sites have been filled in. */
+static int
+tsk_treeseq_init_tree_sites(tsk_treeseq_t *self)
+{
+    int ret = 0;
+    tsk_size_t j, offset;
+
+    self->tree_sites = tsk_malloc((self->num_trees + 1) * sizeof(*self->tree_sites));
+    if (self->tree_sites == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    offset = 0;
+    for (j = 0; j < self->num_trees; j++) {
+        self->tree_sites[j] = self->tree_sites_mem + offset;
+        offset += self->tree_sites_length[j];
+    }
+out:
+    return ret;
+}
+
+static int
+tsk_treeseq_init_lazy_state(tsk_treeseq_t *self)
+{
+    int ret = 0;
+
+    self->lazy_sites = tsk_calloc(1, sizeof(*self->lazy_sites));
+    if (self->lazy_sites == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    self->lazy_sites->tree_sequence = self;
+    ret = tsk_mutex_init(&self->lazy_sites->mutex);
+out:
+    return ret;
+}
+
+/* Returns true if the structs are known to be built, without taking the lock.
+ * Without atomic builtins the flag is only read with the lock held. */
+static bool
+tsk_treeseq_lazy_sites_built(tsk_treeseq_lazy_sites_t *self)
+{
+#if defined(__GNUC__)
+    return __atomic_load_n(&self->built, __ATOMIC_ACQUIRE) != 0;
+#else
+    (void) self;
+    return false;
+#endif
+}
+
+static void
+tsk_treeseq_lazy_sites_set_built(tsk_treeseq_lazy_sites_t *self)
+{
+#if defined(__GNUC__)
+    __atomic_store_n(&self->built, 1, __ATOMIC_RELEASE);
+#else
+    self->built = 1;
+#endif
+}
+
+/* Builds the site and mutation structs of a tree sequence initialised with
+ * TSK_TS_INIT_LAZY. Anything allocated is freed on error, so that the build
+ * can be retried. */
+static int
+tsk_treeseq_init_lazy_sites(tsk_treeseq_t *self)
+{
+    int ret = 0;
+
+    ret = tsk_treeseq_alloc_sites(self);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_treeseq_init_sites(
+        self, self->mutation_edge, 0, (tsk_id_t) self->tables->sites.num_rows);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_treeseq_init_tree_sites(self);
+out:
+    if (ret != 0) {
+        tsk_safe_free(self->tree_sites_mem);
+        tsk_safe_free(self->site_mutations_mem);
+        tsk_safe_free(self->site_mutations_length);
+        tsk_safe_free(self->site_mutations);
+        tsk_safe_free(self->tree_sites);
+    }
+    return ret;
+}
+
+/* Makes sure that the site and mutation structs have been built. These are
+ * built on first use by functions that only have a const reference to the
+ * tree sequence, and so may be called concurrently. The lock is only taken
+ * until the structs have been built.
+ */
+static int
+tsk_treeseq_require_sites(const tsk_treeseq_t *self)
+{
+    int ret = 0;
+    tsk_treeseq_lazy_sites_t *lazy = self->lazy_sites;
+
+    if (lazy != NULL && !tsk_treeseq_lazy_sites_built(lazy)) {
+        tsk_mutex_lock(lazy->mutex);
+        if (!lazy->built) {
+            ret = tsk_treeseq_init_lazy_sites(lazy->tree_sequence);
+            if (ret == 0) {
+                tsk_treeseq_lazy_sites_set_built(lazy);
+            }
+        }
+        tsk_mutex_unlock(lazy->mutex);
+    }
+    return ret;
+}
+
 static int
 tsk_treeseq_init_individuals(tsk_treeseq_t *self)
 {
@@ -238,10 +472,14 @@ out:
     return ret;
 }
 
-/* Initialises memory associated with the trees.
+/* Initialises memory associated with the trees, and finds the number of
+ * sites on each tree and the edge above each mutation. The site and mutation
+ * structs are not touched, so that they can be filled in concurrently by
+ * tsk_treeseq_init_sites, or not at all until needed.
  */
 static int
-tsk_treeseq_init_trees(tsk_treeseq_t *self)
+tsk_treeseq_init_trees(
+    tsk_treeseq_t *self, tsk_id_t *mutation_edge, treeseq_properties_t *properties)
 {
     int ret = TSK_ERR_GENERIC;
     tsk_size_t j, k, tree_index;
@@ -254,13 +492,7 @@ tsk_treeseq_init_trees(tsk_treeseq_t *self)
     const tsk_size_t num_nodes = self->tables->nodes.num_rows;
     const double *restrict site_position = self->tables->sites.position;
     const tsk_id_t *restrict mutation_site = self->tables->mutations.site;
-    const tsk_id_t *restrict mutation_parent = self->tables->mutations.parent;
-    const char *restrict sites_ancestral_state = self->tables->sites.ancestral_state;
-    const tsk_size_t *restrict sites_ancestral_state_offset
-        = self->tables->sites.ancestral_state_offset;
-    const char *restrict mutations_derived_state = self->tables->mutations.derived_state;
-    const tsk_size_t *restrict mutations_derived_state_offset
-        = self->tables->mutations.derived_state_offset;
+    const tsk_id_t *restrict mutation_node = self->tables->mutations.node;
     const tsk_id_t *restrict I = self->tables->indexes.edge_insertion_order;
     const tsk_id_t *restrict O = self->tables->indexes.edge_removal_order;
     const double *restrict edge_right = self->tables->edges.right;
@@ -268,22 +500,19 @@ tsk_treeseq_init_trees(tsk_treeseq_t *self)
     const tsk_id_t *restrict edge_child = self->tables->edges.child;
     tsk_size_t num_trees_alloc = self->num_trees + 1;
     bool discrete_breakpoints = true;
+    bool discrete_sites = true;
     tsk_id_t *node_edge_map = tsk_malloc(num_nodes * sizeof(*node_edge_map));
-    tsk_mutation_t *mutation;
-    tsk_id_t parent_id;
 
     self->tree_sites_length
         = tsk_malloc(num_trees_alloc * sizeof(*self->tree_sites_length));
-    self->tree_sites = tsk_malloc(num_trees_alloc * sizeof(*self->tree_sites));
     self->breakpoints = tsk_malloc(num_trees_alloc * sizeof(*self->breakpoints));
-    if (node_edge_map == NULL || self->tree_sites == NULL
-        || self->tree_sites_length == NULL || self->breakpoints == NULL) {
+    if (node_edge_map == NULL || self->tree_sites_length == NULL
+        || self->breakpoints == NULL) {
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
     tsk_memset(
         self->tree_sites_length, 0, self->num_trees * sizeof(*self->tree_sites_length));
-    tsk_memset(self->tree_sites, 0, self->num_trees * sizeof(*self->tree_sites));
     tsk_memset(node_edge_map, TSK_NULL, num_nodes * sizeof(*node_edge_map));
 
     tree_left = 0;
@@ -313,33 +542,12 @@ tsk_treeseq_init_trees(tsk_treeseq_t *self)
         if (k < num_edges) {
             tree_right = TSK_MIN(tree_right, edge_right[O[k]]);
         }
-        self->tree_sites[tree_index] = self->tree_sites_mem + site_id;
         while (site_id < num_sites && site_position[site_id] < tree_right) {
+            discrete_sites = discrete_sites && is_discrete(site_position[site_id]);
             self->tree_sites_length[tree_index]++;
             while (
                 mutation_id < num_mutations && mutation_site[mutation_id] == site_id) {
-                mutation = self->site_mutations_mem + mutation_id;
-                mutation->edge = node_edge_map[mutation->node];
-
-                /* Compute inherited state */
-                if (mutation_parent[mutation_id] == TSK_NULL) {
-                    /* No parent: inherited state is the site's ancestral state */
-                    mutation->inherited_state
-                        = sites_ancestral_state + sites_ancestral_state_offset[site_id];
-                    mutation->inherited_state_length
-                        = sites_ancestral_state_offset[site_id + 1]
-                          - sites_ancestral_state_offset[site_id];
-                } else {
-                    /* Has parent: inherited state is parent's derived state */
-                    parent_id = mutation_parent[mutation_id];
-                    mutation->inherited_state
-                        = mutations_derived_state
-                          + mutations_derived_state_offset[parent_id];
-                    mutation->inherited_state_length
-                        = mutations_derived_state_offset[parent_id + 1]
-                          - mutations_derived_state_offset[parent_id];
-                }
-
+                mutation_edge[mutation_id] = node_edge_map[mutation_node[mutation_id]];
                 mutation_id++;
             }
             site_id++;
@@ -351,7 +559,8 @@ tsk_treeseq_init_trees(tsk_treeseq_t *self)
     tsk_bug_assert(tree_index == self->num_trees);
     self->breakpoints[tree_index] = tree_right;
     discrete_breakpoints = discrete_breakpoints && is_discrete(tree_right);
-    self->discrete_genome = self->discrete_genome && discrete_breakpoints;
+    properties->discrete_genome
+        = properties->discrete_genome && discrete_breakpoints && discrete_sites;
     ret = 0;
 out:
     tsk_safe_free(node_edge_map);
@@ -359,7 +568,7 @@ out:
 }
 
 static void
-tsk_treeseq_init_migrations(tsk_treeseq_t *self)
+tsk_treeseq_init_migrations(tsk_treeseq_t *self, treeseq_properties_t *properties)
 {
     tsk_size_t j;
     tsk_size_t num_migrations = self->tables->migrations.num_rows;
@@ -375,12 +584,12 @@ tsk_treeseq_init_migrations(tsk_treeseq_t *self)
         discrete_times
             = discrete_times && (is_discrete(time[j]) || tsk_is_unknown_time(time[j]));
     }
-    self->discrete_genome = self->discrete_genome && discrete_breakpoints;
-    self->discrete_time = self->discrete_time && discrete_times;
+    properties->discrete_genome = properties->discrete_genome && discrete_breakpoints;
+    properties->discrete_time = properties->discrete_time && discrete_times;
 }
 
 static void
-tsk_treeseq_init_mutations(tsk_treeseq_t *self)
+tsk_treeseq_init_mutations(tsk_treeseq_t *self, treeseq_properties_t *properties)
 {
     tsk_size_t j;
     tsk_size_t num_mutations = self->tables->mutations.num_rows;
@@ -391,18 +600,18 @@ tsk_treeseq_init_mutations(tsk_treeseq_t *self)
         discrete_times
             = discrete_times && (is_discrete(time[j]) || tsk_is_unknown_time(time[j]));
     }
-    self->discrete_time = self->discrete_time && discrete_times;
+    properties->discrete_time = properties->discrete_time && discrete_times;
 
     for (j = 0; j < num_mutations; j++) {
         if (!tsk_is_unknown_time(time[j])) {
-            self->min_time = TSK_MIN(self->min_time, time[j]);
-            self->max_time = TSK_MAX(self->max_time, time[j]);
+            properties->min_time = TSK_MIN(properties->min_time, time[j]);
+            properties->max_time = TSK_MAX(properties->max_time, time[j]);
         }
     }
 }
 
 static int
-tsk_treeseq_init_nodes(tsk_treeseq_t *self)
+tsk_treeseq_init_nodes(tsk_treeseq_t *self, treeseq_properties_t *properties)
 {
     tsk_size_t j, k;
     tsk_size_t num_nodes = self->tables->nodes.num_rows;
@@ -440,26 +649,144 @@ tsk_treeseq_init_nodes(tsk_treeseq_t *self)
         discrete_times
             = discrete_times && (is_discrete(time[j]) || tsk_is_unknown_time(time[j]));
     }
-    self->discrete_time = self->discrete_time && discrete_times;
+    properties->discrete_time = properties->discrete_time && discrete_times;
 
     for (j = 0; j < num_nodes; j++) {
         if (!tsk_is_unknown_time(time[j])) {
-            self->min_time = TSK_MIN(self->min_time, time[j]);
-            self->max_time = TSK_MAX(self->max_time, time[j]);
+            properties->min_time = TSK_MIN(properties->min_time, time[j]);
+            properties->max_time = TSK_MAX(properties->max_time, time[j]);
         }
     }
 out:
     return ret;
 }
 
+static void
+tsk_treeseq_init_time_units(tsk_treeseq_t *self)
+{
+    if (tsk_treeseq_get_time_units_length(self) == strlen(TSK_TIME_UNITS_UNCALIBRATED)
+        && !strncmp(tsk_treeseq_get_time_units(self), TSK_TIME_UNITS_UNCALIBRATED,
+            strlen(TSK_TIME_UNITS_UNCALIBRATED))) {
+        self->time_uncalibrated = true;
+    }
+}
+
+/* The phases of tsk_treeseq_init that depend only on the tables, which are
+ * run concurrently before the sites are filled in. */
+#define TS_INIT_TREES 0
+#define TS_INIT_NODES 1
+#define TS_INIT_INDIVIDUALS 2
+#define TS_INIT_MUTATIONS 3
+#define TS_INIT_MIGRATIONS 4
+#define TS_INIT_NUM_PHASES 5
+
+typedef struct {
+    tsk_treeseq_t *ts;
+    tsk_id_t *mutation_edge;
+    tsk_size_t num_workers;
+    /* Indexed by phase, and then by worker when filling in the sites */
+    int *ret;
+    treeseq_properties_t *properties;
+} treeseq_initialiser_t;
+
+static int
+treeseq_initialiser_run_phase(treeseq_initialiser_t *self, tsk_size_t phase)
+{
+    int ret = 0;
+    tsk_treeseq_t *ts = self->ts;
+    treeseq_properties_t *properties = &self->properties[phase];
+
+    switch (phase) {
+        case TS_INIT_TREES:
+            ret = tsk_treeseq_init_trees(ts, self->mutation_edge, properties);
+            break;
+        case TS_INIT_NODES:
+            ret = tsk_treeseq_init_nodes(ts, properties);
+            break;
+        case TS_INIT_INDIVIDUALS:
+            ret = tsk_treeseq_init_individuals(ts);
+            break;
+        case TS_INIT_MUTATIONS:
+            tsk_treeseq_init_mutations(ts, properties);
+            break;
+        case TS_INIT_MIGRATIONS:
+            tsk_treeseq_init_migrations(ts, properties);
+            break;
+    }
+    return ret;
+}
+
+static void
+treeseq_initialiser_phases_worker(void *arg, tsk_size_t j)
+{
+    treeseq_initialiser_t *self = (treeseq_initialiser_t *) arg;
+    tsk_size_t phase;
+
+    for (phase = j; phase < TS_INIT_NUM_PHASES; phase += self->num_workers) {
+        self->ret[phase] = treeseq_initialiser_run_phase(self, phase);
+    }
+}
+
+static void
+treeseq_initialiser_sites_worker(void *arg, tsk_size_t j)
+{
+    treeseq_initialiser_t *self = (treeseq_initialiser_t *) arg;
+    const tsk_size_t num_sites = self->ts->tables->sites.num_rows;
+    const tsk_id_t start = (tsk_id_t) (num_sites * j / self->num_workers);
+    const tsk_id_t stop = (tsk_id_t) (num_sites * (j + 1) / self->num_workers);
+
+    self->ret[j] = tsk_treeseq_init_sites(self->ts, self->mutation_edge, start, stop);
+}
+
+/* Runs the worker function on the specified number of workers, returning the
+ * first error in the order of the results and merging the properties found.
+ */
+static int
+treeseq_initialiser_run(treeseq_initialiser_t *self, tsk_size_t num_workers,
+    tsk_size_t num_results, void (*worker)(void *, tsk_size_t))
+{
+    int ret = 0;
+    tsk_size_t j;
+
+    for (j = 0; j < num_results; j++) {
+        self->ret[j] = 0;
+        treeseq_properties_init(&self->properties[j]);
+    }
+    self->num_workers = num_workers;
+    ret = tsk_thread_run_parallel(num_workers, worker, self);
+    if (ret != 0) {
+        goto out;
+    }
+    for (j = 0; j < num_results; j++) {
+        if (self->ret[j] != 0) {
+            ret = self->ret[j];
+            goto out;
+        }
+        tsk_treeseq_merge_properties(self->ts, &self->properties[j]);
+    }
+out:
+    return ret;
+}
+
 int TSK_WARN_UNUSED
 tsk_treeseq_init(
     tsk_treeseq_t *self, tsk_table_collection_t *tables, tsk_flags_t options)
+{
+    return tsk_treeseq_init_parallel(self, tables, options, 1);
+}
+
+int TSK_WARN_UNUSED
+tsk_treeseq_init_parallel(tsk_treeseq_t *self, tsk_table_collection_t *tables,
+    tsk_flags_t options, tsk_size_t num_threads)
 {
     int ret = 0;
     tsk_id_t num_trees;
+    tsk_size_t num_workers, num_sites;
+    treeseq_initialiser_t initialiser;
 
     tsk_memset(self, 0, sizeof(*self));
+    tsk_memset(&initialiser, 0, sizeof(initialiser));
+    num_threads = TSK_MAX(1, num_threads);
     if (options & TSK_TAKE_OWNERSHIP) {
         self->tables = tables;
         if (tables->edges.options & TSK_TABLE_NO_METADATA) {
@@ -482,7 +809,7 @@ tsk_treeseq_init(
         }
     }
     if (options & TSK_TS_INIT_BUILD_INDEXES) {
-        ret = tsk_table_collection_build_index(self->tables, 0);
+        ret = tsk_table_collection_build_index_parallel(self->tables, 0, num_threads);
         if (ret != 0) {
             goto out;
         }
@@ -492,7 +819,8 @@ tsk_treeseq_init(
         /* As tsk_table_collection_compute_mutation_parents performs an
            integrity check, and we don't wish to do that twice we perform
            our own check here */
-        num_trees = tsk_table_collection_check_integrity(self->tables, TSK_CHECK_TREES);
+        num_trees = tsk_table_collection_check_integrity_parallel(
+            self->tables, TSK_CHECK_TREES, num_threads);
         if (num_trees < 0) {
             ret = (int) num_trees;
             goto out;
@@ -504,8 +832,8 @@ tsk_treeseq_init(
             goto out;
         }
     } else {
-        num_trees = tsk_table_collection_check_integrity(
-            self->tables, TSK_CHECK_TREES | TSK_CHECK_MUTATION_PARENTS);
+        num_trees = tsk_table_collection_check_integrity_parallel(self->tables,
+            TSK_CHECK_TREES | TSK_CHECK_MUTATION_PARENTS, num_threads);
         if (num_trees < 0) {
             ret = (int) num_trees;
             goto out;
@@ -516,30 +844,281 @@ tsk_treeseq_init(
     self->discrete_time = true;
     self->min_time = INFINITY;
     self->max_time = -INFINITY;
-    ret = tsk_treeseq_init_nodes(self);
-    if (ret != 0) {
-        goto out;
+    if (!(options & TSK_TS_INIT_LAZY)) {
+        ret = tsk_treeseq_alloc_sites(self);
+        if (ret != 0) {
+            goto out;
+        }
     }
-    ret = tsk_treeseq_init_sites(self);
-    if (ret != 0) {
+
+    num_sites = self->tables->sites.num_rows;
+    initialiser.ts = self;
+    initialiser.mutation_edge = tsk_malloc(TSK_MAX(1, self->tables->mutations.num_rows)
+                                           * sizeof(*initialiser.mutation_edge));
+    initialiser.ret
+        = tsk_malloc(TSK_MAX(num_threads, TS_INIT_NUM_PHASES) * sizeof(int));
+    initialiser.properties = tsk_malloc(TSK_MAX(num_threads, TS_INIT_NUM_PHASES)
+                                        * sizeof(*initialiser.properties));
+    if (initialiser.mutation_edge == NULL || initialiser.ret == NULL
+        || initialiser.properties == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
-    ret = tsk_treeseq_init_individuals(self);
+    /* The sites are filled in once the edge above each mutation is known */
+    num_workers = TSK_MIN(num_threads, TS_INIT_NUM_PHASES);
+    ret = treeseq_initialiser_run(&initialiser, num_workers, TS_INIT_NUM_PHASES,
+        treeseq_initialiser_phases_worker);
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_treeseq_init_trees(self);
-    if (ret != 0) {
+    if (options & TSK_TS_INIT_LAZY) {
+        /* Keep the mutation edges to build the site and mutation structs with
+         * on first use */
+        ret = tsk_treeseq_init_lazy_state(self);
+        if (ret != 0) {
+            goto out;
+        }
+        self->mutation_edge = initialiser.mutation_edge;
+        initialiser.mutation_edge = NULL;
+    } else {
+        num_workers = TSK_MAX(1, TSK_MIN(num_threads, num_sites));
+        ret = treeseq_initialiser_run(
+            &initialiser, num_workers, num_workers, treeseq_initialiser_sites_worker);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_treeseq_init_tree_sites(self);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    tsk_treeseq_init_time_units(self);
+out:
+    tsk_safe_free(initialiser.mutation_edge);
+    tsk_safe_free(initialiser.ret);
+    tsk_safe_free(initialiser.properties);
+    return ret;
+}
+
+/* The indexes stored alongside the tables by tsk_treeseq_dump with the
+ * TSK_DUMP_TREESEQ_INDEXES option, in the order of ts_index_arrays. */
+#define TS_INDEX_BREAKPOINTS 0
+#define TS_INDEX_TREE_SITES_LENGTH 1
+#define TS_INDEX_MUTATION_EDGE 2
+#define TS_INDEX_SAMPLES 3
+#define TS_INDEX_SAMPLE_INDEX_MAP 4
+#define TS_INDEX_INDIVIDUAL_NODES 5
+#define TS_INDEX_INDIVIDUAL_NODES_LENGTH 6
+#define TS_INDEX_TIME_RANGE 7
+#define TS_INDEX_DISCRETE 8
+#define TS_NUM_INDEXES 9
+
+static const tsk_derived_array_t ts_index_arrays[TS_NUM_INDEXES] = {
+    { "breakpoints", NULL, 0, KAS_FLOAT64 },
+    { "tree_sites_length", NULL, 0, TSK_SIZE_STORAGE_TYPE },
+    { "mutation_edge", NULL, 0, TSK_ID_STORAGE_TYPE },
+    { "samples", NULL, 0, TSK_ID_STORAGE_TYPE },
+    { "sample_index_map", NULL, 0, TSK_ID_STORAGE_TYPE },
+    { "individual_nodes", NULL, 0, TSK_ID_STORAGE_TYPE },
+    { "individual_nodes_length", NULL, 0, TSK_SIZE_STORAGE_TYPE },
+    { "time_range", NULL, 0, KAS_FLOAT64 },
+    { "discrete", NULL, 0, KAS_INT8 },
+};
+
+/* Initialise the tree sequence from the stored indexes, which have been
+ * written along with the tables and so are assumed to be correct. Only the
+ * pointers into the tables are computed. Adopted arrays are set to NULL in
+ * the list. */
+static int
+tsk_treeseq_init_from_indexes(tsk_treeseq_t *self, tsk_table_collection_t *tables,
+    tsk_derived_array_t *arrays, tsk_flags_t options)
+{
+    int ret = 0;
+    tsk_size_t j, offset;
+    tsk_size_t num_site_refs = 0;
+    tsk_size_t num_node_refs = 0;
+    const tsk_size_t num_nodes = tables->nodes.num_rows;
+    const tsk_size_t num_sites = tables->sites.num_rows;
+    const tsk_size_t num_mutations = tables->mutations.num_rows;
+    const tsk_size_t num_inds = tables->individuals.num_rows;
+    const tsk_size_t *tree_sites_length = arrays[TS_INDEX_TREE_SITES_LENGTH].array;
+    const tsk_size_t *individual_nodes_length
+        = arrays[TS_INDEX_INDIVIDUAL_NODES_LENGTH].array;
+    const tsk_id_t *mutation_edge = arrays[TS_INDEX_MUTATION_EDGE].array;
+    const double *breakpoints = arrays[TS_INDEX_BREAKPOINTS].array;
+    const double *time_range = arrays[TS_INDEX_TIME_RANGE].array;
+    const int8_t *discrete = arrays[TS_INDEX_DISCRETE].array;
+    const tsk_size_t num_breakpoints = arrays[TS_INDEX_BREAKPOINTS].length;
+
+    tsk_memset(self, 0, sizeof(*self));
+    self->tables = tables;
+    if (tables->edges.options & TSK_TABLE_NO_METADATA) {
+        ret = tsk_trace_error(TSK_ERR_CANT_TAKE_OWNERSHIP_NO_EDGE_METADATA);
+        goto out;
+    }
+    if (num_breakpoints < 2
+        || arrays[TS_INDEX_TREE_SITES_LENGTH].length != num_breakpoints - 1
+        || arrays[TS_INDEX_MUTATION_EDGE].length != num_mutations
+        || arrays[TS_INDEX_SAMPLES].length > num_nodes
+        || arrays[TS_INDEX_SAMPLE_INDEX_MAP].length != num_nodes
+        || arrays[TS_INDEX_INDIVIDUAL_NODES_LENGTH].length != num_inds
+        || arrays[TS_INDEX_TIME_RANGE].length != 2
+        || arrays[TS_INDEX_DISCRETE].length != 2 || breakpoints[0] != 0
+        || breakpoints[num_breakpoints - 1] != tables->sequence_length) {
+        ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+        goto out;
+    }
+    for (j = 0; j < num_breakpoints - 1; j++) {
+        num_site_refs += tree_sites_length[j];
+    }
+    for (j = 0; j < num_inds; j++) {
+        num_node_refs += individual_nodes_length[j];
+    }
+    if (num_site_refs != num_sites
+        || num_node_refs != arrays[TS_INDEX_INDIVIDUAL_NODES].length) {
+        ret = tsk_trace_error(TSK_ERR_FILE_FORMAT);
+        goto out;
+    }
+
+    self->mapped_indexes = tables->mapped_store != NULL;
+    self->num_trees = num_breakpoints - 1;
+    self->breakpoints = arrays[TS_INDEX_BREAKPOINTS].array;
+    self->tree_sites_length = arrays[TS_INDEX_TREE_SITES_LENGTH].array;
+    self->num_samples = arrays[TS_INDEX_SAMPLES].length;
+    self->samples = arrays[TS_INDEX_SAMPLES].array;
+    self->sample_index_map = arrays[TS_INDEX_SAMPLE_INDEX_MAP].array;
+    self->individual_nodes_mem = arrays[TS_INDEX_INDIVIDUAL_NODES].array;
+    self->individual_nodes_length = arrays[TS_INDEX_INDIVIDUAL_NODES_LENGTH].array;
+    arrays[TS_INDEX_BREAKPOINTS].array = NULL;
+    arrays[TS_INDEX_TREE_SITES_LENGTH].array = NULL;
+    arrays[TS_INDEX_SAMPLES].array = NULL;
+    arrays[TS_INDEX_SAMPLE_INDEX_MAP].array = NULL;
+    arrays[TS_INDEX_INDIVIDUAL_NODES].array = NULL;
+    arrays[TS_INDEX_INDIVIDUAL_NODES_LENGTH].array = NULL;
+    self->min_time = time_range[0];
+    self->max_time = time_range[1];
+    self->discrete_genome = discrete[0];
+    self->discrete_time = discrete[1];
+
+    if (options & TSK_TS_INIT_LAZY) {
+        self->mutation_edge = arrays[TS_INDEX_MUTATION_EDGE].array;
+        arrays[TS_INDEX_MUTATION_EDGE].array = NULL;
+        ret = tsk_treeseq_init_lazy_state(self);
+        if (ret != 0) {
+            goto out;
+        }
+    } else {
+        ret = tsk_treeseq_alloc_sites(self);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_treeseq_init_sites(self, mutation_edge, 0, (tsk_id_t) num_sites);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_treeseq_init_tree_sites(self);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    self->individual_nodes
+        = tsk_malloc(TSK_MAX(1, num_inds) * sizeof(*self->individual_nodes));
+    if (self->individual_nodes == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
-    tsk_treeseq_init_migrations(self);
-    tsk_treeseq_init_mutations(self);
+    offset = 0;
+    for (j = 0; j < num_inds; j++) {
+        self->individual_nodes[j] = self->individual_nodes_mem + offset;
+        offset += self->individual_nodes_length[j];
+    }
+    tsk_treeseq_init_time_units(self);
+out:
+    return ret;
+}
 
-    if (tsk_treeseq_get_time_units_length(self) == strlen(TSK_TIME_UNITS_UNCALIBRATED)
-        && !strncmp(tsk_treeseq_get_time_units(self), TSK_TIME_UNITS_UNCALIBRATED,
-            strlen(TSK_TIME_UNITS_UNCALIBRATED))) {
-        self->time_uncalibrated = true;
+/* Initialise the tree sequence from tables loaded from a file, adopting the
+ * stored indexes if they were all found. Takes ownership of the tables and
+ * the arrays, regardless of error conditions. The load options are mapped
+ * to the corresponding init options. */
+static int
+tsk_treeseq_init_loaded(tsk_treeseq_t *self, tsk_table_collection_t *tables,
+    tsk_derived_array_t *arrays, tsk_flags_t load_options)
+{
+    int ret = 0;
+    tsk_size_t j;
+    bool found = true;
+    const bool mapped = tables->mapped_store != NULL;
+    tsk_flags_t options = TSK_TAKE_OWNERSHIP;
+
+    if (load_options & TSK_LOAD_LAZY) {
+        options |= TSK_TS_INIT_LAZY;
+    }
+    for (j = 0; j < TS_NUM_INDEXES; j++) {
+        found = found && arrays[j].array != NULL;
+    }
+    if (found) {
+        ret = tsk_treeseq_init_from_indexes(self, tables, arrays, options);
+    } else {
+        ret = tsk_treeseq_init(self, tables, options);
+    }
+    for (j = 0; j < TS_NUM_INDEXES; j++) {
+        if (!mapped) {
+            tsk_safe_free(arrays[j].array);
+        }
+        arrays[j].array = NULL;
+    }
+    return ret;
+}
+
+/* Set up the list of indexes to store for this tree sequence. The
+ * mutation edges are gathered into a new array, which must be freed by the
+ * caller. */
+static int
+tsk_treeseq_get_indexes(const tsk_treeseq_t *self, tsk_derived_array_t *arrays,
+    tsk_id_t **mutation_edge, double *time_range, int8_t *discrete)
+{
+    int ret = 0;
+    tsk_size_t j;
+    const tsk_size_t num_mutations = self->tables->mutations.num_rows;
+    const tsk_size_t num_inds = self->tables->individuals.num_rows;
+
+    *mutation_edge = tsk_malloc(TSK_MAX(1, num_mutations) * sizeof(**mutation_edge));
+    if (*mutation_edge == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
     }
+    for (j = 0; j < num_mutations; j++) {
+        (*mutation_edge)[j] = self->mutation_edge != NULL
+                                  ? self->mutation_edge[j]
+                                  : self->site_mutations_mem[j].edge;
+    }
+    time_range[0] = self->min_time;
+    time_range[1] = self->max_time;
+    discrete[0] = (int8_t) self->discrete_genome;
+    discrete[1] = (int8_t) self->discrete_time;
+
+    tsk_memcpy(arrays, ts_index_arrays, sizeof(ts_index_arrays));
+    arrays[TS_INDEX_BREAKPOINTS].array = self->breakpoints;
+    arrays[TS_INDEX_BREAKPOINTS].length = self->num_trees + 1;
+    arrays[TS_INDEX_TREE_SITES_LENGTH].array = self->tree_sites_length;
+    arrays[TS_INDEX_TREE_SITES_LENGTH].length = self->num_trees;
+    arrays[TS_INDEX_MUTATION_EDGE].array = *mutation_edge;
+    arrays[TS_INDEX_MUTATION_EDGE].length = num_mutations;
+    arrays[TS_INDEX_SAMPLES].array = self->samples;
+    arrays[TS_INDEX_SAMPLES].length = self->num_samples;
+    arrays[TS_INDEX_SAMPLE_INDEX_MAP].array = self->sample_index_map;
+    arrays[TS_INDEX_SAMPLE_INDEX_MAP].length = self->tables->nodes.num_rows;
+    arrays[TS_INDEX_INDIVIDUAL_NODES].array = self->individual_nodes_mem;
+    arrays[TS_INDEX_INDIVIDUAL_NODES_LENGTH].array = self->individual_nodes_length;
+    arrays[TS_INDEX_INDIVIDUAL_NODES_LENGTH].length = num_inds;
+    for (j = 0; j < num_inds; j++) {
+        arrays[TS_INDEX_INDIVIDUAL_NODES].length += self->individual_nodes_length[j];
+    }
+    arrays[TS_INDEX_TIME_RANGE].array = time_range;
+    arrays[TS_INDEX_TIME_RANGE].length = 2;
+    arrays[TS_INDEX_DISCRETE].array = discrete;
+    arrays[TS_INDEX_DISCRETE].length = 2;
 out:
     return ret;
 }
@@ -555,25 +1134,38 @@ int TSK_WARN_UNUSED
 tsk_treeseq_load(tsk_treeseq_t *self, const char *filename, tsk_flags_t options)
 {
     int ret = 0;
+    tsk_size_t j;
+    tsk_derived_array_t arrays[TS_NUM_INDEXES];
     tsk_table_collection_t *tables = malloc(sizeof(*tables));
 
     /* Need to make sure that we're zero'd out in case of error */
     tsk_memset(self, 0, sizeof(*self));
+    tsk_memcpy(arrays, ts_index_arrays, sizeof(arrays));
 
     if (tables == NULL) {
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
 
-    ret = tsk_table_collection_load(tables, filename, options);
+    if (options & TSK_LOAD_TREESEQ_INDEXES) {
+        ret = tsk_table_collection_load_derived(
+            tables, filename, arrays, TS_NUM_INDEXES, options);
+    } else {
+        ret = tsk_table_collection_load(tables, filename, options);
+    }
     if (ret != 0) {
+        for (j = 0; j < TS_NUM_INDEXES; j++) {
+            if (tables->mapped_store == NULL) {
+                tsk_safe_free(arrays[j].array);
+            }
+        }
         tsk_table_collection_free(tables);
         tsk_safe_free(tables);
         goto out;
     }
-    /* TSK_TAKE_OWNERSHIP takes immediate ownership of the tables, regardless
-     * of error conditions. */
-    ret = tsk_treeseq_init(self, tables, TSK_TAKE_OWNERSHIP);
+    /* Ownership of the tables is taken immediately, regardless of error
+     * conditions. */
+    ret = tsk_treeseq_init_loaded(self, tables, arrays, options);
     if (ret != 0) {
         goto out;
     }
@@ -585,25 +1177,38 @@ int TSK_WARN_UNUSED
 tsk_treeseq_loadf(tsk_treeseq_t *self, FILE *file, tsk_flags_t options)
 {
     int ret = 0;
+    tsk_size_t j;
+    tsk_derived_array_t arrays[TS_NUM_INDEXES];
     tsk_table_collection_t *tables = malloc(sizeof(*tables));
 
     /* Need to make sure that we're zero'd out in case of error */
     tsk_memset(self, 0, sizeof(*self));
+    tsk_memcpy(arrays, ts_index_arrays, sizeof(arrays));
 
     if (tables == NULL) {
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
 
-    ret = tsk_table_collection_loadf(tables, file, options);
+    if (options & TSK_LOAD_TREESEQ_INDEXES) {
+        ret = tsk_table_collection_loadf_derived(
+            tables, file, arrays, TS_NUM_INDEXES, options);
+    } else {
+        ret = tsk_table_collection_loadf(tables, file, options);
+    }
     if (ret != 0) {
+        for (j = 0; j < TS_NUM_INDEXES; j++) {
+            if (tables->mapped_store == NULL) {
+                tsk_safe_free(arrays[j].array);
+            }
+        }
         tsk_table_collection_free(tables);
         tsk_safe_free(tables);
         goto out;
     }
-    /* TSK_TAKE_OWNERSHIP takes immediate ownership of the tables, regardless
-     * of error conditions. */
-    ret = tsk_treeseq_init(self, tables, TSK_TAKE_OWNERSHIP);
+    /* Ownership of the tables is taken immediately, regardless of error
+     * conditions. */
+    ret = tsk_treeseq_init_loaded(self, tables, arrays, options);
     if (ret != 0) {
         goto out;
     }
@@ -611,16 +1216,122 @@ out:
     return ret;
 }
 
+static void
+tsk_treeseq_loader_run(void *arg)
+{
+    tsk_treeseq_loader_t *self = (tsk_treeseq_loader_t *) arg;
+
+    self->ret = tsk_treeseq_load(self->tree_sequence, self->filename, self->options);
+    if (self->callback != NULL) {
+        self->callback(self->tree_sequence, self->ret, self->callback_arg);
+    }
+}
+
+int TSK_WARN_UNUSED
+tsk_treeseq_loader_init(tsk_treeseq_loader_t *self, tsk_treeseq_t *tree_sequence,
+    const char *filename, void (*callback)(tsk_treeseq_t *, int, void *),
+    void *callback_arg, tsk_flags_t options)
+{
+    int ret = 0;
+    size_t filename_length = strlen(filename);
+
+    tsk_memset(self, 0, sizeof(*self));
+    /* Make sure the tree sequence can be freed in case of error */
+    tsk_memset(tree_sequence, 0, sizeof(*tree_sequence));
+    self->tree_sequence = tree_sequence;
+    self->callback = callback;
+    self->callback_arg = callback_arg;
+    self->options = options;
+    self->filename = tsk_malloc(filename_length + 1);
+    if (self->filename == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    tsk_memcpy(self->filename, filename, filename_length + 1);
+    ret = tsk_thread_start(&self->thread, tsk_treeseq_loader_run, self);
+out:
+    if (ret != 0) {
+        /* The load did not start, so report the error when waiting */
+        self->ret = ret;
+    }
+    return ret;
+}
+
+bool
+tsk_treeseq_loader_poll(tsk_treeseq_loader_t *self)
+{
+    return self->thread == NULL || tsk_thread_done(self->thread);
+}
+
+int TSK_WARN_UNUSED
+tsk_treeseq_loader_wait(tsk_treeseq_loader_t *self)
+{
+    if (self->thread != NULL) {
+        tsk_thread_join(self->thread);
+        self->thread = NULL;
+    }
+    return self->ret;
+}
+
+int
+tsk_treeseq_loader_free(tsk_treeseq_loader_t *self)
+{
+    if (self->thread != NULL) {
+        tsk_thread_join(self->thread);
+        self->thread = NULL;
+    }
+    tsk_safe_free(self->filename);
+    return 0;
+}
+
 int TSK_WARN_UNUSED
 tsk_treeseq_dump(const tsk_treeseq_t *self, const char *filename, tsk_flags_t options)
 {
-    return tsk_table_collection_dump(self->tables, filename, options);
+    int ret = 0;
+    tsk_derived_array_t arrays[TS_NUM_INDEXES];
+    tsk_id_t *mutation_edge = NULL;
+    double time_range[2];
+    int8_t discrete[2];
+
+    if (options & TSK_DUMP_TREESEQ_INDEXES) {
+        ret = tsk_treeseq_get_indexes(
+            self, arrays, &mutation_edge, time_range, discrete);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_table_collection_dump_derived(
+            self->tables, filename, arrays, TS_NUM_INDEXES, options);
+    } else {
+        ret = tsk_table_collection_dump(self->tables, filename, options);
+    }
+out:
+    tsk_safe_free(mutation_edge);
+    return ret;
 }
 
 int TSK_WARN_UNUSED
 tsk_treeseq_dumpf(const tsk_treeseq_t *self, FILE *file, tsk_flags_t options)
 {
-    return tsk_table_collection_dumpf(self->tables, file, options);
+    int ret = 0;
+    tsk_derived_array_t arrays[TS_NUM_INDEXES];
+    tsk_id_t *mutation_edge = NULL;
+    double time_range[2];
+    int8_t discrete[2];
+
+    if (options & TSK_DUMP_TREESEQ_INDEXES) {
+        ret = tsk_treeseq_get_indexes(
+            self, arrays, &mutation_edge, time_range, discrete);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_table_collection_dumpf_derived(
+            self->tables, file, arrays, TS_NUM_INDEXES, options);
+    } else {
+        ret = tsk_table_collection_dumpf(self->tables, file, options);
+    }
+out:
+    tsk_safe_free(mutation_edge);
+    return ret;
 }
 
 /* Simple attribute getters */
@@ -1684,6 +2395,10 @@ tsk_treeseq_site_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
+    ret = tsk_treeseq_require_sites(self);
+    if (ret != 0) {
+        goto out;
+    }
     tsk_memset(parent, 0xff, num_nodes * sizeof(*parent));
 
     if (options & TSK_STAT_POLARISED) {
@@ -2679,6 +3394,10 @@ tsk_treeseq_two_site_count_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
+    ret = tsk_treeseq_require_sites(self);
+    if (ret != 0) {
+        goto out;
+    }
     get_site_row_col_indices(
         n_rows, row_sites, n_cols, col_sites, sites, &n_sites, row_idx, col_idx);
     // depends on n_sites
@@ -3574,6 +4293,10 @@ tsk_treeseq_site_allele_frequency_spectrum(const tsk_treeseq_t *self,
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
+    ret = tsk_treeseq_require_sites(self);
+    if (ret != 0) {
+        goto out;
+    }
     tsk_memset(parent, 0xff, num_nodes * sizeof(*parent));
 
     for (j = 0; j < num_sample_sets; j++) {
@@ -5339,10 +6062,16 @@ tsk_treeseq_get_mutation(
     if (ret != 0) {
         goto out;
     }
-    mutation->edge = self->site_mutations_mem[index].edge;
-    mutation->inherited_state = self->site_mutations_mem[index].inherited_state;
-    mutation->inherited_state_length
-        = self->site_mutations_mem[index].inherited_state_length;
+    if (self->mutation_edge != NULL) {
+        /* The mutation structs may not have been built */
+        mutation->edge = self->mutation_edge[index];
+        tsk_treeseq_set_inherited_state(self, mutation);
+    } else {
+        mutation->edge = self->site_mutations_mem[index].edge;
+        mutation->inherited_state = self->site_mutations_mem[index].inherited_state;
+        mutation->inherited_state_length
+            = self->site_mutations_mem[index].inherited_state_length;
+    }
 out:
     return ret;
 }
@@ -5356,6 +6085,10 @@ tsk_treeseq_get_site(const tsk_treeseq_t *self, tsk_id_t index, tsk_site_t *site
     if (ret != 0) {
         goto out;
     }
+    ret = tsk_treeseq_require_sites(self);
+    if (ret != 0) {
+        goto out;
+    }
     site->mutations = self->site_mutations[index];
     site->mutations_length = self->site_mutations_length[index];
 out:
@@ -5539,6 +6272,134 @@ out:
     return ret;
 }
 
+static int
+cmp_edge_rank(const void *a, const void *b)
+{
+    const tsk_id_t *ia = (const tsk_id_t *) a;
+    const tsk_id_t *ib = (const tsk_id_t *) b;
+    return (*ia > *ib) - (*ia < *ib);
+}
+
+int TSK_WARN_UNUSED
+tsk_treeseq_build_checkpoints(tsk_treeseq_t *self, tsk_size_t interval,
+    tsk_size_t max_memory, tsk_flags_t TSK_UNUSED(options))
+{
+    int ret = 0;
+    tsk_tree_checkpoints_t *checkpoints = &self->checkpoints;
+    const tsk_id_t *restrict insertion_order
+        = self->tables->indexes.edge_insertion_order;
+    const tsk_size_t num_edges = self->tables->edges.num_rows;
+    const tsk_size_t num_trees = self->num_trees;
+    tsk_size_t *tree_size = tsk_malloc(num_trees * sizeof(*tree_size));
+    tsk_id_t *rank = tsk_malloc(num_edges * sizeof(*rank));
+    tsk_id_t *alive = tsk_malloc(num_edges * sizeof(*alive));
+    tsk_id_t *alive_position = tsk_malloc(num_edges * sizeof(*alive_position));
+    tsk_size_t j, num_alive, num_checkpoints, memory, offset;
+    tsk_id_t k, r, last;
+    tsk_id_t *edges;
+    tsk_tree_position_t tree_pos;
+
+    tsk_treeseq_free_checkpoints(self);
+    tsk_tree_position_init(&tree_pos, self, 0);
+    if (interval == 0) {
+        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+        goto out;
+    }
+    if (tree_size == NULL || rank == NULL || alive == NULL || alive_position == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+
+    /* Find the number of edges in each tree, and so the interval */
+    num_alive = 0;
+    while (tsk_tree_position_next(&tree_pos)) {
+        num_alive -= (tsk_size_t) (tree_pos.out.stop - tree_pos.out.start);
+        num_alive += (tsk_size_t) (tree_pos.in.stop - tree_pos.in.start);
+        tree_size[tree_pos.index] = num_alive;
+    }
+    while (true) {
+        num_checkpoints = (num_trees + interval - 1) / interval;
+        memory = (num_checkpoints + 1) * sizeof(*checkpoints->edges_offset)
+                 + num_checkpoints
+                       * (sizeof(*checkpoints->insertion_index)
+                           + sizeof(*checkpoints->removal_index));
+        offset = 0;
+        for (j = 0; j < num_checkpoints; j++) {
+            offset += tree_size[j * interval];
+        }
+        memory += offset * sizeof(*checkpoints->edges);
+        if (max_memory == 0 || memory <= max_memory) {
+            break;
+        }
+        if (interval >= num_trees) {
+            ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+            goto out;
+        }
+        interval *= 2;
+    }
+
+    checkpoints->edges_offset
+        = tsk_malloc((num_checkpoints + 1) * sizeof(*checkpoints->edges_offset));
+    checkpoints->edges = tsk_malloc(TSK_MAX(1, offset) * sizeof(*checkpoints->edges));
+    checkpoints->insertion_index
+        = tsk_malloc(num_checkpoints * sizeof(*checkpoints->insertion_index));
+    checkpoints->removal_index
+        = tsk_malloc(num_checkpoints * sizeof(*checkpoints->removal_index));
+    if (checkpoints->edges_offset == NULL || checkpoints->edges == NULL
+        || checkpoints->insertion_index == NULL || checkpoints->removal_index == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+
+    /* Sweep along the trees, keeping the set of edges in the current tree
+     * as their ranks in the insertion order. */
+    for (k = 0; k < (tsk_id_t) num_edges; k++) {
+        rank[insertion_order[k]] = k;
+    }
+    tsk_tree_position_init(&tree_pos, self, 0);
+    num_alive = 0;
+    checkpoints->edges_offset[0] = 0;
+    while (tsk_tree_position_next(&tree_pos)) {
+        for (k = tree_pos.out.start; k != tree_pos.out.stop; k++) {
+            r = rank[tree_pos.out.order[k]];
+            last = alive[num_alive - 1];
+            alive[alive_position[r]] = last;
+            alive_position[last] = alive_position[r];
+            num_alive--;
+        }
+        for (k = tree_pos.in.start; k != tree_pos.in.stop; k++) {
+            alive[num_alive] = k;
+            alive_position[k] = (tsk_id_t) num_alive;
+            num_alive++;
+        }
+        if (tree_pos.index % (tsk_id_t) interval == 0) {
+            j = (tsk_size_t) tree_pos.index / interval;
+            offset = checkpoints->edges_offset[j];
+            edges = checkpoints->edges + offset;
+            tsk_memcpy(edges, alive, num_alive * sizeof(*edges));
+            qsort(edges, num_alive, sizeof(*edges), cmp_edge_rank);
+            for (k = 0; k < (tsk_id_t) num_alive; k++) {
+                edges[k] = insertion_order[edges[k]];
+            }
+            checkpoints->edges_offset[j + 1] = offset + num_alive;
+            checkpoints->insertion_index[j] = tree_pos.in.stop;
+            checkpoints->removal_index[j] = tree_pos.out.stop;
+        }
+    }
+    checkpoints->interval = interval;
+    checkpoints->num_checkpoints = num_checkpoints;
+out:
+    if (ret != 0) {
+        tsk_treeseq_free_checkpoints(self);
+    }
+    tsk_tree_position_free(&tree_pos);
+    tsk_safe_free(tree_size);
+    tsk_safe_free(rank);
+    tsk_safe_free(alive);
+    tsk_safe_free(alive_position);
+    return ret;
+}
+
 /* ======================================================== *
  * tree_position
  * ======================================================== */
@@ -5832,16 +6693,26 @@ tsk_tree_position_seek_backward(tsk_tree_position_t *self, tsk_id_t index)
  * Tree
  * ======================================================== */
 
+/* Return the parent of the specified node, reading the interleaved links
+ * if they are used, as the parent array may then be out of date.
+ * NOTE: no bounds checking is done here.
+ */
+static inline tsk_id_t
+tsk_tree_get_parent_unsafe(const tsk_tree_t *self, tsk_id_t u)
+{
+    return self->links != NULL ? self->links[u].parent : self->parent[u];
+}
+
 /* Return the root for the specified node.
  * NOTE: no bounds checking is done here.
  */
 static tsk_id_t
 tsk_tree_get_node_root(const tsk_tree_t *self, tsk_id_t u)
 {
-    const tsk_id_t *restrict parent = self->parent;
+    tsk_id_t v;
 
-    while (parent[u] != TSK_NULL) {
-        u = parent[u];
+    while ((v = tsk_tree_get_parent_unsafe(self, u)) != TSK_NULL) {
+        u = v;
     }
     return u;
 }
@@ -5899,6 +6770,18 @@ tsk_tree_init(tsk_tree_t *self, const tsk_treeseq_t *tree_sequence, tsk_flags_t
             goto out;
         }
     }
+    if (self->options & TSK_INTERLEAVED_LINKS) {
+        /* Sample lists are maintained by walking the link arrays */
+        if (self->options & TSK_SAMPLE_LISTS) {
+            ret = tsk_trace_error(TSK_ERR_UNSUPPORTED_OPERATION);
+            goto out;
+        }
+        self->links = tsk_malloc(N * sizeof(*self->links));
+        if (self->links == NULL) {
+            ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+            goto out;
+        }
+    }
 
     ret = tsk_tree_position_init(&self->tree_pos, tree_sequence, 0);
     if (ret != 0) {
@@ -5952,6 +6835,7 @@ tsk_tree_free(tsk_tree_t *self)
     tsk_safe_free(self->next_sample);
     tsk_safe_free(self->num_children);
     tsk_safe_free(self->edge);
+    tsk_safe_free(self->links);
     tsk_tree_position_free(&self->tree_pos);
     return 0;
 }
@@ -5968,6 +6852,47 @@ tsk_tree_has_sample_counts(const tsk_tree_t *self)
     return !(self->options & TSK_NO_SAMPLE_COUNTS);
 }
 
+static void
+tsk_tree_copy_links_to_arrays(const tsk_tree_t *self, tsk_tree_t *dest)
+{
+    const tsk_tree_links_t *restrict links = self->links;
+    const tsk_size_t N = self->num_nodes + 1;
+    tsk_size_t u;
+
+    for (u = 0; u < N; u++) {
+        dest->parent[u] = links[u].parent;
+        dest->left_child[u] = links[u].left_child;
+        dest->right_child[u] = links[u].right_child;
+        dest->left_sib[u] = links[u].left_sib;
+        dest->right_sib[u] = links[u].right_sib;
+        dest->num_children[u] = links[u].num_children;
+        dest->edge[u] = links[u].edge;
+    }
+}
+
+int
+tsk_tree_update_arrays(tsk_tree_t *self)
+{
+    if (self->links_dirty) {
+        tsk_tree_copy_links_to_arrays(self, self);
+        self->links_dirty = false;
+    }
+    return 0;
+}
+
+/* Methods that read the parent, left_child, etc arrays directly can't be
+ * used while the interleaved links have changes that aren't in the arrays. */
+static int
+tsk_tree_check_arrays(const tsk_tree_t *self)
+{
+    int ret = 0;
+
+    if (self->links_dirty) {
+        ret = tsk_trace_error(TSK_ERR_UNSUPPORTED_OPERATION);
+    }
+    return ret;
+}
+
 static int TSK_WARN_UNUSED
 tsk_tree_reset_tracked_samples(tsk_tree_t *self)
 {
@@ -5996,6 +6921,10 @@ tsk_tree_set_tracked_samples(
     /* TODO This is not needed when the tree is new. We should use the
      * state machine to check and only reset the tracked samples when needed.
      */
+    ret = tsk_tree_update_arrays(self);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_tree_reset_tracked_samples(self);
     if (ret != 0) {
         goto out;
@@ -6042,6 +6971,10 @@ tsk_tree_track_descendant_samples(tsk_tree_t *self, tsk_id_t node)
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
+    ret = tsk_tree_update_arrays(self);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_tree_postorder_from(self, node, nodes, &num_nodes);
     if (ret != 0) {
         goto out;
@@ -6075,6 +7008,7 @@ tsk_tree_copy(const tsk_tree_t *self, tsk_tree_t *dest, tsk_flags_t options)
 {
     int ret = TSK_ERR_GENERIC;
     tsk_size_t N = self->num_nodes + 1;
+    tsk_size_t j;
 
     if (!(options & TSK_NO_INIT)) {
         ret = tsk_tree_init(dest, self->tree_sequence, options);
@@ -6104,6 +7038,21 @@ tsk_tree_copy(const tsk_tree_t *self, tsk_tree_t *dest, tsk_flags_t options)
     tsk_memcpy(dest->right_sib, self->right_sib, N * sizeof(*self->right_sib));
     tsk_memcpy(dest->num_children, self->num_children, N * sizeof(*self->num_children));
     tsk_memcpy(dest->edge, self->edge, N * sizeof(*self->edge));
+    if (self->links != NULL) {
+        tsk_tree_copy_links_to_arrays(self, dest);
+    }
+    if (dest->links != NULL) {
+        for (j = 0; j < N; j++) {
+            dest->links[j].parent = dest->parent[j];
+            dest->links[j].left_child = dest->left_child[j];
+            dest->links[j].right_child = dest->right_child[j];
+            dest->links[j].left_sib = dest->left_sib[j];
+            dest->links[j].right_sib = dest->right_sib[j];
+            dest->links[j].num_children = dest->num_children[j];
+            dest->links[j].edge = dest->edge[j];
+        }
+    }
+    dest->links_dirty = false;
     if (!(dest->options & TSK_NO_SAMPLE_COUNTS)) {
         if (self->options & TSK_NO_SAMPLE_COUNTS) {
             ret = tsk_trace_error(TSK_ERR_UNSUPPORTED_OPERATION);
@@ -6155,11 +7104,10 @@ tsk_tree_is_descendant(const tsk_tree_t *self, tsk_id_t u, tsk_id_t v)
 {
     bool ret = false;
     tsk_id_t w = u;
-    tsk_id_t *restrict parent = self->parent;
 
     if (tsk_tree_check_node(self, u) == 0 && tsk_tree_check_node(self, v) == 0) {
         while (w != v && w != TSK_NULL) {
-            w = parent[w];
+            w = tsk_tree_get_parent_unsafe(self, w);
         }
         ret = w == v;
     }
@@ -6171,7 +7119,6 @@ tsk_tree_get_mrca(const tsk_tree_t *self, tsk_id_t u, tsk_id_t v, tsk_id_t *mrca
 {
     int ret = 0;
     double tu, tv;
-    const tsk_id_t *restrict parent = self->parent;
     const double *restrict time = self->tree_sequence->tables->nodes.time;
 
     ret = tsk_tree_check_node(self, u);
@@ -6194,13 +7141,13 @@ tsk_tree_get_mrca(const tsk_tree_t *self, tsk_id_t u, tsk_id_t v, tsk_id_t *mrca
     tv = time[v];
     while (u != v) {
         if (tu < tv) {
-            u = parent[u];
+            u = tsk_tree_get_parent_unsafe(self, u);
             if (u == TSK_NULL) {
                 break;
             }
             tu = time[u];
         } else {
-            v = parent[v];
+            v = tsk_tree_get_parent_unsafe(self, v);
             if (v == TSK_NULL) {
                 break;
             }
@@ -6290,18 +7237,27 @@ tsk_tree_is_sample(const tsk_tree_t *self, tsk_id_t u)
 tsk_id_t
 tsk_tree_get_left_root(const tsk_tree_t *self)
 {
+    if (self->links != NULL) {
+        return self->links[self->virtual_root].left_child;
+    }
     return self->left_child[self->virtual_root];
 }
 
 tsk_id_t
 tsk_tree_get_right_root(const tsk_tree_t *self)
 {
+    if (self->links != NULL) {
+        return self->links[self->virtual_root].right_child;
+    }
     return self->right_child[self->virtual_root];
 }
 
 tsk_size_t
 tsk_tree_get_num_roots(const tsk_tree_t *self)
 {
+    if (self->links != NULL) {
+        return (tsk_size_t) self->links[self->virtual_root].num_children;
+    }
     return (tsk_size_t) self->num_children[self->virtual_root];
 }
 
@@ -6314,7 +7270,7 @@ tsk_tree_get_parent(const tsk_tree_t *self, tsk_id_t u, tsk_id_t *parent)
     if (ret != 0) {
         goto out;
     }
-    *parent = self->parent[u];
+    *parent = tsk_tree_get_parent_unsafe(self, u);
 out:
     return ret;
 }
@@ -6342,7 +7298,7 @@ static inline double
 tsk_tree_get_branch_length_unsafe(const tsk_tree_t *self, tsk_id_t u)
 {
     const double *times = self->tree_sequence->tables->nodes.time;
-    const tsk_id_t parent = self->parent[u];
+    const tsk_id_t parent = tsk_tree_get_parent_unsafe(self, u);
 
     return parent == TSK_NULL ? 0 : times[parent] - times[u];
 }
@@ -6399,9 +7355,25 @@ int TSK_WARN_UNUSED
 tsk_tree_get_sites(
     const tsk_tree_t *self, const tsk_site_t **sites, tsk_size_t *sites_length)
 {
+    int ret = 0;
+
     *sites = self->sites;
     *sites_length = self->sites_length;
-    return 0;
+    if (self->tree_sequence->lazy_sites != NULL) {
+        /* The sites are built on first use with TSK_TS_INIT_LAZY */
+        *sites = NULL;
+        if (self->index == TSK_NULL || self->sites_length == 0) {
+            *sites_length = 0;
+        } else {
+            ret = tsk_treeseq_require_sites(self->tree_sequence);
+            if (ret != 0) {
+                goto out;
+            }
+            *sites = self->tree_sequence->tree_sites[self->index];
+        }
+    }
+out:
+    return ret;
 }
 
 /* u must be a valid node in the tree. For internal use */
@@ -6409,13 +7381,13 @@ static int
 tsk_tree_get_depth_unsafe(const tsk_tree_t *self, tsk_id_t u)
 {
     tsk_id_t v;
-    const tsk_id_t *restrict parent = self->parent;
     int depth = 0;
 
     if (u == self->virtual_root) {
         return -1;
     }
-    for (v = parent[u]; v != TSK_NULL; v = parent[v]) {
+    for (v = tsk_tree_get_parent_unsafe(self, u); v != TSK_NULL;
+         v = tsk_tree_get_parent_unsafe(self, v)) {
         depth++;
     }
     return depth;
@@ -6451,9 +7423,10 @@ static void
 tsk_tree_check_state(const tsk_tree_t *self)
 {
     tsk_id_t u, v;
-    tsk_size_t j, num_samples;
+    tsk_size_t j, num_samples, num_sites;
     int err, c;
     tsk_site_t site;
+    const tsk_site_t *sites;
     tsk_id_t *children = tsk_malloc(self->num_nodes * sizeof(tsk_id_t));
     bool *is_root = tsk_calloc(self->num_nodes, sizeof(bool));
 
@@ -6494,8 +7467,10 @@ tsk_tree_check_state(const tsk_tree_t *self)
             tsk_bug_assert(v == children[c]);
         }
     }
-    for (j = 0; j < self->sites_length; j++) {
-        site = self->sites[j];
+    err = tsk_tree_get_sites(self, &sites, &num_sites);
+    tsk_bug_assert(err == 0);
+    for (j = 0; j < num_sites; j++) {
+        site = sites[j];
         tsk_bug_assert(self->interval.left <= site.position);
         tsk_bug_assert(site.position < self->interval.right);
     }
@@ -6529,8 +7504,10 @@ tsk_tree_check_state(const tsk_tree_t *self)
 void
 tsk_tree_print_state(const tsk_tree_t *self, FILE *out)
 {
-    tsk_size_t j;
+    int ret;
+    tsk_size_t j, num_sites;
     tsk_site_t site;
+    const tsk_site_t *sites;
 
     fprintf(out, "Tree state:\n");
     fprintf(out, "options = %d\n", self->options);
@@ -6561,8 +7538,10 @@ tsk_tree_print_state(const tsk_tree_t *self, FILE *out)
         fprintf(out, "\n");
     }
     fprintf(out, "sites = \n");
-    for (j = 0; j < self->sites_length; j++) {
-        site = self->sites[j];
+    ret = tsk_tree_get_sites(self, &sites, &num_sites);
+    tsk_bug_assert(ret == 0);
+    for (j = 0; j < num_sites; j++) {
+        site = sites[j];
         fprintf(out, "\t%lld\t%f\n", (long long) site.id, site.position);
     }
     tsk_tree_check_state(self);
@@ -6663,17 +7642,142 @@ tsk_tree_insert_branch(
     num_children[p]++;
 }
 
+/* The equivalents of the branch operations above for interleaved links */
+
+static inline void
+tsk_tree_links_remove_branch(tsk_tree_t *self, tsk_id_t p, tsk_id_t c)
+{
+    tsk_tree_links_t *restrict links = self->links;
+    tsk_id_t lsib = links[c].left_sib;
+    tsk_id_t rsib = links[c].right_sib;
+
+    if (lsib == TSK_NULL) {
+        links[p].left_child = rsib;
+    } else {
+        links[lsib].right_sib = rsib;
+    }
+    if (rsib == TSK_NULL) {
+        links[p].right_child = lsib;
+    } else {
+        links[rsib].left_sib = lsib;
+    }
+    links[c].parent = TSK_NULL;
+    links[c].left_sib = TSK_NULL;
+    links[c].right_sib = TSK_NULL;
+    links[p].num_children--;
+}
+
+static inline void
+tsk_tree_links_insert_branch(tsk_tree_t *self, tsk_id_t p, tsk_id_t c)
+{
+    tsk_tree_links_t *restrict links = self->links;
+    tsk_id_t u;
+
+    links[c].parent = p;
+    u = links[p].right_child;
+    if (u == TSK_NULL) {
+        links[p].left_child = c;
+    } else {
+        links[u].right_sib = c;
+    }
+    links[c].left_sib = u;
+    links[c].right_sib = TSK_NULL;
+    links[p].right_child = c;
+    links[p].num_children++;
+}
+
 static inline void
 tsk_tree_insert_root(tsk_tree_t *self, tsk_id_t root, tsk_id_t *restrict parent)
 {
-    tsk_tree_insert_branch(self, self->virtual_root, root, parent);
-    parent[root] = TSK_NULL;
+    if (self->links != NULL) {
+        tsk_tree_links_insert_branch(self, self->virtual_root, root);
+        self->links[root].parent = TSK_NULL;
+        self->links_dirty = true;
+    } else {
+        tsk_tree_insert_branch(self, self->virtual_root, root, parent);
+        parent[root] = TSK_NULL;
+    }
 }
 
 static inline void
 tsk_tree_remove_root(tsk_tree_t *self, tsk_id_t root, tsk_id_t *restrict parent)
 {
-    tsk_tree_remove_branch(self, self->virtual_root, root, parent);
+    if (self->links != NULL) {
+        tsk_tree_links_remove_branch(self, self->virtual_root, root);
+        self->links_dirty = true;
+    } else {
+        tsk_tree_remove_branch(self, self->virtual_root, root, parent);
+    }
+}
+
+static void
+tsk_tree_links_remove_edge(tsk_tree_t *self, tsk_id_t p, tsk_id_t c)
+{
+    tsk_tree_links_t *restrict links = self->links;
+    tsk_size_t *restrict num_samples = self->num_samples;
+    tsk_size_t *restrict num_tracked_samples = self->num_tracked_samples;
+    const tsk_size_t root_threshold = self->root_threshold;
+    tsk_id_t u;
+    tsk_id_t path_end = TSK_NULL;
+    bool path_end_was_root = false;
+
+    tsk_tree_links_remove_branch(self, p, c);
+    self->num_edges--;
+    links[c].edge = TSK_NULL;
+    self->links_dirty = true;
+
+    if (!(self->options & TSK_NO_SAMPLE_COUNTS)) {
+        u = p;
+        while (u != TSK_NULL) {
+            path_end = u;
+            path_end_was_root = num_samples[u] >= root_threshold;
+            num_samples[u] -= num_samples[c];
+            num_tracked_samples[u] -= num_tracked_samples[c];
+            u = links[u].parent;
+        }
+
+        if (path_end_was_root && num_samples[path_end] < root_threshold) {
+            tsk_tree_remove_root(self, path_end, NULL);
+        }
+        if (num_samples[c] >= root_threshold) {
+            tsk_tree_insert_root(self, c, NULL);
+        }
+    }
+}
+
+static void
+tsk_tree_links_insert_edge(tsk_tree_t *self, tsk_id_t p, tsk_id_t c, tsk_id_t edge_id)
+{
+    tsk_tree_links_t *restrict links = self->links;
+    tsk_size_t *restrict num_samples = self->num_samples;
+    tsk_size_t *restrict num_tracked_samples = self->num_tracked_samples;
+    const tsk_size_t root_threshold = self->root_threshold;
+    tsk_id_t u;
+    tsk_id_t path_end = TSK_NULL;
+    bool path_end_was_root = false;
+
+    if (!(self->options & TSK_NO_SAMPLE_COUNTS)) {
+        u = p;
+        while (u != TSK_NULL) {
+            path_end = u;
+            path_end_was_root = num_samples[u] >= root_threshold;
+            num_samples[u] += num_samples[c];
+            num_tracked_samples[u] += num_tracked_samples[c];
+            u = links[u].parent;
+        }
+
+        if (num_samples[c] >= root_threshold) {
+            tsk_tree_remove_root(self, c, NULL);
+        }
+        if (num_samples[path_end] >= root_threshold && !path_end_was_root) {
+            tsk_tree_insert_root(self, path_end, NULL);
+        }
+    }
+
+    tsk_tree_links_insert_branch(self, p, c);
+    self->num_edges++;
+    links[c].edge = edge_id;
+    self->links_dirty = true;
 }
 
 static void
@@ -6691,6 +7795,10 @@ tsk_tree_remove_edge(
 
 #define POTENTIAL_ROOT(U) (num_samples[U] >= root_threshold)
 
+    if (self->links != NULL) {
+        tsk_tree_links_remove_edge(self, p, c);
+        return;
+    }
     tsk_tree_remove_branch(self, p, c, parent);
     self->num_edges--;
     edge[c] = TSK_NULL;
@@ -6732,6 +7840,10 @@ tsk_tree_insert_edge(tsk_tree_t *self, tsk_id_t p, tsk_id_t c, tsk_id_t edge_id)
 
 #define POTENTIAL_ROOT(U) (num_samples[U] >= root_threshold)
 
+    if (self->links != NULL) {
+        tsk_tree_links_insert_edge(self, p, c, edge_id);
+        return;
+    }
     if (!(self->options & TSK_NO_SAMPLE_COUNTS)) {
         u = p;
         while (u != TSK_NULL) {
@@ -6797,7 +7909,10 @@ tsk_tree_update_index_and_interval(tsk_tree_t *self)
     self->interval.right = self->tree_pos.interval.right;
 
     if (tables->sites.num_rows > 0) {
-        self->sites = self->tree_sequence->tree_sites[self->index];
+        /* The sites are found by tsk_tree_get_sites if they are built lazily */
+        if (self->tree_sequence->lazy_sites == NULL) {
+            self->sites = self->tree_sequence->tree_sites[self->index];
+        }
         self->sites_length = self->tree_sequence->tree_sites_length[self->index];
     }
 }
@@ -7089,17 +8204,147 @@ tsk_tree_seek_skip(tsk_tree_t *self, double x)
     return ret;
 }
 
+/* Returns the number of edges in the insertion order with left <= x */
+static tsk_id_t
+tsk_tree_get_insertion_index(const tsk_tree_t *self, double x)
+{
+    const tsk_table_collection_t *tables = self->tree_sequence->tables;
+    const double *restrict edge_left = tables->edges.left;
+    const tsk_id_t *restrict insertion_order = tables->indexes.edge_insertion_order;
+    tsk_id_t lower = 0;
+    tsk_id_t upper = (tsk_id_t) tables->edges.num_rows;
+    tsk_id_t mid;
+
+    while (lower < upper) {
+        mid = lower + (upper - lower) / 2;
+        if (edge_left[insertion_order[mid]] <= x) {
+            lower = mid + 1;
+        } else {
+            upper = mid;
+        }
+    }
+    return lower;
+}
+
+/* Remove all edges from the current tree. Every edge in tree j is either in
+ * the checkpoint before j or was inserted between the checkpoint and j, so
+ * we only need to look at these edges. */
+static void
+tsk_tree_remove_all_edges(tsk_tree_t *self)
+{
+    const tsk_table_collection_t *tables = self->tree_sequence->tables;
+    const tsk_tree_checkpoints_t *checkpoints = &self->tree_sequence->checkpoints;
+    const tsk_id_t *restrict edge_parent = tables->edges.parent;
+    const tsk_id_t *restrict edge_child = tables->edges.child;
+    const tsk_id_t *restrict insertion_order = tables->indexes.edge_insertion_order;
+    const tsk_size_t j = (tsk_size_t) self->index / checkpoints->interval;
+    const tsk_id_t stop = tsk_tree_get_insertion_index(self, self->interval.left);
+    tsk_size_t k;
+    tsk_id_t e, c, l;
+
+    for (k = checkpoints->edges_offset[j]; k < checkpoints->edges_offset[j + 1]; k++) {
+        e = checkpoints->edges[k];
+        c = edge_child[e];
+        if ((self->links != NULL ? self->links[c].edge : self->edge[c]) == e) {
+            tsk_tree_remove_edge(self, edge_parent[e], c, e);
+        }
+    }
+    for (l = checkpoints->insertion_index[j]; l < stop; l++) {
+        e = insertion_order[l];
+        c = edge_child[e];
+        if ((self->links != NULL ? self->links[c].edge : self->edge[c]) == e) {
+            tsk_tree_remove_edge(self, edge_parent[e], c, e);
+        }
+    }
+    tsk_bug_assert(self->num_edges == 0);
+}
+
+static int TSK_WARN_UNUSED
+tsk_tree_seek_from_checkpoint(tsk_tree_t *self, tsk_id_t index)
+{
+    int ret = 0;
+    const tsk_table_collection_t *tables = self->tree_sequence->tables;
+    const tsk_tree_checkpoints_t *checkpoints = &self->tree_sequence->checkpoints;
+    const double *restrict breakpoints = self->tree_sequence->breakpoints;
+    const tsk_id_t *restrict edge_parent = tables->edges.parent;
+    const tsk_id_t *restrict edge_child = tables->edges.child;
+    const tsk_id_t interval = (tsk_id_t) checkpoints->interval;
+    tsk_id_t j = index / interval;
+    tsk_size_t k;
+    tsk_id_t e;
+    tsk_tree_position_t *tree_pos = &self->tree_pos;
+
+    /* Move backwards from the next checkpoint if it is closer */
+    if (index - j * interval > interval / 2
+        && j + 1 < (tsk_id_t) checkpoints->num_checkpoints) {
+        j++;
+    }
+    if (self->index != -1) {
+        tsk_tree_remove_all_edges(self);
+    }
+
+    /* Put the tree position into the state that moving forward to the
+     * checkpoint tree would leave it in. */
+    tree_pos->index = j * interval;
+    tree_pos->interval.left = breakpoints[tree_pos->index];
+    tree_pos->interval.right = breakpoints[tree_pos->index + 1];
+    tree_pos->direction = TSK_DIR_FORWARD;
+    tree_pos->in.order = tables->indexes.edge_insertion_order;
+    tree_pos->in.start = checkpoints->insertion_index[j];
+    tree_pos->in.stop = checkpoints->insertion_index[j];
+    tree_pos->out.order = tables->indexes.edge_removal_order;
+    tree_pos->out.start = checkpoints->removal_index[j];
+    tree_pos->out.stop = checkpoints->removal_index[j];
+    for (k = checkpoints->edges_offset[j]; k < checkpoints->edges_offset[j + 1]; k++) {
+        e = checkpoints->edges[k];
+        tsk_tree_insert_edge(self, edge_parent[e], edge_child[e], e);
+    }
+    tsk_tree_update_index_and_interval(self);
+
+    while (self->index < index) {
+        ret = tsk_tree_next(self);
+        if (ret < 0) {
+            goto out;
+        }
+    }
+    while (self->index > index) {
+        ret = tsk_tree_prev(self);
+        if (ret < 0) {
+            goto out;
+        }
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
 int TSK_WARN_UNUSED
 tsk_tree_seek(tsk_tree_t *self, double x, tsk_flags_t options)
 {
     int ret = 0;
     const double L = tsk_treeseq_get_sequence_length(self->tree_sequence);
+    const tsk_tree_checkpoints_t *checkpoints = &self->tree_sequence->checkpoints;
+    const tsk_size_t num_trees = self->tree_sequence->num_trees;
+    const double *restrict breakpoints = self->tree_sequence->breakpoints;
+    tsk_id_t index, distance;
 
     if (x < 0 || x >= L) {
         ret = tsk_trace_error(TSK_ERR_SEEK_OUT_OF_BOUNDS);
         goto out;
     }
 
+    if (checkpoints->num_checkpoints > 0 && !tsk_tree_position_in_interval(self, x)) {
+        index = (tsk_id_t) tsk_search_sorted(breakpoints, num_trees + 1, x);
+        if (breakpoints[index] > x) {
+            index--;
+        }
+        distance = index > self->index ? index - self->index : self->index - index;
+        if (self->index == -1 || (tsk_size_t) distance > checkpoints->interval) {
+            ret = tsk_tree_seek_from_checkpoint(self, index);
+            goto out;
+        }
+    }
+
     if (self->index == -1) {
         ret = tsk_tree_seek_from_null(self, x, options);
     } else {
@@ -7114,6 +8359,130 @@ out:
     return ret;
 }
 
+typedef struct {
+    const tsk_treeseq_t *tree_sequence;
+    int (*callback)(tsk_tree_t *, tsk_size_t, void *);
+    void *callback_arg;
+    tsk_flags_t options;
+    tsk_size_t num_workers;
+    int *ret;
+    /* Trees after the first tree at which a worker failed can be skipped.
+     * Protected by mutex. */
+    tsk_id_t stop_index;
+    tsk_mutex_t *mutex;
+} tree_iterator_t;
+
+static bool
+tree_iterator_should_stop(tree_iterator_t *self, tsk_id_t index)
+{
+    bool stop;
+
+    tsk_mutex_lock(self->mutex);
+    stop = index > self->stop_index;
+    tsk_mutex_unlock(self->mutex);
+    return stop;
+}
+
+static int
+tree_iterator_run_chunk(tree_iterator_t *self, tsk_size_t j)
+{
+    int ret = 0;
+    const tsk_size_t num_trees = self->tree_sequence->num_trees;
+    const tsk_id_t start = (tsk_id_t) (num_trees * j / self->num_workers);
+    const tsk_id_t stop = (tsk_id_t) (num_trees * (j + 1) / self->num_workers);
+    tsk_id_t index = start;
+    tsk_tree_t tree;
+
+    ret = tsk_tree_init(&tree, self->tree_sequence, self->options);
+    if (ret != 0) {
+        goto out;
+    }
+    /* Seek once to the start of the chunk and then move incrementally */
+    ret = tsk_tree_seek_index(&tree, start, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    for (index = start; index < stop; index++) {
+        if (tree_iterator_should_stop(self, index)) {
+            break;
+        }
+        ret = self->callback(&tree, j, self->callback_arg);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_tree_next(&tree);
+        if (ret < 0) {
+            goto out;
+        }
+    }
+    ret = 0;
+out:
+    if (ret != 0) {
+        tsk_mutex_lock(self->mutex);
+        self->stop_index = TSK_MIN(self->stop_index, index);
+        tsk_mutex_unlock(self->mutex);
+    }
+    tsk_tree_free(&tree);
+    return ret;
+}
+
+static void
+tree_iterator_worker(void *arg, tsk_size_t j)
+{
+    tree_iterator_t *self = (tree_iterator_t *) arg;
+
+    self->ret[j] = tree_iterator_run_chunk(self, j);
+}
+
+int TSK_WARN_UNUSED
+tsk_treeseq_for_each_tree_parallel(const tsk_treeseq_t *self,
+    int (*callback)(tsk_tree_t *tree, tsk_size_t thread_id, void *arg),
+    void *callback_arg, tsk_flags_t options, tsk_size_t num_threads)
+{
+    int ret = 0;
+    tsk_size_t j;
+    tree_iterator_t iterator;
+
+    tsk_memset(&iterator, 0, sizeof(iterator));
+    if (callback == NULL) {
+        ret = tsk_trace_error(TSK_ERR_BAD_PARAM_VALUE);
+        goto out;
+    }
+    iterator.tree_sequence = self;
+    iterator.callback = callback;
+    iterator.callback_arg = callback_arg;
+    iterator.options = options;
+    iterator.stop_index = (tsk_id_t) self->num_trees;
+    /* Every worker gets at least one tree */
+    iterator.num_workers = TSK_MAX(1, TSK_MIN(num_threads, self->num_trees));
+    iterator.ret = tsk_calloc(iterator.num_workers, sizeof(*iterator.ret));
+    if (iterator.ret == NULL) {
+        ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
+        goto out;
+    }
+    ret = tsk_mutex_init(&iterator.mutex);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_thread_run_parallel(iterator.num_workers, tree_iterator_worker, &iterator);
+    if (ret != 0) {
+        goto out;
+    }
+    /* Chunks are in tree order, so this is the error at the first failed tree */
+    for (j = 0; j < iterator.num_workers; j++) {
+        if (iterator.ret[j] != 0) {
+            ret = iterator.ret[j];
+            goto out;
+        }
+    }
+out:
+    if (iterator.mutex != NULL) {
+        tsk_mutex_free(iterator.mutex);
+    }
+    tsk_safe_free(iterator.ret);
+    return ret;
+}
+
 int TSK_WARN_UNUSED
 tsk_tree_clear(tsk_tree_t *self)
 {
@@ -7141,6 +8510,13 @@ tsk_tree_clear(tsk_tree_t *self)
     tsk_memset(self->right_sib, 0xff, N * sizeof(*self->right_sib));
     tsk_memset(self->num_children, 0, N * sizeof(*self->num_children));
     tsk_memset(self->edge, 0xff, N * sizeof(*self->edge));
+    if (self->links != NULL) {
+        tsk_memset(self->links, 0xff, N * sizeof(*self->links));
+        for (j = 0; j < N; j++) {
+            self->links[j].num_children = 0;
+        }
+    }
+    self->links_dirty = false;
 
     if (sample_counts) {
         tsk_memset(self->num_samples, 0, N * sizeof(*self->num_samples));
@@ -7238,6 +8614,10 @@ tsk_tree_preorder_from(
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
+    ret = tsk_tree_check_arrays(self);
+    if (ret != 0) {
+        goto out;
+    }
 
     if ((root == -1 || root == self->virtual_root)
         && !tsk_tree_has_sample_counts(self)) {
@@ -7296,6 +8676,10 @@ tsk_tree_preorder_samples_from(
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
+    ret = tsk_tree_check_arrays(self);
+    if (ret != 0) {
+        goto out;
+    }
 
     /* We could push the virtual_root onto the stack directly to simplify
      * the code a little, but then we'd have to check put an extra check
@@ -7361,6 +8745,10 @@ tsk_tree_postorder_from(
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
+    ret = tsk_tree_check_arrays(self);
+    if (ret != 0) {
+        goto out;
+    }
 
     if (root == -1 || is_virtual_root) {
         if (!tsk_tree_has_sample_counts(self)) {
@@ -7435,6 +8823,10 @@ tsk_tree_sackin_index(const tsk_tree_t *self, tsk_size_t *result)
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
+    ret = tsk_tree_check_arrays(self);
+    if (ret != 0) {
+        goto out;
+    }
 
     stack_top = -1;
     for (u = right_child[self->virtual_root]; u != TSK_NULL; u = left_sib[u]) {
@@ -7584,6 +8976,10 @@ tsk_tree_b2_index(const tsk_tree_t *self, double base, double *result)
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
+    ret = tsk_tree_check_arrays(self);
+    if (ret != 0) {
+        goto out;
+    }
     if (tsk_tree_get_num_roots(self) != 1) {
         ret = tsk_trace_error(TSK_ERR_UNDEFINED_MULTIROOT);
         goto out;
@@ -7635,6 +9031,10 @@ tsk_tree_num_lineages(const tsk_tree_t *self, double t, tsk_size_t *result)
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
+    ret = tsk_tree_check_arrays(self);
+    if (ret != 0) {
+        goto out;
+    }
     if (!tsk_isfinite(t)) {
         ret = tsk_trace_error(TSK_ERR_TIME_NONFINITE);
         goto out;
@@ -7754,6 +9154,10 @@ tsk_tree_map_mutations(tsk_tree_t *self, int32_t *genotypes,
         ret = tsk_trace_error(TSK_ERR_NO_MEMORY);
         goto out;
     }
+    ret = tsk_tree_check_arrays(self);
+    if (ret != 0) {
+        goto out;
+    }
     for (j = 0; j < num_samples; j++) {
         if (genotypes[j] >= HARTIGAN_MAX_ALLELES || genotypes[j] < TSK_MISSING_DATA) {
             ret = tsk_trace_error(TSK_ERR_BAD_GENOTYPE);
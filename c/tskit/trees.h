@@ -39,10 +39,11 @@ extern "C" {
 // clang-format off
 
 /*
- * These are both undocumented options for tsk_tree_init
+ * These are undocumented options for tsk_tree_init
  */
 #define TSK_SAMPLE_LISTS            (1 << 1)
 #define TSK_NO_SAMPLE_COUNTS        (1 << 2)
+#define TSK_INTERLEAVED_LINKS       (1 << 3)
 
 #define TSK_STAT_SITE               (1 << 0)
 #define TSK_STAT_BRANCH             (1 << 1)
@@ -76,10 +77,34 @@ If specified, mutation parents in the table collection will be overwritten
 with those computed from the topology when the tree sequence is initialised.
 */
 #define TSK_TS_INIT_COMPUTE_MUTATION_PARENTS (1 << 1)
+/**
+If specified, the site and mutation structs returned by
+:c:func:`tsk_treeseq_get_site` and :c:func:`tsk_tree_get_sites` are not
+built when the tree sequence is initialised, but on first use.
+*/
+#define TSK_TS_INIT_LAZY (1 << 2)
 /** @} */
 
 // clang-format on
 
+/* Snapshots of the trees at regular intervals, built by
+ * tsk_treeseq_build_checkpoints. The edges of tree j * interval are
+ * edges[edges_offset[j]:edges_offset[j + 1]], in insertion order, and
+ * insertion_index[j] and removal_index[j] are the numbers of edges in the
+ * insertion and removal orders that come before this tree. */
+typedef struct {
+    tsk_size_t interval;
+    tsk_size_t num_checkpoints;
+    tsk_size_t *edges_offset;
+    tsk_id_t *edges;
+    tsk_id_t *insertion_index;
+    tsk_id_t *removal_index;
+} tsk_tree_checkpoints_t;
+
+/* Private state used to build the site and mutation structs of a tree
+ * sequence initialised with TSK_TS_INIT_LAZY. */
+typedef struct _tsk_treeseq_lazy_sites_t tsk_treeseq_lazy_sites_t;
+
 /**
 @brief The tree sequence object.
 */
@@ -116,8 +141,35 @@ typedef struct {
      *  collection must be treated as read-only, and any changes to it will
      *  lead to undefined behaviour. */
     tsk_table_collection_t *tables;
+    /* Private; do the stored indexes adopted on load point into the memory
+     * mapped store of the tables? */
+    bool mapped_indexes;
+    /* Private; optional checkpoints used to seek trees */
+    tsk_tree_checkpoints_t checkpoints;
+    /* Private; with TSK_TS_INIT_LAZY, the edge above each mutation, and the
+     * state used to build the site and mutation structs on first use */
+    tsk_id_t *mutation_edge;
+    tsk_treeseq_lazy_sites_t *lazy_sites;
 } tsk_treeseq_t;
 
+/**
+@brief Loads a tree sequence from a file on a background thread.
+
+@rst
+See :c:func:`tsk_treeseq_loader_init` for details.
+@endrst
+*/
+typedef struct {
+    /* Private */
+    tsk_treeseq_t *tree_sequence;
+    char *filename;
+    tsk_flags_t options;
+    void (*callback)(tsk_treeseq_t *tree_sequence, int ret, void *arg);
+    void *callback_arg;
+    int ret;
+    tsk_thread_t *thread;
+} tsk_treeseq_loader_t;
+
 typedef struct {
     tsk_id_t index;
     struct {
@@ -140,6 +192,19 @@ typedef struct {
     const tsk_treeseq_t *tree_sequence;
 } tsk_tree_position_t;
 
+/* The links of a single node in a tree initialised with TSK_INTERLEAVED_LINKS,
+ * packed into one 32 byte record. */
+typedef struct {
+    tsk_id_t parent;
+    tsk_id_t left_child;
+    tsk_id_t right_child;
+    tsk_id_t left_sib;
+    tsk_id_t right_sib;
+    tsk_id_t num_children;
+    tsk_id_t edge;
+    tsk_id_t unused;
+} tsk_tree_links_t;
+
 /**
 @brief A single tree in a tree sequence.
 
@@ -278,9 +343,16 @@ typedef struct {
     tsk_id_t *left_sample;
     tsk_id_t *right_sample;
     tsk_id_t *next_sample;
-    /* The sites on this tree */
+    /* The sites on this tree; NULL if the tree sequence was initialised with
+     * TSK_TS_INIT_LAZY */
     const tsk_site_t *sites;
     tsk_size_t sites_length;
+    /* If TSK_INTERLEAVED_LINKS is specified, the tree transitions update these
+     * records rather than the parent, left_child, etc arrays above, which
+     * are only brought up to date by tsk_tree_update_arrays. */
+    tsk_tree_links_t *links;
+    /* True if the links have changed since the arrays were last updated */
+    bool links_dirty;
     /* Counters needed for next() and prev() transformations. */
     int direction;
     tsk_id_t left_index;
@@ -311,9 +383,19 @@ are initialised and freed.
 If specified, TSK_TAKE_OWNERSHIP takes immediate ownership of the tables, regardless
 of error conditions.
 
+If the :c:macro:`TSK_TS_INIT_LAZY` option is specified, the site and
+mutation structs, which hold a copy of every row of the site and mutation
+tables, are only built when first needed by :c:func:`tsk_treeseq_get_site`,
+:c:func:`tsk_tree_get_sites` or the site statistics. Until then, only the
+edge above each mutation is stored. This saves memory when only the
+topology of the trees is used. With this option the ``sites`` field of a
+:c:type:`tsk_tree_t` is NULL, and :c:func:`tsk_tree_get_sites` must be used
+to get the sites on the tree.
+
 **Options**
 
 - :c:macro:`TSK_TS_INIT_BUILD_INDEXES`
+- :c:macro:`TSK_TS_INIT_LAZY`
 - :c:macro:`TSK_TAKE_OWNERSHIP` (applies to the table collection).
 @endrst
 
@@ -325,6 +407,31 @@ of error conditions.
 int tsk_treeseq_init(
     tsk_treeseq_t *self, tsk_table_collection_t *tables, tsk_flags_t options);
 
+/**
+@brief Initialises the tree sequence using multiple threads.
+
+@rst
+Initialises the tree sequence in the same way as :c:func:`tsk_treeseq_init`.
+The indexes are built and the integrity of the tables checked using
+:c:func:`tsk_table_collection_build_index_parallel` and
+:c:func:`tsk_table_collection_check_integrity_parallel`. The pass over the
+edges that finds the breakpoints and the phases that depend only on the
+nodes, individuals, mutations and migrations are then run concurrently, after
+which the sites and mutations are filled in by blocks of sites on each
+thread. Threads are only used on POSIX systems; otherwise, or if
+``num_threads`` is less than 2, this is equivalent to
+:c:func:`tsk_treeseq_init`.
+@endrst
+
+@param self A pointer to an uninitialised tsk_treeseq_t object.
+@param tables A pointer to a tsk_table_collection_t object.
+@param options Allocation time options, as for :c:func:`tsk_treeseq_init`.
+@param num_threads The maximum number of threads to use.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_treeseq_init_parallel(tsk_treeseq_t *self, tsk_table_collection_t *tables,
+    tsk_flags_t options, tsk_size_t num_threads);
+
 /**
 @brief Load a tree sequence from a file path.
 
@@ -337,6 +444,21 @@ The resources allocated must be freed using
 Works similarly to :c:func:`tsk_table_collection_load` please see
 that function's documentation for details and options.
 
+If the :c:macro:`TSK_LOAD_TREESEQ_INDEXES` option is specified and the file
+was written by :c:func:`tsk_treeseq_dump` with the
+:c:macro:`TSK_DUMP_TREESEQ_INDEXES` option, the stored breakpoints, sample
+maps, per-tree site counts, mutation edges and individual nodes are adopted
+rather than recomputed, avoiding the pass over the edges. When combined with
+:c:macro:`TSK_LOAD_MMAP` these arrays refer directly to the file's contents.
+The stored indexes are ignored if the tables in the file were written
+separately from them. As the integrity of the tables is not checked when
+the indexes are adopted, this option should only be used with files from a
+trusted source.
+
+If the :c:macro:`TSK_LOAD_LAZY` option is specified, the tree sequence is
+initialised as with the :c:macro:`TSK_TS_INIT_LAZY` option to
+:c:func:`tsk_treeseq_init`.
+
 **Examples**
 
 .. code-block:: c
@@ -380,11 +502,135 @@ see that function's documentation for details and options.
 */
 int tsk_treeseq_loadf(tsk_treeseq_t *self, FILE *file, tsk_flags_t options);
 
+/**
+@brief Start loading a tree sequence from a file path on a background thread.
+
+@rst
+Starts loading the specified file into the specified tree sequence, as
+:c:func:`tsk_treeseq_load` would, on a new thread. Both reading the file
+and initialising the tree sequence happen on the background thread, so
+that the calling thread is free to work on other tree sequences in the
+meantime. The load options are the same as for :c:func:`tsk_treeseq_load`.
+
+The tree sequence must not be accessed until the load has completed, which
+can be checked without blocking using :c:func:`tsk_treeseq_loader_poll`,
+or waited for using :c:func:`tsk_treeseq_loader_wait`, which returns the
+result of the load. If ``callback`` is not NULL it is called on the
+background thread once the load has completed, with the tree sequence,
+the result of the load and ``callback_arg`` as arguments. Whatever the
+result, the tree sequence must be freed using :c:func:`tsk_treeseq_free`
+once the load has completed, and the loader must be freed using
+:c:func:`tsk_treeseq_loader_free`, even in error conditions.
+
+On platforms where threads are not supported the load is performed
+before this function returns.
+
+**Examples**
+
+.. code-block:: c
+
+    int ret;
+    tsk_treeseq_t ts;
+    tsk_treeseq_loader_t loader;
+
+    ret = tsk_treeseq_loader_init(&loader, &ts, "data.trees", NULL, NULL, 0);
+    if (ret == 0) {
+        // Do other work here
+        ret = tsk_treeseq_loader_wait(&loader);
+    }
+    tsk_treeseq_loader_free(&loader);
+    if (ret != 0) {
+        fprintf(stderr, "Load error:%s\n", tsk_strerror(ret));
+        exit(EXIT_FAILURE);
+    }
+
+@endrst
+
+@param self A pointer to an uninitialised tsk_treeseq_loader_t object.
+@param tree_sequence A pointer to an uninitialised tsk_treeseq_t object.
+@param filename A NULL terminated string containing the filename.
+@param callback A function to call when the load completes, or NULL.
+@param callback_arg The last argument to the callback function.
+@param options Bitwise options. See :c:func:`tsk_treeseq_load`.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_treeseq_loader_init(tsk_treeseq_loader_t *self, tsk_treeseq_t *tree_sequence,
+    const char *filename, void (*callback)(tsk_treeseq_t *, int, void *),
+    void *callback_arg, tsk_flags_t options);
+
+/**
+@brief Check whether a background load has completed.
+
+@param self A pointer to an initialised tsk_treeseq_loader_t object.
+@return Return true if the load has completed, so that
+    :c:func:`tsk_treeseq_loader_wait` will not block.
+*/
+bool tsk_treeseq_loader_poll(tsk_treeseq_loader_t *self);
+
+/**
+@brief Wait for a background load to complete.
+
+@param self A pointer to an initialised tsk_treeseq_loader_t object.
+@return Return 0 if the tree sequence was loaded successfully or the
+    negative error value returned by the load.
+*/
+int tsk_treeseq_loader_wait(tsk_treeseq_loader_t *self);
+
+/**
+@brief Free the internal memory for the specified loader.
+
+@rst
+Waits for the load to complete if it is still in progress. The loaded tree
+sequence is not freed.
+@endrst
+
+@param self A pointer to an initialised tsk_treeseq_loader_t object.
+@return Always returns 0.
+*/
+int tsk_treeseq_loader_free(tsk_treeseq_loader_t *self);
+
+/**
+@brief Build an index of tree checkpoints to speed up random seeks.
+
+@rst
+Stores the edges of every ``k``-th tree in the tree sequence. A tree seeking
+with :c:func:`tsk_tree_seek` or :c:func:`tsk_tree_seek_index` to a tree more
+than ``k`` trees away from its current position removes its current edges,
+inserts the edges of the nearest checkpoint and then moves at most ``k / 2``
+trees to the target. The cost of such a seek depends on the sizes of the
+trees and ``k`` rather than on the distance moved. Trees reached this way
+represent the same topology as those reached by other seeks, but the
+left-to-right order of children and roots may differ.
+
+The interval ``k`` is the smallest value of the form ``interval * 2^i``
+for which the checkpoints use at most ``max_memory`` bytes. If
+``max_memory`` is 0, ``k = interval``. If even a single checkpoint does
+not fit in ``max_memory`` bytes, an error is returned. Any existing
+checkpoints are replaced.
+
+The checkpoints must be built before any trees use this tree sequence,
+as they change the behaviour of seeks.
+@endrst
+
+@param self A pointer to an initialised tsk_treeseq_t object.
+@param interval The minimum number of trees between checkpoints.
+@param max_memory The maximum number of bytes to use for the checkpoints,
+    or 0 for no limit.
+@param options Bitwise options. Currently unused; should be set to zero to
+    ensure compatibility with later versions of tskit.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_treeseq_build_checkpoints(tsk_treeseq_t *self, tsk_size_t interval,
+    tsk_size_t max_memory, tsk_flags_t options);
+
 /**
 @brief Write a tree sequence to file.
 
 @rst
-Writes the data from this tree sequence to the specified file.
+Writes the data from this tree sequence to the specified file. If the
+:c:macro:`TSK_DUMP_TREESEQ_INDEXES` option is specified the indexes computed
+when the tree sequence was initialised are also stored, so that they can
+be adopted when loading; see :c:func:`tsk_treeseq_load`.
 
 If an error occurs the file path is deleted, ensuring that only complete
 and well formed files will be written.
@@ -392,8 +638,7 @@ and well formed files will be written.
 
 @param self A pointer to an initialised tsk_treeseq_t object.
 @param filename A NULL terminated string containing the filename.
-@param options Bitwise options. Currently unused; should be
-    set to zero to ensure compatibility with later versions of tskit.
+@param options Bitwise options. See :c:func:`tsk_table_collection_dump`.
 @return Return 0 on success or a negative value on failure.
 */
 int tsk_treeseq_dump(
@@ -413,8 +658,7 @@ of how to sequentially dump and load tree sequences from a stream.
 @param self A pointer to an initialised tsk_treeseq_t object.
 @param file A FILE stream opened in an appropriate mode for writing (e.g.
     "w", "a", "r+" or "w+").
-@param options Bitwise options. Currently unused; should be
-    set to zero to ensure compatibility with later versions of tskit.
+@param options Bitwise options. See :c:func:`tsk_table_collection_dump`.
 @return Return 0 on success or a negative value on failure.
 */
 int tsk_treeseq_dumpf(const tsk_treeseq_t *self, FILE *file, tsk_flags_t options);
@@ -1502,6 +1746,43 @@ tree sequence whose index is ``0 <= tree < num_trees``.
 */
 int tsk_tree_seek_index(tsk_tree_t *self, tsk_id_t tree, tsk_flags_t options);
 
+/**
+@brief Call a function for every tree in a tree sequence using multiple threads.
+
+@rst
+Splits the trees of the tree sequence into ``num_threads`` contiguous chunks
+of roughly equal numbers of trees, and iterates over each chunk on its own
+thread. Each thread initialises its own tree using the tree ``options``,
+seeks to the first tree of its chunk using :c:func:`tsk_tree_seek_index`
+and then moves along the chunk using :c:func:`tsk_tree_next`. For each
+tree, ``callback(tree, thread_id, callback_arg)`` is called, where
+``thread_id`` is the index of the chunk (``0 <= thread_id < num_threads``)
+and can be used to index per-thread state. Within a thread, trees are
+visited in increasing order of index. The callbacks on different threads
+run concurrently, so any state they share must be synchronised, and
+the callback must not change the position of the tree it is given.
+
+If the callback returns a non-zero value, iteration stops and this
+value is returned. When several trees fail, the value for the tree with
+the lowest index is returned. Trees after this are not guaranteed to
+be visited.
+
+If ``num_threads`` is less than 2, or threads are not supported on this
+platform, the trees are visited in order on the calling thread.
+@endrst
+
+@param self A pointer to an initialised tsk_treeseq_t object.
+@param callback The function to call for each tree.
+@param callback_arg The last argument to the callback function.
+@param options Options passed to :c:func:`tsk_tree_init`.
+@param num_threads The maximum number of threads to use.
+@return Return 0 on success, the non-zero value returned by the callback,
+    or a negative value on failure.
+*/
+int tsk_treeseq_for_each_tree_parallel(const tsk_treeseq_t *self,
+    int (*callback)(tsk_tree_t *tree, tsk_size_t thread_id, void *arg),
+    void *callback_arg, tsk_flags_t options, tsk_size_t num_threads);
+
 /** @} */
 
 /**
@@ -1578,7 +1859,9 @@ The memory pointed to by the ``sites`` parameter is managed by the
         }
     }
 
-This is a constant time operation.
+This is a constant time operation, except on the first call for a tree
+sequence initialised with :c:macro:`TSK_TS_INIT_LAZY`, when the sites of
+the tree sequence are built.
 
 @endrst
 
@@ -1968,6 +2251,15 @@ int tsk_tree_set_tracked_samples(
     tsk_tree_t *self, tsk_size_t num_tracked_samples, const tsk_id_t *tracked_samples);
 int tsk_tree_track_descendant_samples(tsk_tree_t *self, tsk_id_t node);
 
+/* Copy the interleaved links of a tree initialised with TSK_INTERLEAVED_LINKS
+ * into the parent, left_child, right_child, left_sib, right_sib, num_children
+ * and edge arrays, if they have changed since the last call. The parent and
+ * root getters, get_mrca, get_depth, get_branch_length and is_descendant read
+ * the links directly. Other methods that read the arrays return
+ * TSK_ERR_UNSUPPORTED_OPERATION until this has been called. Has no effect on
+ * other trees. */
+int tsk_tree_update_arrays(tsk_tree_t *self);
+
 typedef struct {
     tsk_id_t node;
     tsk_id_t parent;
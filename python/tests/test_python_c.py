@@ -5073,7 +5073,7 @@ class TestModuleFunctions:
 
     def test_kastore_version(self):
         version = _tskit.get_kastore_version()
-        assert version == (2, 1, 2)
+        assert version == (3, 0, 0)
 
     def test_tskit_version(self):
         version = _tskit.get_tskit_version()